@@ -0,0 +1,48 @@
+// Tests that $out loads enough documents to need several insert batches into a collection with
+// secondary indexes, and that the indexes it builds after loading the documents are enforced.
+(function() {
+    "use strict";
+
+    load("jstests/aggregation/extras/utils.js");  // For arrayEq.
+
+    const coll = db.out_parallel_insert_source;
+    const target = db.out_parallel_insert_target;
+    coll.drop();
+    target.drop();
+
+    // Each batch of inserts is limited to 16MB, so this is three batches.
+    const padding = "x".repeat(100 * 1024);
+    const numDocs = 400;
+    let bulk = coll.initializeUnorderedBulkOp();
+    for (let i = 0; i < numDocs; ++i) {
+        bulk.insert({_id: i, a: i, b: i % 10, padding: padding});
+    }
+    assert.writeOK(bulk.execute());
+
+    assert.commandWorked(target.createIndex({a: 1}, {unique: true}));
+    assert.commandWorked(target.createIndex({b: 1, a: -1}));
+    assert.writeOK(target.insert({_id: "original", a: -1}));
+    const originalIndexes = target.getIndexes();
+
+    coll.aggregate([{$out: target.getName()}]);
+    assert.eq(numDocs, target.find().itcount());
+    assert.eq(0, target.find({_id: "original"}).itcount());
+    assert.eq(numDocs / 10, target.find({b: 3}).hint({b: 1, a: -1}).itcount());
+    assert.eq(1, target.find({a: 300}).hint({a: 1}).itcount());
+    assert(arrayEq(originalIndexes, target.getIndexes()), tojson(target.getIndexes()));
+
+    // A duplicate key in the unique index fails the $out and leaves the target collection as it
+    // was.
+    assert.commandFailed(db.runCommand({
+        aggregate: coll.getName(),
+        pipeline: [{$project: {a: {$mod: ["$a", 200]}}}, {$out: target.getName()}],
+        cursor: {}
+    }));
+    assert.eq(numDocs, target.find().itcount());
+    assert(arrayEq(originalIndexes, target.getIndexes()), tojson(target.getIndexes()));
+
+    // No temporary collections are left behind.
+    assert.eq(0,
+              db.getCollectionInfos({name: {$regex: "^tmp\\.agg_out\\."}}).length,
+              tojson(db.getCollectionInfos()));
+}());
@@ -0,0 +1,74 @@
+// Tests that $window computes the same running and sliding aggregates as the equivalent $group,
+// $push and $unwind pipeline, and that windows do not cross partition boundaries.
+(function() {
+    "use strict";
+
+    load("jstests/aggregation/extras/utils.js");  // For assertErrorCode.
+
+    const coll = db.window_running_and_sliding_aggregates;
+    coll.drop();
+
+    const numPartitions = 5;
+    const docsPerPartition = 40;
+    let bulk = coll.initializeUnorderedBulkOp();
+    for (let p = 0; p < numPartitions; ++p) {
+        for (let t = 0; t < docsPerPartition; ++t) {
+            bulk.insert({_id: p * docsPerPartition + t, p: p, t: t, x: (t * 7 + p) % 13});
+        }
+    }
+    assert.writeOK(bulk.execute());
+
+    const windowed = coll.aggregate([
+                             {$sort: {p: 1, t: 1}},
+                             {
+                               $window: {
+                                   partitionBy: "$p",
+                                   output: {
+                                       total: {$sum: "$x"},
+                                       movingAvg: {$avg: "$x", window: {documents: [-2, 0]}},
+                                       next: {$max: "$x", window: {documents: [1, 1]}}
+                                   }
+                               }
+                             }
+                         ])
+                         .toArray();
+    assert.eq(numPartitions * docsPerPartition, windowed.length);
+
+    // The running total per partition, computed by collecting each partition into an array.
+    const expectedTotals = coll.aggregate([
+                                   {$sort: {p: 1, t: 1}},
+                                   {$group: {_id: "$p", docs: {$push: {t: "$t", x: "$x"}}}},
+                                   {$sort: {_id: 1}}
+                               ])
+                               .toArray();
+    let i = 0;
+    expectedTotals.forEach(function(partition) {
+        let total = 0;
+        partition.docs.forEach(function(doc, position) {
+            const result = windowed[i++];
+            assert.eq(partition._id, result.p, tojson(result));
+            assert.eq(doc.t, result.t, tojson(result));
+
+            total += doc.x;
+            assert.eq(total, result.total, tojson(result));
+
+            const window = partition.docs.slice(Math.max(0, position - 2), position + 1);
+            const avg = window.reduce((sum, d) => sum + d.x, 0) / window.length;
+            assert.close(avg, result.movingAvg, tojson(result));
+
+            if (position + 1 < partition.docs.length) {
+                assert.eq(partition.docs[position + 1].x, result.next, tojson(result));
+            } else {
+                assert.eq(null, result.next, tojson(result));
+            }
+        });
+    });
+
+    // Invalid window bounds are rejected.
+    assertErrorCode(
+        coll,
+        [{$window: {output: {a: {$sum: "$x", window: {documents: [0, "unbounded"]}}}}}],
+        40679);
+    assertErrorCode(
+        coll, [{$window: {output: {a: {$sum: "$x", window: {documents: [1, -1]}}}}}], 40682);
+}());
@@ -0,0 +1,67 @@
+// Tests that many change streams open on the same node each see exactly the events for their own
+// collection, in order, when the oplog is read through the shared oplog reader.
+(function() {
+    "use strict";
+
+    load("jstests/libs/collection_drop_recreate.js");  // For assert[Drop|Create]Collection.
+    load("jstests/libs/change_stream_util.js");        // For 'ChangeStreamTest'.
+    load("jstests/libs/fixture_helpers.js");           // For 'FixtureHelpers'.
+
+    const cst = new ChangeStreamTest(db);
+    const kNumStreamsPerCollection = 10;
+    const kNumInserts = 20;
+
+    const collA = assertDropAndRecreateCollection(db, "shared_oplog_reader_a");
+    const collB = assertDropAndRecreateCollection(db, "shared_oplog_reader_b");
+
+    function startStreams(coll) {
+        let cursors = [];
+        for (let i = 0; i < kNumStreamsPerCollection; ++i) {
+            cursors.push(cst.startWatchingChanges({
+                pipeline: [{$changeStream: {}}, {$project: {_id: 0, "documentKey._id": 1}}],
+                collection: coll
+            }));
+        }
+        return cursors;
+    }
+
+    const streamsA = startStreams(collA);
+    const streamsB = startStreams(collB);
+
+    // Interleave writes to both collections so that each stream must skip the other's events.
+    for (let i = 0; i < kNumInserts; ++i) {
+        assert.writeOK(collA.insert({_id: i}));
+        assert.writeOK(collB.insert({_id: -i}));
+    }
+
+    function expectedChanges(sign) {
+        let changes = [];
+        for (let i = 0; i < kNumInserts; ++i) {
+            changes.push({documentKey: {_id: sign * i}});
+        }
+        return changes;
+    }
+
+    for (let cursor of streamsA) {
+        cst.assertNextChangesEqual({cursor: cursor, expectedChanges: expectedChanges(1)});
+    }
+    for (let cursor of streamsB) {
+        cst.assertNextChangesEqual({cursor: cursor, expectedChanges: expectedChanges(-1)});
+    }
+
+    // A stream opened after the writes sees only later events, even though earlier entries are
+    // still retained by the shared reader.
+    const lateStream = cst.startWatchingChanges({
+        pipeline: [{$changeStream: {}}, {$project: {_id: 0, "documentKey._id": 1}}],
+        collection: collA
+    });
+    assert.writeOK(collA.insert({_id: kNumInserts}));
+    cst.assertNextChangesEqual(
+        {cursor: lateStream, expectedChanges: [{documentKey: {_id: kNumInserts}}]});
+
+    const primary = FixtureHelpers.getPrimaryForNodeHostingDatabase(db);
+    const metrics = assert.commandWorked(primary.getDB("admin").serverStatus()).metrics;
+    assert.gt(metrics.changeStreams.sharedOplogReader.entriesRead, 0, metrics);
+
+    cst.cleanUp();
+}());
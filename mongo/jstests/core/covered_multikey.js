@@ -51,6 +51,26 @@
         assert(!planHasStage(explainRes.queryPlanner.winningPlan, "FETCH"));
     }
 
+    // Verify that a predicate which must be checked against the index keys, such as a regex, can
+    // be covered when its path is not multikey, even though other fields of the index are.
+    coll.drop();
+    assert.writeOK(coll.insert({a: "foo", tags: ["x", "y"]}));
+    assert.writeOK(coll.insert({a: "bar", tags: ["x", "z"]}));
+    assert.commandWorked(coll.createIndex({a: 1, tags: 1}));
+    assert.eq([{a: "foo"}], coll.find({a: /fo/}, {_id: 0, a: 1}).toArray());
+    explainRes = coll.explain("queryPlanner").find({a: /fo/}, {_id: 0, a: 1}).finish();
+    assert(planHasStage(explainRes.queryPlanner.winningPlan, "IXSCAN"));
+    if (isMMAPv1) {
+        assert(planHasStage(explainRes.queryPlanner.winningPlan, "FETCH"));
+    } else {
+        assert(!planHasStage(explainRes.queryPlanner.winningPlan, "FETCH"));
+    }
+
+    // A regex over the multikey path still requires a fetch.
+    assert.eq([{a: "bar"}], coll.find({a: "bar", tags: /z/}, {_id: 0, a: 1}).toArray());
+    explainRes = coll.explain("queryPlanner").find({a: "bar", tags: /z/}, {_id: 0, a: 1}).finish();
+    assert(planHasStage(explainRes.queryPlanner.winningPlan, "FETCH"));
+
     // Verify that a query cannot be covered over a path which is multikey due to an empty array.
     coll.drop();
     assert.writeOK(coll.insert({a: []}));
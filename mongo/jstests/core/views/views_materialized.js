@@ -0,0 +1,111 @@
+// Test that materialized views stay up to date as the underlying collection changes.
+(function() {
+    "use strict";
+
+    let viewsDB = db.getSiblingDB("views_materialized");
+    assert.commandWorked(viewsDB.dropDatabase());
+
+    let coll = viewsDB.getCollection("coll");
+    assert.writeOK(coll.insert({_id: 1, k: "a", v: 1}));
+    assert.writeOK(coll.insert({_id: 2, k: "a", v: 3}));
+    assert.writeOK(coll.insert({_id: 3, k: "b", v: 5}));
+
+    // Only $match, $project and $addFields may precede the final $group, and only decomposable
+    // accumulators are allowed.
+    assert.commandFailedWithCode(viewsDB.runCommand({
+        create: "bad",
+        viewOn: "coll",
+        materialized: true,
+        pipeline: [{$group: {_id: "$k", m: {$max: "$v"}}}]
+    }),
+                                 ErrorCodes.OptionNotSupportedOnView);
+    assert.commandFailedWithCode(viewsDB.runCommand({
+        create: "bad",
+        viewOn: "coll",
+        materialized: true,
+        pipeline: [{$sort: {k: 1}}, {$group: {_id: "$k", n: {$sum: 1}}}]
+    }),
+                                 ErrorCodes.OptionNotSupportedOnView);
+
+    assert.commandWorked(viewsDB.runCommand({
+        create: "totals",
+        viewOn: "coll",
+        materialized: true,
+        pipeline: [
+            {$match: {v: {$gt: 0}}},
+            {$group: {_id: "$k", total: {$sum: "$v"}, n: {$sum: 1}, avg: {$avg: "$v"}}}
+        ]
+    }));
+    let view = viewsDB.getCollection("totals");
+
+    function assertViewContents(expected) {
+        assert.eq(expected, view.find().sort({_id: 1}).toArray());
+    }
+
+    // The view is populated from the existing documents.
+    assertViewContents(
+        [{_id: "a", total: 4, n: 2, avg: 2}, {_id: "b", total: 5, n: 1, avg: 5}]);
+
+    // Inserts, updates and deletes are reflected incrementally.
+    assert.writeOK(coll.insert({_id: 4, k: "c", v: 10}));
+    assertViewContents([
+        {_id: "a", total: 4, n: 2, avg: 2},
+        {_id: "b", total: 5, n: 1, avg: 5},
+        {_id: "c", total: 10, n: 1, avg: 10}
+    ]);
+
+    assert.writeOK(coll.update({_id: 2}, {$set: {k: "b"}}));
+    assertViewContents([
+        {_id: "a", total: 1, n: 1, avg: 1},
+        {_id: "b", total: 8, n: 2, avg: 4},
+        {_id: "c", total: 10, n: 1, avg: 10}
+    ]);
+
+    assert.writeOK(coll.remove({_id: 4}));
+    assertViewContents([{_id: "a", total: 1, n: 1, avg: 1}, {_id: "b", total: 8, n: 2, avg: 4}]);
+
+    // Documents filtered out by the $match do not contribute.
+    assert.writeOK(coll.insert({_id: 5, k: "a", v: -100}));
+    assertViewContents([{_id: "a", total: 1, n: 1, avg: 1}, {_id: "b", total: 8, n: 2, avg: 4}]);
+
+    // Array group keys, which cannot be an _id of the backing collection, are grouped on as well.
+    assert.writeOK(coll.insert({_id: 6, k: [1, 2], v: 2}));
+    assertViewContents([
+        {_id: "a", total: 1, n: 1, avg: 1},
+        {_id: "b", total: 8, n: 2, avg: 4},
+        {_id: [1, 2], total: 2, n: 1, avg: 2}
+    ]);
+    assert.writeOK(coll.remove({_id: 6}));
+
+    // Removing a value does not lose the precision of the sum of the others.
+    assert.writeOK(coll.insert({_id: 7, k: "c", v: 1e20}));
+    assert.writeOK(coll.insert({_id: 8, k: "c", v: 1}));
+    assert.writeOK(coll.remove({_id: 7}));
+    assertViewContents([
+        {_id: "a", total: 1, n: 1, avg: 1},
+        {_id: "b", total: 8, n: 2, avg: 4},
+        {_id: "c", total: 1, n: 1, avg: 1}
+    ]);
+    assert.writeOK(coll.remove({_id: 8}));
+
+    // Renaming a collection onto the one the view is defined on rebuilds the view from it, and
+    // dropping it empties the view.
+    let staging = viewsDB.getCollection("staging");
+    assert.writeOK(staging.insert({_id: 1, k: "d", v: 2}));
+    assert.writeOK(staging.insert({_id: 2, k: "d", v: 4}));
+    assert.commandWorked(staging.renameCollection("coll", true));
+    assertViewContents([{_id: "d", total: 6, n: 2, avg: 3}]);
+
+    assert(coll.drop());
+    assertViewContents([]);
+    assert.writeOK(coll.insert({_id: 1, k: "a", v: 1}));
+    assertViewContents([{_id: "a", total: 1, n: 1, avg: 1}]);
+
+    // Materialized views cannot be modified, but dropping them drops their backing collection.
+    assert.commandFailedWithCode(
+        viewsDB.runCommand({collMod: "totals", viewOn: "coll", pipeline: []}),
+        ErrorCodes.OptionNotSupportedOnView);
+    assert.neq(null, viewsDB.getCollectionInfos({name: "system.materialized.totals"})[0]);
+    assert(view.drop());
+    assert.eq([], viewsDB.getCollectionInfos({name: "system.materialized.totals"}));
+}());
@@ -0,0 +1,66 @@
+// Tests that with fair ticket scheduling enabled, storage engine tickets are accounted per
+// database, and a database with a maxTickets share cannot hold more tickets than that while other
+// databases still get theirs.
+//
+// This test uses the fsync command to make writers hold their tickets.
+// @tags: [requires_fsync, requires_wiredtiger]
+(function() {
+    'use strict';
+
+    var conn = MongoRunner.runMongod({
+        setParameter: {
+            fairTicketSchedulingEnabled: true,
+            fairTicketSchedulingShares: tojson({limited: {maxTickets: 1}}),
+            wiredTigerConcurrentWriteTransactions: 5,
+        }
+    });
+    var admin = conn.getDB('admin');
+
+    var res =
+        assert.commandWorked(admin.runCommand({getParameter: 1, fairTicketSchedulingShares: 1}));
+    assert.eq({limited: {maxTickets: 1}}, res.fairTicketSchedulingShares);
+    assert.commandFailedWithCode(
+        admin.runCommand({setParameter: 1, fairTicketSchedulingShares: {limited: {weight: 0}}}),
+        ErrorCodes.BadValue);
+
+    function writeTenants() {
+        return admin.serverStatus().wiredTiger.concurrentTransactions.fairScheduling.write.tenants;
+    }
+
+    assert.commandWorked(conn.getDB('limited').coll.insert({_id: 'first'}));
+    assert.commandWorked(conn.getDB('other').coll.insert({_id: 'first'}));
+
+    // Each writer which gets a ticket blocks on the global lock while holding it.
+    assert.commandWorked(admin.fsyncLock());
+    var awaitShells = [];
+    ['limited', 'limited', 'other'].forEach(function(dbName, i) {
+        awaitShells.push(startParallelShell(
+            'assert.writeOK(db.getSiblingDB("' + dbName + '").coll.insert({_id: ' + i + '}));',
+            conn.port));
+    });
+
+    // The second writer to 'limited' has to queue although tickets are available, and the writer
+    // to 'other' is not held up by it.
+    assert.soon(function() {
+        var tenants = writeTenants();
+        return tenants.limited && tenants.limited.inFlight === 1 &&
+            tenants.limited.queueDepth === 1 && tenants.other && tenants.other.inFlight === 1;
+    }, function() {
+        return 'writers were not scheduled as expected: ' + tojson(writeTenants());
+    });
+
+    assert.commandWorked(admin.fsyncUnlock());
+    awaitShells.forEach(function(awaitShell) {
+        awaitShell();
+    });
+
+    var tenants = writeTenants();
+    assert.eq(0, tenants.limited.inFlight, tojson(tenants));
+    assert.eq(0, tenants.limited.queueDepth, tojson(tenants));
+    assert.gte(tenants.limited.granted, 3, tojson(tenants));
+    assert.gte(tenants.limited.queued, 1, tojson(tenants));
+    assert.gte(tenants.other.granted, 2, tojson(tenants));
+    assert.eq(3, conn.getDB('limited').coll.count());
+
+    MongoRunner.stopMongod(conn);
+})();
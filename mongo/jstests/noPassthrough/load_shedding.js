@@ -0,0 +1,47 @@
+// Tests that with load shedding enabled, an operation which queues for a storage engine ticket for
+// longer than loadSheddingMaxQueueTimeMillis fails with the retryable ServerOverloaded error
+// rather than waiting indefinitely.
+//
+// This test uses the fsync command to hold every write ticket.
+// @tags: [requires_fsync, requires_wiredtiger]
+(function() {
+    'use strict';
+
+    var kTickets = 5;
+    var conn = MongoRunner.runMongod({
+        setParameter: {
+            loadSheddingEnabled: true,
+            loadSheddingMaxQueueTimeMillis: 200,
+            wiredTigerConcurrentWriteTransactions: kTickets,
+        }
+    });
+    var db = conn.getDB('test');
+    assert.commandWorked(db.coll.insert({_id: 'first'}));
+
+    // Each of these writers takes a ticket and then blocks on the global lock.
+    assert.commandWorked(db.fsyncLock());
+    var awaitShells = [];
+    for (var i = 0; i < kTickets; i++) {
+        awaitShells.push(startParallelShell(
+            'assert.writeOK(db.getSiblingDB("test").coll.insert({_id: ' + i + '}));', conn.port));
+    }
+    assert.soon(function() {
+        return db.currentOp({'command.insert': 'coll', waitingForLock: true}).inprog.length ===
+            kTickets;
+    }, 'the parallel writers never queued on the global lock');
+
+    // No ticket is left, so this write is shed once it has queued for 200ms.
+    assert.writeErrorWithCode(db.coll.insert({_id: 'shed'}), ErrorCodes.ServerOverloaded);
+
+    assert.commandWorked(db.fsyncUnlock());
+    awaitShells.forEach(function(awaitShell) {
+        awaitShell();
+    });
+
+    var stats = db.serverStatus().loadShedding;
+    assert(stats.enabled, tojson(stats));
+    assert.gte(stats.rejectedTimedOut, 1, tojson(stats));
+    assert.eq(null, db.coll.findOne({_id: 'shed'}));
+
+    MongoRunner.stopMongod(conn);
+})();
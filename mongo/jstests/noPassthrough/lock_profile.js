@@ -0,0 +1,69 @@
+// Tests the lockProfile command, which reports lock wait histograms per resource and samples of
+// waits which exceeded lockProfilingSlowWaitMillis.
+//
+// This test uses the fsync command to induce locking.
+// @tags: [requires_fsync]
+(function() {
+    'use strict';
+
+    var conn = MongoRunner.runMongod(
+        {setParameter: {lockProfilingEnabled: true, lockProfilingSlowWaitMillis: 50}});
+    var db = conn.getDB('test');
+    var admin = conn.getDB('admin');
+
+    assert.commandWorked(db.coll.insert({_id: 1}));
+    assert.commandWorked(admin.runCommand({lockProfile: 1, reset: true}));
+
+    // Block a writer behind fsyncLock for longer than the slow wait threshold.
+    assert.commandWorked(db.fsyncLock());
+    var awaitShell =
+        startParallelShell('assert.writeOK(db.getSiblingDB("test").coll.insert({_id: 2}));',
+                           conn.port);
+
+    assert.soon(function() {
+        var res = assert.commandWorked(admin.runCommand({lockProfile: 1}));
+        return res.slowWaitsRecorded > 0;
+    }, 'the blocked insert never showed up as a slow lock wait');
+
+    assert.commandWorked(db.fsyncUnlock());
+    awaitShell();
+
+    var res = assert.commandWorked(admin.runCommand({lockProfile: 1, limit: 5}));
+    assert(res.enabled, tojson(res));
+    assert.lte(res.resources.length, 5, tojson(res));
+
+    var globalResource = res.resources.find(function(resource) {
+        return resource.type === 'Global';
+    });
+    assert(globalResource, 'no wait recorded on the global lock: ' + tojson(res));
+    assert.gte(globalResource.waits, 1, tojson(globalResource));
+    assert.gte(globalResource.maxWaitMicros, 50 * 1000, tojson(globalResource));
+    assert.eq(res.histogramLowerBoundsMicros.length,
+              globalResource.histogram.length,
+              tojson(res));
+
+    // The sample names both the blocked insert and the fsyncLock holder.
+    var sample = res.slowWaits.find(function(sample) {
+        return sample.type === 'Global' && sample.waiter.ns === 'test.coll';
+    });
+    assert(sample, 'no slow wait sample for the insert: ' + tojson(res.slowWaits));
+    assert.eq('insert', sample.waiter.op, tojson(sample));
+    assert.gt(sample.holders.length, 0, tojson(sample));
+    assert.eq('S', sample.holders[0].mode, tojson(sample));
+
+    // The summary used by FTDC only has per-resource-type totals.
+    var summary = assert.commandWorked(admin.runCommand({lockProfile: 1, summary: true}));
+    assert.gte(summary.Global.waits, 1, tojson(summary));
+    assert(!summary.hasOwnProperty('resources'), tojson(summary));
+
+    // Reset clears the statistics after reporting them.
+    assert.commandWorked(admin.runCommand({lockProfile: 1, reset: true}));
+    res = assert.commandWorked(admin.runCommand({lockProfile: 1}));
+    assert.eq(0, res.slowWaitsRecorded, tojson(res));
+    assert.eq(0, res.resources.length, tojson(res));
+
+    assert.commandFailed(admin.runCommand({lockProfile: 1, limit: -1}));
+    assert.commandFailedWithCode(db.runCommand({lockProfile: 1}), ErrorCodes.Unauthorized);
+
+    MongoRunner.stopMongod(conn);
+})();
@@ -0,0 +1,37 @@
+// Tests that $out inserts the batches its writer pool refuses on the aggregation's own operation.
+(function() {
+    "use strict";
+
+    const conn = MongoRunner.runMongod({});
+    assert.neq(null, conn, "mongod was unable to start up");
+    const testDB = conn.getDB("test");
+
+    const coll = testDB.out_writer_pool_rejects_batches_source;
+    const target = testDB.out_writer_pool_rejects_batches_target;
+
+    // Each batch of inserts is limited to 16MB, so this is three batches.
+    const padding = "x".repeat(100 * 1024);
+    const numDocs = 400;
+    let bulk = coll.initializeUnorderedBulkOp();
+    for (let i = 0; i < numDocs; ++i) {
+        bulk.insert({_id: i, padding: padding});
+    }
+    assert.writeOK(bulk.execute());
+
+    assert.commandWorked(testDB.adminCommand(
+        {configureFailPoint: "outWriterPoolRejectsBatches", mode: "alwaysOn"}));
+    coll.aggregate([{$out: target.getName()}]);
+    assert.eq(numDocs, target.find().itcount());
+
+    // A failed insert into the temporary collection fails the $out.
+    assert.commandFailed(testDB.runCommand({
+        aggregate: coll.getName(),
+        pipeline: [{$project: {_id: {$mod: ["$_id", 200]}}}, {$out: target.getName()}],
+        cursor: {}
+    }));
+    assert.eq(numDocs, target.find().itcount());
+    assert.commandWorked(
+        testDB.adminCommand({configureFailPoint: "outWriterPoolRejectsBatches", mode: "off"}));
+
+    MongoRunner.stopMongod(conn);
+}());
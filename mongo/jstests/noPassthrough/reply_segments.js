@@ -0,0 +1,77 @@
+/**
+ * Tests that cursor batches whose documents are sent from their own buffers rather than copied
+ * into the reply reach the client intact, on every transport layer and with network compression.
+ */
+(function() {
+    "use strict";
+
+    const numDocs = 400;
+    const payloadBytes = 50 * 1024;
+
+    // Runs in the compressing shell below too, so it only uses its arguments.
+    function checkBatches(db, numDocs, payloadBytes) {
+        const coll = db.reply_segments;
+
+        // Aggregation results and sorted finds are owned documents, which large batches send
+        // as segments. Both fill a 16MB first batch and need getMores for the rest.
+        const aggregated = coll.aggregate([{$addFields: {n: "$_id"}}, {$sort: {_id: 1}}],
+                                          {cursor: {batchSize: numDocs}})
+                               .toArray();
+        assert.eq(numDocs, aggregated.length);
+        aggregated.forEach(function(doc, i) {
+            assert.eq(i, doc._id);
+            assert.eq(i, doc.n);
+            assert.eq(payloadBytes, doc.payload.length);
+            assert.eq(String.fromCharCode(97 + i % 26), doc.payload[payloadBytes - 1]);
+        });
+
+        const sorted = coll.find().sort({k: -1}).batchSize(numDocs).toArray();
+        assert.eq(numDocs, sorted.length);
+        sorted.forEach(function(doc, i) {
+            assert.eq(numDocs - 1 - i, doc._id);
+            assert.eq(payloadBytes, doc.payload.length);
+        });
+    }
+
+    function runTest(options) {
+        jsTestLog("Testing reply segments with " + tojson(options));
+        const conn = MongoRunner.runMongod(
+            Object.merge(options, {setParameter: {replySegmentMinBytes: 1024}}));
+        assert.neq(null, conn, "mongod failed to start with " + tojson(options));
+
+        const db = conn.getDB("test");
+        const bulk = db.reply_segments.initializeUnorderedBulkOp();
+        for (let i = 0; i < numDocs; ++i) {
+            const payload = String.fromCharCode(97 + i % 26).repeat(payloadBytes);
+            bulk.insert({_id: i, k: i, payload: payload});
+        }
+        assert.writeOK(bulk.execute());
+
+        checkBatches(db, numDocs, payloadBytes);
+
+        // The same replies built by copying every document.
+        assert.commandWorked(db.adminCommand({setParameter: 1, replySegmentMinBytes: 0}));
+        checkBatches(db, numDocs, payloadBytes);
+        assert.commandWorked(db.adminCommand({setParameter: 1, replySegmentMinBytes: 1024}));
+
+        // Compressed replies are made contiguous before they are compressed.
+        if (options.networkMessageCompressors) {
+            const check = "(" + checkBatches.toString() + ")(db.getSiblingDB('test'), " +
+                numDocs + ", " + payloadBytes + ");";
+            assert.eq(0,
+                      runMongoProgram("mongo",
+                                      "--port",
+                                      conn.port,
+                                      "--networkMessageCompressors=snappy",
+                                      "--eval",
+                                      check));
+        }
+
+        MongoRunner.stopMongod(conn);
+    }
+
+    runTest({});
+    runTest({transportLayer: "legacy"});
+    runTest({transportLayer: "io_uring"});
+    runTest({networkMessageCompressors: "snappy"});
+})();
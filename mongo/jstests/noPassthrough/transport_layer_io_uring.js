@@ -0,0 +1,53 @@
+/**
+ * Tests that mongod serves requests over the io_uring transport layer with either service
+ * executor, including messages larger than its registered buffers, and that it falls back to asio
+ * where io_uring is unavailable.
+ */
+(function() {
+    "use strict";
+
+    function runTest(serviceExecutor) {
+        jsTestLog("Testing the io_uring transport layer with the " + serviceExecutor +
+                  " service executor");
+        const conn = MongoRunner.runMongod({
+            transportLayer: "io_uring",
+            serviceExecutor: serviceExecutor,
+            setParameter: {ioUringRegisteredBuffers: 16, ioUringRegisteredBufferSizeBytes: 4096}
+        });
+        assert.neq(null, conn, "mongod failed to start with transportLayer io_uring");
+
+        const log = assert.commandWorked(conn.adminCommand({getLog: "global"})).log;
+        if (log.some((line) => line.includes("using asio instead"))) {
+            jsTestLog("io_uring is not available here, testing the fallback to asio");
+        }
+
+        const coll = conn.getDB("test").transport_layer_io_uring;
+
+        // Small requests and replies fit in a registered buffer.
+        for (let i = 0; i < 100; ++i) {
+            assert.writeOK(coll.insert({_id: i}));
+        }
+        assert.eq(100, coll.find().itcount());
+
+        // Large ones are read and written in place.
+        const big = "x".repeat(8 * 1024 * 1024);
+        assert.writeOK(coll.insert({_id: "big", big: big}));
+        assert.eq(big, coll.findOne({_id: "big"}).big);
+
+        // More clients than registered buffers share the ring.
+        const awaitShells = [];
+        for (let i = 0; i < 20; ++i) {
+            awaitShells.push(startParallelShell(function() {
+                for (let j = 0; j < 200; ++j) {
+                    assert.commandWorked(db.adminCommand({ping: 1}));
+                }
+            }, conn.port));
+        }
+        awaitShells.forEach((awaitShell) => awaitShell());
+
+        MongoRunner.stopMongod(conn);
+    }
+
+    runTest("synchronous");
+    runTest("adaptive");
+})();
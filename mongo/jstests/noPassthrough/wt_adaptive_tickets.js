@@ -0,0 +1,43 @@
+// Tests that the adaptive ticket controller keeps the WiredTiger ticket pools within the
+// configured bounds and reports its state in serverStatus.
+// @tags: [requires_wiredtiger]
+(function() {
+    'use strict';
+
+    var conn = MongoRunner.runMongod({
+        setParameter: {
+            wiredTigerAdaptiveTicketsEnabled: true,
+            wiredTigerAdaptiveTicketsMin: 8,
+            wiredTigerAdaptiveTicketsMax: 64,
+        }
+    });
+    var db = conn.getDB('test');
+
+    // The initial pools are larger than the maximum, so the first decision clamps them.
+    assert.soon(function() {
+        var tickets = db.serverStatus().wiredTiger.concurrentTransactions;
+        return tickets.write.totalTickets <= 64 && tickets.read.totalTickets <= 64;
+    }, 'ticket pools were never brought within wiredTigerAdaptiveTicketsMax');
+
+    for (var i = 0; i < 1000; i++) {
+        assert.writeOK(db.coll.insert({_id: i}));
+    }
+
+    var tickets = db.serverStatus().wiredTiger.concurrentTransactions;
+    assert(tickets.adaptive.enabled, tojson(tickets));
+    assert.gte(tickets.write.totalTickets, 8, tojson(tickets));
+    assert.gte(tickets.read.totalTickets, 8, tojson(tickets));
+    assert.neq('none', tickets.adaptive.write.lastDecision, tojson(tickets));
+
+    // An explicit size is overridden while the controller is enabled, but sticks once it is not.
+    assert.commandWorked(
+        db.adminCommand({setParameter: 1, wiredTigerAdaptiveTicketsEnabled: false}));
+    assert.commandWorked(
+        db.adminCommand({setParameter: 1, wiredTigerConcurrentWriteTransactions: 100}));
+    sleep(2000);
+    tickets = db.serverStatus().wiredTiger.concurrentTransactions;
+    assert.eq(100, tickets.write.totalTickets, tojson(tickets));
+    assert(!tickets.adaptive.enabled, tojson(tickets));
+
+    MongoRunner.stopMongod(conn);
+})();
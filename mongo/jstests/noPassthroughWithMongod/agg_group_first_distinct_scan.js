@@ -0,0 +1,111 @@
+// Tests that a $sort followed by a $group whose accumulators are all $first uses a DISTINCT_SCAN
+// to fetch only the first document for each group key, and that the results match those computed
+// without it.
+(function() {
+    "use strict";
+
+    load("jstests/aggregation/extras/utils.js");  // For arrayEq.
+    load("jstests/libs/analyze_plan.js");         // For getAggPlanStage.
+
+    const coll = db.agg_group_first_distinct_scan;
+    coll.drop();
+
+    const numKeys = 20;
+    const docsPerKey = 50;
+    let bulk = coll.initializeUnorderedBulkOp();
+    for (let k = 0; k < numKeys; ++k) {
+        for (let t = 0; t < docsPerKey; ++t) {
+            bulk.insert({k: k, t: t, x: k * 1000 + t, s: (t % 2 === 0) ? "a" : "b"});
+        }
+    }
+    // Documents which are missing the group key or have a null key belong to the same group.
+    bulk.insert({t: 100, x: -1});
+    bulk.insert({k: null, t: 101, x: -2});
+    assert.writeOK(bulk.execute());
+    assert.commandWorked(coll.createIndex({k: 1, t: -1}));
+    assert.commandWorked(coll.createIndex({s: 1, k: 1, t: -1}));
+
+    function setDistinctScan(enabled) {
+        assert.commandWorked(db.adminCommand(
+            {setParameter: 1, internalQueryAggregationUseDistinctScanForFirst: enabled}));
+    }
+
+    function assertResults(pipeline, expectDistinctScan) {
+        setDistinctScan(false);
+        const expected = coll.aggregate(pipeline).toArray();
+        assert.eq(null, getAggPlanStage(coll.explain().aggregate(pipeline), "DISTINCT_SCAN"));
+
+        setDistinctScan(true);
+        const explain = coll.explain("executionStats").aggregate(pipeline);
+        const distinctScan = getAggPlanStage(explain, "DISTINCT_SCAN");
+        assert.eq(expectDistinctScan, distinctScan !== null, tojson(explain));
+        if (expectDistinctScan) {
+            // Only the first document of each group is examined.
+            const executionStats = explain.stages[0].$cursor.executionStats;
+            assert.lte(executionStats.totalDocsExamined, numKeys + 1, tojson(executionStats));
+        }
+
+        const actual = coll.aggregate(pipeline).toArray();
+        assert(arrayEq(expected, actual), tojson({expected: expected, actual: actual}));
+        return actual;
+    }
+
+    try {
+        // The latest value for each key.
+        const latest =
+            assertResults([{$sort: {k: 1, t: -1}}, {$group: {_id: "$k", v: {$first: "$x"}}}], true);
+        assert.eq(numKeys + 1, latest.length);
+        latest.forEach(function(group) {
+            if (group._id === null) {
+                assert.eq(-2, group.v);
+            } else {
+                assert.eq(group._id * 1000 + docsPerKey - 1, group.v);
+            }
+        });
+
+        assertResults([{$sort: {k: -1, t: 1}}, {$group: {_id: "$k", doc: {$first: "$$ROOT"}}}],
+                      true);
+        assertResults(
+            [
+              {$match: {k: {$gte: 5, $lt: 15}}},
+              {$sort: {k: 1, t: -1}},
+              {$group: {_id: "$k", v: {$first: "$x"}, t: {$first: {$add: ["$t", 1]}}}}
+            ],
+            true);
+        assertResults(
+            [
+              {$match: {s: "a"}},
+              {$sort: {k: 1, t: -1}},
+              {$group: {_id: "$k", v: {$first: "$x"}}}
+            ],
+            true);
+
+        // Pipelines which need more than the first document of each group are not rewritten.
+        assertResults(
+            [{$sort: {k: 1, t: -1}}, {$group: {_id: "$k", v: {$first: "$x"}, n: {$sum: 1}}}],
+            false);
+        assertResults([{$sort: {k: 1, t: -1}}, {$group: {_id: "$k", v: {$last: "$x"}}}], false);
+        assertResults([{$sort: {t: -1}}, {$group: {_id: "$k", v: {$first: "$x"}}}], false);
+        assertResults(
+            [{$sort: {k: 1, t: -1}}, {$limit: 10}, {$group: {_id: "$k", v: {$first: "$x"}}}],
+            false);
+        assertResults(
+            [
+              {$match: {x: {$gt: 3000}}},
+              {$sort: {k: 1, t: -1}},
+              {$group: {_id: "$k", v: {$first: "$x"}}}
+            ],
+            false);
+
+        // A distinct scan over {s: 1, k: 1, t: -1} would return each key once per value of 's'.
+        assertResults(
+            [
+              {$match: {s: {$in: ["a", "b"]}}},
+              {$sort: {k: 1, t: -1}},
+              {$group: {_id: "$k", v: {$first: "$x"}}}
+            ],
+            false);
+    } finally {
+        setDistinctScan(true);
+    }
+}());
@@ -0,0 +1,76 @@
+// Tests that a $group which directly follows the query is run within the query system, that
+// explain reports it, and that it returns the same results as a $group run by the pipeline.
+(function() {
+    "use strict";
+
+    load("jstests/aggregation/extras/utils.js");  // For arrayEq.
+    load("jstests/libs/analyze_plan.js");         // For planHasStage.
+
+    const coll = db.agg_group_pushdown;
+    coll.drop();
+
+    let bulk = coll.initializeUnorderedBulkOp();
+    for (let i = 0; i < 500; ++i) {
+        bulk.insert({
+            _id: i,
+            a: i % 7,
+            b: {c: i % 3, d: (i % 2 === 0) ? "even" : "odd"},
+            arr: [{c: i % 5}, {c: i % 2}],
+            x: (i % 11 === 0) ? null : i * 1.5
+        });
+    }
+    assert.writeOK(bulk.execute());
+    assert.commandWorked(coll.createIndex({a: 1}));
+
+    function setPushDown(enabled) {
+        assert.commandWorked(
+            db.adminCommand({setParameter: 1, internalQueryPushDownAggregationGroup: enabled}));
+    }
+
+    function isPushedDown(pipeline) {
+        const explain = coll.explain().aggregate(pipeline);
+        const cursorStage = explain.stages[0].$cursor;
+        return cursorStage.hasOwnProperty("pushedDownStages") &&
+            cursorStage.pushedDownStages[0].hasOwnProperty("$group") &&
+            !explain.stages.some((stage) => stage.hasOwnProperty("$group"));
+    }
+
+    function assertSameResults(pipeline, expectPushDown) {
+        setPushDown(false);
+        assert(!isPushedDown(pipeline), tojson(pipeline));
+        const expected = coll.aggregate(pipeline).toArray();
+
+        setPushDown(true);
+        assert.eq(expectPushDown, isPushedDown(pipeline), tojson(pipeline));
+        const actual = coll.aggregate(pipeline).toArray();
+        assert(arrayEq(expected, actual), tojson({expected: expected, actual: actual}));
+    }
+
+    try {
+        assertSameResults([{$group: {_id: null, count: {$sum: 1}}}], true);
+        assertSameResults([{$match: {a: {$gte: 2}}}, {$group: {_id: "$a", total: {$sum: "$x"}}}],
+                          true);
+        assertSameResults([{$group: {_id: {c: "$b.c", d: "$b.d"}, n: {$sum: 1}}}], true);
+        assertSameResults(
+            [{$group: {_id: "$arr.c", avg: {$avg: "$x"}, min: {$min: "$x"}, max: {$max: "$x"}}}],
+            true);
+        assertSameResults([{$group: {_id: "$missing", ids: {$push: "$_id"}}}], true);
+        assertSameResults([{$sort: {a: 1}}, {$group: {_id: "$b.d", first: {$first: "$_id"}}}],
+                          true);
+        assertSameResults(
+            [{$group: {_id: "$a", count: {$sum: 1}}}, {$sort: {count: -1, _id: 1}}, {$limit: 3}],
+            true);
+
+        // A group key which is not a constant or a field path is still evaluated by the pipeline.
+        assertSameResults([{$group: {_id: {$mod: ["$_id", 4]}, count: {$sum: 1}}}], false);
+        assertSameResults([{$unwind: "$arr"}, {$group: {_id: "$arr.c", n: {$sum: 1}}}], false);
+
+        // The pushed down $group is listed in the winning plan when there is only one plan.
+        setPushDown(true);
+        const explain = coll.explain().aggregate([{$group: {_id: "$b.c"}}]);
+        assert(planHasStage(explain.stages[0].$cursor.queryPlanner.winningPlan, "PIPELINE_GROUP"),
+               tojson(explain));
+    } finally {
+        setPushDown(true);
+    }
+}());
@@ -0,0 +1,78 @@
+/**
+ * Compares the throughput of 16MB cursor batches when their documents are copied into the reply
+ * and when they are sent from their own buffers. Not part of any suite; run it with
+ *
+ *     ./mongo --nodb jstests/perf/reply_segments.js
+ *
+ * benchRun keeps replies as BSON, so the numbers are not dominated by the shell converting
+ * documents to JavaScript objects.
+ */
+(function() {
+    "use strict";
+
+    const seconds = 10;
+    const clientCounts = [1, 4, 16];
+
+    // 250 documents of 64KB fill one batch without going over the 16MB reply limit, so every
+    // command below returns a whole collection and an exhausted cursor.
+    const numDocs = 250;
+    const payloadBytes = 64 * 1000;
+    const batchMB = numDocs * payloadBytes / (1024 * 1024);
+
+    const conn = MongoRunner.runMongod({});
+    assert.neq(null, conn, "mongod failed to start");
+
+    const db = conn.getDB("bench");
+    const bulk = db.docs.initializeUnorderedBulkOp();
+    for (let i = 0; i < numDocs; ++i) {
+        bulk.insert({_id: i, k: i, payload: "x".repeat(payloadBytes)});
+    }
+    assert.writeOK(bulk.execute());
+
+    const commands = {
+        aggregate: {
+            aggregate: "docs",
+            pipeline: [{$addFields: {n: "$_id"}}],
+            cursor: {batchSize: numDocs},
+        },
+        sortedFind: {find: "docs", sort: {k: -1}, batchSize: numDocs},
+    };
+
+    function measure(minSegmentBytes) {
+        assert.commandWorked(
+            conn.adminCommand({setParameter: 1, replySegmentMinBytes: minSegmentBytes}));
+
+        const mbPerSecond = {};
+        Object.keys(commands).forEach(function(name) {
+            const reply = assert.commandWorked(db.runCommand(commands[name]));
+            assert.eq(0, reply.cursor.id, "batch does not hold the whole collection");
+
+            mbPerSecond[name] = {};
+            clientCounts.forEach(function(clients) {
+                const res = benchRun({
+                    host: conn.host,
+                    parallel: clients,
+                    seconds: seconds,
+                    ops: [{op: "command", ns: "bench", command: commands[name]}],
+                });
+                assert.eq(0, res.errCount, tojson(res));
+                mbPerSecond[name][clients] = res["totalOps/s"] * batchMB;
+            });
+        });
+        return mbPerSecond;
+    }
+
+    const copied = measure(0);
+    const segments = measure(4096);
+
+    Object.keys(commands).forEach(function(name) {
+        clientCounts.forEach(function(clients) {
+            print(name + ", " + clients + " clients: copied " +
+                  copied[name][clients].toFixed(0) + " MB/s, segments " +
+                  segments[name][clients].toFixed(0) + " MB/s (" +
+                  (segments[name][clients] / copied[name][clients]).toFixed(2) + "x)");
+        });
+    });
+
+    MongoRunner.stopMongod(conn);
+})();
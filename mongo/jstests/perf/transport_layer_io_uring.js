@@ -0,0 +1,57 @@
+/**
+ * Compares the request throughput of the asio and io_uring transport layers, each with the
+ * synchronous and the adaptive service executor, under many clients sending small commands, which
+ * the shell sends as OP_MSG. Not part of any suite; run it with
+ *
+ *     ./mongo --nodb jstests/perf/transport_layer_io_uring.js
+ *
+ * The io_uring run falls back to asio on kernels without io_uring, and says so.
+ */
+(function() {
+    "use strict";
+
+    const seconds = 10;
+    const clientCounts = [8, 64, 256];
+
+    function measure(transportLayer, serviceExecutor) {
+        const conn = MongoRunner.runMongod(
+            {transportLayer: transportLayer, serviceExecutor: serviceExecutor});
+        assert.neq(null, conn, "mongod failed to start with transportLayer " + transportLayer);
+
+        const log = assert.commandWorked(conn.adminCommand({getLog: "global"})).log;
+        if (log.some((line) => line.includes("using asio instead"))) {
+            print("WARNING: io_uring is unavailable, the io_uring numbers below are for asio");
+        }
+
+        assert.writeOK(conn.getDB("bench").docs.insert({_id: 0, x: 1}));
+
+        const opsPerSecond = {};
+        clientCounts.forEach(function(clients) {
+            const res = benchRun({
+                host: conn.host,
+                parallel: clients,
+                seconds: seconds,
+                ops: [
+                    {op: "command", ns: "admin", command: {ping: 1}},
+                    {op: "command", ns: "bench", command: {find: "docs", filter: {_id: 0}}},
+                ],
+            });
+            assert.eq(0, res.errCount, tojson(res));
+            opsPerSecond[clients] = res["totalOps/s"];
+        });
+
+        MongoRunner.stopMongod(conn);
+        return opsPerSecond;
+    }
+
+    ["synchronous", "adaptive"].forEach(function(serviceExecutor) {
+        const asio = measure("asio", serviceExecutor);
+        const ioUring = measure("io_uring", serviceExecutor);
+
+        clientCounts.forEach(function(clients) {
+            print(serviceExecutor + ", " + clients + " clients: asio " +
+                  asio[clients].toFixed(0) + " ops/s, io_uring " + ioUring[clients].toFixed(0) +
+                  " ops/s (" + (ioUring[clients] / asio[clients]).toFixed(2) + "x)");
+        });
+    });
+})();
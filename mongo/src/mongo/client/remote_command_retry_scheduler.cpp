@@ -115,7 +115,9 @@ const std::initializer_list<ErrorCodes::Error> RemoteCommandRetryScheduler::kAll
     ErrorCodes::NetworkTimeout,
     ErrorCodes::PrimarySteppedDown,
     ErrorCodes::InterruptedDueToReplStateChange,
-    ErrorCodes::BalancerInterrupted};
+    ErrorCodes::BalancerInterrupted,
+    // Load shedding rejects operations before they do any work.
+    ErrorCodes::ServerOverloaded};
 
 std::unique_ptr<RemoteCommandRetryScheduler::RetryPolicy>
 RemoteCommandRetryScheduler::makeNoRetryPolicy() {
@@ -849,6 +849,9 @@ StatusWith<RecordData> CollectionImpl::updateDocumentWithDamages(
     // Broadcast the mutation so that query results stay correct.
     _cursorManager.invalidateDocument(opCtx, loc, INVALIDATION_MUTATION);
 
+    // The damages may be applied to the old record in place, so copy it out first.
+    args->preImageDoc = oldRec.value().toBson().getOwned();
+
     auto newRecStatus =
         _recordStore->updateWithDamages(opCtx, loc, oldRec.value(), damageSource, damages);
 
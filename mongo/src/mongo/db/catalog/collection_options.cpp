@@ -114,6 +114,7 @@ Status CollectionOptions::validateForStorage() const {
   indexOptionDefaults: <document>,
   viewOn: <source>,
   pipeline: <pipeline>,
+  materialized: <true|false>,
   collation: <document>,
   writeConcern: <document>,
   comment: <any>
@@ -263,6 +264,12 @@ Status CollectionOptions::parse(const BSONObj& options, ParseKind kind) {
             }
 
             pipeline = e.Obj().getOwned();
+        } else if (fieldName == "materialized") {
+            if (e.type() != mongo::Bool) {
+                return Status(ErrorCodes::BadValue, "'materialized' has to be a boolean.");
+            }
+
+            materialized = e.Bool();
         } else if (!createdOn24OrEarlier && !Command::isGenericArgument(fieldName)) {
             return Status(ErrorCodes::InvalidOptions,
                           str::stream() << "The field '" << fieldName
@@ -275,6 +282,10 @@ Status CollectionOptions::parse(const BSONObj& options, ParseKind kind) {
         return Status(ErrorCodes::BadValue, "'pipeline' cannot be specified without 'viewOn'");
     }
 
+    if (viewOn.empty() && materialized) {
+        return Status(ErrorCodes::BadValue, "'materialized' cannot be specified without 'viewOn'");
+    }
+
     return Status::OK();
 }
 
@@ -339,6 +350,10 @@ BSONObj CollectionOptions::toBSON() const {
         b.append("pipeline", pipeline);
     }
 
+    if (materialized) {
+        b.appendBool("materialized", true);
+    }
+
     return b.obj();
 }
 }
@@ -50,6 +50,7 @@
   indexOptionDefaults: <document>,
   viewOn: <source>,
   pipeline: <pipeline>,
+  materialized: <true|false>,
   collation: <document>,
   writeConcern: <document>,
   comment: <any>
@@ -162,5 +163,7 @@ struct CollectionOptions {
     std::string viewOn;
     // The aggregation pipeline that defines this view.
     BSONObj pipeline;
+    // Whether the view's results are stored in a backing collection and maintained incrementally.
+    bool materialized = false;
 };
 }
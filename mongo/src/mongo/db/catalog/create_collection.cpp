@@ -41,6 +41,7 @@
 #include "mongo/db/operation_context.h"
 #include "mongo/db/ops/insert.h"
 #include "mongo/db/repl/replication_coordinator.h"
+#include "mongo/db/views/materialized_view_maintenance.h"
 #include "mongo/logger/redaction.h"
 
 namespace mongo {
@@ -63,6 +64,7 @@ namespace {
   indexOptionDefaults: <document>,
   viewOn: <source>,
   pipeline: <pipeline>,
+  materialized: <true|false>,
   collation: <document>,
   writeConcern: <document>,
   comment: <any>
@@ -110,7 +112,7 @@ Status createCollection(OperationContext* opCtx,
             !options["capped"].trueValue() || options["size"].isNumber() ||
                 options.hasField("$nExtents"));
 
-    return writeConflictRetry(opCtx, "create", nss.ns(), [&] {
+    status = writeConflictRetry(opCtx, "create", nss.ns(), [&] {
         Lock::DBLock dbXLock(opCtx, nss.db(), MODE_X);
         const bool shardVersionCheck = true;
 		////DBڣDatabaseImpl::openDbӦDBϢ
@@ -138,6 +140,13 @@ Status createCollection(OperationContext* opCtx,
 
         return Status::OK();
     });
+    if (!status.isOK() || !options["materialized"].trueValue()) {
+        return status;
+    }
+
+    // A materialized view is filled once its creation has committed, in batches which do not hold
+    // the database lock.
+    return MaterializedViewMaintenance::populate(opCtx, nss);
 }
 }  // namespace
 
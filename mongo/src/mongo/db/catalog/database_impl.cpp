@@ -70,6 +70,7 @@
 #include "mongo/db/storage/storage_engine.h"
 #include "mongo/db/storage/storage_options.h"
 #include "mongo/db/system_index.h"
+#include "mongo/db/views/materialized_view_maintenance.h"
 #include "mongo/db/views/view_catalog.h"
 #include "mongo/platform/random.h"
 #include "mongo/stdx/memory.h"
@@ -472,7 +473,11 @@ void DatabaseImpl::getStats(OperationContext* opCtx, BSONObjBuilder* output, dou
 
 //viewأԺпٷ
 Status DatabaseImpl::dropView(OperationContext* opCtx, StringData fullns) {
+    auto view = _views.lookup(opCtx, fullns);
     Status status = _views.dropView(opCtx, NamespaceString(fullns));
+    if (status.isOK() && view && view->isMaterialized()) {
+        MaterializedViewMaintenance::drop(opCtx, this->_this, *view);
+    }
     Top::get(opCtx->getServiceContext()).collectionDropped(fullns);
     return status;
 }
@@ -509,7 +514,11 @@ Status DatabaseImpl::dropCollection(OperationContext* opCtx,
         }
     }
 
-    return dropCollectionEvenIfSystem(opCtx, nss, dropOpTime);
+    Status status = dropCollectionEvenIfSystem(opCtx, nss, dropOpTime);
+    if (status.isOK()) {
+        MaterializedViewMaintenance::onDropCollection(opCtx, this->_this, nss);
+    }
+    return status;
 }
 
 //dropɾCmdDrop::errmsgRun->dropCollection->DatabaseImpl::dropCollectionEvenIfSystem
@@ -858,7 +867,19 @@ Status DatabaseImpl::createView(OperationContext* opCtx,
         return Status(ErrorCodes::InvalidNamespace,
                       str::stream() << "invalid namespace name for a view: " + nss.toString());
 
-    return _views.createView(opCtx, nss, viewOnNss, BSONArray(options.pipeline), options.collation);
+    Status status = _views.createView(opCtx,
+                                      nss,
+                                      viewOnNss,
+                                      BSONArray(options.pipeline),
+                                      options.collation,
+                                      options.materialized);
+    if (!status.isOK() || !options.materialized)
+        return status;
+
+    auto view = _views.lookup(opCtx, nss.ns());
+    invariant(view);
+    MaterializedViewMaintenance::build(opCtx, this->_this, *view);
+    return Status::OK();
 }
 
 //AutoGetDb::AutoGetDbAutoGetOrCreateDb::AutoGetOrCreateDb->DatabaseHolderImpl::getDatabaseHolderImpl._dbsһȡDatabase
@@ -52,6 +52,7 @@
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/s/collection_sharding_state.h"
 #include "mongo/db/service_context.h"
+#include "mongo/db/views/materialized_view_maintenance.h"
 #include "mongo/util/log.h"
 #include "mongo/util/scopeguard.h"
 
@@ -168,7 +169,7 @@ Status renameCollectionCommon(OperationContext* opCtx,
     auto sourceUUID = sourceColl->uuid();
     // If we are renaming in the same database, just rename the namespace and we're done.
     if (sourceDB == targetDB) {
-        return writeConflictRetry(opCtx, "renameCollection", target.ns(), [&] {
+        status = writeConflictRetry(opCtx, "renameCollection", target.ns(), [&] {
             WriteUnitOfWork wunit(opCtx);
             auto opObserver = getGlobalServiceContext()->getOpObserver();
             if (!targetColl) {
@@ -184,6 +185,7 @@ Status renameCollectionCommon(OperationContext* opCtx,
                 }
                 opObserver->onRenameCollection(
                     opCtx, source, target, sourceUUID, options.dropTarget, {}, stayTemp);
+                MaterializedViewMaintenance::onRenameCollection(opCtx, targetDB, source, target);
                 wunit.commit();
                 return Status::OK();
             }
@@ -206,22 +208,35 @@ Status renameCollectionCommon(OperationContext* opCtx,
                 renameOpTime = renameOpTimeFromApplyOps;
             }
 
-            // No logOp necessary because the entire renameCollection command is one logOp.
-            repl::UnreplicatedWritesBlock uwb(opCtx);
+            {
+                // No logOp necessary because the entire renameCollection command is one logOp.
+                repl::UnreplicatedWritesBlock uwb(opCtx);
 
-            status = targetDB->dropCollection(opCtx, target.ns(), renameOpTime);
-            if (!status.isOK()) {
-                return status;
-            }
+                status = targetDB->dropCollection(opCtx, target.ns(), renameOpTime);
+                if (!status.isOK()) {
+                    return status;
+                }
 
-            status = targetDB->renameCollection(opCtx, source.ns(), target.ns(), options.stayTemp);
-            if (!status.isOK()) {
-                return status;
+                status =
+                    targetDB->renameCollection(opCtx, source.ns(), target.ns(), options.stayTemp);
+                if (!status.isOK()) {
+                    return status;
+                }
             }
+            MaterializedViewMaintenance::onRenameCollection(opCtx, targetDB, source, target);
 
             wunit.commit();
             return Status::OK();
         });
+        if (!status.isOK()) {
+            return status;
+        }
+
+        // The materialized views on the renamed collection are built without the database lock.
+        ctx.reset();
+        dbWriteLock.reset();
+        MaterializedViewMaintenance::populateViewsOn(opCtx, target);
+        return Status::OK();
     }
 
 
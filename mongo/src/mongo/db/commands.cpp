@@ -48,6 +48,7 @@
 #include "mongo/db/curop.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/db/operation_context.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/rpc/write_concern_error_detail.h"
 #include "mongo/s/stale_exception.h"
@@ -73,6 +74,8 @@ namespace {
 ExportedServerParameter<bool, ServerParameterType::kStartupOnly> testCommandsParameter(
     ServerParameterSet::getGlobal(), "enableTestCommands", &Command::testCommandsEnabled);
 
+const auto replySegmentSinkDecoration = OperationContext::declareDecoration<MessageSegmentSink*>();
+
 const char kWriteConcernField[] = "writeConcern";
 const WriteConcernOptions kMajorityWriteConcern(
     WriteConcernOptions::kMajority,
@@ -235,6 +238,14 @@ Status Command::explain(OperationContext* opCtx,
     return {ErrorCodes::IllegalOperation, str::stream() << "Cannot explain cmd: " << getName()};
 }
 
+MessageSegmentSink* Command::getReplySegmentSink(OperationContext* opCtx) {
+    return replySegmentSinkDecoration(opCtx);
+}
+
+void Command::setReplySegmentSink(OperationContext* opCtx, MessageSegmentSink* sink) {
+    replySegmentSinkDecoration(opCtx) = sink;
+}
+
 BSONObj Command::runCommandDirectly(OperationContext* opCtx, const OpMsgRequest& request) {
 	//ҵӦcommand
 	auto command = Command::findCommand(request.getCommandName());
@@ -49,6 +49,7 @@
 
 namespace mongo {
 
+class MessageSegmentSink;
 class OperationContext;
 class Timer;
 
@@ -725,6 +726,14 @@ public:
                                      rpc::ReplyBuilderInterface* replyBuilder,
                                      const Command& command);
 
+    /**
+     * The sink through which cursor batches in the reply to the command running on 'opCtx' may
+     * send documents from their own buffers, or nullptr if the reply must be built contiguously.
+     * Command dispatch sets it for the duration of run().
+     */
+    static MessageSegmentSink* getReplySegmentSink(OperationContext* opCtx);
+    static void setReplySegmentSink(OperationContext* opCtx, MessageSegmentSink* sink);
+
     /**
      * This function checks if a command is a user management command by name.
      */
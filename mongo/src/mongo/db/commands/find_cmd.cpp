@@ -34,19 +34,25 @@
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/client.h"
 #include "mongo/db/clientcursor.h"
+#include "mongo/db/catalog/index_catalog.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/commands/run_aggregate.h"
 #include "mongo/db/concurrency/d_concurrency.h"
 #include "mongo/db/db_raii.h"
 #include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/index/index_access_method.h"
 #include "mongo/db/matcher/extensions_callback_real.h"
+#include "mongo/db/query/collation/collation_index_key.h"
 #include "mongo/db/query/cursor_response.h"
 #include "mongo/db/query/explain.h"
 #include "mongo/db/query/find.h"
 #include "mongo/db/query/find_common.h"
 #include "mongo/db/query/get_executor.h"
+#include "mongo/db/query/indexability.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/repl/replication_coordinator.h"
 #include "mongo/db/s/collection_sharding_state.h"
+#include "mongo/db/s/sharding_state.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/stats/counters.h"
@@ -58,6 +64,96 @@ namespace {
 
 const auto kTermField = "term"_sd;
 
+/**
+ * Returns true if 'qr' asks for at most the single whole document with an exact _id value, and so
+ * may be answered by runIdPointLookup() without canonicalizing the query.
+ */
+bool isIdPointLookup(const QueryRequest& qr) {
+    if (!internalQueryEnableIdPointOperations.load()) {
+        return false;
+    }
+
+    const BSONObj& filter = qr.getFilter();
+    if (filter.nFields() != 1) {
+        return false;
+    }
+    BSONElement idElt = filter.firstElement();
+    if (idElt.fieldNameStringData() != "_id" || !Indexability::isExactBoundsGenerating(idElt)) {
+        return false;
+    }
+
+    if ((qr.getLimit() && *qr.getLimit() <= 0) || (qr.getBatchSize() && *qr.getBatchSize() <= 0)) {
+        return false;
+    }
+
+    return qr.getProj().isEmpty() && qr.getSort().isEmpty() && qr.getHint().isEmpty() &&
+        qr.getMin().isEmpty() && qr.getMax().isEmpty() && qr.getCollation().isEmpty() &&
+        !qr.getSkip() && !qr.getNToReturn() && !qr.isExplain() && !qr.returnKey() &&
+        !qr.showRecordId() && !qr.isSnapshot() && !qr.isTailable() && !qr.isOplogReplay() &&
+        qr.getMaxScan() == 0;
+}
+
+/**
+ * Returns the _id index of 'collection' if the point lookup 'qr' can be served from it, or null
+ * otherwise. The _id value must compare the same under the collection default collation as under
+ * the simple one, and the query must not need shard filtering.
+ */
+const IndexDescriptor* getIdIndexForPointLookup(OperationContext* opCtx,
+                                                Collection* collection,
+                                                const QueryRequest& qr) {
+    if (!collection) {
+        return nullptr;
+    }
+    if (collection->getDefaultCollator() &&
+        CollationIndexKey::isCollatableType(qr.getFilter().firstElement().type())) {
+        return nullptr;
+    }
+    if (ShardingState::get(opCtx)->needCollectionMetadata(opCtx, collection->ns().ns())) {
+        return nullptr;
+    }
+    return collection->getIndexCatalog()->findIdIndex(opCtx);
+}
+
+/**
+ * Answers the point lookup 'qr' by probing 'idIndex' and fetching the matching record directly,
+ * without a PlanExecutor. Fills out CurOp as the IDHACK plan would and appends an exhausted cursor
+ * reply to 'result'.
+ */
+void runIdPointLookup(OperationContext* opCtx,
+                      Collection* collection,
+                      const IndexDescriptor* idIndex,
+                      const QueryRequest& qr,
+                      BSONObjBuilder* result) {
+    const NamespaceString& nss = collection->ns();
+    {
+        stdx::lock_guard<Client> lk(*opCtx->getClient());
+        CurOp::get(opCtx)->setPlanSummary_inlock("IDHACK"_sd);
+    }
+
+    CursorResponseBuilder firstBatch(
+        /*isInitialResponse*/ true, result, Command::getReplySegmentSink(opCtx));
+    long long numResults = 0;
+    RecordId rid =
+        collection->getIndexCatalog()->getIndex(idIndex)->findSingle(opCtx, qr.getFilter());
+    Snapshotted<BSONObj> doc;
+    if (!rid.isNull() && collection->findDoc(opCtx, rid, &doc)) {
+        firstBatch.append(doc.value());
+        numResults++;
+    }
+
+    CollectionShardingState::get(opCtx, nss)->checkShardVersionOrThrow(opCtx);
+
+    auto& opDebug = CurOp::get(opCtx)->debug();
+    opDebug.nreturned = numResults;
+    opDebug.cursorid = -1;
+    opDebug.cursorExhausted = true;
+    opDebug.keysExamined = 1;
+    opDebug.docsExamined = numResults;
+    collection->infoCache()->notifyOfQuery(opCtx, {idIndex->indexName()});
+
+    firstBatch.done(0, nss.ns());
+}
+
 /**
  * A command for running .find() queries.
  findοhttps://docs.mongodb.com/manual/reference/command/find/index.html
@@ -296,23 +392,30 @@ at src/mongo/db/commands/find_cmd.cpp:311
 
         // Finish the parsing step by using the QueryRequest to create a CanonicalQuery.
         ExtensionsCallbackReal extensionsCallback(opCtx, &nss);
-        const boost::intrusive_ptr<ExpressionContext> expCtx;
-        auto statusWithCQ =
+        auto canonicalize = [&]() {
+            const boost::intrusive_ptr<ExpressionContext> expCtx;
 			// Queryм򵥵Ĵ(׼)һЩݽṹCanonicalQuery(׼Query)
-
 		    //qrлȡ_qr_isIsolated_projϢ洢CanonicalQuery
-            CanonicalQuery::canonicalize(opCtx,
-                                         std::move(qr),
-                                         expCtx,
-                                         extensionsCallback,
-                                         MatchExpressionParser::kAllowAllSpecialFeatures &
-                                             ~MatchExpressionParser::AllowedFeatures::kIsolated);
-        if (!statusWithCQ.isOK()) {
-            return appendCommandStatus(result, statusWithCQ.getStatus());
-        }
-
+            return CanonicalQuery::canonicalize(
+                opCtx,
+                std::move(qr),
+                expCtx,
+                extensionsCallback,
+                MatchExpressionParser::kAllowAllSpecialFeatures &
+                    ~MatchExpressionParser::AllowedFeatures::kIsolated);
+        };
+
+        // An exact _id lookup is only canonicalized if it turns out that it cannot be served by
+        // runIdPointLookup() once the collection is known.
 		//ȡֵCanonicalQueryQueryRequestнCanonicalQuery
-        std::unique_ptr<CanonicalQuery> cq = std::move(statusWithCQ.getValue());
+        std::unique_ptr<CanonicalQuery> cq;
+        if (!isIdPointLookup(*qr)) {
+            auto statusWithCQ = canonicalize();
+            if (!statusWithCQ.isOK()) {
+                return appendCommandStatus(result, statusWithCQ.getStatus());
+            }
+            cq = std::move(statusWithCQ.getValue());
+        }
 
 		//std::move(dbSLock)DBLock::~DBLock   
         AutoGetCollectionOrViewForReadCommand ctx(opCtx, nss, std::move(dbSLock));
@@ -324,8 +427,8 @@ at src/mongo/db/commands/find_cmd.cpp:311
 
             // Convert the find command into an aggregation using $match (and other stages, as
             // necessary), if possible.
-            const auto& qr = cq->getQueryRequest();
-            auto viewAggregationCommand = qr.asAggregationCommand();
+            const auto& viewQR = cq ? cq->getQueryRequest() : *qr;
+            auto viewAggregationCommand = viewQR.asAggregationCommand();
             if (!viewAggregationCommand.isOK())
                 return appendCommandStatus(result, viewAggregationCommand.getStatus());
 
@@ -344,6 +447,19 @@ at src/mongo/db/commands/find_cmd.cpp:311
             return status.isOK();
         }
 
+        if (!cq) {
+            if (auto idIndex = getIdIndexForPointLookup(opCtx, collection, *qr)) {
+                runIdPointLookup(opCtx, collection, idIndex, *qr, &result);
+                return true;
+            }
+
+            auto statusWithCQ = canonicalize();
+            if (!statusWithCQ.isOK()) {
+                return appendCommandStatus(result, statusWithCQ.getStatus());
+            }
+            cq = std::move(statusWithCQ.getValue());
+        }
+
 		LOG(2) << "ddd test find::expression: " << redact(cq->toStringShort());
 		/*
 		ddd test find::expression: query: { name: "coutamg1", age: 12.0 } sort: { name: 1.0 } projection: {}
@@ -378,7 +494,8 @@ at src/mongo/db/commands/find_cmd.cpp:311
         const QueryRequest& originalQR = exec->getCanonicalQuery()->getQueryRequest();
 
         // Stream query results, adding them to a BSONArray as we go.
-        CursorResponseBuilder firstBatch(/*isInitialResponse*/ true, &result);
+        CursorResponseBuilder firstBatch(
+            /*isInitialResponse*/ true, &result, Command::getReplySegmentSink(opCtx));
         BSONObj obj;
         PlanExecutor::ExecState state = PlanExecutor::ADVANCED;
         long long numResults = 0;
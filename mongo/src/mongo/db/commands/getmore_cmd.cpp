@@ -321,7 +321,8 @@ public:
         }
 
         CursorId respondWithId = 0;
-        CursorResponseBuilder nextBatch(/*isInitialResponse*/ false, &result);
+        CursorResponseBuilder nextBatch(
+            /*isInitialResponse*/ false, &result, Command::getReplySegmentSink(opCtx));
         BSONObj obj;
         PlanExecutor::ExecState state = PlanExecutor::ADVANCED;
         long long numResults = 0;
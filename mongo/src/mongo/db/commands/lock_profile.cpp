@@ -0,0 +1,165 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <map>
+
+#include "mongo/base/init.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/concurrency/lock_profiler.h"
+#include "mongo/db/concurrency/lock_state.h"
+#include "mongo/db/curop.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/service_context.h"
+
+namespace mongo {
+
+using std::string;
+using std::stringstream;
+
+namespace {
+
+const int kDefaultResourceLimit = 50;
+
+/**
+ * Describes the operation owning each of the requested lockers, for the lock profiler's slow
+ * wait samples. This walks the client list, so it is only run for waits over the threshold.
+ */
+void describeLockers(std::map<LockerId, BSONObj>* descriptions) {
+    if (!hasGlobalServiceContext()) {
+        return;
+    }
+
+    for (ServiceContext::LockedClientsCursor cursor(getGlobalServiceContext());
+         Client* client = cursor.next();) {
+        stdx::lock_guard<Client> lk(*client);
+        const OperationContext* clientOpCtx = client->getOperationContext();
+        if (!clientOpCtx) {
+            continue;
+        }
+
+        auto it = descriptions->find(clientOpCtx->lockState()->getId());
+        if (it == descriptions->end()) {
+            continue;
+        }
+
+        BSONObjBuilder infoBuilder;
+        client->reportState(infoBuilder);
+        infoBuilder.append("opid", clientOpCtx->getOpID());
+
+        CurOp* curOp = CurOp::get(clientOpCtx);
+        infoBuilder.append("op", logicalOpToString(curOp->getLogicalOp()));
+        infoBuilder.append("ns", curOp->getNS());
+        if (curOp->getCommand()) {
+            infoBuilder.append("command", curOp->getCommand()->getName());
+        }
+        infoBuilder.append("microsRunning",
+                           durationCount<Microseconds>(curOp->elapsedTimeTotal()));
+        it->second = infoBuilder.obj();
+    }
+}
+
+MONGO_INITIALIZER(InstallLockProfilerDescriber)(InitializerContext* context) {
+    LockProfiler::get().setLockerDescriber(describeLockers);
+    return Status::OK();
+}
+
+}  // namespace
+
+/**
+ * Admin command to report the lock profiler's per-resource wait histograms and slow wait
+ * samples. The profiler itself is turned on through the 'lockProfilingEnabled' parameter.
+ *
+ *   {lockProfile: 1, limit: <int>, summary: <bool>, reset: <bool>}
+ *
+ * 'limit' caps the number of resources reported, ordered by total wait time. 'summary' reports
+ * only the per-resource-type totals, which is what FTDC collects. 'reset' clears all statistics
+ * after they have been reported.
+ */
+class CmdLockProfile : public BasicCommand {
+public:
+    virtual bool slaveOk() const {
+        return true;
+    }
+
+    virtual bool slaveOverrideOk() const {
+        return true;
+    }
+
+    virtual bool adminOnly() const {
+        return true;
+    }
+
+    virtual bool supportsWriteConcern(const BSONObj& cmd) const {
+        return false;
+    }
+
+    virtual void help(stringstream& help) const {
+        help << "report lock wait histograms per resource and samples of slow lock waits";
+    }
+
+    Status checkAuthForCommand(Client* client,
+                               const std::string& dbname,
+                               const BSONObj& cmdObj) final {
+        bool isAuthorized = AuthorizationSession::get(client)->isAuthorizedForActionsOnResource(
+            ResourcePattern::forClusterResource(), ActionType::serverStatus);
+        return isAuthorized ? Status::OK() : Status(ErrorCodes::Unauthorized, "Unauthorized");
+    }
+
+    CmdLockProfile() : BasicCommand("lockProfile") {}
+
+    bool run(OperationContext* opCtx,
+             const string& dbname,
+             const BSONObj& cmdObj,
+             BSONObjBuilder& result) {
+        int limit = kDefaultResourceLimit;
+        if (BSONElement limitElt = cmdObj["limit"]) {
+            uassert(40688, "'limit' must be a number", limitElt.isNumber());
+            limit = limitElt.numberInt();
+            uassert(40689, "'limit' must be non-negative", limit >= 0);
+        }
+
+        LockProfiler& profiler = LockProfiler::get();
+        if (cmdObj["summary"].trueValue()) {
+            profiler.reportSummary(&result);
+        } else {
+            profiler.report(&result, limit);
+        }
+
+        if (cmdObj["reset"].trueValue()) {
+            profiler.reset();
+        }
+        return true;
+    }
+} cmdLockProfile;
+
+}  // namespace mongo
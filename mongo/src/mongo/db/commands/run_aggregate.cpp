@@ -37,6 +37,7 @@
 
 #include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/catalog/database.h"
+#include "mongo/db/commands.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/db_raii.h"
 #include "mongo/db/exec/pipeline_proxy.h"
@@ -94,7 +95,7 @@ bool handleCursorCommand(OperationContext* opCtx,
 
     long long batchSize = request.getBatchSize();
 
-    CursorResponseBuilder responseBuilder(true, &result);
+    CursorResponseBuilder responseBuilder(true, &result, Command::getReplySegmentSink(opCtx));
     BSONObj next;
     for (int objCount = 0; objCount < batchSize; objCount++) {
         // The initial getNext() on a PipelineProxyStage may be very expensive so we don't
@@ -199,8 +200,11 @@ StatusWith<StringMap<ExpressionContext::ResolvedNamespace>> resolveInvolvedNames
             // snapshot of the view catalog.
             resolvedNamespaces[involvedNs.coll()] = {involvedNs, std::vector<BSONObj>{}};
         } else if (viewCatalog->lookup(opCtx, involvedNs.ns())) {
-            // If 'involvedNs' refers to a view namespace, then we resolve its definition.
-            auto resolvedView = viewCatalog->resolveView(opCtx, involvedNs);
+            // If 'involvedNs' refers to a view namespace, then we resolve its definition along
+            // with its parsed pipeline, which the view catalog caches.
+            std::shared_ptr<const LiteParsedPipeline> resolvedViewLitePipeline;
+            auto resolvedView =
+                viewCatalog->resolveView(opCtx, involvedNs, &resolvedViewLitePipeline);
             if (!resolvedView.isOK()) {
                 return {ErrorCodes::FailedToParse,
                         str::stream() << "Failed to resolve view '" << involvedNs.ns() << "': "
@@ -210,13 +214,10 @@ StatusWith<StringMap<ExpressionContext::ResolvedNamespace>> resolveInvolvedNames
             resolvedNamespaces[involvedNs.coll()] = {resolvedView.getValue().getNamespace(),
                                                      resolvedView.getValue().getPipeline()};
 
-            // We parse the pipeline corresponding to the resolved view in case we must resolve
-            // other view namespaces that are also involved.
-            LiteParsedPipeline resolvedViewLitePipeline(
-                {resolvedView.getValue().getNamespace(), resolvedView.getValue().getPipeline()});
-
+            // We use the parsed pipeline of the resolved view in case we must resolve other view
+            // namespaces that are also involved.
             const auto& resolvedViewInvolvedNamespaces =
-                resolvedViewLitePipeline.getInvolvedNamespaces();
+                resolvedViewLitePipeline->getInvolvedNamespaces();
             involvedNamespacesQueue.insert(involvedNamespacesQueue.end(),
                                            resolvedViewInvolvedNamespaces.begin(),
                                            resolvedViewInvolvedNamespaces.end());
@@ -0,0 +1,200 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/concurrency/admission_control.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/client.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/transport/session.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+MONGO_EXPORT_SERVER_PARAMETER(loadSheddingEnabled, bool, false);
+
+// Zero or less leaves only maxTimeMS to bound the queue time.
+MONGO_EXPORT_SERVER_PARAMETER(loadSheddingMaxQueueTimeMillis, int, 1000);
+
+const OperationContext::Decoration<AdmissionControl> AdmissionControl::get =
+    OperationContext::declareDecoration<AdmissionControl>();
+
+namespace {
+
+const Milliseconds kReleaseRateSampleInterval(50);
+
+/**
+ * Tracks the rate at which one TicketHolder hands out tickets. It is only sampled by operations
+ * which find the holder exhausted, so it costs nothing while the server is not overloaded.
+ */
+struct ReleaseRate {
+    TicketHolder* holder;
+    uint64_t lastReleased;
+    Date_t lastSample;
+    double perSecond;
+};
+
+stdx::mutex releaseRatesMutex;
+std::vector<ReleaseRate> releaseRates;
+
+AtomicInt64 admittedCount;
+AtomicInt64 rejectedPredictedCount;
+AtomicInt64 rejectedQueuedCount;
+AtomicInt64 rejectedTimedOutCount;
+
+/**
+ * Returns the rate at which 'holder' has been releasing tickets, or 0 if it is not yet known.
+ */
+double sampleReleaseRate(TicketHolder* holder, Date_t now) {
+    stdx::lock_guard<stdx::mutex> lk(releaseRatesMutex);
+
+    auto it = std::find_if(releaseRates.begin(), releaseRates.end(), [&](const ReleaseRate& r) {
+        return r.holder == holder;
+    });
+    if (it == releaseRates.end()) {
+        releaseRates.push_back({holder, holder->numReleased(), now, 0});
+        return 0;
+    }
+
+    const uint64_t released = holder->numReleased();
+    if (released < it->lastReleased) {
+        // A different TicketHolder now lives at this address.
+        *it = {holder, released, now, 0};
+        return 0;
+    }
+
+    const Milliseconds elapsed = now - it->lastSample;
+    if (elapsed >= kReleaseRateSampleInterval) {
+        const double rate =
+            (released - it->lastReleased) * 1000.0 / durationCount<Milliseconds>(elapsed);
+
+        // Average with the previous estimate so that a single slow interval does not swing the
+        // prediction for every queued operation.
+        it->perSecond = it->perSecond == 0 ? rate : (it->perSecond + rate) / 2;
+        it->lastReleased = released;
+        it->lastSample = now;
+    }
+    return it->perSecond;
+}
+
+Status overloaded(const std::string& reason) {
+    return Status(ErrorCodes::ServerOverloaded,
+                  str::stream() << "Operation rejected because the server is overloaded: "
+                                << reason);
+}
+
+}  // namespace
+
+StatusWith<Milliseconds> AdmissionControl::beginTicketWait(OperationContext* opCtx,
+                                                           TicketHolder* holder) {
+    if (_admitted || !loadSheddingEnabled.load() || _isExempt(opCtx)) {
+        return Milliseconds::max();
+    }
+    _admitted = true;
+
+    // An operation which does not have to queue for its ticket is admitted however long it took
+    // to get here, since that time may have been spent on things other than queueing, such as
+    // waiting for a readConcern.
+    if (holder->available() > 0) {
+        admittedCount.addAndFetch(1);
+        return Milliseconds::max();
+    }
+
+    const Date_t now = Date_t::now();
+    Milliseconds allowance = Milliseconds::max();
+
+    const int maxQueueTimeMillis = loadSheddingMaxQueueTimeMillis.load();
+    if (maxQueueTimeMillis > 0 && _arrival != Date_t()) {
+        allowance = Milliseconds(maxQueueTimeMillis) - (now - _arrival);
+    }
+    if (opCtx->hasDeadline()) {
+        allowance = std::min(allowance, opCtx->getRemainingMaxTimeMillis());
+    }
+
+    if (allowance == Milliseconds::max()) {
+        admittedCount.addAndFetch(1);
+        return allowance;
+    }
+
+    if (allowance <= Milliseconds(0)) {
+        rejectedQueuedCount.addAndFetch(1);
+        return overloaded(str::stream() << "queued for " << (now - _arrival)
+                                        << " before reaching the storage engine");
+    }
+
+    const double releaseRate = sampleReleaseRate(holder, now);
+    const Milliseconds predicted = predictTicketWait(holder->numWaiting(), releaseRate);
+    if (releaseRate > 0 && predicted > allowance) {
+        rejectedPredictedCount.addAndFetch(1);
+        return overloaded(str::stream() << "expected to wait " << predicted
+                                        << " for a ticket, but only " << allowance
+                                        << " of queue time remains");
+    }
+
+    admittedCount.addAndFetch(1);
+    return allowance;
+}
+
+Status AdmissionControl::ticketWaitTimedOut() {
+    rejectedTimedOutCount.addAndFetch(1);
+    return overloaded("ran out of queue time waiting for a ticket");
+}
+
+void AdmissionControl::appendStats(BSONObjBuilder* builder) {
+    builder->append("enabled", loadSheddingEnabled.load());
+    builder->append("admitted", admittedCount.load());
+    builder->append("rejectedPredicted", rejectedPredictedCount.load());
+    builder->append("rejectedQueued", rejectedQueuedCount.load());
+    builder->append("rejectedTimedOut", rejectedTimedOutCount.load());
+}
+
+Milliseconds AdmissionControl::predictTicketWait(int numWaiting, double releaseRate) {
+    if (releaseRate <= 0) {
+        return Milliseconds::max();
+    }
+    return Milliseconds(static_cast<long long>((numWaiting + 1) * 1000 / releaseRate));
+}
+
+bool AdmissionControl::_isExempt(OperationContext* opCtx) {
+    Client* client = opCtx->getClient();
+    if (!client || client->isInDirectClient()) {
+        return true;
+    }
+
+    const auto& session = client->session();
+    return !session || (session->getTags() & transport::Session::kInternalClient);
+}
+
+}  // namespace mongo
@@ -0,0 +1,108 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/base/status_with.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+class BSONObjBuilder;
+class TicketHolder;
+
+extern AtomicBool loadSheddingEnabled;
+extern AtomicInt32 loadSheddingMaxQueueTimeMillis;
+
+/**
+ * Sheds load at the point where operations queue for storage engine tickets, so that an
+ * overloaded server fails some requests quickly instead of queueing all of them until every
+ * client times out.
+ *
+ * An operation's queue time runs from when its request arrived at the server until it obtains a
+ * ticket. An operation which finds a ticket available is never shed, since it does not queue.
+ * Otherwise, before the operation's first ticket wait, the wait is predicted from the number of
+ * threads already waiting and the rate at which tickets are being released. If the prediction,
+ * added to the time already spent queued, exceeds either the operation's maxTimeMS or the
+ * server-wide loadSheddingMaxQueueTimeMillis, the operation fails with ServerOverloaded before
+ * doing any work, which makes it safe to retry. Otherwise the wait is bounded by whatever
+ * remains of the budget and fails the same way if it runs out.
+ *
+ * Operations without a client connection (replication, TTL and other internal threads), those
+ * from connections which identified themselves as internal and DBDirectClient operations are
+ * never shed, and neither is any global lock acquisition after an operation's first.
+ */
+class AdmissionControl {
+public:
+    static const OperationContext::Decoration<AdmissionControl> get;
+
+    // Decoration requires a default constructor.
+    AdmissionControl() = default;
+
+    /**
+     * Records when the request which the operation executes arrived at the server.
+     */
+    void setArrivalTime(Date_t arrival) {
+        _arrival = arrival;
+    }
+
+    /**
+     * Called before the operation waits for a ticket from 'holder'. Returns the longest the
+     * wait may last, which is Milliseconds::max() if the operation is not subject to load
+     * shedding or 'holder' has a ticket available, or ServerOverloaded if the operation should be
+     * rejected outright.
+     */
+    StatusWith<Milliseconds> beginTicketWait(OperationContext* opCtx, TicketHolder* holder);
+
+    /**
+     * Returns the ServerOverloaded error for an operation whose ticket wait reached the limit
+     * returned by beginTicketWait().
+     */
+    static Status ticketWaitTimedOut();
+
+    static void appendStats(BSONObjBuilder* builder);
+
+    /**
+     * Returns how long a thread which starts waiting now should expect to wait for a ticket,
+     * given 'numWaiting' threads ahead of it and tickets being released at 'releaseRate' per
+     * second. Returns Milliseconds::max() if nothing is being released.
+     */
+    static Milliseconds predictTicketWait(int numWaiting, double releaseRate);
+
+private:
+    static bool _isExempt(OperationContext* opCtx);
+
+    Date_t _arrival;
+
+    // Set once the operation has been through admission, after which it is never shed.
+    bool _admitted = false;
+};
+
+}  // namespace mongo
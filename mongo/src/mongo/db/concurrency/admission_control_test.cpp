@@ -0,0 +1,210 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/client.h"
+#include "mongo/db/concurrency/admission_control.h"
+#include "mongo/db/concurrency/d_concurrency.h"
+#include "mongo/db/concurrency/lock_state.h"
+#include "mongo/db/service_context.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/transport/mock_session.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/scopeguard.h"
+
+namespace mongo {
+namespace {
+
+/**
+ * Turns load shedding on with the given queue time budget for the duration of a test.
+ */
+class LoadSheddingEnabledBlock {
+public:
+    explicit LoadSheddingEnabledBlock(int maxQueueTimeMillis)
+        : _wasEnabled(loadSheddingEnabled.load()),
+          _oldMaxQueueTimeMillis(loadSheddingMaxQueueTimeMillis.load()) {
+        loadSheddingEnabled.store(true);
+        loadSheddingMaxQueueTimeMillis.store(maxQueueTimeMillis);
+    }
+
+    ~LoadSheddingEnabledBlock() {
+        loadSheddingEnabled.store(_wasEnabled);
+        loadSheddingMaxQueueTimeMillis.store(_oldMaxQueueTimeMillis);
+    }
+
+private:
+    const bool _wasEnabled;
+    const int _oldMaxQueueTimeMillis;
+};
+
+class AdmissionControlTest : public unittest::Test {
+public:
+    AdmissionControlTest()
+        : _session(transport::MockSession::create(nullptr)),
+          _client(getGlobalServiceContext()->makeClient("admissionControlTest", _session)),
+          _holder(5) {}
+
+    ~AdmissionControlTest() {
+        for (int i = 0; i < _ticketsTaken; i++) {
+            _holder.release();
+        }
+    }
+
+    ServiceContext::UniqueOperationContext makeOpCtx() {
+        auto opCtx = _client->makeOperationContext();
+        opCtx->releaseLockState();
+        opCtx->setLockState(stdx::make_unique<DefaultLockerImpl>());
+        return opCtx;
+    }
+
+    /**
+     * Takes every ticket, so that operations have to queue, until the end of the test.
+     */
+    void takeAllTickets() {
+        while (_holder.tryAcquire()) {
+            _ticketsTaken++;
+        }
+    }
+
+protected:
+    transport::SessionHandle _session;
+    ServiceContext::UniqueClient _client;
+    TicketHolder _holder;
+    int _ticketsTaken = 0;
+};
+
+TEST(AdmissionControlPrediction, WaitGrowsWithQueueAndShrinksWithReleaseRate) {
+    ASSERT_EQ(Milliseconds(10), AdmissionControl::predictTicketWait(0, 100));
+    ASSERT_EQ(Milliseconds(100), AdmissionControl::predictTicketWait(9, 100));
+    ASSERT_EQ(Milliseconds(10), AdmissionControl::predictTicketWait(9, 1000));
+    ASSERT_EQ(Milliseconds::max(), AdmissionControl::predictTicketWait(5, 0));
+}
+
+TEST_F(AdmissionControlTest, DisabledDoesNotLimitWait) {
+    auto opCtx = makeOpCtx();
+    auto& admission = AdmissionControl::get(opCtx.get());
+    admission.setArrivalTime(Date_t::now() - Seconds(10));
+    ASSERT_EQ(Milliseconds::max(),
+              unittest::assertGet(admission.beginTicketWait(opCtx.get(), &_holder)));
+}
+
+TEST_F(AdmissionControlTest, RejectsOperationQueuedBeyondBudget) {
+    LoadSheddingEnabledBlock enabled(100);
+    takeAllTickets();
+    auto opCtx = makeOpCtx();
+    auto& admission = AdmissionControl::get(opCtx.get());
+    admission.setArrivalTime(Date_t::now() - Milliseconds(200));
+    ASSERT_EQ(ErrorCodes::ServerOverloaded,
+              admission.beginTicketWait(opCtx.get(), &_holder).getStatus());
+}
+
+TEST_F(AdmissionControlTest, DoesNotShedWhenATicketIsAvailable) {
+    LoadSheddingEnabledBlock enabled(100);
+    auto opCtx = makeOpCtx();
+    auto& admission = AdmissionControl::get(opCtx.get());
+    admission.setArrivalTime(Date_t::now() - Milliseconds(200));
+    ASSERT_EQ(Milliseconds::max(),
+              unittest::assertGet(admission.beginTicketWait(opCtx.get(), &_holder)));
+}
+
+TEST_F(AdmissionControlTest, LimitsWaitToRemainingBudget) {
+    LoadSheddingEnabledBlock enabled(1000);
+    takeAllTickets();
+    auto opCtx = makeOpCtx();
+    auto& admission = AdmissionControl::get(opCtx.get());
+    admission.setArrivalTime(Date_t::now() - Milliseconds(400));
+    auto limit = unittest::assertGet(admission.beginTicketWait(opCtx.get(), &_holder));
+    ASSERT_GT(limit, Milliseconds(0));
+    ASSERT_LTE(limit, Milliseconds(600));
+}
+
+TEST_F(AdmissionControlTest, LimitsWaitToMaxTimeMS) {
+    LoadSheddingEnabledBlock enabled(0);
+    takeAllTickets();
+    auto opCtx = makeOpCtx();
+    opCtx->setDeadlineAfterNowBy(Milliseconds(50));
+    auto& admission = AdmissionControl::get(opCtx.get());
+    admission.setArrivalTime(Date_t::now());
+    auto limit = unittest::assertGet(admission.beginTicketWait(opCtx.get(), &_holder));
+    ASSERT_GT(limit, Milliseconds(0));
+    ASSERT_LTE(limit, Milliseconds(50));
+}
+
+TEST_F(AdmissionControlTest, OnlyFirstTicketWaitIsLimited) {
+    LoadSheddingEnabledBlock enabled(100);
+    takeAllTickets();
+    auto opCtx = makeOpCtx();
+    auto& admission = AdmissionControl::get(opCtx.get());
+    admission.setArrivalTime(Date_t::now());
+    ASSERT_LTE(unittest::assertGet(admission.beginTicketWait(opCtx.get(), &_holder)),
+               Milliseconds(100));
+    ASSERT_EQ(Milliseconds::max(),
+              unittest::assertGet(admission.beginTicketWait(opCtx.get(), &_holder)));
+}
+
+TEST_F(AdmissionControlTest, InternalClientsAreExempt) {
+    LoadSheddingEnabledBlock enabled(100);
+    _session->setTags(transport::Session::kInternalClient);
+    auto opCtx = makeOpCtx();
+    auto& admission = AdmissionControl::get(opCtx.get());
+    admission.setArrivalTime(Date_t::now() - Seconds(10));
+    ASSERT_EQ(Milliseconds::max(),
+              unittest::assertGet(admission.beginTicketWait(opCtx.get(), &_holder)));
+}
+
+TEST(AdmissionControlExemption, OperationsWithoutASessionAreExempt) {
+    LoadSheddingEnabledBlock enabled(100);
+    TicketHolder holder(5);
+    auto client = getGlobalServiceContext()->makeClient("internalThread");
+    auto opCtx = client->makeOperationContext();
+    auto& admission = AdmissionControl::get(opCtx.get());
+    admission.setArrivalTime(Date_t::now() - Seconds(10));
+    ASSERT_EQ(Milliseconds::max(),
+              unittest::assertGet(admission.beginTicketWait(opCtx.get(), &holder)));
+}
+
+TEST_F(AdmissionControlTest, GlobalLockThrowsWhenTicketWaitRunsOutOfQueueTime) {
+    LoadSheddingEnabledBlock enabled(20);
+    Locker::setGlobalThrottling(&_holder, &_holder);
+    ON_BLOCK_EXIT([] { Locker::setGlobalThrottling(nullptr, nullptr); });
+
+    takeAllTickets();
+
+    auto opCtx = makeOpCtx();
+    AdmissionControl::get(opCtx.get()).setArrivalTime(Date_t::now());
+    ASSERT_THROWS_CODE(Lock::GlobalLock(opCtx.get(), MODE_IX, UINT_MAX),
+                       AssertionException,
+                       ErrorCodes::ServerOverloaded);
+    ASSERT_FALSE(opCtx->lockState()->isLocked());
+    ASSERT_EQ(MODE_NONE, opCtx->lockState()->getLockMode(resourceIdParallelBatchWriterMode));
+}
+
+}  // namespace
+}  // namespace mongo
@@ -35,6 +35,7 @@
 #include <string>
 #include <vector>
 
+#include "mongo/db/concurrency/admission_control.h"
 #include "mongo/db/concurrency/global_lock_acquisition_tracker.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/server_parameters.h"
@@ -42,6 +43,7 @@
 #include "mongo/stdx/memory.h"
 #include "mongo/stdx/mutex.h"
 #include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/stacktrace.h"
@@ -197,7 +199,35 @@ void Lock::GlobalLock::_enqueue(LockMode lockMode, unsigned timeoutMs) {
 
 	//LockerImpl:lockGlobalBegin->LockerImpl<>::_lockGlobalBegin
 	//log() << "ddd test.... global lock, lock mode:" << modeName(lockMode);
-    _result = _opCtx->lockState()->lockGlobalBegin(lockMode, Milliseconds(timeoutMs));
+    // The outermost global lock is where an operation queues for a storage engine ticket, and
+    // so where it may be shed under overload.
+    Milliseconds timeout(timeoutMs);
+    bool shedOnTimeout = false;
+    TicketHolder* holder = _isOutermostLock ? Locker::getGlobalThrottling(lockMode) : nullptr;
+    if (holder) {
+        auto swLimit = AdmissionControl::get(_opCtx).beginTicketWait(_opCtx, holder);
+        if (!swLimit.isOK()) {
+            _unlockPBWM();
+            uassertStatusOK(swLimit.getStatus());
+        }
+        if (swLimit.getValue() < timeout) {
+            timeout = swLimit.getValue();
+            shedOnTimeout = true;
+        }
+    }
+
+    _result = _opCtx->lockState()->lockGlobalBegin(lockMode, timeout);
+
+    if (_result == LOCK_TIMEOUT && shedOnTimeout) {
+        _unlockPBWM();
+        uassertStatusOK(AdmissionControl::ticketWaitTimedOut());
+    }
+}
+
+void Lock::GlobalLock::_unlockPBWM() {
+    if (_opCtx->lockState()->shouldConflictWithSecondaryBatchApplication()) {
+        _pbwm.unlock();
+    }
 }
 
 //Lock::GlobalLock::GlobalLock
@@ -207,8 +237,8 @@ void Lock::GlobalLock::waitForLock(unsigned timeoutMs) {
         _result = _opCtx->lockState()->lockGlobalComplete(Milliseconds(timeoutMs));
     }
 
-    if (_result != LOCK_OK && _opCtx->lockState()->shouldConflictWithSecondaryBatchApplication()) {
-        _pbwm.unlock();
+    if (_result != LOCK_OK) {
+        _unlockPBWM();
     }
 
     if (_opCtx->lockState()->isWriteLocked()) {
@@ -187,6 +187,9 @@ public:
      * acquired during the transaction. Note that any writes are committed in nested WriteUnitOfWork
      * scopes, so write conflicts cannot happen when releasing the GlobalLock.
      *
+     * The first outermost GlobalLock of an operation throws ServerOverloaded if load shedding
+     * rejects the operation while it queues for a ticket, see AdmissionControl.
+     *
      * NOTE: Does not acquire flush lock.
      */  
     //ȫʹÿԲο lock_stat_test.cppеĲ
@@ -233,6 +236,7 @@ public:
     private:
         void _enqueue(LockMode lockMode, unsigned timeoutMs);
         void _unlock();
+        void _unlockPBWM();
 
         //в_opCtx_lockerlocker
         OperationContext* const _opCtx;
@@ -1050,6 +1050,25 @@ TEST_F(DConcurrencyTestFixture, PerformanceCollectionIntentExclusiveLock) {
         kMaxPerfThreads);
 }
 
+TEST_F(DConcurrencyTestFixture, PerformanceCollectionIntentLocksWithOccasionalConflicts) {
+    std::vector<std::pair<ServiceContext::UniqueClient, ServiceContext::UniqueOperationContext>>
+        clients = makeKClientsWithLockers<DefaultLockerImpl>(kMaxPerfThreads);
+    ForceSupportsDocLocking supported(true);
+    std::array<int64_t, kMaxPerfThreads> calls{};
+    perfTest(
+        [&](int threadId) {
+            // Every so often the first thread takes a conflicting database lock, which moves the
+            // intent locks held by the other threads off the lock-free fast path.
+            if (threadId == 0 && ++calls[threadId] % 1000 == 0) {
+                Lock::DBLock dlk(clients[threadId].second.get(), "test", MODE_X);
+                return;
+            }
+            Lock::DBLock dlk(clients[threadId].second.get(), "test", MODE_IX);
+            Lock::CollectionLock clk(clients[threadId].second->lockState(), "test.coll", MODE_IX);
+        },
+        kMaxPerfThreads);
+}
+
 TEST_F(DConcurrencyTestFixture, PerformanceMMAPv1CollectionSharedLock) {
     std::vector<std::pair<ServiceContext::UniqueClient, ServiceContext::UniqueOperationContext>>
         clients = makeKClientsWithLockers<DefaultLockerImpl>(kMaxPerfThreads);
@@ -118,6 +118,8 @@ featdoc:PRIMARY>
 
 #include "mongo/db/concurrency/lock_manager.h"
 
+#include <boost/align/aligned_alloc.hpp>
+#include <new>
 #include <third_party/murmurhash3/MurmurHash3.h>
 
 #include "mongo/base/data_type_endian.h"
@@ -131,6 +133,11 @@ featdoc:PRIMARY>
 #include "mongo/util/log.h"
 #include "mongo/util/stringutils.h"
 #include "mongo/util/timer.h"
+#include "mongo/util/with_alignment.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 namespace mongo {
 namespace {
@@ -237,6 +244,86 @@ MONGO_STATIC_ASSERT((sizeof(LockRequestStatusNames) / sizeof(LockRequestStatusNa
 
 }  // namespace
 
+/**
+ * The intent fast path lets IS and IX requests on a hot resource be granted without taking any
+ * mutex. A slot is owned by the LockHead of one resource and holds one counter word per stripe.
+ * A request is granted by atomically incrementing the IS or IX count in the stripe of the CPU it
+ * runs on, and is released by decrementing it again.
+ *
+ * The slot is enabled while the LockHead has no conflicts and only intent modes granted. The first
+ * request that needs the LockHead (an S or X request, or a conversion) revokes it under the bucket
+ * mutex: the revoked bit is set in every stripe, which fails all further fast path acquisitions,
+ * and the counts found at that point are added to the LockHead's granted counts. Requests that are
+ * released afterwards see the revoked bit, or a newer generation if the slot was enabled again in
+ * the meantime, and release their grant on the LockHead instead.
+ *
+ * Slots are claimed from a small table. A resource that finds no free slot, and any resource type
+ * other than global, database and collection, keeps using the PartitionedLockHeads. Requests
+ * granted on a slot are not visible to the DeadlockDetector, which is why the MMAP V1 flush lock,
+ * the one resource locked with deadlock detection, never uses the fast path.
+ */
+struct FastPathLockSlot {
+    static const unsigned kNumStripes = 32;
+
+    // Layout of a stripe word: the IS count in the low 20 bits, the IX count in the next 20 bits,
+    // then the revoked bit and a 23 bit generation, which is bumped every time the slot is enabled.
+    static const int kCountBits = 20;
+    static const uint64_t kCountMask = (1ULL << kCountBits) - 1;
+    static const uint64_t kRevokedBit = 1ULL << (2 * kCountBits);
+    static const int kGenerationShift = 2 * kCountBits + 1;
+    static const uint64_t kGenerationMask = (1ULL << (64 - kGenerationShift)) - 1;
+
+    static uint64_t unit(LockMode mode) {
+        invariant(mode == MODE_IS || mode == MODE_IX);
+        return mode == MODE_IS ? 1ULL : (1ULL << kCountBits);
+    }
+
+    static uint32_t count(uint64_t word, LockMode mode) {
+        return (word / unit(mode)) & kCountMask;
+    }
+
+    static uint32_t generation(uint64_t word) {
+        return word >> kGenerationShift;
+    }
+
+    /**
+     * Whether requests for 'resId' may use the fast path at all.
+     */
+    static bool supports(ResourceId resId) {
+        const ResourceType type = resId.getType();
+        return type == RESOURCE_GLOBAL || type == RESOURCE_DATABASE ||
+            type == RESOURCE_COLLECTION;
+    }
+
+    /**
+     * Returns the stripe to be used by the calling thread.
+     */
+    static uint32_t currentStripe(const LockRequest* request) {
+#if defined(__linux__)
+        const int cpu = sched_getcpu();
+        if (cpu >= 0) {
+            return static_cast<uint32_t>(cpu) % kNumStripes;
+        }
+#endif
+        return request->locker->getId() % kNumStripes;
+    }
+
+    struct Stripe {
+        AtomicUInt64 word;
+    };
+
+    // The resource owning this slot, or 0 if the slot is free. Only changes while all the stripes
+    // are revoked, under the bucket mutex of the resource.
+    AtomicUInt64 resourceId;
+
+    // The same resource, set when the slot is claimed. Only read while the slot cannot change
+    // owners.
+    ResourceId owner;
+
+    // Every stripe is on its own cache line.
+    CacheAligned<Stripe> stripes[kNumStripes];
+};
+
 /**
  * There is one of these objects for each resource that has a lock request. Empty objects (i.e.
  * LockHead with no requests) are allowed to exist on the lock manager's hash table.
@@ -272,6 +359,10 @@ struct LockHead { //LockHead::newRequest
 
         conversionsCount = 0;
         compatibleFirstCount = 0;
+
+        fastPathSlot = nullptr;
+        fastPathEnabled = false;
+        memset(fastPathGrantedCounts, 0, sizeof(fastPathGrantedCounts));
     }
 
     /**
@@ -383,6 +474,75 @@ struct LockHead { //LockHead::newRequest
      */
     void migratePartitionedLockHeads();
 
+    /**
+     * Starts a new generation of 'fastPathSlot', on which intent requests can be granted without
+     * the bucket mutex.
+     */
+    void enableFastPath() {
+        invariant(fastPathSlot && !fastPathEnabled);
+        invariant(!(grantedModes & ~intentModes) && !conflictModes);
+
+        // All the stripes are revoked and belong to the same generation.
+        const uint64_t generation =
+            (FastPathLockSlot::generation(fastPathSlot->stripes[0].word.load()) + 1) &
+            FastPathLockSlot::kGenerationMask;
+        for (auto& stripe : fastPathSlot->stripes) {
+            stripe.word.store(generation << FastPathLockSlot::kGenerationShift);
+        }
+        fastPathEnabled = true;
+    }
+
+    /**
+     * Stops granting requests on 'fastPathSlot' and takes over the requests granted on it so far,
+     * so that they are accounted for in the granted modes.
+     */
+    void revokeFastPath() {
+        invariant(fastPathEnabled);
+
+        for (auto& stripe : fastPathSlot->stripes) {
+            uint64_t word = stripe.word.load();
+            while (true) {
+                invariant(!(word & FastPathLockSlot::kRevokedBit));
+                const uint64_t prev =
+                    stripe.word.compareAndSwap(word, word | FastPathLockSlot::kRevokedBit);
+                if (prev == word) {
+                    break;
+                }
+                word = prev;
+            }
+
+            for (LockMode mode : {MODE_IS, MODE_IX}) {
+                const uint32_t count = FastPathLockSlot::count(word, mode);
+                if (count > 0) {
+                    fastPathGrantedCounts[mode] += count;
+                    grantedCounts[mode] += count;
+                    grantedModes |= modeMask(mode);
+                }
+            }
+        }
+        fastPathEnabled = false;
+    }
+
+    /**
+     * True iff requests granted on the fast path hold this lock. If 'fastPathEnabled', this reads
+     * the stripes and so is only a snapshot.
+     */
+    bool hasFastPathGrants() const {
+        if (fastPathGrantedCounts[MODE_IS] || fastPathGrantedCounts[MODE_IX]) {
+            return true;
+        }
+        if (fastPathEnabled) {
+            for (const auto& stripe : fastPathSlot->stripes) {
+                const uint64_t word = stripe.word.load();
+                if (FastPathLockSlot::count(word, MODE_IS) ||
+                    FastPathLockSlot::count(word, MODE_IX)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
 	/*ǳMongoDBе https://mp.weixin.qq.com/s/aD6AySeHX8uqMlg9NgvppA?spm=a2c4e.11153940.blogcont655101.6.6fca281cYe2TH0
 	˼볢
 	ǷMongoDBĽṹͼڶdb1˴ISҪdb1IXΪ˼
@@ -485,6 +645,23 @@ struct LockHead { //LockHead::newRequest
     //ӳ䵽LockHead.partitionsУ_partitionsԴϢ(IX IS)ͨLockManager::lock
     std::vector<LockManager::Partition*> partitions;
 
+    //
+    // Intent fast path
+    //
+
+    // The fast path slot claimed for this resource, or null. It stays claimed until the LockHead
+    // is deleted.
+    FastPathLockSlot* fastPathSlot;
+
+    // Whether intent requests may currently be granted on 'fastPathSlot'. Implies the lock has no
+    // conflicts and only has intent modes as grantedModes.
+    bool fastPathEnabled;
+
+    // Counts the requests granted on the fast path, which were taken over when it was revoked and
+    // have not been released yet. They are included in grantedCounts, but are not on the granted
+    // queue.
+    uint32_t fastPathGrantedCounts[LockModesCount];
+
     //
     // Conversion
     //
@@ -607,10 +784,28 @@ const unsigned LockManager::_numLockBuckets(128); //
 // The exact value doesn't appear very important, but should be power of two
 const unsigned LockManager::_numPartitions = 32;
 
+// Only the global lock and the most used databases and collections need the intent fast path, so
+// a small table is enough. Each resource probes a few slots starting at its hash.
+const unsigned LockManager::_numFastPathSlots = 128;
+static const unsigned kFastPathProbes = 8;
+
 //LockManager::LockManager()  _numLockBucketsĬ128
 LockManager::LockManager() {
     _lockBuckets = new LockBucket[_numLockBuckets]; //128
     _partitions = new Partition[_numPartitions]; //32
+
+    // The stripes are cache aligned, which operator new[] does not guarantee before C++17. Free
+    // slots are fully revoked, so that nothing can be granted on them.
+    void* slots = boost::alignment::aligned_alloc(alignof(FastPathLockSlot),
+                                                  sizeof(FastPathLockSlot) * _numFastPathSlots);
+    invariant(slots);
+    _fastPathSlots = static_cast<FastPathLockSlot*>(slots);
+    for (unsigned i = 0; i < _numFastPathSlots; i++) {
+        new (&_fastPathSlots[i]) FastPathLockSlot();
+        for (auto& stripe : _fastPathSlots[i].stripes) {
+            stripe.word.store(FastPathLockSlot::kRevokedBit);
+        }
+    }
 }
 
 LockManager::~LockManager() {
@@ -623,6 +818,10 @@ LockManager::~LockManager() {
 
     delete[] _lockBuckets;
     delete[] _partitions;
+    for (unsigned i = 0; i < _numFastPathSlots; i++) {
+        _fastPathSlots[i].~FastPathLockSlot();
+    }
+    boost::alignment::aligned_free(_fastPathSlots);
 }
 
 //LockerImpl<>::lockBegin
@@ -635,6 +834,14 @@ LockResult LockManager::lock(ResourceId resId, LockRequest* request, LockMode mo
     request->partitioned = (mode == MODE_IX || mode == MODE_IS);
     request->mode = mode;
 
+    // Lock-free fast path for intent locks
+    if (request->partitioned && FastPathLockSlot::supports(resId)) {
+        FastPathLockSlot* slot = _findFastPathSlot(resId);
+        if (slot && _tryLockFastPath(slot, resId, request)) {
+            return LOCK_OK;
+        }
+    }
+
 	/*ȲrequestӦĸۣòλжӦresId ȻӵλĶӦ */
     // For intent modes, try the PartitionedLockHead
     if (request->partitioned) { //
@@ -674,6 +881,20 @@ LockResult LockManager::lock(ResourceId resId, LockRequest* request, LockMode mo
 
 	//ԴϢӦȫIX IS,ͳһ_partitionsͳһ
     if (request->partitioned && !(lock->grantedModes & (~intentModes)) && !lock->conflictModes) {
+        if (FastPathLockSlot::supports(resId)) {
+            if (!lock->fastPathSlot) {
+                lock->fastPathSlot = _claimFastPathSlot(resId);
+            }
+            if (lock->fastPathSlot) {
+                if (!lock->fastPathEnabled) {
+                    lock->enableFastPath();
+                }
+                if (_tryLockFastPath(lock->fastPathSlot, resId, request)) {
+                    return LOCK_OK;
+                }
+            }
+        }
+
         Partition* partition = _getPartition(request);
         stdx::lock_guard<SimpleMutex> scopedLock(partition->mutex);
         PartitionedLockHead* partitionedLock = partition->findOrInsert(resId);
@@ -690,6 +911,9 @@ LockResult LockManager::lock(ResourceId resId, LockRequest* request, LockMode mo
     if (lock->partitioned()) {
         lock->migratePartitionedLockHeads();
     }
+    if (lock->fastPathEnabled) {
+        lock->revokeFastPath();
+    }
 
     request->partitioned = false;
 	//LockHead::newRequest
@@ -736,6 +960,19 @@ LockResult LockManager::convert(ResourceId resId, LockRequest* request, LockMode
     if (lock->partitioned()) {
         lock->migratePartitionedLockHeads();
     }
+    if (lock->fastPathEnabled) {
+        lock->revokeFastPath();
+    }
+
+    if (request->fastPathSlot) {
+        // The grant of this request is now held by the LockHead. Move it to the granted queue, so
+        // that it can be converted like any other request.
+        invariant(lock->fastPathGrantedCounts[request->mode] > 0);
+        lock->fastPathGrantedCounts[request->mode]--;
+        request->fastPathSlot = nullptr;
+        request->lock = lock;
+        lock->grantedList.push_back(request);
+    }
 
     // Construct granted mask without our current mode, so that it is not counted as
     // conflicting
@@ -792,6 +1029,11 @@ bool LockManager::unlock(LockRequest* request) {
 
 	//_partitionsʽϢԴϢӦַֻʽȽϼ
 	//  ֱӴpartitionedLock->grantedList޳request
+    if (request->fastPathSlot) {
+        _unlockFastPath(request);
+        return true;
+    }
+
     if (request->partitioned) {
         // Unlocking a lock that was acquired as partitioned. The lock request may since have
         // moved to the lock head, but there is no safe way to find out without synchronizing
@@ -903,7 +1145,12 @@ void LockManager::_cleanupUnusedLocksInBucket(LockBucket* bucket) {
             lock->migratePartitionedLockHeads();
         }
 
-        if (lock->grantedModes == 0) {//ûmodeϢֱ
+        // Only revoke an idle fast path, so that the hot resources keep theirs.
+        if (lock->fastPathEnabled && !lock->hasFastPathGrants()) {
+            lock->revokeFastPath();
+        }
+
+        if (lock->grantedModes == 0 && !lock->fastPathEnabled) {//ûmodeϢֱ
             invariant(lock->grantedModes == 0);
             invariant(lock->grantedList._front == nullptr);
             invariant(lock->grantedList._back == nullptr);
@@ -913,6 +1160,11 @@ void LockManager::_cleanupUnusedLocksInBucket(LockBucket* bucket) {
             invariant(lock->conversionsCount == 0);
             invariant(lock->compatibleFirstCount == 0);
 
+            if (lock->fastPathSlot) {
+                // The slot is revoked, so it can be handed to another resource.
+                lock->fastPathSlot->resourceId.store(0);
+            }
+
             bucket->data.erase(it++);
             deletedLockHeads++;
             delete lock;
@@ -1035,7 +1287,9 @@ void LockManager::_onLockModeChanged(LockHead* lock, bool checkConflictQueue) {
 
     // This is a convenient place to check that the state of the two request queues is in sync
     // with the bitmask on the modes.
-    invariant((lock->grantedModes == 0) ^ (lock->grantedList._front != nullptr));
+    invariant((lock->grantedModes == 0) ^
+              (lock->grantedList._front != nullptr || lock->fastPathGrantedCounts[MODE_IS] ||
+               lock->fastPathGrantedCounts[MODE_IX]));
     invariant((lock->conflictModes == 0) ^ (lock->conflictList._front != nullptr));
 }
 
@@ -1054,6 +1308,98 @@ LockManager::Partition* LockManager::_getPartition(LockRequest* request) const {
     return &_partitions[request->locker->getId() % _numPartitions]; 
 }
 
+FastPathLockSlot* LockManager::_findFastPathSlot(ResourceId resId) const {
+    for (unsigned i = 0; i < kFastPathProbes; i++) {
+        FastPathLockSlot* slot = &_fastPathSlots[(resId + i) % _numFastPathSlots];
+        if (slot->resourceId.load() == resId) {
+            return slot;
+        }
+    }
+    return nullptr;
+}
+
+FastPathLockSlot* LockManager::_claimFastPathSlot(ResourceId resId) {
+    for (unsigned i = 0; i < kFastPathProbes; i++) {
+        FastPathLockSlot* slot = &_fastPathSlots[(resId + i) % _numFastPathSlots];
+        if (slot->resourceId.compareAndSwap(0, resId) == 0) {
+            slot->owner = resId;
+            return slot;
+        }
+    }
+    return nullptr;
+}
+
+bool LockManager::_tryLockFastPath(FastPathLockSlot* slot, ResourceId resId, LockRequest* request) {
+    const uint32_t stripeNum = FastPathLockSlot::currentStripe(request);
+    AtomicUInt64& word = slot->stripes[stripeNum].word;
+    const uint64_t unit = FastPathLockSlot::unit(request->mode);
+
+    uint64_t current = word.load();
+    while (true) {
+        if (current & FastPathLockSlot::kRevokedBit) {
+            return false;
+        }
+
+        // The slot may have been handed to another resource since it was found. That requires
+        // revoking it and enabling it again with a new generation, so a successful swap of the
+        // word read before this check means the slot was still ours.
+        if (slot->resourceId.load() != resId) {
+            return false;
+        }
+
+        if (FastPathLockSlot::count(current, request->mode) == FastPathLockSlot::kCountMask) {
+            return false;
+        }
+
+        const uint64_t prev = word.compareAndSwap(current, current + unit);
+        if (prev == current) {
+            break;
+        }
+        current = prev;
+    }
+
+    request->fastPathSlot = slot;
+    request->fastPathStripe = stripeNum;
+    request->fastPathGeneration = FastPathLockSlot::generation(current);
+    request->status = LockRequest::STATUS_GRANTED;
+    return true;
+}
+
+void LockManager::_unlockFastPath(LockRequest* request) {
+    invariant(request->status == LockRequest::STATUS_GRANTED);
+
+    FastPathLockSlot* const slot = request->fastPathSlot;
+    AtomicUInt64& word = slot->stripes[request->fastPathStripe].word;
+    const uint64_t unit = FastPathLockSlot::unit(request->mode);
+    request->fastPathSlot = nullptr;
+
+    uint64_t current = word.load();
+    while (!(current & FastPathLockSlot::kRevokedBit) &&
+           FastPathLockSlot::generation(current) == request->fastPathGeneration) {
+        const uint64_t prev = word.compareAndSwap(current, current - unit);
+        if (prev == current) {
+            return;
+        }
+        current = prev;
+    }
+
+    // The fast path was revoked after this request was granted, so the LockHead holds the grant.
+    // The slot cannot change owners while it does.
+    const ResourceId resId = slot->owner;
+    LockBucket* bucket = _getBucket(resId);
+    stdx::lock_guard<SimpleMutex> scopedLock(bucket->mutex);
+
+    LockBucket::Map::iterator it = bucket->data.find(resId);
+    invariant(it != bucket->data.end());
+    LockHead* lock = it->second;
+
+    invariant(lock->fastPathGrantedCounts[request->mode] > 0);
+    lock->fastPathGrantedCounts[request->mode]--;
+    lock->decGrantedModeCount(request->mode);
+
+    _onLockModeChanged(lock, lock->grantedCounts[request->mode] == 0);
+}
+
 void LockManager::dump() const {
     log() << "Dumping LockManager @ " << static_cast<const void*>(this) << '\n';
 
@@ -1220,6 +1566,37 @@ void LockManager::getLockInfoBSON(const std::map<LockerId, BSONObj>& lockToClien
     result->append("lockInfo", lockInfo.arr());
 }
 
+int LockManager::getGrantedLockers(ResourceId resId,
+                                   std::vector<std::pair<LockerId, LockMode>>* holders) {
+    LockBucket* bucket = _getBucket(resId);
+    stdx::lock_guard<SimpleMutex> scopedLock(bucket->mutex);
+
+    LockBucket::Map::iterator it = bucket->data.find(resId);
+    if (it == bucket->data.end()) {
+        return 0;
+    }
+
+    LockHead* lock = it->second;
+    if (lock->partitioned()) {
+        lock->migratePartitionedLockHeads();
+    }
+
+    for (LockRequest* iter = lock->grantedList._front; iter != nullptr; iter = iter->next) {
+        holders->push_back(std::make_pair(iter->locker->getId(), iter->mode));
+    }
+
+    int unattributed =
+        lock->fastPathGrantedCounts[MODE_IS] + lock->fastPathGrantedCounts[MODE_IX];
+    if (lock->fastPathEnabled) {
+        for (const auto& stripe : lock->fastPathSlot->stripes) {
+            const uint64_t word = stripe.word.load();
+            unattributed += FastPathLockSlot::count(word, MODE_IS);
+            unattributed += FastPathLockSlot::count(word, MODE_IX);
+        }
+    }
+    return unattributed;
+}
+
 
 void LockManager::_dumpBucket(const LockBucket* bucket) const {
     for (LockBucket::Map::const_iterator it = bucket->data.begin(); it != bucket->data.end();
@@ -1525,6 +1902,9 @@ void LockRequest::initNew(Locker* locker, LockGrantNotification* notify) {
 
     lock = nullptr;
     partitionedLock = nullptr;
+    fastPathSlot = nullptr;
+    fastPathStripe = 0;
+    fastPathGeneration = 0;
     prev = nullptr;
     next = nullptr;
     status = STATUS_NEW;
@@ -220,6 +220,13 @@ public:
     void getLockInfoBSON(const std::map<LockerId, BSONObj>& lockToClientMap,
                          BSONObjBuilder* result);
 
+    /**
+     * Appends the locker and mode of every request granted on 'resId' and returns the number
+     * of intent grants which were taken through the fast path and so have no request to
+     * attribute them to. Used by the lock profiler to describe who holds a contended resource.
+     */
+    int getGrantedLockers(ResourceId resId, std::vector<std::pair<LockerId, LockMode>>* holders);
+
 private:
     // The deadlock detector needs to access the buckets and locks directly
     friend class DeadlockDetector;
@@ -268,6 +275,30 @@ private:
      */
     Partition* _getPartition(LockRequest* request) const;
 
+    /**
+     * Returns the intent fast path slot currently owned by 'resId', or nullptr. Does not take any
+     * locks.
+     */
+    FastPathLockSlot* _findFastPathSlot(ResourceId resId) const;
+
+    /**
+     * Takes a free intent fast path slot for 'resId', or returns nullptr if none of the slots
+     * that 'resId' may use is free. Must be called under the bucket mutex of 'resId'.
+     */
+    FastPathLockSlot* _claimFastPathSlot(ResourceId resId);
+
+    /**
+     * Attempts to grant the intent mode 'request' by incrementing the counter of the current
+     * CPU's stripe in 'slot'. Fails if the slot is revoked or no longer owned by 'resId'. Does not
+     * take any locks.
+     */
+    bool _tryLockFastPath(FastPathLockSlot* slot, ResourceId resId, LockRequest* request);
+
+    /**
+     * Releases a request that was granted on the intent fast path.
+     */
+    void _unlockFastPath(LockRequest* request);
+
     /**
      * Prints the contents of a bucket to the log.
      */
@@ -330,6 +361,10 @@ private:
     // ҪΪ_lockBucketsͳһǰ_partitionsҪȫϲ_lockBuckets
     //οLockManager::lock
     Partition* _partitions; //
+
+    // Intent fast path slots, claimed by the hottest resources. See FastPathLockSlot.
+    static const unsigned _numFastPathSlots;
+    FastPathLockSlot* _fastPathSlots;
 };
 
 
@@ -41,6 +41,7 @@ namespace mongo {
 
 class Locker;
 
+struct FastPathLockSlot;
 struct LockHead;
 struct PartitionedLockHead;
 
@@ -794,6 +795,19 @@ struct LockRequest { // һ
     // Protected by LockHead bucket's mutex
     PartitionedLockHead* partitionedLock; 
 
+    // Pointer to the intent fast path slot on which this request was granted, or null. Such a
+    // request is on neither a LockHead nor a PartitionedLockHead: its grant is an increment of
+    // the counter of stripe 'fastPathStripe' of the slot, made while the slot was at generation
+    // 'fastPathGeneration'. If the slot has been revoked since, the grant is held by the LockHead
+    // on the request's behalf.
+    //
+    // Written by LockManager on Locker thread
+    // Read by LockManager on Locker thread
+    // No synchronization
+    FastPathLockSlot* fastPathSlot;
+    uint32_t fastPathStripe;
+    uint32_t fastPathGeneration;
+
     // The linked list chain on which this request hangs off the owning lock head. The reason
     // intrusive linked list is used instead of the std::list class is to allow for entries to be
     // removed from the middle of the list in O(1) time, if they are known instead of having to
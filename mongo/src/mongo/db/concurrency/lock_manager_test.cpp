@@ -26,9 +26,16 @@
  *    it in the license file.
  */
 
+#include <memory>
+#include <vector>
+
 #include "mongo/db/concurrency/lock_manager_defs.h"
 #include "mongo/db/concurrency/lock_manager_test_help.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
 
@@ -597,6 +604,338 @@ TEST(LockManager, Downgrade) {
 }
 
 
+TEST(LockManager, IntentFastPathExclusiveWaitsForAllIntentHolders) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_COLLECTION, std::string("TestDB.collection"));
+
+    MMAPV1LockerImpl lockerIS;
+    LockRequestCombo requestIS(&lockerIS);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestIS, MODE_IS));
+
+    MMAPV1LockerImpl lockerIX;
+    LockRequestCombo requestIX(&lockerIX);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestIX, MODE_IX));
+
+    MMAPV1LockerImpl lockerX;
+    LockRequestCombo requestX(&lockerX);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestX, MODE_X));
+
+    ASSERT(lockMgr.unlock(&requestIS));
+    ASSERT_EQ(0, requestX.numNotifies);
+
+    ASSERT(lockMgr.unlock(&requestIX));
+    ASSERT_EQ(1, requestX.numNotifies);
+    ASSERT_EQ(LOCK_OK, requestX.lastResult);
+
+    // Intent requests must not bypass the granted X lock
+    MMAPV1LockerImpl lockerIS2;
+    LockRequestCombo requestIS2(&lockerIS2);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestIS2, MODE_IS));
+
+    ASSERT(lockMgr.unlock(&requestX));
+    ASSERT_EQ(1, requestIS2.numNotifies);
+    ASSERT_EQ(LOCK_OK, requestIS2.lastResult);
+
+    ASSERT(lockMgr.unlock(&requestIS2));
+}
+
+TEST(LockManager, IntentFastPathSharedWaitsOnlyForIX) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_DATABASE, std::string("TestDB"));
+
+    MMAPV1LockerImpl lockerIS;
+    LockRequestCombo requestIS(&lockerIS);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestIS, MODE_IS));
+
+    MMAPV1LockerImpl lockerIX;
+    LockRequestCombo requestIX(&lockerIX);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestIX, MODE_IX));
+
+    MMAPV1LockerImpl lockerS;
+    LockRequestCombo requestS(&lockerS);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestS, MODE_S));
+
+    ASSERT(lockMgr.unlock(&requestIX));
+    ASSERT_EQ(1, requestS.numNotifies);
+    ASSERT_EQ(LOCK_OK, requestS.lastResult);
+
+    ASSERT(lockMgr.unlock(&requestS));
+    ASSERT(lockMgr.unlock(&requestIS));
+}
+
+TEST(LockManager, IntentFastPathConvertUpgrade) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_COLLECTION, std::string("TestDB.collection"));
+
+    MMAPV1LockerImpl locker1;
+    LockRequestCombo request1(&locker1);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request1, MODE_IS));
+
+    MMAPV1LockerImpl locker2;
+    LockRequestCombo request2(&locker2);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request2, MODE_IS));
+
+    // Upgrade the first IS lock to IX, which must then block an S request
+    ASSERT(LOCK_OK == lockMgr.convert(resId, &request1, MODE_IX));
+    ASSERT(request1.mode == MODE_IX);
+
+    MMAPV1LockerImpl lockerS;
+    LockRequestCombo requestS(&lockerS);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestS, MODE_S));
+
+    ASSERT(!lockMgr.unlock(&request1));
+    ASSERT_EQ(0, requestS.numNotifies);
+    ASSERT(lockMgr.unlock(&request1));
+    ASSERT_EQ(1, requestS.numNotifies);
+
+    ASSERT(lockMgr.unlock(&requestS));
+    ASSERT(lockMgr.unlock(&request2));
+}
+
+TEST(LockManager, IntentFastPathReleaseAfterReenable) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_GLOBAL, ResourceId::SINGLETON_GLOBAL);
+
+    MMAPV1LockerImpl lockerOld;
+    LockRequestCombo requestOld(&lockerOld);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestOld, MODE_IS));
+
+    // A compatible S request still revokes the fast path
+    MMAPV1LockerImpl lockerS;
+    LockRequestCombo requestS(&lockerS);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestS, MODE_S));
+    ASSERT(lockMgr.unlock(&requestS));
+
+    // Once only intent modes are held, new requests use the fast path again
+    MMAPV1LockerImpl lockerNew;
+    LockRequestCombo requestNew(&lockerNew);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestNew, MODE_IX));
+
+    // The request granted before the revocation is released on the LockHead
+    ASSERT(lockMgr.unlock(&requestOld));
+
+    MMAPV1LockerImpl lockerX;
+    LockRequestCombo requestX(&lockerX);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestX, MODE_X));
+
+    ASSERT(lockMgr.unlock(&requestNew));
+    ASSERT_EQ(1, requestX.numNotifies);
+    ASSERT_EQ(LOCK_OK, requestX.lastResult);
+
+    ASSERT(lockMgr.unlock(&requestX));
+}
+
+TEST(LockManager, IntentFastPathManyResources) {
+    LockManager lockMgr;
+    MMAPV1LockerImpl locker;
+
+    // More resources than there are fast path slots, so that some use the partitioned lock heads
+    const int kNumResources = 512;
+    std::vector<std::unique_ptr<LockRequestCombo>> requests;
+    for (int i = 0; i < kNumResources; i++) {
+        const std::string ns = str::stream() << "TestDB.coll" << i;
+        const ResourceId resId(RESOURCE_COLLECTION, ns);
+        requests.emplace_back(stdx::make_unique<LockRequestCombo>(&locker));
+        ASSERT(LOCK_OK == lockMgr.lock(resId, requests.back().get(), MODE_IX));
+    }
+
+    for (int i = 0; i < kNumResources; i++) {
+        const std::string ns = str::stream() << "TestDB.coll" << i;
+        const ResourceId resId(RESOURCE_COLLECTION, ns);
+        MMAPV1LockerImpl lockerX;
+        LockRequestCombo requestX(&lockerX);
+        ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestX, MODE_X));
+
+        ASSERT(lockMgr.unlock(requests[i].get()));
+        ASSERT_EQ(1, requestX.numNotifies);
+        ASSERT(lockMgr.unlock(&requestX));
+    }
+
+    // Slots of the released resources can be reused
+    lockMgr.cleanupUnusedLocks();
+    const ResourceId resId(RESOURCE_COLLECTION, std::string("TestDB.other"));
+    LockRequestCombo request(&locker);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request, MODE_IS));
+    ASSERT(lockMgr.unlock(&request));
+}
+
+/**
+ * Holds a lock for as long as it is in scope, waiting for the grant if the request has to queue.
+ * Meant for threads other than the test's own, so failures are counted rather than asserted.
+ */
+class ScopedLockForThreads {
+public:
+    ScopedLockForThreads(LockManager* lockMgr,
+                         Locker* locker,
+                         ResourceId resId,
+                         LockMode mode,
+                         AtomicInt32* failures)
+        : _lockMgr(lockMgr), _failures(failures) {
+        _request.initNew(locker, &_notify);
+        LockResult result = _lockMgr->lock(resId, &_request, mode);
+        if (result == LOCK_WAITING) {
+            result = _notify.wait(Seconds(60));
+        }
+        if (result != LOCK_OK) {
+            _failures->fetchAndAdd(1);
+        }
+    }
+
+    ~ScopedLockForThreads() {
+        if (!_lockMgr->unlock(&_request)) {
+            _failures->fetchAndAdd(1);
+        }
+    }
+
+private:
+    LockManager* const _lockMgr;
+    AtomicInt32* const _failures;
+    CondVarLockGrantNotification _notify;
+    LockRequest _request;
+};
+
+TEST(LockManager, IntentFastPathConcurrentRevokeAcquireAndRelease) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_COLLECTION, std::string("TestDB.collection"));
+
+    // The lock modes held right now, counted by each thread once its lock is granted and before
+    // it releases it, so that a grant which conflicts with one of them is seen as a failure.
+    AtomicInt32 isHolders;
+    AtomicInt32 ixHolders;
+    AtomicInt32 sHolders;
+    AtomicInt32 xHolders;
+    AtomicInt32 failures;
+    AtomicBool intentThreadsDone;
+
+    const int kIntentThreads = 8;
+    const int kIterations = 20000;
+    std::vector<stdx::thread> intentThreads;
+    for (int t = 0; t < kIntentThreads; t++) {
+        intentThreads.emplace_back([&, t] {
+            MMAPV1LockerImpl locker;
+            const LockMode mode = t % 2 ? MODE_IX : MODE_IS;
+            AtomicInt32& holders = mode == MODE_IX ? ixHolders : isHolders;
+            for (int i = 0; i < kIterations; i++) {
+                ScopedLockForThreads lock(&lockMgr, &locker, resId, mode, &failures);
+                holders.fetchAndAdd(1);
+                if (xHolders.load() || (mode == MODE_IX && sHolders.load())) {
+                    failures.fetchAndAdd(1);
+                }
+                holders.fetchAndSubtract(1);
+            }
+        });
+    }
+
+    // Each S or X grant revokes the fast path, and each release lets it be enabled again.
+    int conflictingGrants = 0;
+    stdx::thread conflictingThread([&] {
+        MMAPV1LockerImpl locker;
+        while (!intentThreadsDone.load()) {
+            {
+                ScopedLockForThreads lock(&lockMgr, &locker, resId, MODE_X, &failures);
+                xHolders.fetchAndAdd(1);
+                if (isHolders.load() || ixHolders.load() || sHolders.load()) {
+                    failures.fetchAndAdd(1);
+                }
+                xHolders.fetchAndSubtract(1);
+            }
+            {
+                ScopedLockForThreads lock(&lockMgr, &locker, resId, MODE_S, &failures);
+                sHolders.fetchAndAdd(1);
+                if (ixHolders.load() || xHolders.load()) {
+                    failures.fetchAndAdd(1);
+                }
+                sHolders.fetchAndSubtract(1);
+            }
+            conflictingGrants++;
+        }
+    });
+
+    for (auto& thread : intentThreads) {
+        thread.join();
+    }
+    intentThreadsDone.store(true);
+    conflictingThread.join();
+
+    ASSERT_EQ(0, failures.load());
+    ASSERT_GT(conflictingGrants, 0);
+
+    // Every grant was released, wherever it was accounted for.
+    MMAPV1LockerImpl lockerX;
+    LockRequestCombo requestX(&lockerX);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestX, MODE_X));
+    ASSERT(lockMgr.unlock(&requestX));
+}
+
+TEST(LockManager, IntentFastPathConcurrentSlotReuse) {
+    LockManager lockMgr;
+
+    // More resources than there are fast path slots, whose slots are freed by the cleanup and
+    // claimed by other resources while intent requests are finding them.
+    const int kNumResources = 512;
+    std::vector<ResourceId> resIds;
+    for (int i = 0; i < kNumResources; i++) {
+        resIds.emplace_back(RESOURCE_COLLECTION, std::string(str::stream() << "TestDB.coll" << i));
+    }
+    std::vector<AtomicInt32> intentHolders(kNumResources);
+    std::vector<AtomicInt32> exclusiveHolders(kNumResources);
+    AtomicInt32 failures;
+    AtomicBool intentThreadsDone;
+
+    const int kIntentThreads = 8;
+    const int kIterations = 20000;
+    std::vector<stdx::thread> intentThreads;
+    for (int t = 0; t < kIntentThreads; t++) {
+        intentThreads.emplace_back([&, t] {
+            MMAPV1LockerImpl locker;
+            for (int i = 0; i < kIterations; i++) {
+                const int r = (i * 7 + t) % kNumResources;
+                ScopedLockForThreads lock(&lockMgr, &locker, resIds[r], MODE_IX, &failures);
+                intentHolders[r].fetchAndAdd(1);
+                if (exclusiveHolders[r].load()) {
+                    failures.fetchAndAdd(1);
+                }
+                intentHolders[r].fetchAndSubtract(1);
+            }
+        });
+    }
+
+    stdx::thread cleanupThread([&] {
+        MMAPV1LockerImpl locker;
+        for (int i = 0; !intentThreadsDone.load(); i++) {
+            const int r = (i * 13) % kNumResources;
+            {
+                ScopedLockForThreads lock(&lockMgr, &locker, resIds[r], MODE_X, &failures);
+                exclusiveHolders[r].fetchAndAdd(1);
+                if (intentHolders[r].load()) {
+                    failures.fetchAndAdd(1);
+                }
+                exclusiveHolders[r].fetchAndSubtract(1);
+            }
+            if (i % 16 == 0) {
+                lockMgr.cleanupUnusedLocks();
+            }
+        }
+    });
+
+    for (auto& thread : intentThreads) {
+        thread.join();
+    }
+    intentThreadsDone.store(true);
+    cleanupThread.join();
+
+    ASSERT_EQ(0, failures.load());
+
+    MMAPV1LockerImpl lockerX;
+    for (const auto& resId : resIds) {
+        LockRequestCombo requestX(&lockerX);
+        ASSERT(LOCK_OK == lockMgr.lock(resId, &requestX, MODE_X));
+        ASSERT(lockMgr.unlock(&requestX));
+    }
+    lockMgr.cleanupUnusedLocks();
+}
+
+
 // Lock conflict matrix tests
 static void checkConflict(LockMode existingMode, LockMode newMode, bool hasConflict) {
     LockManager lockMgr;
@@ -0,0 +1,318 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/concurrency/lock_profiler.h"
+
+#include <algorithm>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/server_parameters.h"
+
+namespace mongo {
+
+MONGO_EXPORT_SERVER_PARAMETER(lockProfilingEnabled, bool, false);
+
+AtomicInt32 lockProfilingSlowWaitMillis(100);
+
+namespace {
+
+class ExportedLockProfilingSlowWaitParameter
+    : public ExportedServerParameter<std::int32_t, ServerParameterType::kStartupAndRuntime> {
+public:
+    ExportedLockProfilingSlowWaitParameter()
+        : ExportedServerParameter<std::int32_t, ServerParameterType::kStartupAndRuntime>(
+              ServerParameterSet::getGlobal(),
+              "lockProfilingSlowWaitMillis",
+              &lockProfilingSlowWaitMillis) {}
+
+    virtual Status validate(const std::int32_t& potentialNewValue) {
+        if (potentialNewValue < 0) {
+            return Status(ErrorCodes::BadValue,
+                          "lockProfilingSlowWaitMillis must be greater than or equal to 0");
+        }
+
+        return Status::OK();
+    }
+
+} exportedLockProfilingSlowWaitParameter;
+
+LockProfiler globalLockProfiler;
+
+void appendHistogram(BSONObjBuilder* builder, const int64_t* counts) {
+    BSONArrayBuilder arr(builder->subarrayStart("histogram"));
+    for (int i = 0; i < LockProfiler::kNumHistogramBuckets; i++) {
+        arr.append(static_cast<long long>(counts[i]));
+    }
+}
+
+}  // namespace
+
+LockProfiler::LockProfiler() {
+    reset();
+}
+
+LockProfiler& LockProfiler::get() {
+    return globalLockProfiler;
+}
+
+bool LockProfiler::isEnabled() {
+    return lockProfilingEnabled.load();
+}
+
+Milliseconds LockProfiler::slowWaitThreshold() {
+    return Milliseconds(lockProfilingSlowWaitMillis.load());
+}
+
+void LockProfiler::setLockerDescriber(LockerDescriber describer) {
+    _describer = std::move(describer);
+}
+
+int LockProfiler::histogramBucket(int64_t waitMicros) {
+    int bucket = 0;
+    for (int64_t bound = kFirstBucketMicros; waitMicros >= bound; bound <<= 1) {
+        if (++bucket == kNumHistogramBuckets - 1) {
+            break;
+        }
+    }
+    return bucket;
+}
+
+void LockProfiler::recordWait(ResourceId resId, LockMode mode, int64_t waitMicros) {
+    const int bucket = histogramBucket(waitMicros);
+
+    TypeStats& typeStats = _typeStats[resId.getType()];
+    typeStats.waits.addAndFetch(1);
+    typeStats.waitMicros.addAndFetch(waitMicros);
+    typeStats.histogram[bucket].addAndFetch(1);
+
+    Partition& partition = _getPartition(resId);
+    stdx::lock_guard<stdx::mutex> lk(partition.mutex);
+
+    ResourceStats* stats = _findOrCreate(&partition, resId);
+    if (!stats) {
+        _untrackedWaits.addAndFetch(1);
+        return;
+    }
+
+    stats->waits++;
+    stats->waitMicros += waitMicros;
+    stats->maxWaitMicros = std::max(stats->maxWaitMicros, waitMicros);
+    stats->waitsByMode[mode]++;
+    stats->histogram[bucket]++;
+}
+
+void LockProfiler::recordSlowWait(ResourceId resId,
+                                  LockMode mode,
+                                  int64_t waitMicros,
+                                  LockerId waiter,
+                                  const HolderList& holders,
+                                  int unattributedHolders) {
+    std::map<LockerId, BSONObj> descriptions;
+    descriptions[waiter] = BSONObj();
+    for (const auto& holder : holders) {
+        descriptions[holder.first] = BSONObj();
+    }
+
+    // Describing lockers walks the client list, so it must not happen under any of our mutexes.
+    if (_describer) {
+        _describer(&descriptions);
+    }
+
+    SlowWait sample;
+    sample.when = Date_t::now();
+    sample.resId = resId;
+    sample.mode = mode;
+    sample.waitMicros = waitMicros;
+    sample.unattributedHolders = unattributedHolders;
+
+    BSONObjBuilder waiterBuilder;
+    waiterBuilder.append("lockerId", static_cast<long long>(waiter));
+    waiterBuilder.appendElements(descriptions[waiter]);
+    sample.waiter = waiterBuilder.obj();
+
+    for (const auto& holder : holders) {
+        BSONObjBuilder holderBuilder;
+        holderBuilder.append("lockerId", static_cast<long long>(holder.first));
+        holderBuilder.append("mode", modeName(holder.second));
+        holderBuilder.appendElements(descriptions[holder.first]);
+        sample.holders.push_back(holderBuilder.obj());
+    }
+
+    // Resource ids are hashes, so remember the namespace the waiter was working on to make the
+    // per-resource report readable. The wait itself is counted by recordWait once it completes.
+    BSONElement waiterNs = sample.waiter["ns"];
+    if (waiterNs.type() == String) {
+        Partition& partition = _getPartition(resId);
+        stdx::lock_guard<stdx::mutex> lk(partition.mutex);
+
+        if (ResourceStats* stats = _findOrCreate(&partition, resId)) {
+            stats->lastWaiterNs = waiterNs.String();
+        }
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_slowWaitsMutex);
+    _slowWaitsRecorded++;
+    _slowWaits.push_back(std::move(sample));
+    if (_slowWaits.size() > kMaxSlowWaits) {
+        _slowWaits.pop_front();
+    }
+}
+
+LockProfiler::ResourceStats* LockProfiler::_findOrCreate(Partition* partition, ResourceId resId) {
+    auto it = partition->resources.find(resId);
+    if (it == partition->resources.end()) {
+        if (partition->resources.size() >= kMaxTrackedResources / kNumPartitions) {
+            return nullptr;
+        }
+        it = partition->resources.emplace(resId, ResourceStats()).first;
+    }
+    return &it->second;
+}
+
+void LockProfiler::report(BSONObjBuilder* builder, int limit) const {
+    builder->append("enabled", isEnabled());
+    builder->append("slowWaitMillis", durationCount<Milliseconds>(slowWaitThreshold()));
+    {
+        BSONArrayBuilder bounds(builder->subarrayStart("histogramLowerBoundsMicros"));
+        bounds.append(0LL);
+        for (int i = 1; i < kNumHistogramBuckets; i++) {
+            bounds.append(static_cast<long long>(kFirstBucketMicros << (i - 1)));
+        }
+    }
+
+    std::vector<std::pair<ResourceId, ResourceStats>> resources;
+    for (int i = 0; i < kNumPartitions; i++) {
+        stdx::lock_guard<stdx::mutex> lk(_partitions[i].mutex);
+        resources.insert(
+            resources.end(), _partitions[i].resources.begin(), _partitions[i].resources.end());
+    }
+
+    const size_t numReported = std::min(resources.size(), static_cast<size_t>(std::max(limit, 0)));
+    std::partial_sort(resources.begin(),
+                      resources.begin() + numReported,
+                      resources.end(),
+                      [](const std::pair<ResourceId, ResourceStats>& lhs,
+                         const std::pair<ResourceId, ResourceStats>& rhs) {
+                          return lhs.second.waitMicros > rhs.second.waitMicros;
+                      });
+
+    builder->append("trackedResources", static_cast<long long>(resources.size()));
+    builder->append("untrackedWaits", _untrackedWaits.load());
+
+    BSONArrayBuilder resourcesBuilder(builder->subarrayStart("resources"));
+    for (size_t i = 0; i < numReported; i++) {
+        const ResourceId& resId = resources[i].first;
+        const ResourceStats& stats = resources[i].second;
+
+        BSONObjBuilder resourceBuilder(resourcesBuilder.subobjStart());
+        resourceBuilder.append("resourceId", resId.toString());
+        resourceBuilder.append("type", resourceTypeName(resId.getType()));
+        if (!stats.lastWaiterNs.empty()) {
+            resourceBuilder.append("lastWaiterNs", stats.lastWaiterNs);
+        }
+        resourceBuilder.append("waits", static_cast<long long>(stats.waits));
+        resourceBuilder.append("waitMicros", static_cast<long long>(stats.waitMicros));
+        resourceBuilder.append("maxWaitMicros", static_cast<long long>(stats.maxWaitMicros));
+        {
+            BSONObjBuilder modesBuilder(resourceBuilder.subobjStart("waitsByMode"));
+            for (int mode = 1; mode < LockModesCount; mode++) {
+                if (stats.waitsByMode[mode]) {
+                    modesBuilder.append(modeName(static_cast<LockMode>(mode)),
+                                        static_cast<long long>(stats.waitsByMode[mode]));
+                }
+            }
+        }
+        appendHistogram(&resourceBuilder, stats.histogram);
+    }
+    resourcesBuilder.doneFast();
+
+    stdx::lock_guard<stdx::mutex> lk(_slowWaitsMutex);
+    builder->append("slowWaitsRecorded", static_cast<long long>(_slowWaitsRecorded));
+
+    BSONArrayBuilder slowWaitsBuilder(builder->subarrayStart("slowWaits"));
+    for (const auto& sample : _slowWaits) {
+        BSONObjBuilder sampleBuilder(slowWaitsBuilder.subobjStart());
+        sampleBuilder.append("when", sample.when);
+        sampleBuilder.append("resourceId", sample.resId.toString());
+        sampleBuilder.append("type", resourceTypeName(sample.resId.getType()));
+        sampleBuilder.append("mode", modeName(sample.mode));
+        sampleBuilder.append("waitMicros", static_cast<long long>(sample.waitMicros));
+        sampleBuilder.append("waiter", sample.waiter);
+        sampleBuilder.append("holders", sample.holders);
+        if (sample.unattributedHolders) {
+            sampleBuilder.append("unattributedIntentHolders", sample.unattributedHolders);
+        }
+    }
+}
+
+void LockProfiler::reportSummary(BSONObjBuilder* builder) const {
+    builder->append("enabled", isEnabled());
+
+    // Index 0 is the invalid resource type, which is never waited on.
+    for (int i = 1; i < ResourceTypesCount; i++) {
+        const TypeStats& typeStats = _typeStats[i];
+
+        int64_t histogram[kNumHistogramBuckets];
+        for (int bucket = 0; bucket < kNumHistogramBuckets; bucket++) {
+            histogram[bucket] = typeStats.histogram[bucket].load();
+        }
+
+        BSONObjBuilder typeBuilder(
+            builder->subobjStart(resourceTypeName(static_cast<ResourceType>(i))));
+        typeBuilder.append("waits", typeStats.waits.load());
+        typeBuilder.append("waitMicros", typeStats.waitMicros.load());
+        appendHistogram(&typeBuilder, histogram);
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_slowWaitsMutex);
+    builder->append("slowWaitsRecorded", static_cast<long long>(_slowWaitsRecorded));
+}
+
+void LockProfiler::reset() {
+    for (int i = 0; i < ResourceTypesCount; i++) {
+        _typeStats[i].waits.store(0);
+        _typeStats[i].waitMicros.store(0);
+        for (int bucket = 0; bucket < kNumHistogramBuckets; bucket++) {
+            _typeStats[i].histogram[bucket].store(0);
+        }
+    }
+    _untrackedWaits.store(0);
+
+    for (int i = 0; i < kNumPartitions; i++) {
+        stdx::lock_guard<stdx::mutex> lk(_partitions[i].mutex);
+        _partitions[i].resources.clear();
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_slowWaitsMutex);
+    _slowWaits.clear();
+    _slowWaitsRecorded = 0;
+}
+
+}  // namespace mongo
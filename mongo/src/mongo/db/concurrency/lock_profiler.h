@@ -0,0 +1,195 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/db/concurrency/lock_manager_defs.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+class BSONObjBuilder;
+
+/**
+ * Server parameters controlling the lock profiler. Both may be changed at runtime.
+ */
+extern AtomicBool lockProfilingEnabled;
+extern AtomicInt32 lockProfilingSlowWaitMillis;
+
+/**
+ * Opt-in lock contention profiler. While the 'lockProfilingEnabled' server parameter is set,
+ * every lock acquisition which had to wait records its wait time in a per-ResourceId histogram,
+ * and every wait which exceeds 'lockProfilingSlowWaitMillis' additionally captures who was
+ * waiting and who was holding the resource at the time.
+ *
+ * Only waits are recorded, so when profiling is enabled the cost on the uncontended acquisition
+ * path is zero. The per-resource table is bounded; waits on resources beyond the bound are still
+ * counted in the per-resource-type totals, which is what FTDC collects.
+ */
+class LockProfiler {
+    MONGO_DISALLOW_COPYING(LockProfiler);
+
+public:
+    /**
+     * Wait times are bucketed by powers of two of microseconds. Bucket 0 holds waits shorter
+     * than kFirstBucketMicros and the last bucket holds everything above its lower bound.
+     */
+    static const int kNumHistogramBuckets = 18;
+    static const int64_t kFirstBucketMicros = 128;
+
+    static const size_t kMaxTrackedResources = 10000;
+    static const size_t kMaxSlowWaits = 100;
+
+    /**
+     * Fills in a description for each LockerId key present in the map. Lockers which are not
+     * found (for example because they already finished) are left with an empty object.
+     */
+    using LockerDescriber = stdx::function<void(std::map<LockerId, BSONObj>*)>;
+
+    /**
+     * Granted requests on a resource, as returned by LockManager::getGrantedLockers.
+     */
+    typedef std::vector<std::pair<LockerId, LockMode>> HolderList;
+
+    LockProfiler();
+
+    static LockProfiler& get();
+
+    /**
+     * Whether profiling is turned on and the slow wait threshold. Both are runtime settable
+     * server parameters.
+     */
+    static bool isEnabled();
+    static Milliseconds slowWaitThreshold();
+
+    /**
+     * Installs the function used to describe the waiter and holders of a slow wait. The lock
+     * manager library cannot see operations, so the command layer provides this at startup.
+     */
+    void setLockerDescriber(LockerDescriber describer);
+
+    /**
+     * Records a completed (granted, timed out or deadlocked) wait on 'resId'.
+     */
+    void recordWait(ResourceId resId, LockMode mode, int64_t waitMicros);
+
+    /**
+     * Records a wait which is still in progress and has exceeded the slow wait threshold.
+     * 'holders' are the requests granted on the resource at this point and
+     * 'unattributedHolders' is the number of intent grants which were taken through the lock
+     * manager's fast path and therefore cannot be attributed to a particular locker.
+     */
+    void recordSlowWait(ResourceId resId,
+                        LockMode mode,
+                        int64_t waitMicros,
+                        LockerId waiter,
+                        const HolderList& holders,
+                        int unattributedHolders);
+
+    /**
+     * Reports the 'limit' resources with the highest total wait time, followed by the retained
+     * slow wait samples.
+     */
+    void report(BSONObjBuilder* builder, int limit) const;
+
+    /**
+     * Reports the per-resource-type totals only. The shape of the output does not depend on
+     * which resources were seen, which keeps the FTDC schema stable.
+     */
+    void reportSummary(BSONObjBuilder* builder) const;
+
+    void reset();
+
+    static int histogramBucket(int64_t waitMicros);
+
+private:
+    struct ResourceStats {
+        int64_t waits = 0;
+        int64_t waitMicros = 0;
+        int64_t maxWaitMicros = 0;
+        int64_t waitsByMode[LockModesCount] = {};
+        int64_t histogram[kNumHistogramBuckets] = {};
+        std::string lastWaiterNs;
+    };
+
+    struct TypeStats {
+        AtomicInt64 waits;
+        AtomicInt64 waitMicros;
+        AtomicInt64 histogram[kNumHistogramBuckets];
+    };
+
+    struct SlowWait {
+        Date_t when;
+        ResourceId resId;
+        LockMode mode;
+        int64_t waitMicros;
+        BSONObj waiter;
+        std::vector<BSONObj> holders;
+        int unattributedHolders;
+    };
+
+    enum { kNumPartitions = 16 };
+
+    struct Partition {
+        mutable stdx::mutex mutex;
+        std::unordered_map<ResourceId, ResourceStats> resources;
+    };
+
+    Partition& _getPartition(ResourceId resId) {
+        return _partitions[static_cast<uint64_t>(resId) % kNumPartitions];
+    }
+
+    /**
+     * Returns nullptr if the resource is not tracked yet and the partition is full. Must be
+     * called with the partition's mutex held.
+     */
+    ResourceStats* _findOrCreate(Partition* partition, ResourceId resId);
+
+    LockerDescriber _describer;
+
+    Partition _partitions[kNumPartitions];
+    TypeStats _typeStats[ResourceTypesCount];
+    AtomicInt64 _untrackedWaits;
+
+    mutable stdx::mutex _slowWaitsMutex;
+    std::deque<SlowWait> _slowWaits;
+    int64_t _slowWaitsRecorded = 0;
+};
+
+}  // namespace mongo
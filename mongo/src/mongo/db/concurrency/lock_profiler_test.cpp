@@ -0,0 +1,259 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/concurrency/lock_manager_test_help.h"
+#include "mongo/db/concurrency/lock_profiler.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+/**
+ * Turns the global lock profiler on for the duration of a test.
+ */
+class LockProfilingEnabledBlock {
+public:
+    explicit LockProfilingEnabledBlock(int slowWaitMillis)
+        : _wasEnabled(lockProfilingEnabled.load()),
+          _oldSlowWaitMillis(lockProfilingSlowWaitMillis.load()) {
+        lockProfilingEnabled.store(true);
+        lockProfilingSlowWaitMillis.store(slowWaitMillis);
+        LockProfiler::get().reset();
+    }
+
+    ~LockProfilingEnabledBlock() {
+        lockProfilingEnabled.store(_wasEnabled);
+        lockProfilingSlowWaitMillis.store(_oldSlowWaitMillis);
+        LockProfiler::get().reset();
+    }
+
+private:
+    const bool _wasEnabled;
+    const int _oldSlowWaitMillis;
+};
+
+TEST(LockProfiler, HistogramBuckets) {
+    ASSERT_EQUALS(0, LockProfiler::histogramBucket(0));
+    ASSERT_EQUALS(0, LockProfiler::histogramBucket(LockProfiler::kFirstBucketMicros - 1));
+    ASSERT_EQUALS(1, LockProfiler::histogramBucket(LockProfiler::kFirstBucketMicros));
+    ASSERT_EQUALS(1, LockProfiler::histogramBucket(2 * LockProfiler::kFirstBucketMicros - 1));
+    ASSERT_EQUALS(2, LockProfiler::histogramBucket(2 * LockProfiler::kFirstBucketMicros));
+    ASSERT_EQUALS(LockProfiler::kNumHistogramBuckets - 1,
+                  LockProfiler::histogramBucket(std::numeric_limits<int64_t>::max()));
+}
+
+TEST(LockProfiler, ReportOrdersResourcesByTotalWaitTime) {
+    const ResourceId resA(RESOURCE_COLLECTION, std::string("LockProfiler.A"));
+    const ResourceId resB(RESOURCE_COLLECTION, std::string("LockProfiler.B"));
+    const ResourceId resC(RESOURCE_DATABASE, std::string("LockProfiler"));
+
+    LockProfiler profiler;
+    profiler.recordWait(resA, MODE_S, 100);
+    profiler.recordWait(resB, MODE_IX, 5000);
+    profiler.recordWait(resB, MODE_X, 1000);
+    profiler.recordWait(resC, MODE_X, 300);
+
+    BSONObjBuilder builder;
+    profiler.report(&builder, 2);
+    BSONObj report = builder.obj();
+
+    ASSERT_EQUALS(3, report["trackedResources"].numberLong());
+    std::vector<BSONElement> resources = report["resources"].Array();
+    ASSERT_EQUALS(2U, resources.size());
+
+    BSONObj first = resources[0].Obj();
+    ASSERT_EQUALS(resB.toString(), first["resourceId"].String());
+    ASSERT_EQUALS(2, first["waits"].numberLong());
+    ASSERT_EQUALS(6000, first["waitMicros"].numberLong());
+    ASSERT_EQUALS(5000, first["maxWaitMicros"].numberLong());
+    ASSERT_BSONOBJ_EQ(BSON("IX" << 1LL << "X" << 1LL), first["waitsByMode"].Obj());
+
+    std::vector<BSONElement> histogram = first["histogram"].Array();
+    ASSERT_EQUALS(static_cast<size_t>(LockProfiler::kNumHistogramBuckets), histogram.size());
+    ASSERT_EQUALS(1, histogram[LockProfiler::histogramBucket(1000)].numberLong());
+    ASSERT_EQUALS(1, histogram[LockProfiler::histogramBucket(5000)].numberLong());
+
+    ASSERT_EQUALS(resC.toString(), resources[1].Obj()["resourceId"].String());
+}
+
+TEST(LockProfiler, SummaryAggregatesByResourceType) {
+    LockProfiler profiler;
+    profiler.recordWait(ResourceId(RESOURCE_COLLECTION, std::string("LockProfiler.A")), MODE_S, 10);
+    profiler.recordWait(ResourceId(RESOURCE_COLLECTION, std::string("LockProfiler.B")), MODE_S, 20);
+    profiler.recordWait(ResourceId(RESOURCE_GLOBAL, ResourceId::SINGLETON_GLOBAL), MODE_X, 30);
+
+    BSONObjBuilder builder;
+    profiler.reportSummary(&builder);
+    BSONObj summary = builder.obj();
+
+    ASSERT_EQUALS(2, summary["Collection"]["waits"].numberLong());
+    ASSERT_EQUALS(30, summary["Collection"]["waitMicros"].numberLong());
+    ASSERT_EQUALS(1, summary["Global"]["waits"].numberLong());
+    ASSERT_EQUALS(0, summary["Database"]["waits"].numberLong());
+}
+
+TEST(LockProfiler, SlowWaitDescribesWaiterAndHolders) {
+    const ResourceId resId(RESOURCE_COLLECTION, std::string("LockProfiler.Slow"));
+
+    LockProfiler profiler;
+    profiler.setLockerDescriber([](std::map<LockerId, BSONObj>* descriptions) {
+        for (auto& entry : *descriptions) {
+            entry.second = BSON("ns"
+                                << "LockProfiler.Slow"
+                                << "desc"
+                                << (entry.first == 1 ? "waiter" : "holder"));
+        }
+    });
+
+    profiler.recordWait(resId, MODE_X, 250000);
+    profiler.recordSlowWait(resId, MODE_X, 200000, 1, {{2, MODE_IX}, {3, MODE_IX}}, 4);
+
+    BSONObjBuilder builder;
+    profiler.report(&builder, 10);
+    BSONObj report = builder.obj();
+
+    ASSERT_EQUALS(1, report["slowWaitsRecorded"].numberLong());
+    std::vector<BSONElement> slowWaits = report["slowWaits"].Array();
+    ASSERT_EQUALS(1U, slowWaits.size());
+
+    BSONObj sample = slowWaits[0].Obj();
+    ASSERT_EQUALS("X", sample["mode"].String());
+    ASSERT_EQUALS(200000, sample["waitMicros"].numberLong());
+    ASSERT_EQUALS("waiter", sample["waiter"]["desc"].String());
+    ASSERT_EQUALS(4, sample["unattributedIntentHolders"].numberInt());
+
+    std::vector<BSONElement> holders = sample["holders"].Array();
+    ASSERT_EQUALS(2U, holders.size());
+    ASSERT_EQUALS(2, holders[0].Obj()["lockerId"].numberLong());
+    ASSERT_EQUALS("IX", holders[0].Obj()["mode"].String());
+    ASSERT_EQUALS("holder", holders[0].Obj()["desc"].String());
+
+    ASSERT_EQUALS("LockProfiler.Slow",
+                  report["resources"].Array()[0].Obj()["lastWaiterNs"].String());
+}
+
+TEST(LockProfiler, SlowWaitsAreCapped) {
+    const ResourceId resId(RESOURCE_COLLECTION, std::string("LockProfiler.Capped"));
+
+    LockProfiler profiler;
+    for (size_t i = 0; i < LockProfiler::kMaxSlowWaits + 10; i++) {
+        profiler.recordSlowWait(resId, MODE_S, i, 1, {}, 0);
+    }
+
+    BSONObjBuilder builder;
+    profiler.report(&builder, 0);
+    BSONObj report = builder.obj();
+
+    ASSERT_EQUALS(static_cast<long long>(LockProfiler::kMaxSlowWaits + 10),
+                  report["slowWaitsRecorded"].numberLong());
+    std::vector<BSONElement> slowWaits = report["slowWaits"].Array();
+    ASSERT_EQUALS(LockProfiler::kMaxSlowWaits, slowWaits.size());
+
+    // The oldest samples are the ones dropped.
+    ASSERT_EQUALS(10, slowWaits[0].Obj()["waitMicros"].numberLong());
+}
+
+TEST(LockProfiler, Reset) {
+    const ResourceId resId(RESOURCE_COLLECTION, std::string("LockProfiler.Reset"));
+
+    LockProfiler profiler;
+    profiler.recordWait(resId, MODE_S, 100);
+    profiler.recordSlowWait(resId, MODE_S, 100, 1, {}, 0);
+    profiler.reset();
+
+    BSONObjBuilder builder;
+    profiler.report(&builder, 10);
+    BSONObj report = builder.obj();
+
+    ASSERT_EQUALS(0, report["trackedResources"].numberLong());
+    ASSERT_EQUALS(0, report["slowWaitsRecorded"].numberLong());
+    ASSERT(report["slowWaits"].Array().empty());
+}
+
+TEST(LockProfiler, DisabledByDefault) {
+    const ResourceId resId(RESOURCE_COLLECTION, std::string("LockProfiler.Disabled"));
+
+    LockProfiler::get().reset();
+    ASSERT_FALSE(LockProfiler::isEnabled());
+
+    LockerForTests locker(MODE_IX);
+    locker.lock(resId, MODE_X);
+
+    LockerForTests lockerConflict(MODE_IX);
+    ASSERT_EQUALS(LOCK_WAITING, lockerConflict.lockBegin(resId, MODE_S));
+    ASSERT_EQUALS(LOCK_TIMEOUT, lockerConflict.lockComplete(resId, MODE_S, Milliseconds(1), false));
+
+    BSONObjBuilder builder;
+    LockProfiler::get().reportSummary(&builder);
+    ASSERT_EQUALS(0, builder.obj()["Collection"]["waits"].numberLong());
+
+    locker.unlock(resId);
+}
+
+TEST(LockProfiler, LockerWaitRecordsHolders) {
+    const ResourceId resId(RESOURCE_COLLECTION, std::string("LockProfiler.Locker"));
+
+    LockProfilingEnabledBlock profiling(0);
+
+    LockerForTests locker(MODE_IX);
+    locker.lock(resId, MODE_X);
+
+    {
+        LockerForTests lockerConflict(MODE_IX);
+        ASSERT_EQUALS(LOCK_WAITING, lockerConflict.lockBegin(resId, MODE_S));
+        ASSERT_EQUALS(LOCK_TIMEOUT,
+                      lockerConflict.lockComplete(resId, MODE_S, Milliseconds(1), false));
+    }
+
+    locker.unlock(resId);
+
+    BSONObjBuilder builder;
+    LockProfiler::get().report(&builder, 10);
+    BSONObj report = builder.obj();
+
+    std::vector<BSONElement> resources = report["resources"].Array();
+    ASSERT_EQUALS(1U, resources.size());
+    ASSERT_EQUALS(resId.toString(), resources[0].Obj()["resourceId"].String());
+    ASSERT_EQUALS(1, resources[0].Obj()["waits"].numberLong());
+
+    std::vector<BSONElement> slowWaits = report["slowWaits"].Array();
+    ASSERT_EQUALS(1U, slowWaits.size());
+    ASSERT_EQUALS("S", slowWaits[0].Obj()["mode"].String());
+
+    std::vector<BSONElement> holders = slowWaits[0].Obj()["holders"].Array();
+    ASSERT_EQUALS(1U, holders.size());
+    ASSERT_EQUALS(static_cast<long long>(locker.getId()),
+                  holders[0].Obj()["lockerId"].numberLong());
+    ASSERT_EQUALS("X", holders[0].Obj()["mode"].String());
+}
+
+}  // namespace
+}  // namespace mongo
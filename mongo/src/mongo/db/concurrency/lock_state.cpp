@@ -34,11 +34,15 @@
 
 #include <vector>
 
+#include "mongo/bson/json.h"
+#include "mongo/db/concurrency/lock_profiler.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/service_context.h"
 #include "mongo/platform/compiler.h"
 #include "mongo/stdx/new.h"
 #include "mongo/util/background.h"
+#include "mongo/util/concurrency/fair_ticket_scheduler.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/debug_util.h"
 #include "mongo/util/log.h"
@@ -342,6 +346,42 @@ void CondVarLockGrantNotification::notify(ResourceId resId, LockResult result) {
 //ͨdb.serverStatus().globalLockȡ
 namespace { //ֵsetGlobalThrottling //WiredTigerKVEngine::WiredTigerKVEngine->Locker::setGlobalThrottling
 TicketHolder* ticketHolders[LockModesCount] = {}; 
+FairTicketScheduler* ticketSchedulers[LockModesCount] = {};
+
+MONGO_EXPORT_SERVER_PARAMETER(fairTicketSchedulingEnabled, bool, false);
+
+/**
+ * Weights and ticket limits of the databases sharing the tickets when fair ticket scheduling is
+ * enabled, see FairTicketScheduler::setShares.
+ */
+class FairTicketSchedulingSharesParameter : public ServerParameter {
+    MONGO_DISALLOW_COPYING(FairTicketSchedulingSharesParameter);
+
+public:
+    FairTicketSchedulingSharesParameter()
+        : ServerParameter(
+              ServerParameterSet::getGlobal(), "fairTicketSchedulingShares", true, true) {}
+
+    virtual void append(OperationContext* opCtx, BSONObjBuilder& b, const std::string& name) {
+        b.append(name, FairTicketScheduler::getShares());
+    }
+
+    virtual Status set(const BSONElement& newValueElement) {
+        if (newValueElement.type() != Object)
+            return Status(ErrorCodes::BadValue, str::stream() << name() << " has to be an object");
+        return FairTicketScheduler::setShares(newValueElement.Obj());
+    }
+
+    virtual Status setFromString(const std::string& str) {
+        BSONObj shares;
+        try {
+            shares = fromjson(str);
+        } catch (const DBException& ex) {
+            return ex.toStatus();
+        }
+        return FairTicketScheduler::setShares(shares);
+    }
+} fairTicketSchedulingSharesParameter;
 }  // namespace
 
 
@@ -375,6 +415,17 @@ void Locker::setGlobalThrottling(class TicketHolder* reading, class TicketHolder
 	//ticketHolders[MODE_X]Ϊʲôûֵأ︳ֵ   _lockGlobalBeginĶ
 }
 
+TicketHolder* Locker::getGlobalThrottling(LockMode mode) {
+    return ticketHolders[mode];
+}
+
+void Locker::setGlobalTicketScheduling(FairTicketScheduler* reading,
+                                       FairTicketScheduler* writing) {
+    ticketSchedulers[MODE_S] = reading;
+    ticketSchedulers[MODE_IS] = reading;
+    ticketSchedulers[MODE_IX] = writing;
+}
+
 template <bool IsForMMAPV1>
 LockerImpl<IsForMMAPV1>::LockerImpl()
     : _id(idCounter.addAndFetch(1)), _wuowNestingLevel(0), _threadId(stdx::this_thread::get_id()) {}
@@ -468,13 +519,7 @@ LockResult LockerImpl<IsForMMAPV1>::_lockGlobalBegin(LockMode mode, Milliseconds
 		
             _clientState.store(reader ? kQueuedReader : kQueuedWriter); 
 			//ȴڼΪQueued״̬ȡΪActive״̬ȡʱΪinactive
-            if (timeout == Milliseconds::max()) {
-				//TicketHolder::waitForTicketһֱź
-                holder->waitForTicket();  
-
-
-			//ȴʱ䣬ʱֱӽinactive
-            } else if (!holder->waitForTicketUntil(Date_t::now() + timeout)) {
+            if (!_acquireTicket(holder, mode, timeout)) {
             	//ûȡҲźˣ״̬Ϊinactive
                 _clientState.store(kInactive); 
 				//ȡʱ
@@ -845,6 +890,28 @@ bool LockerImpl<IsForMMAPV1>::saveLockStateAndUnlock(Locker::LockSnapshot* state
     return true;
 }
 
+template <bool IsForMMAPV1>
+bool LockerImpl<IsForMMAPV1>::_acquireTicket(TicketHolder* holder,
+                                             LockMode mode,
+                                             Milliseconds timeout) {
+    auto scheduler = ticketSchedulers[mode];
+    if (scheduler && fairTicketSchedulingEnabled.load()) {
+        const Date_t deadline =
+            timeout == Milliseconds::max() ? Date_t::max() : Date_t::now() + timeout;
+        _ticketSchedulerTenant = scheduler->acquire(_ticketSchedulingTenant, deadline);
+        if (!_ticketSchedulerTenant) {
+            return false;
+        }
+    } else if (timeout == Milliseconds::max()) {
+        holder->waitForTicket();
+    } else if (!holder->waitForTicketUntil(Date_t::now() + timeout)) {
+        return false;
+    }
+
+    _ticketAcquiredMicros = curTimeMicros64();
+    return true;
+}
+
 //Lock::TempRelease::~TempRelease    WiredTigerRecordStore::yieldAndAwaitOplogDeletionRequest
 //QueryYield::yieldAllLocks   handleBatchHelper 
 template <bool IsForMMAPV1>
@@ -988,6 +1055,16 @@ LockResult LockerImpl<IsForMMAPV1>::lockComplete(ResourceId resId,
     const uint64_t startOfTotalWaitTime = curTimeMicros64();
     uint64_t startOfCurrentWaitTime = startOfTotalWaitTime;
 
+    // The lock profiler wants to see the holders while we are still blocked, so wake up once at
+    // the slow wait threshold in order to sample them.
+    LockProfiler& profiler = LockProfiler::get();
+    const bool profiling = LockProfiler::isEnabled();
+    const Milliseconds slowWaitThreshold = LockProfiler::slowWaitThreshold();
+    bool slowWaitRecorded = !profiling;
+    if (!slowWaitRecorded) {
+        waitTime = std::min(waitTime, slowWaitThreshold);
+    }
+
     while (true) {
         // It is OK if this call wakes up spuriously, because we re-evaluate the remaining
         // wait time anyways.
@@ -1006,6 +1083,22 @@ LockResult LockerImpl<IsForMMAPV1>::lockComplete(ResourceId resId,
         if (result == LOCK_OK)
             break;
 
+        const auto totalBlockTime = duration_cast<Milliseconds>(
+            Microseconds(int64_t(curTimeMicros - startOfTotalWaitTime)));
+
+        if (!slowWaitRecorded && totalBlockTime >= slowWaitThreshold) {
+            LockProfiler::HolderList holders;
+            const int unattributedHolders = globalLockManager.getGrantedLockers(resId, &holders);
+            profiler.recordSlowWait(resId,
+                                    mode,
+                                    curTimeMicros - startOfTotalWaitTime,
+                                    _id,
+                                    holders,
+                                    unattributedHolders);
+            slowWaitRecorded = true;
+            waitTime = std::min(timeout, DeadlockTimeout);
+        }
+
         if (checkDeadlock) {
             DeadlockDetector wfg(globalLockManager, this);
             if (wfg.check().hasCycle()) {
@@ -1024,8 +1117,6 @@ LockResult LockerImpl<IsForMMAPV1>::lockComplete(ResourceId resId,
             continue;
         }
 
-        const auto totalBlockTime = duration_cast<Milliseconds>(
-            Microseconds(int64_t(curTimeMicros - startOfTotalWaitTime)));
         waitTime = (totalBlockTime < timeout) ? std::min(timeout - totalBlockTime, DeadlockTimeout)
                                               : Milliseconds(0);
 
@@ -1035,6 +1126,10 @@ LockResult LockerImpl<IsForMMAPV1>::lockComplete(ResourceId resId,
         }
     }
 
+    if (profiling) {
+        profiler.recordWait(resId, mode, curTimeMicros64() - startOfTotalWaitTime);
+    }
+
     // Cleanup the state, since this is an unused lock now
     if (result != LOCK_OK) {
         LockRequestsMap::Iterator it = _requests.find(resId);
@@ -1064,8 +1159,13 @@ bool LockerImpl<IsForMMAPV1>::_unlockImpl(LockRequestsMap::Iterator* it) {
         if (it->key() == resourceIdGlobal) {
             invariant(_modeForTicket != MODE_NONE);
             auto holder = ticketHolders[_modeForTicket];
+            auto scheduler = ticketSchedulers[_modeForTicket];
             _modeForTicket = MODE_NONE;
-            if (holder) {
+            if (scheduler && (_ticketSchedulerTenant || fairTicketSchedulingEnabled.load())) {
+                const long long heldMicros = curTimeMicros64() - _ticketAcquiredMicros;
+                scheduler->release(_ticketSchedulerTenant, Microseconds(heldMicros));
+                _ticketSchedulerTenant = nullptr;
+            } else if (holder) {
                 holder->release();
             }
             _clientState.store(kInactive);
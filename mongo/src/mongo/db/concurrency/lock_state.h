@@ -33,6 +33,7 @@
 #include "mongo/db/concurrency/fast_map_noalloc.h"
 #include "mongo/db/concurrency/locker.h"
 #include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/fair_ticket_scheduler.h"
 #include "mongo/util/concurrency/spin_lock.h"
 
 namespace mongo {
@@ -105,6 +106,10 @@ public:
 
     virtual ClientState getClientState() const;
 
+    void setTicketSchedulingTenant(StringData tenant) override {
+        _ticketSchedulingTenant = tenant.toString();
+    }
+
     virtual LockerId getId() const {
         return _id;
     }
@@ -199,6 +204,12 @@ private:
      */ //LockResult lockGlobalBeginе
     LockResult _lockGlobalBegin(LockMode, Milliseconds timeout);
 
+    /**
+     * Waits up to 'timeout' for a ticket from 'holder', through the FairTicketScheduler for
+     * 'mode' if fair ticket scheduling is enabled. Returns false if the wait timed out.
+     */
+    bool _acquireTicket(TicketHolder* holder, LockMode mode, Milliseconds timeout);
+
     /**
      * The main functionality of the unlock method, except accepts iterator in order to avoid
      * additional lookups during unlockGlobal. Frees locks immediately, so must not be called from
@@ -253,6 +264,16 @@ private:
     //ֵLockerImpl<IsForMMAPV1>::_lockGlobalBegin
     LockMode _modeForTicket = MODE_NONE;
 
+    // Tenant which this locker queues for a ticket under, see setTicketSchedulingTenant.
+    std::string _ticketSchedulingTenant;
+
+    // Tenant which was granted the current ticket, or nullptr if the ticket did not come from a
+    // FairTicketScheduler.
+    FairTicketScheduler::Tenant* _ticketSchedulerTenant = nullptr;
+
+    // When the current ticket was acquired, for charging its holding time to the tenant.
+    unsigned long long _ticketAcquiredMicros = 0;
+
     // Indicates whether the client is active reader/writer or is queued.
     //ֵLockerImpl<IsForMMAPV1>::_lockGlobalBegin
     AtomicWord<ClientState> _clientState{kInactive};
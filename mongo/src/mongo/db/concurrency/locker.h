@@ -79,6 +79,21 @@ public:
      */
     static void setGlobalThrottling(class TicketHolder* reading, class TicketHolder* writing);
 
+    /**
+     * Returns the TicketHolder which global lock attempts in 'mode' obtain tickets from, or
+     * nullptr if 'mode' is not throttled.
+     */
+    static class TicketHolder* getGlobalThrottling(LockMode mode);
+
+    /**
+     * While fairTicketSchedulingEnabled is set, makes global lock attempts obtain the tickets of
+     * the 'reading' and 'writing' TicketHolders through these schedulers, which share them out
+     * between databases. The schedulers must have static lifetimes and wrap the TicketHolders
+     * passed to setGlobalThrottling.
+     */
+    static void setGlobalTicketScheduling(class FairTicketScheduler* reading,
+                                          class FairTicketScheduler* writing);
+
     /**
      * State for reporting the number of active and queued reader and writer clients.
      */ 
@@ -110,6 +125,13 @@ public:
      */
     virtual ClientState getClientState() const = 0;
 
+    /**
+     * Sets the tenant, normally the database name, which this locker queues for a ticket under
+     * when fair ticket scheduling is enabled. Lockers without a tenant are internal operations,
+     * which are served first.
+     */
+    virtual void setTicketSchedulingTenant(StringData tenant) {}
+
     virtual LockerId getId() const = 0;
 
     /**
@@ -28,6 +28,8 @@
 
 #include "mongo/db/exec/and_hash.h"
 
+#include <algorithm>
+
 #include "mongo/db/exec/and_common-inl.h"
 #include "mongo/db/exec/scoped_timer.h"
 #include "mongo/db/exec/working_set.h"
@@ -358,7 +360,7 @@ PlanStage::StageState AndHashStage::hashOtherChildren(WorkingSetID* out) {
         // Keep elements of _dataMap that are in _seenMap.
         DataMap::iterator it = _dataMap.begin();
         while (it != _dataMap.end()) {
-            if (_seenMap.end() == _seenMap.find(it->first)) {
+            if (!_seenMap.contains(it->first)) {
                 DataMap::iterator toErase = it;
                 ++it;
 
@@ -375,6 +377,8 @@ PlanStage::StageState AndHashStage::hashOtherChildren(WorkingSetID* out) {
 
         _specificStats.mapAfterChild.push_back(_dataMap.size());
 
+        _specificStats.seenMemUsage =
+            std::max(_specificStats.seenMemUsage, _seenMap.memUsageBytes());
         _seenMap.clear();
 
         // _dataMap is now the intersection of the first _currentChild nodes.
@@ -470,6 +474,7 @@ unique_ptr<PlanStageStats> AndHashStage::getStats() {
 
     _specificStats.memLimit = _maxMemUsage;
     _specificStats.memUsage = _memUsage;
+    _specificStats.seenMemUsage = std::max(_specificStats.seenMemUsage, _seenMap.memUsageBytes());
 
     unique_ptr<PlanStageStats> ret = make_unique<PlanStageStats>(_commonStats, STAGE_AND_HASH);
     ret->specific = make_unique<AndHashStats>(_specificStats);
@@ -30,11 +30,14 @@
 
 #include "mongo/db/exec/fetch.h"
 
+#include <algorithm>
+
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/scoped_timer.h"
 #include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/storage/record_fetcher.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/util/fail_point_service.h"
@@ -75,7 +78,8 @@ FetchStage::FetchStage(OperationContext* opCtx,
       _collection(collection),
       _ws(ws),
       _filter(filter),
-      _idRetrying(WorkingSet::INVALID_ID) {
+      _idRetrying(WorkingSet::INVALID_ID),
+      _batchSize(std::max(internalQueryFetchBatchSize.load(), 0)) {
     _children.emplace_back(child);
 }
 
@@ -87,6 +91,10 @@ bool FetchStage::isEOF() {
         // paged in document
         return false;
     }
+    if (!_batch.empty()) {
+        // Results of the current batch are still to be returned.
+        return false;
+    }
 
     return child()->isEOF();
 }
@@ -127,6 +135,10 @@ PlanStage::StageState FetchStage::doWork(WorkingSetID* out) {
         return PlanStage::IS_EOF;
     }
 
+    if (_batchSize > 1) {
+        return doBatchedWork(out);
+    }
+
     // Either retry the last WSM we worked on or get a new one from our child.
     WorkingSetID id;
     StageState status;
@@ -202,9 +214,120 @@ PlanStage::StageState FetchStage::doWork(WorkingSetID* out) {
     return status;
 }
 
+PlanStage::StageState FetchStage::doBatchedWork(WorkingSetID* out) {
+    if (!_batchFull) {
+        if (_batch.size() < _batchSize && !child()->isEOF()) {
+            WorkingSetID id = WorkingSet::INVALID_ID;
+            StageState status = child()->work(&id);
+            if (PlanStage::ADVANCED == status) {
+                _batch.push_back(id);
+                return PlanStage::NEED_TIME;
+            } else if (PlanStage::FAILURE == status || PlanStage::DEAD == status) {
+                *out = id;
+                if (WorkingSet::INVALID_ID == id) {
+                    Status error(ErrorCodes::InternalError,
+                                 "fetch stage failed to read in results from child");
+                    *out = WorkingSetCommon::allocateStatusMember(_ws, error);
+                }
+                return status;
+            } else if (PlanStage::IS_EOF != status) {
+                *out = id;
+                return status;
+            }
+        }
+
+        if (_batch.empty()) {
+            return PlanStage::IS_EOF;
+        }
+
+        for (size_t i = 0; i < _batch.size(); ++i) {
+            WorkingSetMember* member = _ws->get(_batch[i]);
+            if (member->hasObj()) {
+                ++_specificStats.alreadyHasObj;
+            } else {
+                verify(WorkingSetMember::RID_AND_IDX == member->getState());
+                verify(member->hasRecordId());
+                _fetchOrder.push_back(i);
+            }
+        }
+        std::sort(_fetchOrder.begin(), _fetchOrder.end(), [this](size_t lhs, size_t rhs) {
+            return _ws->get(_batch[lhs])->recordId < _ws->get(_batch[rhs])->recordId;
+        });
+        _batchFull = true;
+    }
+
+    if (_numFetched < _fetchOrder.size()) {
+        StageState status = fetchBatch(out);
+        if (PlanStage::NEED_TIME != status) {
+            return status;
+        }
+    }
+
+    while (_nextToReturn < _batch.size()) {
+        const WorkingSetID id = _batch[_nextToReturn++];
+        if (_nextToReturn == _batch.size()) {
+            resetBatch();
+        }
+        if (WorkingSet::INVALID_ID != id) {
+            return returnIfMatches(_ws->get(id), id, out);
+        }
+    }
+
+    resetBatch();
+    return PlanStage::NEED_TIME;
+}
+
+PlanStage::StageState FetchStage::fetchBatch(WorkingSetID* out) {
+    for (; _numFetched < _fetchOrder.size(); ++_numFetched) {
+        WorkingSetID& id = _batch[_fetchOrder[_numFetched]];
+        WorkingSetMember* member = _ws->get(id);
+        if (member->hasObj()) {
+            // The document was read when its RecordId was invalidated.
+            continue;
+        }
+
+        try {
+            if (!_cursor)
+                _cursor = _collection->getCursor(getOpCtx());
+
+            if (auto fetcher = _cursor->fetcherForId(member->recordId)) {
+                // This document is fetched again once the record has been paged in.
+                member->setFetcher(fetcher.release());
+                *out = id;
+                return NEED_YIELD;
+            }
+
+            if (!WorkingSetCommon::fetch(getOpCtx(), _ws, id, _cursor)) {
+                _ws->free(id);
+                id = WorkingSet::INVALID_ID;
+            }
+        } catch (const WriteConflictException&) {
+            *out = WorkingSet::INVALID_ID;
+            return NEED_YIELD;
+        }
+    }
+
+    return PlanStage::NEED_TIME;
+}
+
+void FetchStage::resetBatch() {
+    _batch.clear();
+    _fetchOrder.clear();
+    _numFetched = 0;
+    _batchFull = false;
+    _nextToReturn = 0;
+}
+
 void FetchStage::doSaveState() {
     if (_cursor)
         _cursor->saveUnpositioned();
+
+    // The documents already fetched for the rest of the batch must outlive the snapshot.
+    for (size_t i = _nextToReturn; i < _batch.size(); ++i) {
+        if (WorkingSet::INVALID_ID != _batch[i]) {
+            _ws->get(_batch[i])->makeObjOwnedIfNeeded();
+        }
+    }
 }
 
 void FetchStage::doRestoreState() {
@@ -232,6 +355,16 @@ void FetchStage::doInvalidate(OperationContext* opCtx, const RecordId& dl, Inval
             WorkingSetCommon::fetchAndInvalidateRecordId(opCtx, member, _collection);
         }
     }
+
+    for (size_t i = _nextToReturn; i < _batch.size(); ++i) {
+        if (WorkingSet::INVALID_ID == _batch[i]) {
+            continue;
+        }
+        WorkingSetMember* member = _ws->get(_batch[i]);
+        if (member->hasRecordId() && (member->recordId == dl)) {
+            WorkingSetCommon::fetchAndInvalidateRecordId(opCtx, member, _collection);
+        }
+    }
 }
 
 //FetchStage::doWork
@@ -29,6 +29,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/jsobj.h"
@@ -46,6 +47,10 @@ class SeekableRecordCursor;
  * the record at the provided RecordId.  Returns verbatim any data that already has an object.
  *
  * Preconditions: Valid RecordId.
+ *
+ * When 'internalQueryFetchBatchSize' is greater than one, the stage instead collects a batch of
+ * that many results from its child, reads their documents in RecordId order, and then returns
+ * them in the order the child produced them.
  */
 /*
 2021-01-22T10:59:08.080+0800 D QUERY    [conn-1] Winning solution:
@@ -101,6 +106,24 @@ private:
      */
     StageState returnIfMatches(WorkingSetMember* member, WorkingSetID memberID, WorkingSetID* out);
 
+    /**
+     * Implements doWork() when fetching in batches: fills '_batch' from the child, fetches its
+     * documents in RecordId order, and then returns them in the child's order.
+     */
+    StageState doBatchedWork(WorkingSetID* out);
+
+    /**
+     * Fetches the documents of '_batch' which are not yet fetched, in RecordId order. Returns
+     * NEED_TIME once every document is fetched, or NEED_YIELD if a fetch must be retried after a
+     * yield.
+     */
+    StageState fetchBatch(WorkingSetID* out);
+
+    /**
+     * Forgets the current batch once all of its results are returned.
+     */
+    void resetBatch();
+
     // Collection which is used by this stage. Used to resolve record ids retrieved by child
     // stages. The lifetime of the collection must supersede that of the stage.
     const Collection* _collection;
@@ -118,6 +141,23 @@ private:
     // If not Null, we use this rather than asking our child what to do next.
     WorkingSetID _idRetrying;
 
+    // The number of results to collect from the child before fetching them, or at most one if
+    // each document is fetched as soon as the child produces it.
+    const size_t _batchSize;
+
+    // The current batch of results in the order the child produced them. An entry whose
+    // document no longer exists is reset to WorkingSet::INVALID_ID.
+    std::vector<WorkingSetID> _batch;
+
+    // Positions in '_batch' which still need a document, sorted by RecordId, once the batch is
+    // full. '_numFetched' of them have been fetched so far.
+    std::vector<size_t> _fetchOrder;
+    size_t _numFetched = 0;
+
+    // Whether '_batch' is full, and the position of the next of its results to return.
+    bool _batchFull = false;
+    size_t _nextToReturn = 0;
+
     // Stats
     FetchStats _specificStats;
 };
@@ -275,7 +275,7 @@ PlanStage::StageState IndexScan::doWork(WorkingSetID* out) { //PlanStage::work
 
     if (_shouldDedup) {
         ++_specificStats.dupsTested;
-        if (!_returned.insert(kv->loc).second) {
+        if (!_returned.insert(kv->loc)) {
             // We've seen this RecordId before. Skip it this time.
             ++_specificStats.dupsDropped;
             return PlanStage::NEED_TIME;
@@ -352,10 +352,8 @@ void IndexScan::doInvalidate(OperationContext* opCtx, const RecordId& dl, Invali
 
     // If we see this RecordId again, it may not be the same document it was before, so we want
     // to return it if we see it again.
-    unordered_set<RecordId, RecordId::Hasher>::iterator it = _returned.find(dl);
-    if (it != _returned.end()) {
+    if (_returned.erase(dl)) {
         ++_specificStats.seenInvalidated;
-        _returned.erase(it);
     }
 }
 
@@ -379,6 +377,8 @@ std::unique_ptr<PlanStageStats> IndexScan::getStats() {
         _specificStats.direction = _params.direction;
     }
 
+    _specificStats.dupsMemUsage = _returned.memUsageBytes();
+
     std::unique_ptr<PlanStageStats> ret =
         stdx::make_unique<PlanStageStats>(_commonStats, STAGE_IXSCAN);
     ret->specific = stdx::make_unique<IndexScanStats>(_specificStats);
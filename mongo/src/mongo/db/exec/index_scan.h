@@ -30,6 +30,7 @@
 
 
 #include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/exec/record_id_set.h"
 #include "mongo/db/index/index_access_method.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/matcher/expression.h"
@@ -37,7 +38,6 @@
 #include "mongo/db/record_id.h"
 #include "mongo/db/storage/index_entry_comparison.h"
 #include "mongo/db/storage/sorted_data_interface.h"
-#include "mongo/platform/unordered_set.h"
 
 namespace mongo {
 
@@ -140,7 +140,7 @@ private:
 
     // Could our index have duplicates?  If so, we use _returned to dedup.
     bool _shouldDedup;
-    unordered_set<RecordId, RecordId::Hasher> _returned;
+    RecordIdSet _returned;
 
     const bool _forward;
     const IndexScanParams _params;
@@ -76,14 +76,11 @@ PlanStage::StageState OrStage::doWork(WorkingSetID* out) {
             ++_specificStats.dupsTested;
 
             // ...and we've seen the RecordId before
-            if (_seen.end() != _seen.find(member->recordId)) {
+            if (!_seen.insert(member->recordId)) {
                 // ...drop it.
                 ++_specificStats.dupsDropped;
                 _ws->free(id);
                 return PlanStage::NEED_TIME;
-            } else {
-                // Otherwise, note that we've seen it.
-                _seen.insert(member->recordId);
             }
         }
 
@@ -135,16 +132,15 @@ void OrStage::doInvalidate(OperationContext* opCtx, const RecordId& dl, Invalida
     // If we see DL again it is not the same record as it once was so we still want to
     // return it.
     if (_dedup && INVALIDATION_DELETION == type) {
-        unordered_set<RecordId, RecordId::Hasher>::iterator it = _seen.find(dl);
-        if (_seen.end() != it) {
+        if (_seen.erase(dl)) {
             ++_specificStats.recordIdsForgotten;
-            _seen.erase(dl);
         }
     }
 }
 
 unique_ptr<PlanStageStats> OrStage::getStats() {
     _commonStats.isEOF = isEOF();
+    _specificStats.dupsMemUsage = _seen.memUsageBytes();
 
     // Add a BSON representation of the filter to the stats tree, if there is one.
     if (NULL != _filter) {
@@ -0,0 +1,132 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/exec/pipeline_group.h"
+
+#include "mongo/db/exec/working_set_common.h"
+#include "mongo/stdx/memory.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+using std::unique_ptr;
+using stdx::make_unique;
+
+// static
+const char* PipelineGroupStage::kStageType = "PIPELINE_GROUP";
+
+PipelineGroupStage::PipelineGroupStage(OperationContext* opCtx,
+                                       intrusive_ptr<DocumentSourceGroup> group,
+                                       WorkingSet* ws,
+                                       unique_ptr<PlanStage> child)
+    : PlanStage(kStageType, opCtx), _group(std::move(group)), _ws(ws) {
+    invariant(_group->canAccumulateBSON());
+    _children.emplace_back(std::move(child));
+
+    std::vector<Value> serialized;
+    _group->serializeToArray(serialized);
+    invariant(serialized.size() == 1);
+    _specificStats.groupSpec = serialized[0].getDocument().toBson();
+}
+
+bool PipelineGroupStage::isEOF() {
+    return _done;
+}
+
+PlanStage::StageState PipelineGroupStage::doWork(WorkingSetID* out) {
+    if (_done) {
+        return PlanStage::IS_EOF;
+    }
+
+    if (!_inputExhausted) {
+        WorkingSetID id = WorkingSet::INVALID_ID;
+        StageState status = child()->work(&id);
+
+        if (PlanStage::ADVANCED == status) {
+            // A count plan may return members without any data, which stand for empty documents.
+            WorkingSetMember* member = _ws->get(id);
+            _group->accumulateBSON(member->hasObj() ? member->obj.value() : BSONObj());
+            _ws->free(id);
+            return PlanStage::NEED_TIME;
+        } else if (PlanStage::IS_EOF == status) {
+            _group->finishAccumulatingBSON();
+            _inputExhausted = true;
+            return PlanStage::NEED_TIME;
+        } else if (PlanStage::FAILURE == status || PlanStage::DEAD == status) {
+            *out = id;
+            // If a stage fails, it may create a status WSM to indicate why it failed, in which
+            // case 'id' is valid. If ID is invalid, we create our own error message.
+            if (WorkingSet::INVALID_ID == id) {
+                Status status(ErrorCodes::InternalError,
+                              "pipeline group stage failed to read in results from child");
+                *out = WorkingSetCommon::allocateStatusMember(_ws, status);
+            }
+            return status;
+        } else if (PlanStage::NEED_YIELD == status) {
+            *out = id;
+        }
+
+        // NEED_TIME, NEED_YIELD
+        return status;
+    }
+
+    auto next = _group->getNext();
+    if (next.isEOF()) {
+        _done = true;
+        return PlanStage::IS_EOF;
+    }
+    invariant(next.isAdvanced());
+
+    *out = _ws->allocate();
+    WorkingSetMember* member = _ws->get(*out);
+    member->obj = Snapshotted<BSONObj>(SnapshotId(), next.releaseDocument().toBson());
+    member->transitionToOwnedObj();
+    ++_specificStats.nGroups;
+    return PlanStage::ADVANCED;
+}
+
+void PipelineGroupStage::doDispose() {
+    _group->dispose();
+}
+
+unique_ptr<PlanStageStats> PipelineGroupStage::getStats() {
+    _commonStats.isEOF = isEOF();
+    unique_ptr<PlanStageStats> ret =
+        make_unique<PlanStageStats>(_commonStats, STAGE_PIPELINE_GROUP);
+    ret->specific = make_unique<PipelineGroupStats>(_specificStats);
+    ret->children.emplace_back(child()->getStats());
+    return ret;
+}
+
+const SpecificStats* PipelineGroupStage::getSpecificStats() const {
+    return &_specificStats;
+}
+
+}  // namespace mongo
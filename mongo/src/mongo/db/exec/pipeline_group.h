@@ -0,0 +1,82 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <boost/intrusive_ptr.hpp>
+
+#include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/exec/plan_stats.h"
+#include "mongo/db/pipeline/document_source_group.h"
+
+namespace mongo {
+
+/**
+ * This stage runs a $group which has been pushed down from an aggregation pipeline. Each result of
+ * its child is fed to the $group as BSON, without being converted to a Document, and once the
+ * child is exhausted the stage returns one owned object per group.
+ *
+ * Preconditions: The $group must satisfy DocumentSourceGroup::canAccumulateBSON().
+ */
+class PipelineGroupStage final : public PlanStage {
+public:
+    PipelineGroupStage(OperationContext* opCtx,
+                       boost::intrusive_ptr<DocumentSourceGroup> group,
+                       WorkingSet* ws,
+                       std::unique_ptr<PlanStage> child);
+
+    bool isEOF() final;
+    StageState doWork(WorkingSetID* out) final;
+
+    StageType stageType() const final {
+        return STAGE_PIPELINE_GROUP;
+    }
+
+    std::unique_ptr<PlanStageStats> getStats() final;
+
+    const SpecificStats* getSpecificStats() const final;
+
+    static const char* kStageType;
+
+protected:
+    void doDispose() final;
+
+private:
+    boost::intrusive_ptr<DocumentSourceGroup> _group;
+
+    // Not owned by us.
+    WorkingSet* _ws;
+
+    // Set once the child is exhausted and the groups are being returned.
+    bool _inputExhausted = false;
+    bool _done = false;
+
+    PipelineGroupStats _specificStats;
+};
+
+}  // namespace mongo
@@ -231,7 +231,8 @@ private:
 };
 
 struct AndHashStats : public SpecificStats {
-    AndHashStats() : flaggedButPassed(0), flaggedInProgress(0), memUsage(0), memLimit(0) {}
+    AndHashStats()
+        : flaggedButPassed(0), flaggedInProgress(0), memUsage(0), memLimit(0), seenMemUsage(0) {}
 
     SpecificStats* clone() const final {
         AndHashStats* specific = new AndHashStats(*this);
@@ -258,6 +259,9 @@ struct AndHashStats : public SpecificStats {
 
     // What's our memory limit?
     size_t memLimit;
+
+    // The most memory used to track which RecordIds of the map a child has produced.
+    size_t seenMemUsage;
 };
 
 
@@ -506,6 +510,7 @@ struct IndexScanStats : public SpecificStats {
           isUnique(false),
           dupsTested(0),
           dupsDropped(0),
+          dupsMemUsage(0),
           seenInvalidated(0),
           keysExamined(0),
           seeks(0) {}
@@ -553,6 +558,9 @@ struct IndexScanStats : public SpecificStats {
     size_t dupsTested;
     size_t dupsDropped;
 
+    // The memory used to remember the RecordIds returned so far, when deduplicating.
+    size_t dupsMemUsage;
+
     size_t seenInvalidated;
     // TODO: we could track key sizes here.
 
@@ -593,7 +601,7 @@ struct MultiPlanStats : public SpecificStats {
 };
 
 struct OrStats : public SpecificStats {
-    OrStats() : dupsTested(0), dupsDropped(0), recordIdsForgotten(0) {}
+    OrStats() : dupsTested(0), dupsDropped(0), dupsMemUsage(0), recordIdsForgotten(0) {}
 
     SpecificStats* clone() const final {
         OrStats* specific = new OrStats(*this);
@@ -603,6 +611,9 @@ struct OrStats : public SpecificStats {
     size_t dupsTested;
     size_t dupsDropped;
 
+    // The memory used to remember the RecordIds returned so far, when deduplicating.
+    size_t dupsMemUsage;
+
     // How many calls to invalidate(...) actually removed a RecordId from our deduping map?
     size_t recordIdsForgotten;
 };
@@ -672,6 +683,19 @@ struct ShardingFilterStats : public SpecificStats {
     size_t chunkSkips;
 };
 
+struct PipelineGroupStats : public SpecificStats {
+    SpecificStats* clone() const final {
+        PipelineGroupStats* specific = new PipelineGroupStats(*this);
+        return specific;
+    }
+
+    // The specification of the $group stage being run.
+    BSONObj groupSpec;
+
+    // The number of groups returned so far.
+    size_t nGroups = 0;
+};
+
 struct SkipStats : public SpecificStats {
     SkipStats() : skip(0) {}
 
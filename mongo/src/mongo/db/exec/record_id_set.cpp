@@ -0,0 +1,172 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/exec/record_id_set.h"
+
+#include <algorithm>
+
+namespace mongo {
+
+namespace {
+
+const size_t kBitmapWords = (1 << 16) / 64;
+
+uint64_t bitFor(uint16_t low) {
+    return uint64_t(1) << (low % 64);
+}
+
+}  // namespace
+
+bool RecordIdSet::Group::contains(uint16_t low) const {
+    if (!bitmap.empty()) {
+        return bitmap[low / 64] & bitFor(low);
+    }
+    return std::binary_search(array.begin(), array.end(), low);
+}
+
+bool RecordIdSet::Group::insert(uint16_t low) {
+    if (!bitmap.empty()) {
+        uint64_t& word = bitmap[low / 64];
+        if (word & bitFor(low)) {
+            return false;
+        }
+        word |= bitFor(low);
+        ++size;
+        return true;
+    }
+
+    auto it = std::lower_bound(array.begin(), array.end(), low);
+    if (it != array.end() && *it == low) {
+        return false;
+    }
+
+    if (array.size() < kMaxArraySize) {
+        array.insert(it, low);
+    } else {
+        bitmap.assign(kBitmapWords, 0);
+        for (uint16_t member : array) {
+            bitmap[member / 64] |= bitFor(member);
+        }
+        bitmap[low / 64] |= bitFor(low);
+        std::vector<uint16_t>().swap(array);
+    }
+    ++size;
+    return true;
+}
+
+bool RecordIdSet::Group::erase(uint16_t low) {
+    if (!bitmap.empty()) {
+        uint64_t& word = bitmap[low / 64];
+        if (!(word & bitFor(low))) {
+            return false;
+        }
+        word &= ~bitFor(low);
+        --size;
+        return true;
+    }
+
+    auto it = std::lower_bound(array.begin(), array.end(), low);
+    if (it == array.end() || *it != low) {
+        return false;
+    }
+    array.erase(it);
+    --size;
+    return true;
+}
+
+size_t RecordIdSet::findGroup(int64_t high) const {
+    if (_lastGroup < _groups.size() && _groups[_lastGroup].high == high) {
+        return _lastGroup;
+    }
+
+    auto it = std::lower_bound(
+        _groups.begin(), _groups.end(), high, [](const Group& group, int64_t value) {
+            return group.high < value;
+        });
+    return it - _groups.begin();
+}
+
+bool RecordIdSet::insert(const RecordId& id) {
+    const int64_t high = highBits(id);
+    size_t pos = findGroup(high);
+    if (pos == _groups.size() || _groups[pos].high != high) {
+        _groups.emplace(_groups.begin() + pos, high);
+    }
+    _lastGroup = pos;
+
+    Group& group = _groups[pos];
+    const size_t memUsageBefore = group.memUsageBytes();
+    if (!group.insert(lowBits(id))) {
+        return false;
+    }
+    _groupsMemUsageBytes = _groupsMemUsageBytes - memUsageBefore + group.memUsageBytes();
+    ++_size;
+    return true;
+}
+
+bool RecordIdSet::contains(const RecordId& id) const {
+    const int64_t high = highBits(id);
+    size_t pos = findGroup(high);
+    if (pos == _groups.size() || _groups[pos].high != high) {
+        return false;
+    }
+    _lastGroup = pos;
+    return _groups[pos].contains(lowBits(id));
+}
+
+bool RecordIdSet::erase(const RecordId& id) {
+    const int64_t high = highBits(id);
+    size_t pos = findGroup(high);
+    if (pos == _groups.size() || _groups[pos].high != high) {
+        return false;
+    }
+
+    Group& group = _groups[pos];
+    if (!group.erase(lowBits(id))) {
+        return false;
+    }
+    --_size;
+
+    if (group.size == 0) {
+        _groupsMemUsageBytes -= group.memUsageBytes();
+        _groups.erase(_groups.begin() + pos);
+        _lastGroup = 0;
+    }
+    return true;
+}
+
+void RecordIdSet::clear() {
+    std::vector<Group>().swap(_groups);
+    _lastGroup = 0;
+    _size = 0;
+    _groupsMemUsageBytes = 0;
+}
+
+}  // namespace mongo
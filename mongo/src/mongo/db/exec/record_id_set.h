@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mongo/db/record_id.h"
+
+namespace mongo {
+
+/**
+ * A compressed set of RecordIds, used by the query stages which deduplicate the RecordIds they
+ * have already returned.
+ *
+ * In the style of a roaring bitmap, the set groups RecordIds by their upper 48 bits. Each group
+ * holds the lower 16 bits either as a sorted array of values or, once the group has more than
+ * kMaxArraySize members, as a bitmap of all 65536 possible values. The groups are kept in a vector
+ * sorted by their upper bits. RecordIds handed out by a storage engine are usually dense, so a set
+ * of many RecordIds takes a little over two bytes for each, rather than the tens of bytes of a node
+ * in a hash set.
+ */
+class RecordIdSet {
+public:
+    // The size beyond which a group's array is converted to a bitmap. An array this large takes as
+    // much memory as the bitmap.
+    static const size_t kMaxArraySize = 4096;
+
+    /**
+     * Adds 'id' to the set. Returns true if it was not already a member.
+     */
+    bool insert(const RecordId& id);
+
+    /**
+     * Returns true if 'id' is a member of the set.
+     */
+    bool contains(const RecordId& id) const;
+
+    /**
+     * Removes 'id' from the set. Returns true if it was a member.
+     */
+    bool erase(const RecordId& id);
+
+    /**
+     * Removes all members and releases the memory held by the set.
+     */
+    void clear();
+
+    size_t size() const {
+        return _size;
+    }
+
+    bool empty() const {
+        return _size == 0;
+    }
+
+    /**
+     * Returns the number of bytes of memory held by the set.
+     */
+    size_t memUsageBytes() const {
+        return _groups.capacity() * sizeof(Group) + _groupsMemUsageBytes;
+    }
+
+private:
+    /**
+     * The members of the set sharing the upper 48 bits 'high'.
+     */
+    struct Group {
+        explicit Group(int64_t high) : high(high) {}
+
+        bool contains(uint16_t low) const;
+        bool insert(uint16_t low);
+        bool erase(uint16_t low);
+
+        size_t memUsageBytes() const {
+            return array.capacity() * sizeof(uint16_t) + bitmap.capacity() * sizeof(uint64_t);
+        }
+
+        int64_t high;
+
+        // The lower 16 bits of each member in increasing order, while there are at most
+        // kMaxArraySize members. Empty once 'bitmap' is in use.
+        std::vector<uint16_t> array;
+
+        // One bit for each of the 65536 possible lower 16 bits, or empty while 'array' is in use.
+        std::vector<uint64_t> bitmap;
+
+        size_t size = 0;
+    };
+
+    static int64_t highBits(const RecordId& id) {
+        return id.repr() >> 16;
+    }
+
+    static uint16_t lowBits(const RecordId& id) {
+        return static_cast<uint16_t>(id.repr() & 0xFFFF);
+    }
+
+    /**
+     * Returns the position of the group with upper bits 'high', or of where it would be inserted.
+     */
+    size_t findGroup(int64_t high) const;
+
+    std::vector<Group> _groups;
+
+    // The position of the group most recently looked up, since consecutive lookups tend to fall
+    // into the same group.
+    mutable size_t _lastGroup = 0;
+
+    size_t _size = 0;
+    size_t _groupsMemUsageBytes = 0;
+};
+
+}  // namespace mongo
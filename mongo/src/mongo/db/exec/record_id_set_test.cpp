@@ -0,0 +1,130 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <set>
+
+#include "mongo/db/exec/record_id_set.h"
+#include "mongo/platform/random.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+TEST(RecordIdSetTest, InsertReportsWhetherIdWasNew) {
+    RecordIdSet set;
+    ASSERT_TRUE(set.empty());
+    ASSERT_TRUE(set.insert(RecordId(5)));
+    ASSERT_FALSE(set.insert(RecordId(5)));
+    ASSERT_TRUE(set.insert(RecordId(6)));
+    ASSERT_EQ(2U, set.size());
+    ASSERT_TRUE(set.contains(RecordId(5)));
+    ASSERT_TRUE(set.contains(RecordId(6)));
+    ASSERT_FALSE(set.contains(RecordId(7)));
+}
+
+TEST(RecordIdSetTest, EraseRemovesOnlyMembers) {
+    RecordIdSet set;
+    set.insert(RecordId(1));
+    set.insert(RecordId(1 << 20));
+    ASSERT_FALSE(set.erase(RecordId(2)));
+    ASSERT_TRUE(set.erase(RecordId(1 << 20)));
+    ASSERT_FALSE(set.contains(RecordId(1 << 20)));
+    ASSERT_TRUE(set.contains(RecordId(1)));
+    ASSERT_EQ(1U, set.size());
+}
+
+TEST(RecordIdSetTest, HandlesExtremeAndNegativeRecordIds) {
+    RecordIdSet set;
+    const std::vector<RecordId> ids{
+        RecordId::min(), RecordId(-1), RecordId(1), RecordId(65536), RecordId::max()};
+    for (auto&& id : ids) {
+        ASSERT_TRUE(set.insert(id));
+    }
+    for (auto&& id : ids) {
+        ASSERT_TRUE(set.contains(id));
+    }
+    ASSERT_FALSE(set.contains(RecordId(65535)));
+    ASSERT_FALSE(set.contains(RecordId(-65536)));
+}
+
+TEST(RecordIdSetTest, DenseGroupSwitchesToBitmapAndStaysCompact) {
+    RecordIdSet set;
+    for (int64_t i = 1; i <= 100000; ++i) {
+        ASSERT_TRUE(set.insert(RecordId(i)));
+    }
+    ASSERT_EQ(100000U, set.size());
+    for (int64_t i = 1; i <= 100000; ++i) {
+        ASSERT_TRUE(set.contains(RecordId(i)));
+    }
+    ASSERT_FALSE(set.contains(RecordId(100001)));
+
+    // Both groups have more than kMaxArraySize members, so each holds an 8KB bitmap.
+    ASSERT_LT(set.memUsageBytes(), 20000U);
+
+    for (int64_t i = 1; i <= 100000; i += 2) {
+        ASSERT_TRUE(set.erase(RecordId(i)));
+    }
+    ASSERT_EQ(50000U, set.size());
+    ASSERT_FALSE(set.contains(RecordId(1)));
+    ASSERT_TRUE(set.contains(RecordId(2)));
+}
+
+TEST(RecordIdSetTest, ClearReleasesMemory) {
+    RecordIdSet set;
+    for (int64_t i = 0; i < 10000; ++i) {
+        set.insert(RecordId(i * 7));
+    }
+    ASSERT_GT(set.memUsageBytes(), 0U);
+    set.clear();
+    ASSERT_TRUE(set.empty());
+    ASSERT_EQ(0U, set.memUsageBytes());
+    ASSERT_FALSE(set.contains(RecordId(7)));
+}
+
+TEST(RecordIdSetTest, MatchesStdSetForRandomOperations) {
+    PseudoRandom random(int64_t(1));
+    RecordIdSet set;
+    std::set<RecordId> expected;
+    for (int i = 0; i < 50000; ++i) {
+        RecordId id(random.nextInt64(1 << 22) - (1 << 21));
+        if (random.nextInt32(4) == 0) {
+            ASSERT_EQ(expected.erase(id) > 0, set.erase(id));
+        } else {
+            ASSERT_EQ(expected.insert(id).second, set.insert(id));
+        }
+        ASSERT_EQ(expected.size(), set.size());
+    }
+    for (auto&& id : expected) {
+        ASSERT_TRUE(set.contains(id));
+    }
+}
+
+}  // namespace
+}  // namespace mongo
@@ -181,10 +181,18 @@ UpdateStage::UpdateStage(OperationContext* opCtx,
     _specificStats.isDocReplacement = params.driver->isDocReplacement();
 }
 
-BSONObj UpdateStage::transformAndUpdate(const Snapshotted<BSONObj>& oldObj, RecordId& recordId) {
-    const UpdateRequest* request = _params.request;
-    UpdateDriver* driver = _params.driver;
-    CanonicalQuery* cq = _params.canonicalQuery;
+BSONObj UpdateStage::applyUpdateToDocument(OperationContext* opCtx,
+                                           Collection* collection,
+                                           const UpdateStageParams& params,
+                                           const Snapshotted<BSONObj>& oldObj,
+                                           const RecordId& recordId,
+                                           mutablebson::Document* doc,
+                                           mutablebson::DamageVector* damages,
+                                           bool* docWasModified,
+                                           RecordId* newRecordId) {
+    const UpdateRequest* request = params.request;
+    UpdateDriver* driver = params.driver;
+    CanonicalQuery* cq = params.canonicalQuery;
     UpdateLifecycle* lifecycle = request->getLifecycle();
 
     // If asked to return new doc, default to the oldObj, in case nothing changes.
@@ -196,23 +204,23 @@ BSONObj UpdateStage::transformAndUpdate(const Snapshotted<BSONObj>& oldObj, Reco
     // is needed to accomodate the new bson layout of the resulting document. In any event,
     // only enable in-place mutations if the underlying storage engine offers support for
     // writing damage events.
-    _doc.reset(oldObj.value(),
-               (_collection->updateWithDamagesSupported()
+    doc->reset(oldObj.value(),
+               (collection->updateWithDamagesSupported()
                     ? mutablebson::Document::kInPlaceEnabled
                     : mutablebson::Document::kInPlaceDisabled));
 
     BSONObj logObj;
 
-    bool docWasModified = false;
+    *docWasModified = false;
 
     Status status = Status::OK();
-    const bool validateForStorage = getOpCtx()->writesAreReplicated() &&
+    const bool validateForStorage = opCtx->writesAreReplicated() &&
         !request->isFromMigration() && driver->modOptions().enforceOkForStorage;
     FieldRefSet immutablePaths;
-    if (getOpCtx()->writesAreReplicated() && !request->isFromMigration()) {
+    if (opCtx->writesAreReplicated() && !request->isFromMigration()) {
         if (lifecycle) {
             auto immutablePathsVector =
-                getImmutableFields(getOpCtx(), request->getNamespaceString());
+                getImmutableFields(opCtx, request->getNamespaceString());
             if (immutablePathsVector) {
                 immutablePaths.fillFrom(
                     transitional_tools_do_not_use::unspool_vector(*immutablePathsVector));
@@ -224,11 +232,11 @@ BSONObj UpdateStage::transformAndUpdate(const Snapshotted<BSONObj>& oldObj, Reco
         // If we don't need match details, avoid doing the rematch
         status = driver->update(StringData(),
                                 oldObj.value(),
-                                &_doc,
+                                doc,
                                 validateForStorage,
                                 immutablePaths,
                                 &logObj,
-                                &docWasModified);
+                                docWasModified);
     } else {
         // If there was a matched field, obtain it.
         MatchDetails matchDetails;
@@ -243,11 +251,11 @@ BSONObj UpdateStage::transformAndUpdate(const Snapshotted<BSONObj>& oldObj, Reco
 
         status = driver->update(matchedField,
                                 oldObj.value(),
-                                &_doc,
+                                doc,
                                 validateForStorage,
                                 immutablePaths,
                                 &logObj,
-                                &docWasModified);
+                                docWasModified);
     }
 
     if (!status.isOK()) {
@@ -256,14 +264,14 @@ BSONObj UpdateStage::transformAndUpdate(const Snapshotted<BSONObj>& oldObj, Reco
 
     // Skip adding _id field if the collection is capped (since capped collection documents can
     // neither grow nor shrink).
-    const auto createIdField = !_collection->isCapped();
+    const auto createIdField = !collection->isCapped();
 
     // Ensure if _id exists it is first
-    status = ensureIdFieldIsFirst(&_doc);
+    status = ensureIdFieldIsFirst(doc);
     if (status.code() == ErrorCodes::InvalidIdField) {
         // Create ObjectId _id field if we are doing that
         if (createIdField) {
-            addObjectIDIdField(&_doc);
+            addObjectIDIdField(doc);
         }
     } else {
         uassertStatusOK(status);
@@ -271,30 +279,29 @@ BSONObj UpdateStage::transformAndUpdate(const Snapshotted<BSONObj>& oldObj, Reco
 
     // See if the changes were applied in place
     const char* source = NULL;
-    const bool inPlace = _doc.getInPlaceUpdates(&_damages, &source);
+    const bool inPlace = doc->getInPlaceUpdates(damages, &source);
 
-    if (inPlace && _damages.empty()) {
+    if (inPlace && damages->empty()) {
         // An interesting edge case. A modifier didn't notice that it was really a no-op
         // during its 'prepare' phase. That represents a missed optimization, but we still
         // shouldn't do any real work. Toggle 'docWasModified' to 'false'.
         //
         // Currently, an example of this is '{ $push : { x : {$each: [], $sort: 1} } }' when the 'x'
         // array exists and is already sorted.
-        docWasModified = false;
+        *docWasModified = false;
     }
 
-    if (docWasModified) {
+    if (*docWasModified) {
 
         // Prepare to write back the modified document
-        WriteUnitOfWork wunit(getOpCtx());
+        WriteUnitOfWork wunit(opCtx);
 
-        RecordId newRecordId;
         OplogUpdateEntryArgs args;
         if (!request->isExplain()) {
-            invariant(_collection);
-            auto* css = CollectionShardingState::get(getOpCtx(), _collection->ns());
-            args.nss = _collection->ns();
-            args.uuid = _collection->uuid();
+            invariant(collection);
+            auto* css = CollectionShardingState::get(opCtx, collection->ns());
+            args.nss = collection->ns();
+            args.uuid = collection->uuid();
             args.stmtId = request->getStmtId();
             args.update = logObj;
             args.criteria = css->getMetadata().extractDocumentKey(newObj);
@@ -315,37 +322,55 @@ BSONObj UpdateStage::transformAndUpdate(const Snapshotted<BSONObj>& oldObj, Reco
 
                 Snapshotted<RecordData> snap(oldObj.snapshotId(), oldRec);
 
-                StatusWith<RecordData> newRecStatus = _collection->updateDocumentWithDamages(
-                    getOpCtx(), recordId, std::move(snap), source, _damages, &args);
+                StatusWith<RecordData> newRecStatus = collection->updateDocumentWithDamages(
+                    opCtx, recordId, std::move(snap), source, *damages, &args);
 
                 newObj = uassertStatusOK(std::move(newRecStatus)).releaseToBson();
             }
 
-            newRecordId = recordId;
+            *newRecordId = recordId;
         } else {
             // The updates were not in place. Apply them through the file manager.
 
-            newObj = _doc.getObject();
+            newObj = doc->getObject();
             uassert(17419,
                     str::stream() << "Resulting document after update is larger than "
                                   << BSONObjMaxUserSize,
                     newObj.objsize() <= BSONObjMaxUserSize);
 
             if (!request->isExplain()) {
-                newRecordId = _collection->updateDocument(getOpCtx(),
+                *newRecordId = collection->updateDocument(opCtx,
                                                           recordId,
                                                           oldObj,
                                                           newObj,
                                                           true,
                                                           driver->modsAffectIndices(),
-                                                          _params.opDebug,
+                                                          params.opDebug,
                                                           &args);
             }
         }
 
-        invariant(oldObj.snapshotId() == getOpCtx()->recoveryUnit()->getSnapshotId());
+        invariant(oldObj.snapshotId() == opCtx->recoveryUnit()->getSnapshotId());
         wunit.commit();
+    }
 
+    return newObj;
+}
+
+BSONObj UpdateStage::transformAndUpdate(const Snapshotted<BSONObj>& oldObj, RecordId& recordId) {
+    bool docWasModified = false;
+    RecordId newRecordId;
+    BSONObj newObj = applyUpdateToDocument(getOpCtx(),
+                                           _collection,
+                                           _params,
+                                           oldObj,
+                                           recordId,
+                                           &_doc,
+                                           &_damages,
+                                           &docWasModified,
+                                           &newRecordId);
+
+    if (docWasModified) {
         // If the document moved, we might see it again in a collection scan (maybe it's
         // a document after our current document).
         //
@@ -354,14 +379,14 @@ BSONObj UpdateStage::transformAndUpdate(const Snapshotted<BSONObj>& oldObj, Reco
         // updatedRecordIds.
         //
         // This must be done after the wunit commits so we are sure we won't be rolling back.
-        if (_updatedRecordIds && (newRecordId != recordId || driver->modsAffectIndices())) {
+        if (_updatedRecordIds && (newRecordId != recordId || _params.driver->modsAffectIndices())) {
             _updatedRecordIds->insert(newRecordId);
         }
     }
 
     // Only record doc modifications if they wrote (exclude no-ops). Explains get
     // recorded as if they wrote.
-    if (docWasModified || request->isExplain()) {
+    if (docWasModified || _params.request->isExplain()) {
         _specificStats.nModified++;
     }
 
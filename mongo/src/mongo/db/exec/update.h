@@ -143,6 +143,26 @@ public:
                                            const NamespaceString& ns,
                                            UpdateStats* stats);
 
+    /**
+     * Computes the result of applying the mods in 'params' to the document 'oldObj' at RecordId
+     * 'recordId' of 'collection', then commits these changes to the database in a
+     * WriteUnitOfWork of its own. 'doc' and 'damages' are scratch space which callers may reuse
+     * across calls.
+     *
+     * Sets 'docWasModified' to whether the document was written, and if so sets 'newRecordId'
+     * to where it now lives. Returns a possibly unowned copy of the newly-updated version of
+     * the document.
+     */
+    static BSONObj applyUpdateToDocument(OperationContext* opCtx,
+                                         Collection* collection,
+                                         const UpdateStageParams& params,
+                                         const Snapshotted<BSONObj>& oldObj,
+                                         const RecordId& recordId,
+                                         mutablebson::Document* doc,
+                                         mutablebson::DamageVector* damages,
+                                         bool* docWasModified,
+                                         RecordId* newRecordId);
+
 private:
     /**
      * Computes the result of applying mods to the document 'oldObj' at RecordId 'recordId' in
@@ -58,6 +58,11 @@ void registerMongoDCollectors(FTDCController* controller) {
                                                                   BSON("collStats"
                                                                        << "oplog.rs")));
     }
+
+    // Lock profiler totals per resource type. These stay at zero unless lockProfilingEnabled is
+    // set, and their shape does not depend on which resources were waited on.
+    controller->addPeriodicCollector(stdx::make_unique<FTDCSimpleInternalCommandCollector>(
+        "lockProfile", "lockProfile", "", BSON("lockProfile" << 1 << "summary" << true)));
 }
 
 }  // namespace
@@ -49,6 +49,8 @@
 #include "mongo/db/server_options.h"
 #include "mongo/db/session_catalog.h"
 #include "mongo/db/views/durable_view_catalog.h"
+#include "mongo/db/views/materialized_view.h"
+#include "mongo/db/views/materialized_view_maintenance.h"
 #include "mongo/scripting/engine.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/fail_point_service.h"
@@ -82,6 +84,12 @@ void onWriteOpCompleted(OperationContext* opCtx,
     if (lastStmtIdWriteOpTime.isNull())
         return;
 
+    // The writes which keep materialized views up to date are made on behalf of the statement
+    // which wrote to the view's collection. They carry no statement id of their own and are not
+    // part of the retryable write history.
+    if (MaterializedViewPipeline::isBackingNamespace(nss))
+        return;
+
     if (session) {
         session->onWriteOpCompletedOnPrimary(opCtx,
                                              *opCtx->getTxnNumber(),
@@ -351,6 +359,10 @@ void OpObserverImpl::onInserts(OperationContext* opCtx,
         }
     }
 
+    if (!fromMigrate) {
+        MaterializedViewMaintenance::onInserts(opCtx, nss, begin, end);
+    }
+
     std::vector<StmtId> stmtIdsWritten;
     std::transform(begin, end, std::back_inserter(stmtIdsWritten), [](const InsertStatement& stmt) {
         return stmt.stmtId;
@@ -409,6 +421,10 @@ void OpObserverImpl::onUpdate(OperationContext* opCtx, const OplogUpdateEntryArg
         SessionCatalog::get(opCtx)->invalidateSessions(opCtx, args.updatedDoc);
     }
 
+    if (!args.fromMigrate && args.preImageDoc) {
+        MaterializedViewMaintenance::onUpdate(opCtx, args.nss, *args.preImageDoc, args.updatedDoc);
+    }
+
     onWriteOpCompleted(opCtx,
                        args.nss,
                        session,
@@ -420,6 +436,8 @@ void OpObserverImpl::onUpdate(OperationContext* opCtx, const OplogUpdateEntryArg
 auto OpObserverImpl::aboutToDelete(OperationContext* opCtx,
                                    NamespaceString const& nss,
                                    BSONObj const& doc) -> CollectionShardingState::DeleteState {
+    MaterializedViewMaintenance::aboutToDelete(opCtx, nss, doc);
+
     auto* css = CollectionShardingState::get(opCtx, nss.ns());
     return css->makeDeleteState(doc);
 }
@@ -464,6 +482,10 @@ void OpObserverImpl::onDelete(OperationContext* opCtx,
         SessionCatalog::get(opCtx)->invalidateSessions(opCtx, deleteState.documentKey);
     }
 
+    if (!fromMigrate) {
+        MaterializedViewMaintenance::onDelete(opCtx, nss);
+    }
+
     onWriteOpCompleted(
         opCtx, nss, session, std::vector<StmtId>{stmtId}, opTime.writeOpTime, opTime.wallClockTime);
 }
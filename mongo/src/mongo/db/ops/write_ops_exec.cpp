@@ -38,12 +38,14 @@
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database_holder.h"
 #include "mongo/db/catalog/document_validation.h"
+#include "mongo/db/catalog/index_catalog.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/db/curop_metrics.h"
 #include "mongo/db/db_raii.h"
 #include "mongo/db/exec/delete.h"
 #include "mongo/db/exec/update.h"
+#include "mongo/db/index/index_access_method.h"
 #include "mongo/db/introspect.h"
 #include "mongo/db/lasterror.h"
 #include "mongo/db/ops/delete_request.h"
@@ -56,6 +58,7 @@
 #include "mongo/db/ops/write_ops_gen.h"
 #include "mongo/db/ops/write_ops_retryability.h"
 #include "mongo/db/query/get_executor.h"
+#include "mongo/db/query/indexability.h"
 #include "mongo/db/query/plan_summary_stats.h"
 #include "mongo/db/query/query_knobs.h"
 #include "mongo/db/repl/repl_client_info.h"
@@ -647,6 +650,173 @@ db.test1.update(
 )
 */ 
 
+/**
+ * Returns the _id index through which a write with 'query' and 'collation' may be applied directly,
+ * or null if it must go through a PlanExecutor. The query must be an exact match on an _id value
+ * under the collection default collation, and the collection must not need sharding metadata.
+ */
+static const IndexDescriptor* getIdIndexForPointWrite(OperationContext* opCtx,
+                                                      Collection* collection,
+                                                      const BSONObj& query,
+                                                      const BSONObj& collation) {
+    if (!internalQueryEnableIdPointOperations.load() || !collection || !collation.isEmpty()) {
+        return nullptr;
+    }
+    if (collection->ns().isSystem() || collection->ns().isVirtualized()) {
+        return nullptr;
+    }
+    if (ShardingState::get(opCtx)->needCollectionMetadata(opCtx, collection->ns().ns())) {
+        return nullptr;
+    }
+    if (query.nFields() != 1) {
+        return nullptr;
+    }
+    BSONElement idElt = query.firstElement();
+    if (idElt.fieldNameStringData() != "_id" || !Indexability::isExactBoundsGenerating(idElt)) {
+        return nullptr;
+    }
+    return collection->getIndexCatalog()->findIdIndex(opCtx);
+}
+
+/**
+ * Fills out CurOp for a write applied through 'idIndex' as the IDHACK plan would.
+ */
+static void recordPointWriteInCurOp(OperationContext* opCtx,
+                                    Collection* collection,
+                                    const IndexDescriptor* idIndex,
+                                    long long docsExamined) {
+    auto& curOp = *CurOp::get(opCtx);
+    {
+        stdx::lock_guard<Client> lk(*opCtx->getClient());
+        curOp.setPlanSummary_inlock("IDHACK"_sd);
+    }
+    curOp.debug().keysExamined = 1;
+    curOp.debug().docsExamined = docsExamined;
+    collection->infoCache()->notifyOfQuery(opCtx, {idIndex->indexName()});
+}
+
+/**
+ * Applies 'parsedUpdate' straight to the document found through the _id index, without building a
+ * PlanExecutor. Returns boost::none if the update must instead go through getExecutorUpdate(),
+ * which includes an upsert that matches no document.
+ */
+static boost::optional<SingleWriteResult> performSingleUpdateOpById(OperationContext* opCtx,
+                                                                    Collection* collection,
+                                                                    ParsedUpdate* parsedUpdate) {
+    const UpdateRequest* request = parsedUpdate->getRequest();
+    if (parsedUpdate->hasParsedQuery()) {
+        return boost::none;
+    }
+    const IndexDescriptor* idIndex =
+        getIdIndexForPointWrite(opCtx, collection, request->getQuery(), request->getCollation());
+    if (!idIndex) {
+        return boost::none;
+    }
+
+    UpdateDriver* driver = parsedUpdate->getDriver();
+    if (collection->getDefaultCollator()) {
+        parsedUpdate->setCollator(collection->getDefaultCollator()->clone());
+    }
+    if (UpdateLifecycle* lifecycle = request->getLifecycle()) {
+        lifecycle->setCollection(collection);
+        driver->refreshIndexKeys(lifecycle->getIndexKeys(opCtx));
+    }
+
+    auto& curOp = *CurOp::get(opCtx);
+    UpdateStageParams updateStageParams(request, driver, &curOp.debug());
+    IndexAccessMethod* idAccessMethod = collection->getIndexCatalog()->getIndex(idIndex);
+    UpdateStats stats;
+    stats.isDocReplacement = driver->isDocReplacement();
+    writeConflictRetry(opCtx, "update", collection->ns().ns(), [&] {
+        stats.nMatched = 0;
+        stats.nModified = 0;
+
+        RecordId recordId = idAccessMethod->findSingle(opCtx, request->getQuery());
+        Snapshotted<BSONObj> oldObj;
+        if (recordId.isNull() || !collection->findDoc(opCtx, recordId, &oldObj)) {
+            return;
+        }
+
+        mutablebson::DamageVector damages;
+        bool docWasModified = false;
+        RecordId newRecordId;
+        UpdateStage::applyUpdateToDocument(opCtx,
+                                           collection,
+                                           updateStageParams,
+                                           oldObj,
+                                           recordId,
+                                           &driver->getDocument(),
+                                           &damages,
+                                           &docWasModified,
+                                           &newRecordId);
+        stats.nMatched = 1;
+        stats.nModified = docWasModified ? 1 : 0;
+    });
+
+    if (stats.nMatched == 0 && request->isUpsert()) {
+        return boost::none;
+    }
+
+    UpdateStage::recordUpdateStatsInOpDebug(&stats, &curOp.debug());
+    recordPointWriteInCurOp(opCtx, collection, idIndex, stats.nMatched);
+    UpdateResult res = UpdateStage::makeUpdateResult(&stats);
+
+    LastError::get(opCtx->getClient()).recordUpdate(res.existing, res.numMatched, res.upserted);
+
+    SingleWriteResult result;
+    result.setN(res.numMatched);
+    result.setNModified(res.numDocsModified);
+    return result;
+}
+
+/**
+ * Deletes the document matched by 'parsedDelete' straight through the _id index, without building
+ * a PlanExecutor. Returns boost::none if the delete must instead go through getExecutorDelete().
+ */
+static boost::optional<SingleWriteResult> performSingleDeleteOpById(OperationContext* opCtx,
+                                                                    Collection* collection,
+                                                                    ParsedDelete* parsedDelete) {
+    const DeleteRequest* request = parsedDelete->getRequest();
+    if (parsedDelete->hasParsedQuery() || (collection && collection->isCapped())) {
+        return boost::none;
+    }
+    const IndexDescriptor* idIndex =
+        getIdIndexForPointWrite(opCtx, collection, request->getQuery(), request->getCollation());
+    if (!idIndex) {
+        return boost::none;
+    }
+
+    auto& curOp = *CurOp::get(opCtx);
+    IndexAccessMethod* idAccessMethod = collection->getIndexCatalog()->getIndex(idIndex);
+    long long n = 0;
+    writeConflictRetry(opCtx, "delete", collection->ns().ns(), [&] {
+        n = 0;
+
+        RecordId recordId = idAccessMethod->findSingle(opCtx, request->getQuery());
+        if (recordId.isNull()) {
+            return;
+        }
+
+        WriteUnitOfWork wunit(opCtx);
+        collection->deleteDocument(opCtx,
+                                   request->getStmtId(),
+                                   recordId,
+                                   &curOp.debug(),
+                                   request->isFromMigrate());
+        wunit.commit();
+        n = 1;
+    });
+
+    curOp.debug().ndeleted = n;
+    recordPointWriteInCurOp(opCtx, collection, idIndex, n);
+
+    LastError::get(opCtx->getClient()).recordDelete(n);
+
+    SingleWriteResult result;
+    result.setN(n);
+    return result;
+}
+
 //performUpdatesе
 static SingleWriteResult performSingleUpdateOp(OperationContext* opCtx,
                                                const NamespaceString& ns,
@@ -726,6 +896,11 @@ static SingleWriteResult performSingleUpdateOp(OperationContext* opCtx,
 	//дڵжϼ汾ж
     assertCanWrite_inlock(opCtx, ns);
 
+    if (auto result =
+            performSingleUpdateOpById(opCtx, collection->getCollection(), &parsedUpdate)) {
+        return *result;
+    }
+
 	//ִмƻԲοdb.xxx.find(xxx).explain('allPlansExecution')
 	//ȡִмƻӦPlanExecutor
     auto exec = uassertStatusOK(
@@ -896,6 +1071,10 @@ static SingleWriteResult performSingleDeleteOp(OperationContext* opCtx,
 	//дڵжϼ汾ж
     assertCanWrite_inlock(opCtx, ns);
 
+    if (auto result = performSingleDeleteOpById(opCtx, collection.getCollection(), &parsedDelete)) {
+        return *result;
+    }
+
 	//ºִмƻأһ
     auto exec = uassertStatusOK(
         getExecutorDelete(opCtx, &curOp.debug(), collection.getCollection(), &parsedDelete));
@@ -60,6 +60,14 @@ public:
         processInternal(input, merging);
     }
 
+    /** Process each of 'inputs' in order, with the same result as calling process() on each.
+     *  Accumulators which can handle runs of values of the same type together override
+     *  processBatchInternal().
+     */
+    void processBatch(const std::vector<Value>& inputs, bool merging) {
+        processBatchInternal(inputs, merging);
+    }
+
     /** Marks the end of the evaluate() phase and return accumulated result.
      *  toBeMerged should be true when the outputs will be merged by process().
      */
@@ -89,6 +97,13 @@ protected:
     /// Update subclass's internal state based on input
     virtual void processInternal(const Value& input, bool merging) = 0;
 
+    /// Update subclass's internal state based on each of 'inputs' in order
+    virtual void processBatchInternal(const std::vector<Value>& inputs, bool merging) {
+        for (auto&& input : inputs) {
+            processInternal(input, merging);
+        }
+    }
+
     const boost::intrusive_ptr<ExpressionContext>& getExpressionContext() const {
         return _expCtx;
     }
@@ -161,11 +176,22 @@ private:
 };
 
 
+/**
+ * Adds the values in ['begin', 'end'), which must all be of type 'type', to 'total'. The result is
+ * exactly the same as adding them one at a time, but without examining the type of each value.
+ * Returns false, having added nothing, if 'type' is not NumberInt, NumberLong or NumberDouble.
+ */
+bool addNumericRun(BSONType type,
+                   std::vector<Value>::const_iterator begin,
+                   std::vector<Value>::const_iterator end,
+                   DoubleDoubleSummation* total);
+
 class AccumulatorSum final : public Accumulator {
 public:
     explicit AccumulatorSum(const boost::intrusive_ptr<ExpressionContext>& expCtx);
 
     void processInternal(const Value& input, bool merging) final;
+    void processBatchInternal(const std::vector<Value>& inputs, bool merging) final;
     Value getValue(bool toBeMerged) final;
     const char* getOpName() const final;
     void reset() final;
@@ -198,6 +224,7 @@ public:
     AccumulatorMinMax(const boost::intrusive_ptr<ExpressionContext>& expCtx, Sense sense);
 
     void processInternal(const Value& input, bool merging) final;
+    void processBatchInternal(const std::vector<Value>& inputs, bool merging) final;
     Value getValue(bool toBeMerged) final;
     const char* getOpName() const final;
     void reset() final;
@@ -254,6 +281,7 @@ public:
     explicit AccumulatorAvg(const boost::intrusive_ptr<ExpressionContext>& expCtx);
 
     void processInternal(const Value& input, bool merging) final;
+    void processBatchInternal(const std::vector<Value>& inputs, bool merging) final;
     Value getValue(bool toBeMerged) final;
     const char* getOpName() const final;
     void reset() final;
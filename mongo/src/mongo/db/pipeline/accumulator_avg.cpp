@@ -30,6 +30,8 @@
 
 #include "mongo/db/pipeline/accumulator.h"
 
+#include <algorithm>
+
 #include "mongo/db/pipeline/accumulation_statement.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression.h"
@@ -92,6 +94,27 @@ void AccumulatorAvg::processInternal(const Value& input, bool merging) {
     _count++;
 }
 
+void AccumulatorAvg::processBatchInternal(const std::vector<Value>& inputs, bool merging) {
+    if (merging) {
+        Accumulator::processBatchInternal(inputs, merging);
+        return;
+    }
+
+    for (auto runBegin = inputs.begin(); runBegin != inputs.end();) {
+        const BSONType type = runBegin->getType();
+        auto runEnd = std::find_if(
+            runBegin, inputs.end(), [type](const Value& input) { return input.getType() != type; });
+        if (addNumericRun(type, runBegin, runEnd, &_nonDecimalTotal)) {
+            _count += runEnd - runBegin;
+        } else {
+            for (auto it = runBegin; it != runEnd; ++it) {
+                processInternal(*it, false);
+            }
+        }
+        runBegin = runEnd;
+    }
+}
+
 intrusive_ptr<Accumulator> AccumulatorAvg::create(
     const boost::intrusive_ptr<ExpressionContext>& expCtx) {
     return new AccumulatorAvg(expCtx);
@@ -30,6 +30,9 @@
 
 #include "mongo/db/pipeline/accumulator.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "mongo/db/pipeline/accumulation_statement.h"
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/value.h"
@@ -61,6 +64,82 @@ void AccumulatorMinMax::processInternal(const Value& input, bool merging) {
     }
 }
 
+namespace {
+/**
+ * Returns the first of the values in ['begin', 'end') which would be chosen by processing them in
+ * order, where 'isBetter' must order values of type T the same way as the ValueComparator.
+ */
+template <typename T, typename GetFn, typename BetterFn>
+std::vector<Value>::const_iterator findExtreme(std::vector<Value>::const_iterator begin,
+                                               std::vector<Value>::const_iterator end,
+                                               GetFn get,
+                                               BetterFn isBetter) {
+    auto best = begin;
+    T bestVal = get(*best);
+    for (auto it = begin + 1; it != end; ++it) {
+        const T val = get(*it);
+        if (isBetter(val, bestVal)) {
+            best = it;
+            bestVal = val;
+        }
+    }
+    return best;
+}
+
+// NaN compares below all other numbers, and equal to itself.
+bool doubleLessThan(double lhs, double rhs) {
+    return std::isnan(lhs) ? !std::isnan(rhs) : (!std::isnan(rhs) && lhs < rhs);
+}
+}  // namespace
+
+void AccumulatorMinMax::processBatchInternal(const std::vector<Value>& inputs, bool merging) {
+    const bool min = _sense == MIN;
+    for (auto runBegin = inputs.begin(); runBegin != inputs.end();) {
+        const BSONType type = runBegin->getType();
+        auto runEnd = std::find_if(
+            runBegin, inputs.end(), [type](const Value& input) { return input.getType() != type; });
+
+        // Within a run of numbers of the same type, find the best candidate without going through
+        // the ValueComparator, which only needs to compare it against the current value. Numbers
+        // are unaffected by the collation.
+        switch (type) {
+            case NumberInt:
+                processInternal(*findExtreme<int>(runBegin,
+                                                  runEnd,
+                                                  [](const Value& v) { return v.getInt(); },
+                                                  [min](int lhs, int rhs) {
+                                                      return min ? lhs < rhs : rhs < lhs;
+                                                  }),
+                                merging);
+                break;
+            case NumberLong:
+                processInternal(*findExtreme<long long>(runBegin,
+                                                        runEnd,
+                                                        [](const Value& v) { return v.getLong(); },
+                                                        [min](long long lhs, long long rhs) {
+                                                            return min ? lhs < rhs : rhs < lhs;
+                                                        }),
+                                merging);
+                break;
+            case NumberDouble:
+                processInternal(*findExtreme<double>(runBegin,
+                                                     runEnd,
+                                                     [](const Value& v) { return v.getDouble(); },
+                                                     [min](double lhs, double rhs) {
+                                                         return min ? doubleLessThan(lhs, rhs)
+                                                                    : doubleLessThan(rhs, lhs);
+                                                     }),
+                                merging);
+                break;
+            default:
+                for (auto it = runBegin; it != runEnd; ++it) {
+                    processInternal(*it, merging);
+                }
+        }
+        runBegin = runEnd;
+    }
+}
+
 Value AccumulatorMinMax::getValue(bool toBeMerged) {
     if (_val.missing()) {
         return Value(BSONNULL);
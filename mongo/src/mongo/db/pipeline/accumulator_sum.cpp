@@ -28,6 +28,7 @@
 
 #include "mongo/platform/basic.h"
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
@@ -36,6 +37,7 @@
 #include "mongo/db/pipeline/accumulation_statement.h"
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/platform/overflow_arithmetic.h"
 #include "mongo/util/summation.h"
 
 namespace mongo {
@@ -84,6 +86,67 @@ void AccumulatorSum::processInternal(const Value& input, bool merging) {
     }
 }
 
+bool addNumericRun(BSONType type,
+                   std::vector<Value>::const_iterator begin,
+                   std::vector<Value>::const_iterator end,
+                   DoubleDoubleSummation* total) {
+    switch (type) {
+        case NumberInt: {
+            // No sum of fewer than 2**32 ints can overflow a long long.
+            long long intTotal = 0;
+            for (auto it = begin; it != end; ++it) {
+                intTotal += it->getInt();
+            }
+            total->addLong(intTotal);
+            return true;
+        }
+        case NumberLong: {
+            // The double-double sum is exact for integers, so adding a partial sum gives the same
+            // result as adding each of its terms. Flush the partial sum whenever it would overflow.
+            long long longTotal = 0;
+            for (auto it = begin; it != end; ++it) {
+                long long sum;
+                if (mongoSignedAddOverflow64(longTotal, it->getLong(), &sum)) {
+                    total->addLong(longTotal);
+                    sum = it->getLong();
+                }
+                longTotal = sum;
+            }
+            total->addLong(longTotal);
+            return true;
+        }
+        case NumberDouble:
+            // Compensated summation is not associative, so doubles must still be added in order.
+            for (auto it = begin; it != end; ++it) {
+                total->addDouble(it->getDouble());
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+void AccumulatorSum::processBatchInternal(const std::vector<Value>& inputs, bool merging) {
+    if (merging) {
+        Accumulator::processBatchInternal(inputs, merging);
+        return;
+    }
+
+    for (auto runBegin = inputs.begin(); runBegin != inputs.end();) {
+        const BSONType type = runBegin->getType();
+        auto runEnd = std::find_if(
+            runBegin, inputs.end(), [type](const Value& input) { return input.getType() != type; });
+        if (addNumericRun(type, runBegin, runEnd, &nonDecimalTotal)) {
+            totalType = Value::getWidestNumeric(totalType, type);
+        } else {
+            for (auto it = runBegin; it != runEnd; ++it) {
+                processInternal(*it, false);
+            }
+        }
+        runBegin = runEnd;
+    }
+}
+
 intrusive_ptr<Accumulator> AccumulatorSum::create(
     const boost::intrusive_ptr<ExpressionContext>& expCtx) {
     return new AccumulatorSum(expCtx);
@@ -66,6 +66,15 @@ static void assertExpectedResults(
                 ASSERT_EQUALS(op.second.getType(), result.getType());
             }
 
+            // Asserts that result equals expected result when the input is processed as a batch.
+            {
+                boost::intrusive_ptr<Accumulator> accum(factory(expCtx));
+                accum->processBatch(op.first, false);
+                Value result = accum->getValue(false);
+                ASSERT_VALUE_EQ(op.second, result);
+                ASSERT_EQUALS(op.second.getType(), result.getType());
+            }
+
             // Asserts that result equals expected result when all input is on one shard.
             {
                 boost::intrusive_ptr<Accumulator> accum(factory(expCtx));
@@ -334,6 +343,76 @@ TEST(Accumulators, Sum) {
          {{Value(9), Value()}, Value(9)}});
 }
 
+/**
+ * Asserts that processing 'inputs' as a batch gives exactly the same result, including the type,
+ * as processing them one at a time.
+ */
+static void assertBatchMatchesSequential(std::string accumulatorName,
+                                         const std::vector<Value>& inputs) {
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContextForTest());
+    auto factory = AccumulationStatement::getFactory(accumulatorName);
+
+    boost::intrusive_ptr<Accumulator> sequential(factory(expCtx));
+    for (auto&& val : inputs) {
+        sequential->process(val, false);
+    }
+    boost::intrusive_ptr<Accumulator> batch(factory(expCtx));
+    batch->processBatch(inputs, false);
+
+    ASSERT_VALUE_EQ(sequential->getValue(false), batch->getValue(false));
+    ASSERT_EQUALS(sequential->getValue(false).getType(), batch->getValue(false).getType());
+    ASSERT_VALUE_EQ(sequential->getValue(true), batch->getValue(true));
+}
+
+TEST(Accumulators, BatchOfRunsMatchesSequentialProcessing) {
+    std::vector<Value> inputs;
+    for (int i = 0; i < 100; ++i) {
+        inputs.push_back(Value(i * 7919 % 1000 - 500));
+    }
+    for (int i = 0; i < 100; ++i) {
+        inputs.push_back(Value(0.1 * i - 3.3));
+    }
+    inputs.push_back(Value(BSONNULL));
+    for (int i = 0; i < 100; ++i) {
+        inputs.push_back(Value(i * 1000000007LL - 50000000000LL));
+    }
+    inputs.push_back(Value("string"_sd));
+    inputs.push_back(Value(Decimal128("1.5")));
+    for (int i = 0; i < 10; ++i) {
+        inputs.push_back(Value(numeric_limits<int>::max() - i));
+    }
+
+    for (auto&& name : {"$sum", "$avg", "$min", "$max"}) {
+        assertBatchMatchesSequential(name, inputs);
+    }
+}
+
+TEST(Accumulators, BatchOfLongsMatchesSequentialProcessingAcrossOverflow) {
+    std::vector<Value> inputs{Value(numeric_limits<long long>::max()),
+                              Value(numeric_limits<long long>::max()),
+                              Value(numeric_limits<long long>::min()),
+                              Value(1LL),
+                              Value(numeric_limits<long long>::max())};
+    for (auto&& name : {"$sum", "$avg", "$min", "$max"}) {
+        assertBatchMatchesSequential(name, inputs);
+    }
+}
+
+TEST(Accumulators, BatchOfDoublesMatchesSequentialProcessingWithNaNAndSignedZero) {
+    const double nan = numeric_limits<double>::quiet_NaN();
+    const double inf = numeric_limits<double>::infinity();
+    for (auto&& inputs : std::vector<std::vector<Value>>{
+             {Value(-0.0), Value(0.0), Value(1e308), Value(1e308), Value(-1e308)},
+             {Value(0.0), Value(-0.0)},
+             {Value(1.0), Value(nan), Value(-inf), Value(2.0)},
+             {Value(nan), Value(nan), Value(inf)},
+             {Value(1e16), Value(1.0), Value(1.0), Value(-1e16)}}) {
+        for (auto&& name : {"$sum", "$avg", "$min", "$max"}) {
+            assertBatchMatchesSequential(name, inputs);
+        }
+    }
+}
+
 TEST(Accumulators, AddToSetRespectsCollation) {
     intrusive_ptr<ExpressionContextForTest> expCtx(new ExpressionContextForTest());
     CollatorInterfaceMock collator(CollatorInterfaceMock::MockType::kAlwaysEqual);
@@ -0,0 +1,136 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/change_stream_post_image_cache.h"
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/service_context.h"
+
+namespace mongo {
+
+namespace {
+
+const auto getPostImageCache = ServiceContext::declareDecoration<ChangeStreamPostImageCache>();
+
+}  // namespace
+
+ChangeStreamPostImageCache& ChangeStreamPostImageCache::get(ServiceContext* service) {
+    return getPostImageCache(service);
+}
+
+std::string ChangeStreamPostImageCache::makeKey(UUID collectionUUID, const Value& id) {
+    BSONObjBuilder builder;
+    collectionUUID.appendToBuilder(&builder, "u");
+    id.addToBsonObj(&builder, "i");
+    BSONObj keyObj = builder.obj();
+    return std::string(keyObj.objdata(), keyObj.objsize());
+}
+
+bool ChangeStreamPostImageCache::lookup(UUID collectionUUID,
+                                        const Value& id,
+                                        Timestamp clusterTime,
+                                        Date_t now,
+                                        Milliseconds maxAge,
+                                        boost::optional<Document>* postImage) {
+    const auto key = makeKey(collectionUUID, id);
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    auto it = _index.find(key);
+    if (it == _index.end()) {
+        return false;
+    }
+
+    const Entry& entry = *it->second;
+    if (entry.insertedAt + maxAge < now) {
+        _erase_inlock(it->second);
+        return false;
+    }
+    if (entry.clusterTime < clusterTime) {
+        return false;
+    }
+
+    *postImage = entry.postImage;
+    return true;
+}
+
+void ChangeStreamPostImageCache::insert(UUID collectionUUID,
+                                        const Value& id,
+                                        boost::optional<Document> postImage,
+                                        Timestamp clusterTime,
+                                        Date_t now,
+                                        Milliseconds maxAge,
+                                        size_t maxBytes) {
+    Entry entry;
+    entry.key = makeKey(collectionUUID, id);
+    entry.size = sizeof(Entry) + entry.key.size() +
+        (postImage ? postImage->getApproximateSize() : size_t(0));
+    entry.postImage = std::move(postImage);
+    entry.clusterTime = clusterTime;
+    entry.insertedAt = now;
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    auto it = _index.find(entry.key);
+    if (it != _index.end()) {
+        if (it->second->clusterTime > clusterTime) {
+            // The cached result is already newer.
+            return;
+        }
+        _erase_inlock(it->second);
+    }
+
+    while (!_entries.empty() && _entries.front().insertedAt + maxAge < now) {
+        _erase_inlock(_entries.begin());
+    }
+
+    if (entry.size > maxBytes) {
+        return;
+    }
+    while (!_entries.empty() && _bytes + entry.size > maxBytes) {
+        _erase_inlock(_entries.begin());
+    }
+
+    _bytes += entry.size;
+    auto key = entry.key;
+    _entries.push_back(std::move(entry));
+    _index[std::move(key)] = std::prev(_entries.end());
+}
+
+size_t ChangeStreamPostImageCache::getApproximateSize() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _bytes;
+}
+
+void ChangeStreamPostImageCache::_erase_inlock(EntryList::iterator it) {
+    _bytes -= it->size;
+    _index.erase(it->key);
+    _entries.erase(it);
+}
+
+}  // namespace mongo
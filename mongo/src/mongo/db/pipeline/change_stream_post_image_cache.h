@@ -0,0 +1,118 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <list>
+#include <string>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/bson/timestamp.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/value.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/unordered_map.h"
+#include "mongo/util/time_support.h"
+#include "mongo/util/uuid.h"
+
+namespace mongo {
+
+class ServiceContext;
+
+/**
+ * A short-lived cache of "updateLookup" post-images, shared by all change streams on a node, keyed
+ * by collection UUID and _id.
+ *
+ * Each entry records the cluster time of the newest change event it was looked up for. Since a
+ * change stream only sees an event once every earlier write is visible, such an entry reflects
+ * every write at or before that time, and can therefore serve any event no newer than it. Entries
+ * are also bounded in age, so a hit is never much staler than a fresh lookup would be.
+ *
+ * _id values are compared by their BSON representation, so the cache must only be used for
+ * collections with the simple default collation.
+ */
+class ChangeStreamPostImageCache {
+    MONGO_DISALLOW_COPYING(ChangeStreamPostImageCache);
+
+public:
+    ChangeStreamPostImageCache() = default;
+
+    static ChangeStreamPostImageCache& get(ServiceContext* service);
+
+    /**
+     * Returns true if there is an entry for 'id' in 'collectionUUID' which is no older than
+     * 'maxAge' and reflects every write at or before 'clusterTime'. On a hit, 'postImage' is set
+     * to the cached document, or to boost::none if the document did not exist.
+     */
+    bool lookup(UUID collectionUUID,
+                const Value& id,
+                Timestamp clusterTime,
+                Date_t now,
+                Milliseconds maxAge,
+                boost::optional<Document>* postImage);
+
+    /**
+     * Records the result of a lookup of 'id' which reflects every write at or before
+     * 'clusterTime'. Expired entries are discarded, and then the oldest entries are evicted
+     * while the cache is larger than 'maxBytes'.
+     */
+    void insert(UUID collectionUUID,
+                const Value& id,
+                boost::optional<Document> postImage,
+                Timestamp clusterTime,
+                Date_t now,
+                Milliseconds maxAge,
+                size_t maxBytes);
+
+    size_t getApproximateSize() const;
+
+private:
+    struct Entry {
+        std::string key;
+        boost::optional<Document> postImage;
+        Timestamp clusterTime;
+        Date_t insertedAt;
+        size_t size;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    static std::string makeKey(UUID collectionUUID, const Value& id);
+
+    void _erase_inlock(EntryList::iterator it);
+
+    mutable stdx::mutex _mutex;
+
+    // Ordered from least to most recently inserted.
+    EntryList _entries;
+    stdx::unordered_map<std::string, EntryList::iterator> _index;
+    size_t _bytes = 0;
+};
+
+}  // namespace mongo
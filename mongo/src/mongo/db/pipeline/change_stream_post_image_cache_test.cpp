@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/change_stream_post_image_cache.h"
+
+#include "mongo/db/pipeline/document_value_test_util.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+const Milliseconds kMaxAge{1000};
+const size_t kMaxBytes = 1024 * 1024;
+
+class ChangeStreamPostImageCacheTest : public unittest::Test {
+protected:
+    boost::optional<boost::optional<Document>> lookup(const Value& id,
+                                                      Timestamp clusterTime,
+                                                      Date_t now) {
+        boost::optional<Document> postImage;
+        if (!cache.lookup(uuid, id, clusterTime, now, kMaxAge, &postImage)) {
+            return boost::none;
+        }
+        return postImage;
+    }
+
+    ChangeStreamPostImageCache cache;
+    const UUID uuid = UUID::gen();
+    const Date_t start = Date_t::fromMillisSinceEpoch(100000);
+};
+
+TEST_F(ChangeStreamPostImageCacheTest, HitsForEventsAtOrBeforeTheCachedClusterTime) {
+    cache.insert(uuid,
+                 Value(1),
+                 Document{{"_id", 1}, {"x", 2}},
+                 Timestamp(10, 1),
+                 start,
+                 kMaxAge,
+                 kMaxBytes);
+
+    auto hit = lookup(Value(1), Timestamp(10, 1), start);
+    ASSERT_TRUE(hit);
+    ASSERT_DOCUMENT_EQ(**hit, (Document{{"_id", 1}, {"x", 2}}));
+    ASSERT_TRUE(lookup(Value(1), Timestamp(9, 0), start));
+
+    // A newer event may not have been visible when the post-image was read.
+    ASSERT_FALSE(lookup(Value(1), Timestamp(10, 2), start));
+}
+
+TEST_F(ChangeStreamPostImageCacheTest, CachesMissingDocuments) {
+    cache.insert(uuid, Value(1), boost::none, Timestamp(10, 1), start, kMaxAge, kMaxBytes);
+
+    auto hit = lookup(Value(1), Timestamp(10, 1), start);
+    ASSERT_TRUE(hit);
+    ASSERT_FALSE(*hit);
+}
+
+TEST_F(ChangeStreamPostImageCacheTest, DistinguishesCollectionsAndIds) {
+    cache.insert(uuid, Value(1), Document{{"_id", 1}}, Timestamp(10, 1), start, kMaxAge, kMaxBytes);
+
+    ASSERT_FALSE(lookup(Value(2), Timestamp(10, 1), start));
+    boost::optional<Document> postImage;
+    ASSERT_FALSE(
+        cache.lookup(UUID::gen(), Value(1), Timestamp(10, 1), start, kMaxAge, &postImage));
+}
+
+TEST_F(ChangeStreamPostImageCacheTest, EntriesExpire) {
+    cache.insert(uuid, Value(1), Document{{"_id", 1}}, Timestamp(10, 1), start, kMaxAge, kMaxBytes);
+
+    ASSERT_TRUE(lookup(Value(1), Timestamp(10, 1), start + kMaxAge));
+    ASSERT_FALSE(lookup(Value(1), Timestamp(10, 1), start + kMaxAge + Milliseconds(1)));
+    ASSERT_EQ(cache.getApproximateSize(), 0U);
+}
+
+TEST_F(ChangeStreamPostImageCacheTest, OlderResultDoesNotReplaceNewerOne) {
+    cache.insert(uuid, Value(1), Document{{"x", 2}}, Timestamp(10, 2), start, kMaxAge, kMaxBytes);
+    cache.insert(uuid, Value(1), Document{{"x", 1}}, Timestamp(10, 1), start, kMaxAge, kMaxBytes);
+
+    auto hit = lookup(Value(1), Timestamp(10, 2), start);
+    ASSERT_TRUE(hit);
+    ASSERT_DOCUMENT_EQ(**hit, (Document{{"x", 2}}));
+}
+
+TEST_F(ChangeStreamPostImageCacheTest, EvictsOldestEntriesWhenFull) {
+    cache.insert(uuid, Value(1), Document{{"_id", 1}}, Timestamp(10, 1), start, kMaxAge, kMaxBytes);
+    const size_t entrySize = cache.getApproximateSize();
+
+    cache.insert(uuid, Value(2), Document{{"_id", 2}}, Timestamp(10, 1), start, kMaxAge, entrySize);
+
+    ASSERT_FALSE(lookup(Value(1), Timestamp(10, 1), start));
+    ASSERT_TRUE(lookup(Value(2), Timestamp(10, 1), start));
+    ASSERT_EQ(cache.getApproximateSize(), entrySize);
+}
+
+}  // namespace
+}  // namespace mongo
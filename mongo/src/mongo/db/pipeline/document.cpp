@@ -49,26 +49,38 @@ const std::vector<StringData> Document::allMetadataFieldNames = {
     Document::metaFieldTextScore, Document::metaFieldRandVal, Document::metaFieldSortKey};
 
 Position DocumentStorage::findField(StringData requested) const {
+    if (_numFields >= HASH_TAB_MIN) {
+        return findField(requested, hashKey(requested));
+    }
+    return findFieldLinear(requested);
+}
+
+Position DocumentStorage::findField(StringData requested, unsigned requestedHash) const {
+    if (_numFields < HASH_TAB_MIN) {
+        return findFieldLinear(requested);
+    }
+
     int reqSize = requested.size();  // get size calculation out of the way if needed
+    Position pos = _hashTab[requestedHash & _hashTabMask];
+    while (pos.found()) {
+        const ValueElement& elem = getField(pos);
+        if (elem.nameLen == reqSize && memcmp(requested.rawData(), elem._name, reqSize) == 0) {
+            return pos;
+        }
 
-    if (_numFields >= HASH_TAB_MIN) {  // hash lookup
-        const unsigned bucket = bucketForKey(requested);
+        // possible collision
+        pos = elem.nextCollision;
+    }
 
-        Position pos = _hashTab[bucket];
-        while (pos.found()) {
-            const ValueElement& elem = getField(pos);
-            if (elem.nameLen == reqSize && memcmp(requested.rawData(), elem._name, reqSize) == 0) {
-                return pos;
-            }
+    // if we got here, there's no such field
+    return Position();
+}
 
-            // possible collision
-            pos = elem.nextCollision;
-        }
-    } else {  // linear scan
-        for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance()) {
-            if (it->nameLen == reqSize && memcmp(requested.rawData(), it->_name, reqSize) == 0) {
-                return it.position();
-            }
+Position DocumentStorage::findFieldLinear(StringData requested) const {
+    int reqSize = requested.size();  // get size calculation out of the way if needed
+    for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance()) {
+        if (it->nameLen == reqSize && memcmp(requested.rawData(), it->_name, reqSize) == 0) {
+            return it.position();
         }
     }
 
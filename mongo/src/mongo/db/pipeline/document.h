@@ -121,6 +121,17 @@ public:
         return storage().getField(key);
     }
 
+    /**
+     * Same as getField(key), but with 'keyHash' already computed by hashFieldName(key). Use this to
+     * avoid rehashing a field name that is looked up in many documents.
+     */
+    const Value getField(StringData key, unsigned keyHash) const {
+        return storage().getField(key, keyHash);
+    }
+    static unsigned hashFieldName(StringData key) {
+        return DocumentStorage::hashKey(key);
+    }
+
     /// Look up a field by Position. See positionOf and getNestedField.
     const Value operator[](Position pos) const {
         return getField(pos);
@@ -221,6 +221,18 @@ public:
     /// Returns the position of the named field (may be missing) or Position()
     Position findField(StringData name) const;
 
+    /// Same as findField(name), but with 'nameHash' already computed by hashKey(name).
+    Position findField(StringData name, unsigned nameHash) const;
+
+    /// Hashes a field name for findField(). Callers looking up the same name in many documents
+    /// can compute this once up front.
+    static unsigned hashKey(StringData name) {
+        // TODO consider FNV-1a once we have a better benchmark corpus
+        unsigned out;
+        MurmurHash3_x86_32(name.rawData(), name.size(), 0, &out);
+        return out;
+    }
+
     // Document uses these
     const ValueElement& getField(Position pos) const {
         verify(pos.found());
@@ -232,6 +244,12 @@ public:
             return Value();
         return getField(pos).val;
     }
+    Value getField(StringData name, unsigned nameHash) const {
+        Position pos = findField(name, nameHash);
+        if (!pos.found())
+            return Value();
+        return getField(pos).val;
+    }
 
     // MutableDocument uses these
     ValueElement& getField(Position pos) {
@@ -349,12 +367,8 @@ private:
         memset(_hashTab, -1, hashTabBytes());
     }
 
-    static unsigned hashKey(StringData name) {
-        // TODO consider FNV-1a once we have a better benchmark corpus
-        unsigned out;
-        MurmurHash3_x86_32(name.rawData(), name.size(), 0, &out);
-        return out;
-    }
+    /// Looks up 'name' by scanning the fields in order, for documents without a hash table.
+    Position findFieldLinear(StringData name) const;
 
     unsigned bucketForKey(StringData name) const {
         return hashKey(name) & _hashTabMask;
@@ -753,6 +753,22 @@ public:
          */
         virtual BSONObj insert(const NamespaceString& ns, const std::vector<BSONObj>& objs) = 0;
 
+        /**
+         * Inserts each of 'batches' into 'ns', possibly concurrently and so in no particular order
+         * relative to each other. Returns the first error encountered, after every batch has been
+         * attempted. The default implementation inserts the batches in turn through insert().
+         */
+        virtual Status insertBatches(const NamespaceString& ns,
+                                     const std::vector<std::vector<BSONObj>>& batches) {
+            for (auto&& batch : batches) {
+                BSONObj err = insert(ns, batch);
+                if (!DBClientBase::getLastErrorString(err).empty()) {
+                    return {ErrorCodes::OperationFailed, err.toString()};
+                }
+            }
+            return Status::OK();
+        }
+
         virtual CollectionIndexUsageMap getIndexStats(OperationContext* opCtx,
                                                       const NamespaceString& ns) = 0;
 
@@ -852,6 +868,32 @@ public:
             const Document& documentKey,
             boost::optional<BSONObj> readConcern) = 0;
 
+        /**
+         * Looks up the documents with each of the document keys in 'documentKeys', returning one
+         * result per key, in order, with the same semantics as lookupSingleDocument(). Each
+         * result reflects at least every write at or before 'clusterTime'. The default
+         * implementation looks up each key in turn.
+         */
+        virtual std::vector<boost::optional<Document>> lookupDocumentsByKey(
+            const NamespaceString& nss,
+            UUID collectionUUID,
+            const std::vector<Document>& documentKeys,
+            Timestamp clusterTime) {
+            std::vector<boost::optional<Document>> results;
+            for (auto&& documentKey : documentKeys) {
+                results.push_back(
+                    lookupSingleDocument(nss, collectionUUID, documentKey, boost::none));
+            }
+            return results;
+        }
+
+        /**
+         * Sets whether a tailable, awaitData cursor feeding the current operation may block
+         * waiting for new data, returning the previous setting. A stage which reads ahead of its
+         * consumer turns waiting off once it holds a result, as the getMore command does.
+         */
+        virtual bool setShouldWaitForInserts(bool shouldWait) = 0;
+
         // Add new methods as needed.
     };
 
@@ -203,6 +203,14 @@ Value DocumentSourceCursor::serialize(boost::optional<ExplainOptions::Verbosity>
     if (!_projection.isEmpty())
         out["fields"] = Value(_projection);
 
+    if (!_pushedDownStages.empty()) {
+        std::vector<Value> pushedDownStages;
+        for (auto&& stage : _pushedDownStages) {
+            stage->serializeToArray(pushedDownStages, explain);
+        }
+        out["pushedDownStages"] = Value(std::move(pushedDownStages));
+    }
+
     // Add explain results from the query system into the agg explain output.
     BSONObj explainObj = explainBuilder.obj();
     invariant(explainObj.hasField("queryPlanner"));
@@ -215,6 +223,17 @@ Value DocumentSourceCursor::serialize(boost::optional<ExplainOptions::Verbosity>
     return Value(DOC(getSourceName() << out.freezeToValue()));
 }
 
+void DocumentSourceCursor::addPushedDownStage(intrusive_ptr<DocumentSource> stage) {
+    // A projection which was to be applied here no longer applies to the results.
+    if (_dependencies) {
+        _projection = BSONObj();
+        _dependencies = boost::none;
+    }
+    _shouldProduceEmptyDocs = false;
+    _outputSorts = SimpleBSONObjComparator::kInstance.makeBSONObjSet();
+    _pushedDownStages.push_back(std::move(stage));
+}
+
 void DocumentSourceCursor::detachFromOperationContext() {
     if (_exec) {
         _exec->detachFromOperationContext();
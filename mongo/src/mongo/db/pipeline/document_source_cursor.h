@@ -116,6 +116,13 @@ public:
         _dependencies = deps;
     }
 
+    /**
+     * Records that 'stage', which followed this cursor in the pipeline, now runs within the
+     * PlanExecutor. The results of the PlanExecutor are then the output of 'stage', so they are
+     * passed on whole and in no particular order. Pushed down stages are listed in explain output.
+     */
+    void addPushedDownStage(boost::intrusive_ptr<DocumentSource> stage);
+
     /**
      * Returns the limit associated with this cursor, or -1 if there is no limit.
      */
@@ -188,6 +195,9 @@ private:
     boost::intrusive_ptr<DocumentSourceLimit> _limit;
     long long _docsAddedToBatches;  // for _limit enforcement
 
+    // Stages from later in the pipeline which run within '_exec'.
+    std::vector<boost::intrusive_ptr<DocumentSource>> _pushedDownStages;
+
     // The underlying query plan which feeds this pipeline. Must be destroyed while holding the
     // collection lock.
     std::unique_ptr<PlanExecutor, PlanExecutor::Deleter> _exec;
@@ -28,6 +28,8 @@
 
 #include "mongo/platform/basic.h"
 
+#include <algorithm>
+
 #include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/accumulation_statement.h"
 #include "mongo/db/pipeline/accumulator.h"
@@ -167,6 +169,9 @@ DocumentSource::GetNextResult DocumentSourceGroup::getNextStreaming() {
 void DocumentSourceGroup::doDispose() {
     // Free our resources.
     _groups = pExpCtx->getValueComparator().makeUnorderedValueMap<Accumulators>();
+    _pendingInputs.clear();
+    _numPendingInputs = 0;
+    _pendingInputsBytes = 0;
     _sorterIterator.reset();
 
     // Make us look done.
@@ -221,12 +226,41 @@ Value DocumentSourceGroup::serialize(boost::optional<ExplainOptions::Verbosity>
         insides["$doingMerge"] = Value(true);
     }
 
+    if (explain && _unwindSrc) {
+        // Our explain output does not have to be parseable, so report the absorbed $unwind inside
+        // the $group, using a field name that cannot clash with an accumulator.
+        const auto& indexPath = _unwindSrc->indexPath();
+        insides["$unwinding"] =
+            Value(DOC("path" << ("$" + _unwindSrc->getUnwindPath()) << "preserveNullAndEmptyArrays"
+                             << _unwindSrc->preserveNullAndEmptyArrays()
+                             << "includeArrayIndex"
+                             << (indexPath ? Value(indexPath->fullPath()) : Value())));
+    }
+
     if (explain && findRelevantInputSort()) {
         return Value(DOC("$streamingGroup" << insides.freeze()));
     }
     return Value(DOC(getSourceName() << insides.freeze()));
 }
 
+void DocumentSourceGroup::serializeToArray(
+    std::vector<Value>& array, boost::optional<ExplainOptions::Verbosity> explain) const {
+    // Outside of explain, an absorbed $unwind is serialized as its own stage so that the output
+    // can be parsed again, for example when sent to the shards.
+    if (_unwindSrc && !explain) {
+        _unwindSrc->serializeToArray(array);
+    }
+    array.push_back(serialize(explain));
+}
+
+bool DocumentSourceGroup::absorbUnwind(const intrusive_ptr<DocumentSourceUnwind>& unwind) {
+    if (_unwindSrc) {
+        return false;
+    }
+    _unwindSrc = unwind;
+    return true;
+}
+
 DocumentSource::GetDepsReturn DocumentSourceGroup::getDependencies(DepsTracker* deps) const {
     // add the _id
     for (size_t i = 0; i < _idExpressions.size(); i++) {
@@ -238,6 +272,10 @@ DocumentSource::GetDepsReturn DocumentSourceGroup::getDependencies(DepsTracker*
         accumulatedField.expression->addDependencies(deps);
     }
 
+    if (_unwindSrc) {
+        _unwindSrc->getDependencies(deps);
+    }
+
     return EXHAUSTIVE_ALL;
 }
 
@@ -481,61 +519,13 @@ DocumentSource::GetNextResult DocumentSourceGroup::initialize() {
     // Barring any pausing, this loop exhausts 'pSource' and populates '_groups'.
     GetNextResult input = pSource->getNext();
     for (; input.isAdvanced(); input = pSource->getNext()) {
-        if (_memoryUsageBytes > _maxMemoryUsageBytes) {
-            uassert(16945,
-                    "Exceeded memory limit for $group, but didn't allow external sort."
-                    " Pass allowDiskUse:true to opt in.",
-                    _allowDiskUse);
-            _sortedFiles.push_back(spill());
-            _memoryUsageBytes = 0;
-        }
-
         // We release the result document here so that it does not outlive the end of this loop
         // iteration. Not releasing could lead to an array copy when this group follows an unwind.
-        auto rootDocument = input.releaseDocument();
-        Value id = computeId(rootDocument);
-
-        // Look for the _id value in the map. If it's not there, add a new entry with a blank
-        // accumulator. This is done in a somewhat odd way in order to avoid hashing 'id' and
-        // looking it up in '_groups' multiple times.
-        const size_t oldSize = _groups->size();
-        vector<intrusive_ptr<Accumulator>>& group = (*_groups)[id];
-        const bool inserted = _groups->size() != oldSize;
-
-        if (inserted) {
-            _memoryUsageBytes += id.getApproximateSize();
-
-            // Add the accumulators
-            group.reserve(numAccumulators);
-            for (auto&& accumulatedField : _accumulatedFields) {
-                group.push_back(accumulatedField.makeAccumulator(pExpCtx));
-            }
+        if (_unwindSrc) {
+            _unwindSrc->unwindDocument(input.releaseDocument(),
+                                       [this](Document unwound) { accumulate(unwound); });
         } else {
-            for (auto&& groupObj : group) {
-                // subtract old mem usage. New usage added back after processing.
-                _memoryUsageBytes -= groupObj->memUsageForSorter();
-            }
-        }
-
-        /* tickle all the accumulators for the group we found */
-        dassert(numAccumulators == group.size());
-
-        for (size_t i = 0; i < numAccumulators; i++) {
-            group[i]->process(_accumulatedFields[i].expression->evaluate(rootDocument),
-                              _doingMerge);
-
-            _memoryUsageBytes += group[i]->memUsageForSorter();
-        }
-
-        if (kDebugBuild && !storageGlobalParams.readOnly) {
-            // In debug mode, spill every time we have a duplicate id to stress merge logic.
-            if (!inserted &&                 // is a dup
-                !pExpCtx->inMongos &&        // can't spill to disk in mongos
-                !_allowDiskUse &&            // don't change behavior when testing external sort
-                _sortedFiles.size() < 20) {  // don't open too many FDs
-
-                _sortedFiles.push_back(spill());
-            }
+            accumulate(input.releaseDocument());
         }
     }
 
@@ -544,34 +534,11 @@ DocumentSource::GetNextResult DocumentSourceGroup::initialize() {
             MONGO_UNREACHABLE;  // We consumed all advances above.
         }
         case DocumentSource::GetNextResult::ReturnStatus::kPauseExecution: {
+            processPendingInputs();
             return input;  // Propagate pause.
         }
         case DocumentSource::GetNextResult::ReturnStatus::kEOF: {
-            // Do any final steps necessary to prepare to output results.
-            if (!_sortedFiles.empty()) {
-                _spilled = true;
-                if (!_groups->empty()) {
-                    _sortedFiles.push_back(spill());
-                }
-
-                // We won't be using groups again so free its memory.
-                _groups = pExpCtx->getValueComparator().makeUnorderedValueMap<Accumulators>();
-
-                _sorterIterator.reset(Sorter<Value, Value>::Iterator::merge(
-                    _sortedFiles, SortOptions(), SorterComparator(pExpCtx->getValueComparator())));
-
-                // prepare current to accumulate data
-                _currentAccumulators.reserve(numAccumulators);
-                for (auto&& accumulatedField : _accumulatedFields) {
-                    _currentAccumulators.push_back(accumulatedField.makeAccumulator(pExpCtx));
-                }
-
-                verify(_sorterIterator->more());  // we put data in, we should get something out.
-                _firstPartOfNextGroup = _sorterIterator->next();
-            } else {
-                // start the group iterator
-                groupsIterator = _groups->begin();
-            }
+            finishAccumulating();
 
             // This must happen last so that, unless control gets here, we will re-enter
             // initialization after getting a GetNextResult::ResultState::kPauseExecution.
@@ -582,6 +549,199 @@ DocumentSource::GetNextResult DocumentSourceGroup::initialize() {
     MONGO_UNREACHABLE;
 }
 
+void DocumentSourceGroup::finishAccumulating() {
+    const size_t numAccumulators = _accumulatedFields.size();
+
+    processPendingInputs();
+
+    // Do any final steps necessary to prepare to output results.
+    if (!_sortedFiles.empty()) {
+        _spilled = true;
+        if (!_groups->empty()) {
+            _sortedFiles.push_back(spill());
+        }
+
+        // We won't be using groups again so free its memory.
+        _groups = pExpCtx->getValueComparator().makeUnorderedValueMap<Accumulators>();
+
+        _sorterIterator.reset(Sorter<Value, Value>::Iterator::merge(
+            _sortedFiles, SortOptions(), SorterComparator(pExpCtx->getValueComparator())));
+
+        // prepare current to accumulate data
+        _currentAccumulators.reserve(numAccumulators);
+        for (auto&& accumulatedField : _accumulatedFields) {
+            _currentAccumulators.push_back(accumulatedField.makeAccumulator(pExpCtx));
+        }
+
+        verify(_sorterIterator->more());  // we put data in, we should get something out.
+        _firstPartOfNextGroup = _sorterIterator->next();
+    } else {
+        // start the group iterator
+        groupsIterator = _groups->begin();
+    }
+}
+
+namespace {
+// Queued inputs are processed once there are this many of them, or once their approximate size
+// reaches kMaxPendingInputsBytes, which keeps the queue small next to the memory limit.
+const size_t kMaxPendingInputs = 256;
+const size_t kMaxPendingInputsBytes = 1024 * 1024;
+
+/**
+ * Returns true if 'expression' can be evaluated by evaluateOnBSON().
+ */
+bool canEvaluateOnBSON(const intrusive_ptr<Expression>& expression) {
+    if (dynamic_cast<ExpressionConstant*>(expression.get())) {
+        return true;
+    }
+    auto fieldPath = dynamic_cast<ExpressionFieldPath*>(expression.get());
+    return fieldPath && fieldPath->isRootFieldPath() &&
+        fieldPath->getFieldPath().getPathLength() > 1;
+}
+
+Value evaluateOnBSON(const intrusive_ptr<Expression>& expression, const BSONObj& root) {
+    if (auto fieldPath = dynamic_cast<ExpressionFieldPath*>(expression.get())) {
+        return fieldPath->evaluateOnBSON(root);
+    }
+    return expression->evaluate(Document());
+}
+}  // namespace
+
+template <typename EvaluateArgument>
+void DocumentSourceGroup::accumulateWithId(Value id, const EvaluateArgument& evaluateArgument) {
+    const size_t numAccumulators = _accumulatedFields.size();
+
+    if (_numPendingInputs > 0 && !pExpCtx->getValueComparator().evaluate(_pendingId == id)) {
+        processPendingInputs();
+    }
+    if (_numPendingInputs == 0) {
+        _pendingInputsBytes += id.getApproximateSize();
+        _pendingId = std::move(id);
+        _pendingInputs.resize(numAccumulators);
+    }
+
+    for (size_t i = 0; i < numAccumulators; i++) {
+        _pendingInputs[i].push_back(evaluateArgument(i));
+        _pendingInputsBytes += _pendingInputs[i].back().getApproximateSize();
+    }
+
+    if (++_numPendingInputs >= kMaxPendingInputs ||
+        _pendingInputsBytes >= kMaxPendingInputsBytes) {
+        processPendingInputs();
+    }
+}
+
+void DocumentSourceGroup::processPendingInputs() {
+    const size_t numAccumulators = _accumulatedFields.size();
+    if (_numPendingInputs == 0) {
+        return;
+    }
+
+    if (_memoryUsageBytes > _maxMemoryUsageBytes) {
+        uassert(16945,
+                "Exceeded memory limit for $group, but didn't allow external sort."
+                " Pass allowDiskUse:true to opt in.",
+                _allowDiskUse);
+        _sortedFiles.push_back(spill());
+        _memoryUsageBytes = 0;
+    }
+
+    // Look for the _id value in the map. If it's not there, add a new entry with a blank
+    // accumulator. This is done in a somewhat odd way in order to avoid hashing 'id' and
+    // looking it up in '_groups' multiple times.
+    const size_t oldSize = _groups->size();
+    vector<intrusive_ptr<Accumulator>>& group = (*_groups)[_pendingId];
+    const bool inserted = _groups->size() != oldSize;
+
+    if (inserted) {
+        _memoryUsageBytes += _pendingId.getApproximateSize();
+
+        // Add the accumulators
+        group.reserve(numAccumulators);
+        for (auto&& accumulatedField : _accumulatedFields) {
+            group.push_back(accumulatedField.makeAccumulator(pExpCtx));
+        }
+    } else {
+        for (auto&& groupObj : group) {
+            // subtract old mem usage. New usage added back after processing.
+            _memoryUsageBytes -= groupObj->memUsageForSorter();
+        }
+    }
+
+    /* tickle all the accumulators for the group we found */
+    dassert(numAccumulators == group.size());
+    for (size_t i = 0; i < numAccumulators; i++) {
+        group[i]->processBatch(_pendingInputs[i], _doingMerge);
+        _memoryUsageBytes += group[i]->memUsageForSorter();
+
+        // Keep the capacity for the next run.
+        _pendingInputs[i].clear();
+    }
+
+    if (kDebugBuild && !storageGlobalParams.readOnly) {
+        // In debug mode, spill every time we have a duplicate id to stress merge logic.
+        if (!inserted &&                 // is a dup
+            !pExpCtx->inMongos &&        // can't spill to disk in mongos
+            !_allowDiskUse &&            // don't change behavior when testing external sort
+            _sortedFiles.size() < 20) {  // don't open too many FDs
+
+            _sortedFiles.push_back(spill());
+        }
+    }
+
+    _numPendingInputs = 0;
+    _pendingInputsBytes = 0;
+}
+
+bool DocumentSourceGroup::canAccumulateBSON() const {
+    if (_unwindSrc || _doingMerge || _streaming || _initialized) {
+        return false;
+    }
+    return std::all_of(_idExpressions.begin(), _idExpressions.end(), canEvaluateOnBSON) &&
+        std::all_of(_accumulatedFields.begin(),
+                    _accumulatedFields.end(),
+                    [](const AccumulationStatement& accumulatedField) {
+                        return canEvaluateOnBSON(accumulatedField.expression);
+                    });
+}
+
+boost::optional<std::string> DocumentSourceGroup::getFirstDocumentGroupField() const {
+    if (_unwindSrc || _doingMerge || _idExpressions.size() != 1 || !_idFieldNames.empty()) {
+        return boost::none;
+    }
+
+    auto fieldPath = dynamic_cast<ExpressionFieldPath*>(_idExpressions.front().get());
+    if (!fieldPath || !fieldPath->isRootFieldPath() ||
+        fieldPath->getFieldPath().getPathLength() < 2) {
+        return boost::none;
+    }
+
+    for (auto&& accumulatedField : _accumulatedFields) {
+        if (StringData(accumulatedField.makeAccumulator(pExpCtx)->getOpName()) != "$first"_sd) {
+            return boost::none;
+        }
+    }
+    return fieldPath->getFieldPath().tail().fullPath();
+}
+
+void DocumentSourceGroup::accumulateBSON(const BSONObj& input) {
+    accumulateWithId(computeIdFromBSON(input), [this, &input](size_t i) {
+        return evaluateOnBSON(_accumulatedFields[i].expression, input);
+    });
+}
+
+void DocumentSourceGroup::finishAccumulatingBSON() {
+    invariant(!_initialized);
+    finishAccumulating();
+    _initialized = true;
+}
+
+void DocumentSourceGroup::accumulate(const Document& root) {
+    accumulateWithId(computeId(root), [this, &root](size_t i) {
+        return _accumulatedFields[i].expression->evaluate(root);
+    });
+}
+
 shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill() {
     vector<const GroupsMap::value_type*> ptrs;  // using pointers to speed sorting
     ptrs.reserve(_groups->size());
@@ -635,6 +795,11 @@ boost::optional<BSONObj> DocumentSourceGroup::findRelevantInputSort() const {
         return boost::none;
     }
 
+    if (_unwindSrc) {
+        // The streaming path does not unwind its input.
+        return boost::none;
+    }
+
     BSONObjSet sorts = pSource->getOutputSorts();
 
     // 'sorts' is a BSONObjSet. We need to check if our group pattern is compatible with one of the
@@ -786,6 +951,20 @@ Value DocumentSourceGroup::computeId(const Document& root) {
     return Value(std::move(vals));
 }
 
+Value DocumentSourceGroup::computeIdFromBSON(const BSONObj& root) {
+    if (_idExpressions.size() == 1) {
+        Value retValue = evaluateOnBSON(_idExpressions[0], root);
+        return retValue.missing() ? Value(BSONNULL) : std::move(retValue);
+    }
+
+    vector<Value> vals;
+    vals.reserve(_idExpressions.size());
+    for (size_t i = 0; i < _idExpressions.size(); i++) {
+        vals.push_back(evaluateOnBSON(_idExpressions[i], root));
+    }
+    return Value(std::move(vals));
+}
+
 Value DocumentSourceGroup::expandId(const Value& val) {
     // _id doesn't get wrapped in a document
     if (_idFieldNames.empty())
@@ -34,6 +34,7 @@
 #include "mongo/db/pipeline/accumulation_statement.h"
 #include "mongo/db/pipeline/accumulator.h"
 #include "mongo/db/pipeline/document_source.h"
+#include "mongo/db/pipeline/document_source_unwind.h"
 #include "mongo/db/sorter/sorter.h"
 
 namespace mongo {
@@ -49,6 +50,9 @@ public:
     boost::intrusive_ptr<DocumentSource> optimize() final;
     GetDepsReturn getDependencies(DepsTracker* deps) const final;
     Value serialize(boost::optional<ExplainOptions::Verbosity> explain = boost::none) const final;
+    void serializeToArray(
+        std::vector<Value>& array,
+        boost::optional<ExplainOptions::Verbosity> explain = boost::none) const final;
     GetNextResult getNext() final;
     const char* getSourceName() const final;
     BSONObjSet getOutputSorts() final;
@@ -98,6 +102,47 @@ public:
         return _streaming;
     }
 
+    /**
+     * Takes over the work of 'unwind', which must immediately precede this stage, so that each
+     * array element is fed straight into the accumulators instead of first being returned from
+     * the $unwind stage as a separate document. Returns false, leaving 'unwind' in place, if this
+     * stage has already absorbed an $unwind.
+     */
+    bool absorbUnwind(const boost::intrusive_ptr<DocumentSourceUnwind>& unwind);
+
+    /**
+     * Returns the $unwind stage absorbed by absorbUnwind(), if any.
+     */
+    const boost::intrusive_ptr<DocumentSourceUnwind>& getAbsorbedUnwind() const {
+        return _unwindSrc;
+    }
+
+    /**
+     * Returns true if the group key and every accumulator argument are constants or paths within
+     * the input document, so that this stage can be fed BSON input through accumulateBSON()
+     * instead of reading Documents from its source.
+     */
+    bool canAccumulateBSON() const;
+
+    /**
+     * Adds 'input' to the group it belongs to. Must only be called if canAccumulateBSON(), and
+     * before finishAccumulatingBSON().
+     */
+    void accumulateBSON(const BSONObj& input);
+
+    /**
+     * Signals that all of the input has been passed to accumulateBSON(). Subsequent calls to
+     * getNext() return the groups without reading from the source stage.
+     */
+    void finishAccumulatingBSON();
+
+    /**
+     * Returns the path of the field the input is grouped by if every group can be computed from
+     * its first input document alone, which is the case when the group key is a single field path
+     * and every accumulator is $first. Returns boost::none otherwise.
+     */
+    boost::optional<std::string> getFirstDocumentGroupField() const;
+
     // Virtuals for SplittableDocumentSource.
     boost::intrusive_ptr<DocumentSource> getShardSource() final;
     std::list<boost::intrusive_ptr<DocumentSource>> getMergeSources() final;
@@ -145,10 +190,36 @@ private:
 
     Document makeDocument(const Value& id, const Accumulators& accums, bool mergeableOutput);
 
+    /**
+     * Adds 'root' to the group it belongs to in '_groups', spilling to disk first if necessary.
+     */
+    void accumulate(const Document& root);
+
+    /**
+     * Queues the input with group key 'id' for its group, where 'evaluateArgument(i)' returns the
+     * argument for the i-th accumulator. Only a run of consecutive inputs of the same group is
+     * queued: the queue is processed by processPendingInputs() when an input of another group
+     * arrives, or once enough inputs have been collected.
+     */
+    template <typename EvaluateArgument>
+    void accumulateWithId(Value id, const EvaluateArgument& evaluateArgument);
+
+    /**
+     * Adds the queued inputs to their group in '_groups', passing each accumulator all of the
+     * arguments queued for it in a single processBatch() call. Spills to disk first if necessary.
+     */
+    void processPendingInputs();
+
+    /**
+     * Prepares to return the accumulated groups, once all of the input has been accumulated.
+     */
+    void finishAccumulating();
+
     /**
      * Computes the internal representation of the group key.
      */
     Value computeId(const Document& root);
+    Value computeIdFromBSON(const BSONObj& root);
 
     /**
      * Converts the internal representation of the group key to the _id shape specified by the
@@ -158,6 +229,9 @@ private:
 
     std::vector<AccumulationStatement> _accumulatedFields;
 
+    // If set, each input document is unwound by this stage before being accumulated.
+    boost::intrusive_ptr<DocumentSourceUnwind> _unwindSrc;
+
     bool _doingMerge;
     size_t _memoryUsageBytes = 0;
     size_t _maxMemoryUsageBytes;
@@ -176,6 +250,15 @@ private:
     // definition of equality.
     boost::optional<GroupsMap> _groups;
 
+    // The arguments for each accumulator which have not been processed yet, in input order, all
+    // of them from inputs of the group '_pendingId'. Consecutive inputs of the same group, as
+    // produced by an index scan or a sort on the group key, are queued so that they are processed
+    // as a batch while hashing the group key once.
+    Value _pendingId;
+    std::vector<std::vector<Value>> _pendingInputs;
+    size_t _numPendingInputs = 0;
+    size_t _pendingInputsBytes = 0;
+
     std::vector<std::shared_ptr<Sorter<Value, Value>::Iterator>> _sortedFiles;
     bool _spilled;
 
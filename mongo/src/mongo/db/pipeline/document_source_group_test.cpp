@@ -43,6 +43,7 @@
 #include "mongo/db/pipeline/dependencies.h"
 #include "mongo/db/pipeline/document_source_group.h"
 #include "mongo/db/pipeline/document_source_mock.h"
+#include "mongo/db/pipeline/document_source_unwind.h"
 #include "mongo/db/pipeline/document_value_test_util.h"
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context_for_test.h"
@@ -189,6 +190,189 @@ TEST_F(DocumentSourceGroupTest, ShouldCorrectlyTrackMemoryUsageBetweenPauses) {
     ASSERT_THROWS_CODE(group->getNext(), AssertionException, 16945);
 }
 
+TEST_F(DocumentSourceGroupTest, ShouldUnwindInputWhenAbsorbingUnwind) {
+    auto expCtx = getExpCtx();
+    VariablesParseState vps = expCtx->variablesParseState;
+    AccumulationStatement totalStatement{"total",
+                                         ExpressionFieldPath::parse(expCtx, "$items.v", vps),
+                                         AccumulationStatement::getFactory("$sum")};
+    AccumulationStatement indexesStatement{"indexes",
+                                           ExpressionFieldPath::parse(expCtx, "$idx", vps),
+                                           AccumulationStatement::getFactory("$push")};
+    auto group = DocumentSourceGroup::create(expCtx,
+                                             ExpressionFieldPath::parse(expCtx, "$items.k", vps),
+                                             {totalStatement, indexesStatement});
+    auto unwind = DocumentSourceUnwind::create(expCtx, "items", true, std::string("idx"));
+    ASSERT_TRUE(group->absorbUnwind(unwind));
+    ASSERT_FALSE(group->absorbUnwind(unwind));
+
+    auto mock = DocumentSourceMock::create(
+        {Document{{"_id", 0},
+                  {"items",
+                   vector<Value>{Value(Document{{"k", "a"_sd}, {"v", 1}}),
+                                 Value(Document{{"k", "b"_sd}, {"v", 2}}),
+                                 Value(Document{{"k", "a"_sd}, {"v", 3}})}}},
+         Document{{"_id", 1}, {"items", vector<Value>{}}},
+         Document{{"_id", 2}, {"items", Document{{"k", "b"_sd}, {"v", 10}}}}});
+    group->setSource(mock.get());
+
+    // Each group should see the documents the $unwind would have produced, including those it
+    // preserves because of an empty array or a non-array value.
+    map<string, Document> results;
+    for (auto next = group->getNext(); next.isAdvanced(); next = group->getNext()) {
+        auto result = next.releaseDocument();
+        results[result["_id"].toString()] = result;
+    }
+    ASSERT_EQ(results.size(), 3UL);
+    ASSERT_DOCUMENT_EQ(
+        results[Value("a"_sd).toString()],
+        (Document{{"_id", "a"_sd}, {"total", 4}, {"indexes", vector<Value>{Value(0), Value(2)}}}));
+    ASSERT_DOCUMENT_EQ(results[Value("b"_sd).toString()],
+                       (Document{{"_id", "b"_sd},
+                                 {"total", 12},
+                                 {"indexes", vector<Value>{Value(1), Value(BSONNULL)}}}));
+    ASSERT_DOCUMENT_EQ(
+        results[Value(BSONNULL).toString()],
+        (Document{{"_id", BSONNULL}, {"total", 0}, {"indexes", vector<Value>{Value(BSONNULL)}}}));
+
+    // Outside of explain, the absorbed $unwind is serialized as a separate stage.
+    vector<Value> serialized;
+    group->serializeToArray(serialized);
+    ASSERT_EQ(serialized.size(), 2UL);
+    ASSERT_VALUE_EQ(serialized[0], unwind->serialize());
+}
+
+TEST_F(DocumentSourceGroupTest, ShouldAccumulateBSONInputLikeDocumentInput) {
+    auto expCtx = getExpCtx();
+    auto spec = fromjson(
+        "{$group: {_id: {k: '$a.k', c: 'x'}, total: {$sum: '$v'}, count: {$sum: 1},"
+        " values: {$push: '$a.v'}, first: {$first: '$missing.field'}}}");
+    const vector<BSONObj> inputs{fromjson("{a: {k: 1, v: 'one'}, v: 1}"),
+                                 fromjson("{a: {k: 2}, v: 2.5}"),
+                                 fromjson("{a: {k: 1, v: {nested: true}}, v: 3}"),
+                                 fromjson("{a: [{k: 1}, {k: 2}], v: 4}"),
+                                 fromjson("{a: 'notAnObject', v: 5}"),
+                                 fromjson("{v: 6}")};
+
+    auto documentGroup = DocumentSourceGroup::createFromBson(spec.firstElement(), expCtx);
+    deque<DocumentSource::GetNextResult> mockInputs;
+    for (auto&& input : inputs) {
+        mockInputs.emplace_back(Document(input));
+    }
+    auto mock = DocumentSourceMock::create(mockInputs);
+    documentGroup->setSource(mock.get());
+
+    auto bsonGroupSource = DocumentSourceGroup::createFromBson(spec.firstElement(), expCtx);
+    auto bsonGroup = static_cast<DocumentSourceGroup*>(bsonGroupSource.get());
+    ASSERT_TRUE(bsonGroup->canAccumulateBSON());
+    for (auto&& input : inputs) {
+        bsonGroup->accumulateBSON(input);
+    }
+    bsonGroup->finishAccumulatingBSON();
+
+    auto collect = [](DocumentSource* group) {
+        map<string, Document> results;
+        for (auto next = group->getNext(); next.isAdvanced(); next = group->getNext()) {
+            auto result = next.releaseDocument();
+            results[result["_id"].toString()] = result;
+        }
+        return results;
+    };
+    auto expected = collect(documentGroup.get());
+    auto actual = collect(bsonGroup);
+    ASSERT_EQ(expected.size(), 4UL);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (auto&& result : expected) {
+        ASSERT_DOCUMENT_EQ(actual[result.first], result.second);
+    }
+}
+
+TEST_F(DocumentSourceGroupTest, ShouldProcessEachGroupInInputOrderAcrossBatches) {
+    auto expCtx = getExpCtx();
+    expCtx->inMongos = true;  // Disallow external sort.
+                              // This is the only way to do this in a debug build.
+    auto spec = fromjson(
+        "{$group: {_id: '$k', sum: {$sum: '$v'}, avg: {$avg: '$v'}, min: {$min: '$v'},"
+        " max: {$max: '$v'}, values: {$push: '$v'}}}");
+    auto group = DocumentSourceGroup::createFromBson(spec.firstElement(), expCtx);
+
+    // Enough documents for several batches, with the groups interleaved in the first half and in
+    // runs longer than a batch in the second, a mix of numeric types within each group, and a
+    // pause part way through a batch.
+    const int kNumGroups = 3;
+    const int kNumDocs = 1000;
+    deque<DocumentSource::GetNextResult> inputs;
+    vector<vector<Value>> expectedValues(kNumGroups);
+    for (int i = 0; i < kNumDocs; ++i) {
+        const Value v = i % 7 == 0
+            ? Value(i * 0.5)
+            : i % 5 == 0 ? Value(i * 1000000000LL) : Value(i);
+        const int k = i < kNumDocs / 2 ? i % kNumGroups : (i / 300) % kNumGroups;
+        inputs.emplace_back(Document{{"k", k}, {"v", v}});
+        expectedValues[k].push_back(v);
+        if (i == 300) {
+            inputs.emplace_back(DocumentSource::GetNextResult::makePauseExecution());
+        }
+    }
+    auto mock = DocumentSourceMock::create(inputs);
+    group->setSource(mock.get());
+    ASSERT_TRUE(group->getNext().isPaused());
+
+    map<int, Document> results;
+    for (auto next = group->getNext(); next.isAdvanced(); next = group->getNext()) {
+        auto result = next.releaseDocument();
+        results[result["_id"].getInt()] = result;
+    }
+    ASSERT_EQ(results.size(), static_cast<size_t>(kNumGroups));
+
+    // Each accumulator must see the values of its group in input order, one at a time.
+    for (int k = 0; k < kNumGroups; ++k) {
+        MutableDocument expected;
+        expected.addField("_id", Value(k));
+        for (auto&& name : {"sum", "avg", "min", "max"}) {
+            auto accumulator = AccumulationStatement::getFactory("$" + string(name))(expCtx);
+            for (auto&& v : expectedValues[k]) {
+                accumulator->process(v, false);
+            }
+            expected.addField(name, accumulator->getValue(false));
+        }
+        expected.addField("values", Value(expectedValues[k]));
+        ASSERT_DOCUMENT_EQ(results[k], expected.freeze());
+    }
+}
+
+TEST_F(DocumentSourceGroupTest, ShouldOnlyAccumulateBSONForConstantsAndFieldPaths) {
+    auto expCtx = getExpCtx();
+    auto canAccumulateBSON = [&](const char* spec) {
+        auto group = DocumentSourceGroup::createFromBson(fromjson(spec).firstElement(), expCtx);
+        return static_cast<DocumentSourceGroup*>(group.get())->canAccumulateBSON();
+    };
+    ASSERT_TRUE(canAccumulateBSON("{$group: {_id: null, count: {$sum: 1}}}"));
+    ASSERT_TRUE(canAccumulateBSON("{$group: {_id: {a: '$a', b: '$b.c'}, m: {$max: '$d'}}}"));
+    ASSERT_FALSE(canAccumulateBSON("{$group: {_id: '$$ROOT'}}"));
+    ASSERT_FALSE(canAccumulateBSON("{$group: {_id: {$add: ['$a', 1]}}}"));
+    ASSERT_FALSE(canAccumulateBSON("{$group: {_id: null, s: {$sum: {$multiply: ['$a', 2]}}}}"));
+}
+
+TEST_F(DocumentSourceGroupTest, ShouldOnlyReportFirstDocumentGroupFieldForFieldPathAndFirst) {
+    auto expCtx = getExpCtx();
+    auto getFirstDocumentGroupField = [&](const char* spec) {
+        auto group = DocumentSourceGroup::createFromBson(fromjson(spec).firstElement(), expCtx);
+        return static_cast<DocumentSourceGroup*>(group.get())->getFirstDocumentGroupField();
+    };
+    ASSERT_EQ("a", *getFirstDocumentGroupField("{$group: {_id: '$a', x: {$first: '$x'}}}"));
+    ASSERT_EQ("a.b", *getFirstDocumentGroupField("{$group: {_id: '$a.b'}}"));
+    ASSERT_EQ("a",
+              *getFirstDocumentGroupField(
+                  "{$group: {_id: '$a', x: {$first: '$x'}, y: {$first: {$add: ['$y', 1]}}}}"));
+    ASSERT_FALSE(getFirstDocumentGroupField("{$group: {_id: '$a', x: {$last: '$x'}}}"));
+    ASSERT_FALSE(
+        getFirstDocumentGroupField("{$group: {_id: '$a', x: {$first: '$x'}, n: {$sum: 1}}}"));
+    ASSERT_FALSE(getFirstDocumentGroupField("{$group: {_id: {a: '$a'}, x: {$first: '$x'}}}"));
+    ASSERT_FALSE(getFirstDocumentGroupField("{$group: {_id: '$$ROOT', x: {$first: '$x'}}}"));
+    ASSERT_FALSE(getFirstDocumentGroupField("{$group: {_id: null, x: {$first: '$x'}}}"));
+}
+
 BSONObj toBson(const intrusive_ptr<DocumentSource>& source) {
     vector<Value> arr;
     source->serializeToArray(arr);
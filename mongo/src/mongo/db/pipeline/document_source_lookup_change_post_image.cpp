@@ -30,7 +30,11 @@
 
 #include "mongo/db/pipeline/document_source_lookup_change_post_image.h"
 
+#include <algorithm>
+
 #include "mongo/bson/simple_bsonelement_comparator.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/util/scopeguard.h"
 
 namespace mongo {
 
@@ -58,22 +62,145 @@ Value assertFieldHasType(const Document& fullDoc, StringData fieldName, BSONType
 DocumentSource::GetNextResult DocumentSourceLookupChangePostImage::getNext() {
     pExpCtx->checkForInterrupt();
 
+    if (_pending.empty()) {
+        loadBatch();
+    }
+    auto next = std::move(_pending.front());
+    _pending.pop_front();
+    return next;
+}
+
+bool DocumentSourceLookupChangePostImage::isUpdate(const Document& input) {
+    auto opTypeVal = assertFieldHasType(
+        input, DocumentSourceChangeStream::kOperationTypeField, BSONType::String);
+    return opTypeVal.getString() == DocumentSourceChangeStream::kUpdateOpType;
+}
+
+bool DocumentSourceLookupChangePostImage::isInvalidate(const Document& input) {
+    auto opTypeVal = assertFieldHasType(
+        input, DocumentSourceChangeStream::kOperationTypeField, BSONType::String);
+    return opTypeVal.getString() == DocumentSourceChangeStream::kInvalidateOpType;
+}
+
+void DocumentSourceLookupChangePostImage::loadBatch() {
     auto input = pSource->getNext();
     if (!input.isAdvanced()) {
-        return input;
+        _pending.push_back(std::move(input));
+        return;
     }
-    auto opTypeVal = assertFieldHasType(
-        input.getDocument(), DocumentSourceChangeStream::kOperationTypeField, BSONType::String);
-    if (opTypeVal.getString() != DocumentSourceChangeStream::kUpdateOpType) {
-        return input;
+
+    if (pExpCtx->inMongos) {
+        // Each lookup from mongos carries a read concern specific to the event it is for, so
+        // lookups cannot be combined.
+        if (!isUpdate(input.getDocument())) {
+            _pending.push_back(std::move(input));
+            return;
+        }
+
+        // Temporarily remove any deadline from this operation to avoid timeout during lookup.
+        OperationContext::DeadlineStash deadlineStash(pExpCtx->opCtx);
+
+        MutableDocument output(input.releaseDocument());
+        output[kFullDocumentFieldName] = lookupPostImage(output.peek());
+        _pending.push_back(output.freeze());
+        return;
+    }
+
+    std::vector<Document> batch;
+    batch.push_back(input.releaseDocument());
+
+    // Gather up any further events which are already available. We must not wait for new events
+    // here, since that would delay returning those we already have. Stop after an invalidation,
+    // since the next request for input after it closes the cursor.
+    boost::optional<GetNextResult> trailingResult;
+    {
+        const bool wasWaitingForInserts = _mongoProcessInterface->setShouldWaitForInserts(false);
+        ON_BLOCK_EXIT(
+            [&] { _mongoProcessInterface->setShouldWaitForInserts(wasWaitingForInserts); });
+
+        const size_t maxBatchSize =
+            std::max(1, internalChangeStreamPostImageLookupBatchSize.load());
+        while (batch.size() < maxBatchSize && !isInvalidate(batch.back())) {
+            auto next = pSource->getNext();
+            if (!next.isAdvanced()) {
+                trailingResult = std::move(next);
+                break;
+            }
+            batch.push_back(next.releaseDocument());
+        }
+    }
+
+    lookupPostImages(&batch);
+
+    for (auto&& output : batch) {
+        _pending.push_back(std::move(output));
+    }
+    if (trailingResult) {
+        _pending.push_back(std::move(*trailingResult));
+    }
+}
+
+void DocumentSourceLookupChangePostImage::lookupPostImages(
+    std::vector<Document>* batch) const {
+    // Validate every update event and extract what we need to look up its post-image.
+    struct Lookup {
+        size_t index;
+        UUID uuid;
+        Document documentKey;
+    };
+    std::vector<Lookup> lookups;
+    Timestamp latestClusterTime;
+    boost::optional<NamespaceString> nss;
+    for (size_t i = 0; i < batch->size(); ++i) {
+        const auto& updateOp = (*batch)[i];
+        if (!isUpdate(updateOp)) {
+            continue;
+        }
+        nss = assertNamespaceMatches(updateOp);
+        auto documentKey = assertFieldHasType(updateOp,
+                                              DocumentSourceChangeStream::kDocumentKeyField,
+                                              BSONType::Object)
+                               .getDocument();
+        auto resumeToken =
+            ResumeToken::parse(updateOp[DocumentSourceChangeStream::kIdField].getDocument());
+        invariant(resumeToken.getData().uuid);
+        latestClusterTime = std::max(latestClusterTime, resumeToken.getData().clusterTime);
+        lookups.push_back({i, *resumeToken.getData().uuid, std::move(documentKey)});
+    }
+
+    if (lookups.empty()) {
+        return;
     }
 
     // Temporarily remove any deadline from this operation to avoid timeout during lookup.
     OperationContext::DeadlineStash deadlineStash(pExpCtx->opCtx);
 
-    MutableDocument output(input.releaseDocument());
-    output[kFullDocumentFieldName] = lookupPostImage(output.peek());
-    return output.freeze();
+    // Look up each run of events on the same collection together. Every lookup happens after all
+    // of the events in the batch, so the post-images reflect at least 'latestClusterTime'.
+    for (auto runStart = lookups.begin(); runStart != lookups.end();) {
+        auto runEnd = std::find_if(runStart, lookups.end(), [&](const Lookup& lookup) {
+            return lookup.uuid != runStart->uuid;
+        });
+
+        std::vector<Document> documentKeys;
+        for (auto it = runStart; it != runEnd; ++it) {
+            documentKeys.push_back(it->documentKey);
+        }
+        auto postImages = _mongoProcessInterface->lookupDocumentsByKey(
+            *nss, runStart->uuid, documentKeys, latestClusterTime);
+        invariant(postImages.size() == documentKeys.size());
+
+        // Even if the lookup itself succeeded, it may not have found a document if it was deleted
+        // in the time since the update op.
+        for (size_t i = 0; i < postImages.size(); ++i) {
+            auto& updateOp = (*batch)[runStart[i].index];
+            MutableDocument output(std::move(updateOp));
+            output[kFullDocumentFieldName] =
+                postImages[i] ? Value(*postImages[i]) : Value(BSONNULL);
+            updateOp = output.freeze();
+        }
+        runStart = runEnd;
+    }
 }
 
 NamespaceString DocumentSourceLookupChangePostImage::assertNamespaceMatches(
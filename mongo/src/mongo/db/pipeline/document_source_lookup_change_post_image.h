@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <deque>
+
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/document_source_change_stream.h"
 
@@ -37,6 +39,10 @@ namespace mongo {
  * Part of the change stream API machinery used to look up the post-image of a document. Uses
  * the "documentKey" field of the input to look up the new version of the document.
  *
+ * On mongod, the stage reads ahead through whatever change events are already available (without
+ * waiting for new ones) and looks up the post-images for all update events in that batch
+ * together, rather than issuing one query per event.
+ *
  * Uses the ExpressionContext to determine what collection to look up into.
  * TODO SERVER-29134 When we allow change streams on multiple collections, this will need to change.
  */
@@ -89,7 +95,8 @@ public:
     }
 
     /**
-     * Performs the lookup to retrieve the full document.
+     * Performs the lookup to retrieve the full document. Results are returned in the order they
+     * were produced by the previous stage.
      */
     GetNextResult getNext() final;
 
@@ -108,17 +115,43 @@ private:
     DocumentSourceLookupChangePostImage(const boost::intrusive_ptr<ExpressionContext>& expCtx)
         : DocumentSourceNeedsMongoProcessInterface(expCtx) {}
 
+    /**
+     * Pulls the next result from the previous stage, together with any results that can be
+     * produced without blocking, and appends them to '_pending' with their post-images filled in.
+     */
+    void loadBatch();
+
+    /**
+     * Looks up the post-images of every update event in 'batch' and stores them in the
+     * "fullDocument" field of each event.
+     */
+    void lookupPostImages(std::vector<Document>* batch) const;
+
     /**
      * Uses the "documentKey" field from 'updateOp' to look up the current version of the document.
      * Returns Value(BSONNULL) if the document couldn't be found.
      */
     Value lookupPostImage(const Document& updateOp) const;
 
+    /**
+     * Returns true if 'input' is an update event, and therefore needs its post-image looked up.
+     */
+    static bool isUpdate(const Document& input);
+
+    /**
+     * Returns true if 'input' is an invalidate event, after which the stream will be closed.
+     */
+    static bool isInvalidate(const Document& input);
+
     /**
      * Throws a AssertionException if the namespace found in 'inputDoc' doesn't match the one on the
      * ExpressionContext.
      */
     NamespaceString assertNamespaceMatches(const Document& inputDoc) const;
+
+    // Results which have already been pulled from the previous stage and had their post-images
+    // looked up, but have not yet been returned.
+    std::deque<GetNextResult> _pending;
 };
 
 }  // namespace mongo
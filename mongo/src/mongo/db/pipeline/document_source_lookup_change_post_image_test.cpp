@@ -138,6 +138,22 @@ public:
         return lookedUpDocument;
     }
 
+    std::vector<boost::optional<Document>> lookupDocumentsByKey(
+        const NamespaceString& nss,
+        UUID collectionUUID,
+        const std::vector<Document>& documentKeys,
+        Timestamp clusterTime) final {
+        ++numBatchedLookups;
+        return MongoProcessInterface::lookupDocumentsByKey(
+            nss, collectionUUID, documentKeys, clusterTime);
+    }
+
+    bool setShouldWaitForInserts(bool shouldWait) final {
+        return false;
+    }
+
+    int numBatchedLookups = 0;
+
 private:
     deque<DocumentSource::GetNextResult> _mockResults;
 };
@@ -333,5 +349,45 @@ TEST_F(DocumentSourceLookupChangePostImageTest, ShouldPropagatePauses) {
     ASSERT_TRUE(lookupChangeStage->getNext().isEOF());
 }
 
+TEST_F(DocumentSourceLookupChangePostImageTest, ShouldLookUpAvailableUpdatesTogether) {
+    auto expCtx = getExpCtx();
+
+    // Set up the $lookup stage.
+    auto lookupChangeStage = DocumentSourceLookupChangePostImage::create(expCtx);
+
+    // Mock its input with several updates, one of which is to a document that no longer exists.
+    auto makeUpdate = [&](int id) {
+        return Document{{"_id", makeResumeToken(id)},
+                        {"documentKey", Document{{"_id", id}}},
+                        {"operationType", "update"_sd},
+                        {"ns", Document{{"db", expCtx->ns.db()}, {"coll", expCtx->ns.coll()}}}};
+    };
+    auto mockLocalSource = DocumentSourceMock::create({makeUpdate(0),
+                                                       makeUpdate(1),
+                                                       makeUpdate(2),
+                                                       DocumentSource::GetNextResult::makeEOF()});
+
+    lookupChangeStage->setSource(mockLocalSource.get());
+
+    // Mock out the foreign collection.
+    deque<DocumentSource::GetNextResult> mockForeignContents{Document{{"_id", 0}},
+                                                             Document{{"_id", 2}}};
+    auto mongoProcessInterface =
+        std::make_shared<MockMongoProcessInterface>(std::move(mockForeignContents));
+    lookupChangeStage->injectMongoProcessInterface(mongoProcessInterface);
+
+    const vector<Value> expectedFullDocuments{
+        Value(Document{{"_id", 0}}), Value(BSONNULL), Value(Document{{"_id", 2}})};
+    for (int id = 0; id < 3; ++id) {
+        auto next = lookupChangeStage->getNext();
+        ASSERT_TRUE(next.isAdvanced());
+        ASSERT_VALUE_EQ(next.releaseDocument()["fullDocument"], expectedFullDocuments[id]);
+    }
+    ASSERT_TRUE(lookupChangeStage->getNext().isEOF());
+
+    // All of the updates were available at once, so they should have been looked up together.
+    ASSERT_EQ(mongoProcessInterface->numBatchedLookups, 1);
+}
+
 }  // namespace
 }  // namespace mongo
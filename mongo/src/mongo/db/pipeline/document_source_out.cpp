@@ -31,6 +31,7 @@
 #include "mongo/db/pipeline/document_source_out.h"
 
 #include "mongo/db/ops/write_ops.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/util/destructor_guard.h"
 
@@ -123,11 +124,20 @@ void DocumentSourceOut::initialize() {
     }
 
     // copy indexes to _tempNs
+    const bool deferIndexBuilds = internalDocumentSourceOutDeferIndexBuilds.load();
     for (std::list<BSONObj>::const_iterator it = _originalIndexes.begin();
          it != _originalIndexes.end();
          ++it) {
         MutableDocument index((Document(*it)));
         index.remove("_id");  // indexes shouldn't have _ids but some existing ones do
+
+        // The _id index is needed to replicate the inserts, but the others can wait until the
+        // temporary collection has been loaded.
+        if (deferIndexBuilds && (*it)["name"].str() != "_id_") {
+            index.remove("ns");
+            _deferredIndexes.push_back(index.freeze().toBson());
+            continue;
+        }
         index["ns"] = Value(_tempNs.ns());
 
         BSONObj indexBson = index.freeze().toBson();
@@ -144,11 +154,35 @@ void DocumentSourceOut::initialize() {
     _initialized = true;
 }
 
-void DocumentSourceOut::spill(const vector<BSONObj>& toInsert) {
-    BSONObj err = _mongoProcessInterface->insert(_tempNs, toInsert);
-    uassert(16996,
-            str::stream() << "insert for $out failed: " << err,
-            DBClientBase::getLastErrorString(err).empty());
+void DocumentSourceOut::spill(const vector<vector<BSONObj>>& batches) {
+    Status status = _mongoProcessInterface->insertBatches(_tempNs, batches);
+    uassert(16996, str::stream() << "insert for $out failed: " << status.reason(), status.isOK());
+}
+
+void DocumentSourceOut::buildDeferredIndexes() {
+    if (_deferredIndexes.empty()) {
+        return;
+    }
+
+    BSONObjBuilder cmd;
+    cmd << "createIndexes" << _tempNs.coll();
+    BSONArrayBuilder indexes(cmd.subarrayStart("indexes"));
+    for (auto&& index : _deferredIndexes) {
+        indexes.append(index);
+    }
+    indexes.doneFast();
+
+    BSONObj cmdObj = cmd.done();
+    BSONObj info;
+    bool ok =
+        _mongoProcessInterface->directClient()->runCommand(_tempNs.db().toString(), cmdObj, info);
+    uassert(40691,
+            str::stream() << "building indexes for $out failed."
+                          << " indexes: "
+                          << cmdObj["indexes"]
+                          << " error: "
+                          << info,
+            ok);
 }
 
 DocumentSource::GetNextResult DocumentSourceOut::getNext() {
@@ -162,7 +196,11 @@ DocumentSource::GetNextResult DocumentSourceOut::getNext() {
         initialize();
     }
 
-    // Insert all documents into temp collection, batching to perform vectored inserts.
+    // Insert all documents into temp collection, batching to perform vectored inserts. Full
+    // batches are handed to the writers together, so that they insert concurrently.
+    const size_t numWriters =
+        std::max(1, std::min(16, internalDocumentSourceOutWriterThreads.load()));
+    vector<vector<BSONObj>> fullBatches;
     vector<BSONObj> bufferedObjects;
     int bufferedBytes = 0;
 
@@ -173,14 +211,20 @@ DocumentSource::GetNextResult DocumentSourceOut::getNext() {
         bufferedBytes += toInsert.objsize();
         if (!bufferedObjects.empty() && (bufferedBytes > BSONObjMaxUserSize ||
                                          bufferedObjects.size() >= write_ops::kMaxWriteBatchSize)) {
-            spill(bufferedObjects);
+            fullBatches.push_back(std::move(bufferedObjects));
             bufferedObjects.clear();
             bufferedBytes = toInsert.objsize();
+            if (fullBatches.size() >= numWriters) {
+                spill(fullBatches);
+                fullBatches.clear();
+            }
         }
         bufferedObjects.push_back(toInsert);
     }
     if (!bufferedObjects.empty())
-        spill(bufferedObjects);
+        fullBatches.push_back(std::move(bufferedObjects));
+    if (!fullBatches.empty())
+        spill(fullBatches);
 
     switch (nextInput.getStatus()) {
         case GetNextResult::ReturnStatus::kAdvanced: {
@@ -190,6 +234,7 @@ DocumentSource::GetNextResult DocumentSourceOut::getNext() {
             return nextInput;  // Propagate the pause.
         }
         case GetNextResult::ReturnStatus::kEOF: {
+            buildDeferredIndexes();
 
             auto renameCommandObj =
                 BSON("renameCollection" << _tempNs.ns() << "to" << _outputNs.ns() << "dropTarget"
@@ -86,16 +86,23 @@ private:
      * Sets '_tempNs' to a unique temporary namespace, makes sure the output collection isn't
      * sharded or capped, and saves the collection options and indexes of the target collection.
      * Then creates the temporary collection we will insert into by copying the collection options
-     * and indexes from the target collection.
+     * and indexes from the target collection. Unless internalDocumentSourceOutDeferIndexBuilds is
+     * off, only the _id index is created now and the others are saved in '_deferredIndexes'.
      *
      * Sets '_initialized' to true upon completion.
      */
     void initialize();
 
     /**
-     * Inserts all of 'toInsert' into the temporary collection.
+     * Inserts all of 'batches' into the temporary collection, each batch on its own writer.
      */
-    void spill(const std::vector<BSONObj>& toInsert);
+    void spill(const std::vector<std::vector<BSONObj>>& batches);
+
+    /**
+     * Builds all of '_deferredIndexes' on the temporary collection at once, so that each index is
+     * built by sorting its keys in bulk rather than by maintaining it on every insert.
+     */
+    void buildDeferredIndexes();
 
     bool _initialized = false;
     bool _done = false;
@@ -105,6 +112,9 @@ private:
     BSONObj _originalOutOptions;
     std::list<BSONObj> _originalIndexes;
 
+    // The secondary indexes to build on the temporary collection once it is loaded.
+    std::vector<BSONObj> _deferredIndexes;
+
     NamespaceString _tempNs;          // output goes here as it is being processed.
     const NamespaceString _outputNs;  // output will go here after all data is processed.
 };
@@ -0,0 +1,420 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/document_source_shared_oplog_cursor.h"
+
+#include <limits>
+
+#include "mongo/base/counter.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/commands/server_status_metric.h"
+#include "mongo/db/curop.h"
+#include "mongo/db/db_raii.h"
+#include "mongo/db/matcher/expression_leaf.h"
+#include "mongo/db/matcher/expression_parser.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/query/plan_executor.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/db/repl/optime.h"
+#include "mongo/db/repl/replication_coordinator.h"
+#include "mongo/db/storage/oplog_hack.h"
+#include "mongo/db/storage/record_store.h"
+#include "mongo/util/scopeguard.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+
+namespace {
+
+Counter64 sharedEntriesRead;
+Counter64 privateEntriesRead;
+Counter64 subscriptionsDetached;
+Counter64 filterEvaluations;
+
+ServerStatusMetricField<Counter64> displaySharedEntriesRead(
+    "changeStreams.sharedOplogReader.entriesRead", &sharedEntriesRead);
+ServerStatusMetricField<Counter64> displayPrivateEntriesRead(
+    "changeStreams.sharedOplogReader.privateEntriesRead", &privateEntriesRead);
+ServerStatusMetricField<Counter64> displaySubscriptionsDetached(
+    "changeStreams.sharedOplogReader.subscriptionsDetached", &subscriptionsDetached);
+ServerStatusMetricField<Counter64> displayFilterEvaluations(
+    "changeStreams.sharedOplogReader.filterEvaluations", &filterEvaluations);
+
+SharedOplogReader::Limits currentLimits() {
+    return {static_cast<size_t>(internalChangeStreamSharedOplogBufferBytes.load()),
+            static_cast<size_t>(internalChangeStreamSubscriptionBufferBytes.load())};
+}
+
+/**
+ * Returns the timestamp immediately preceding 'ts', so that "ts >= x" can be expressed as
+ * "ts > predecessor(x)".
+ */
+Timestamp predecessor(Timestamp ts) {
+    if (ts.getInc() > 0) {
+        return Timestamp(ts.getSecs(), ts.getInc() - 1);
+    }
+    if (ts.getSecs() > 0) {
+        return Timestamp(ts.getSecs() - 1, std::numeric_limits<unsigned>::max());
+    }
+    return Timestamp();
+}
+
+/**
+ * Finds the lower bound of a top-level $gt or $gte predicate on "ts" in a change stream's oplog
+ * filter, expressed as an exclusive bound.
+ */
+boost::optional<Timestamp> extractStartAfter(const MatchExpression* filter) {
+    if (filter->matchType() != MatchExpression::AND) {
+        return boost::none;
+    }
+
+    for (size_t i = 0; i < filter->numChildren(); ++i) {
+        auto child = filter->getChild(i);
+        if (!ComparisonMatchExpression::isComparisonMatchExpression(child) ||
+            child->path() != repl::OpTime::kTimestampFieldName) {
+            continue;
+        }
+
+        auto rawElem = static_cast<const ComparisonMatchExpression*>(child)->getData();
+        if (rawElem.type() != BSONType::bsonTimestamp) {
+            continue;
+        }
+
+        if (child->matchType() == MatchExpression::GT) {
+            return rawElem.timestamp();
+        }
+        if (child->matchType() == MatchExpression::GTE) {
+            return predecessor(rawElem.timestamp());
+        }
+    }
+    return boost::none;
+}
+
+/**
+ * Returns 'filter' without the top-level $gt or $gte predicate on "ts" of a change stream's oplog
+ * filter, or boost::none if it has no such predicate. Change streams on the same namespace with
+ * the same options differ only in that predicate, which the subscription enforces through its
+ * position instead.
+ */
+boost::optional<BSONObj> withoutStartAfter(const BSONObj& filter) {
+    BSONElement andElem = filter.firstElement();
+    if (filter.nFields() != 1 || andElem.fieldNameStringData() != "$and" ||
+        andElem.type() != BSONType::Array) {
+        return boost::none;
+    }
+
+    BSONArrayBuilder others;
+    bool removed = false;
+    for (auto&& child : andElem.Obj()) {
+        if (!removed && child.type() == BSONType::Object && child.Obj().nFields() == 1) {
+            BSONElement tsElem = child.Obj().firstElement();
+            if (tsElem.fieldNameStringData() == repl::OpTime::kTimestampFieldName &&
+                tsElem.type() == BSONType::Object && tsElem.Obj().nFields() == 1) {
+                BSONElement bound = tsElem.Obj().firstElement();
+                if ((bound.fieldNameStringData() == "$gt" ||
+                     bound.fieldNameStringData() == "$gte") &&
+                    bound.type() == BSONType::bsonTimestamp) {
+                    removed = true;
+                    continue;
+                }
+            }
+        }
+        others.append(child);
+    }
+    if (!removed) {
+        return boost::none;
+    }
+    return BSON("$and" << others.arr());
+}
+
+/**
+ * Reads oplog entries newer than 'after', up to roughly 'maxBytes'. If 'requireExact' is true, the
+ * entry at 'after' must still exist, and if 'lastRead' is not empty it must be that same entry;
+ * otherwise the position has been lost to capped deletion or rollback.
+ */
+StatusWith<std::vector<BSONObj>> readOplogAfter(OperationContext* opCtx,
+                                                Collection* oplog,
+                                                Timestamp after,
+                                                const BSONObj& lastRead,
+                                                bool requireExact,
+                                                size_t maxBytes) {
+    const Status positionLost(ErrorCodes::CappedPositionLost,
+                              str::stream() << "oplog position " << after.toString()
+                                            << " is no longer available");
+
+    auto key = oploghack::keyForOptime(after);
+    if (!key.isOK()) {
+        return key.getStatus();
+    }
+
+    auto recordStore = oplog->getRecordStore();
+    auto startLoc = recordStore->oplogStartHack(opCtx, key.getValue());
+    invariant(startLoc);
+
+    auto cursor = recordStore->getCursor(opCtx, true);
+    boost::optional<Record> record;
+    if (startLoc->isNull()) {
+        // Nothing at or before 'after' is left, so start from the beginning of the oplog.
+        if (requireExact) {
+            return positionLost;
+        }
+        record = cursor->next();
+    } else {
+        record = cursor->seekExact(*startLoc);
+        if (!record) {
+            return positionLost;
+        }
+
+        BSONObj startEntry = record->data.toBson();
+        if (requireExact && (startEntry["ts"].timestamp() != after ||
+                             (!lastRead.isEmpty() &&
+                              startEntry["h"].numberLong() != lastRead["h"].numberLong()))) {
+            return positionLost;
+        }
+        record = cursor->next();
+    }
+
+    std::vector<BSONObj> entries;
+    size_t bytes = 0;
+    for (; record && bytes < maxBytes; record = cursor->next()) {
+        BSONObj entry = record->data.releaseToBson().getOwned();
+        if (entry["ts"].timestamp() <= after) {
+            continue;
+        }
+        bytes += entry.objsize();
+        entries.push_back(std::move(entry));
+    }
+    return std::move(entries);
+}
+
+}  // namespace
+
+const char* DocumentSourceSharedOplogCursor::getSourceName() const {
+    return "$sharedOplogCursor";
+}
+
+DocumentSource::GetNextResult DocumentSourceSharedOplogCursor::getNext() {
+    pExpCtx->checkForInterrupt();
+
+    if (_currentBatch.empty()) {
+        loadBatch();
+
+        if (_currentBatch.empty()) {
+            _latestOplogTimestamp = _batchScannedThrough;
+            return GetNextResult::makeEOF();
+        }
+    }
+
+    Document out(_currentBatch.front()->obj);
+    _latestOplogTimestamp =
+        _currentBatch.size() == 1 ? _batchScannedThrough : _currentBatch.front()->ts;
+    _currentBatch.pop_front();
+    return std::move(out);
+}
+
+void DocumentSourceSharedOplogCursor::loadBatch() {
+    if (!_subscription) {
+        return;
+    }
+
+    auto opCtx = pExpCtx->opCtx;
+    while (true) {
+        std::shared_ptr<CappedInsertNotifier> notifier;
+        uint64_t notifierVersion;
+        {
+            AutoGetCollectionForRead autoColl(opCtx, NamespaceString::kRsOplogNamespace);
+            uassertStatusOK(repl::ReplicationCoordinator::get(opCtx)->checkCanServeReadsFor(
+                opCtx, NamespaceString::kRsOplogNamespace, true));
+
+            auto oplog = autoColl.getCollection();
+            uassert(ErrorCodes::QueryPlanKilled, "the oplog no longer exists", oplog);
+
+            // Sample the notifier before reading, so that an insert which races with the read
+            // ends the wait below immediately.
+            notifier = oplog->getCappedInsertNotifier();
+            notifierVersion = notifier->getVersion();
+
+            if (!readShared(oplog)) {
+                readPrivately(oplog);
+            }
+        }
+
+        if (!_currentBatch.empty() || !shouldWaitForInserts()) {
+            return;
+        }
+
+        auto curOp = CurOp::get(opCtx);
+        curOp->pauseTimer();
+        ON_BLOCK_EXIT([curOp] { curOp->resumeTimer(); });
+        notifier->wait(notifierVersion, opCtx->getRemainingMaxTimeMicros());
+    }
+}
+
+bool DocumentSourceSharedOplogCursor::readShared(Collection* oplog) {
+    auto opCtx = pExpCtx->opCtx;
+    auto& reader = SharedOplogReader::get(opCtx->getServiceContext());
+    const auto limits = currentLimits();
+
+    if (!_subscription->isAttached() && !reader.attach(opCtx, _subscription.get(), limits)) {
+        return false;
+    }
+
+    auto drain = [this] {
+        for (auto&& entry : _subscription->drain(&_batchScannedThrough)) {
+            _currentBatch.push_back(std::move(entry));
+        }
+    };
+
+    drain();
+    if (_currentBatch.empty()) {
+        const size_t maxBytes = internalDocumentSourceCursorBatchSizeBytes.load();
+        auto fetch = [opCtx, oplog, maxBytes](Timestamp after, const BSONObj& lastRead) {
+            return readOplogAfter(opCtx, oplog, after, lastRead, !lastRead.isEmpty(), maxBytes);
+        };
+
+        // A failed refill detaches every subscription; each then finds out on its own whether
+        // its position is still in the oplog.
+        auto swResult = reader.refill(opCtx, fetch, limits);
+        if (swResult.isOK()) {
+            sharedEntriesRead.increment(swResult.getValue().entriesRead);
+            subscriptionsDetached.increment(swResult.getValue().subscriptionsDetached);
+            filterEvaluations.increment(swResult.getValue().filterEvaluations);
+        }
+        drain();
+    }
+
+    return !_currentBatch.empty() || _subscription->isAttached();
+}
+
+void DocumentSourceSharedOplogCursor::readPrivately(Collection* oplog) {
+    const Timestamp after = _subscription->getScannedThrough();
+    auto oplogEntries =
+        uassertStatusOK(readOplogAfter(pExpCtx->opCtx,
+                                       oplog,
+                                       after,
+                                       BSONObj(),
+                                       after != _startAfter,
+                                       internalDocumentSourceCursorBatchSizeBytes.load()));
+    if (oplogEntries.empty()) {
+        _batchScannedThrough = after;
+        return;
+    }
+
+    privateEntriesRead.increment(oplogEntries.size());
+    _batchScannedThrough = oplogEntries.back()["ts"].timestamp();
+    for (auto&& oplogEntry : oplogEntries) {
+        auto entry = std::make_shared<const SharedOplogReader::Entry>(std::move(oplogEntry));
+        if (_subscription->matches(*entry)) {
+            _currentBatch.push_back(std::move(entry));
+        }
+    }
+    _subscription->advance(_batchScannedThrough);
+}
+
+bool DocumentSourceSharedOplogCursor::shouldWaitForInserts() const {
+    // Mirrors PlanExecutor::shouldWaitForInserts() for the oplog scan this stage replaces.
+    auto opCtx = pExpCtx->opCtx;
+    if (!pExpCtx->isTailableAwaitData() || !mongo::shouldWaitForInserts(opCtx) ||
+        !opCtx->checkForInterruptNoAssert().isOK() ||
+        opCtx->getRemainingMaxTimeMicros() <= Microseconds::zero()) {
+        return false;
+    }
+
+    if (!clientsLastKnownCommittedOpTime(opCtx).isNull()) {
+        auto replCoord = repl::ReplicationCoordinator::get(opCtx);
+        return clientsLastKnownCommittedOpTime(opCtx) == replCoord->getLastCommittedOpTime();
+    }
+    return true;
+}
+
+Value DocumentSourceSharedOplogCursor::serialize(
+    boost::optional<ExplainOptions::Verbosity> explain) const {
+    // Explained change streams use a DocumentSourceCursor, so this stage is never serialized.
+    return Value();
+}
+
+void DocumentSourceSharedOplogCursor::doDispose() {
+    _currentBatch.clear();
+    if (_subscription) {
+        SharedOplogReader::get(pExpCtx->opCtx->getServiceContext()).unsubscribe(_subscription);
+        _subscription.reset();
+    }
+}
+
+DocumentSourceSharedOplogCursor::~DocumentSourceSharedOplogCursor() {
+    invariant(!_subscription);  // '_subscription' should have been released via dispose().
+}
+
+DocumentSourceSharedOplogCursor::DocumentSourceSharedOplogCursor(
+    const BSONObj& filterObj,
+    std::unique_ptr<MatchExpression> filter,
+    Timestamp startAfter,
+    const intrusive_ptr<ExpressionContext>& pExpCtx)
+    : DocumentSource(pExpCtx),
+      _batchScannedThrough(startAfter),
+      _latestOplogTimestamp(startAfter),
+      _startAfter(startAfter),
+      _subscription(SharedOplogReader::get(pExpCtx->opCtx->getServiceContext())
+                        .subscribe(filterObj, std::move(filter), pExpCtx->ns, startAfter)) {}
+
+intrusive_ptr<DocumentSourceSharedOplogCursor> DocumentSourceSharedOplogCursor::create(
+    Collection* oplog, const BSONObj& filter, const intrusive_ptr<ExpressionContext>& pExpCtx) {
+    // Comparisons against the oplog must use the simple collation, regardless of the collation on
+    // the change stream's ExpressionContext.
+    intrusive_ptr<ExpressionContext> simpleExpCtx(new ExpressionContext(pExpCtx->opCtx, nullptr));
+    auto matchExpr = uassertStatusOK(MatchExpressionParser::parse(filter, simpleExpCtx));
+
+    auto startAfter = extractStartAfter(matchExpr.get());
+    if (!startAfter) {
+        return nullptr;
+    }
+
+    // The shared reader positions itself by timestamp, which requires a storage engine that can
+    // seek the oplog directly.
+    auto key = oploghack::keyForOptime(*startAfter);
+    if (!key.isOK() ||
+        !oplog->getRecordStore()->oplogStartHack(pExpCtx->opCtx, key.getValue())) {
+        return nullptr;
+    }
+
+    // Entries at or before 'startAfter' are never delivered to the subscription, so its filter
+    // can leave out the bound and be shared with the change streams opened at other times.
+    BSONObj subscriptionFilter = filter;
+    if (auto withoutBound = withoutStartAfter(filter)) {
+        subscriptionFilter = *withoutBound;
+        matchExpr = uassertStatusOK(MatchExpressionParser::parse(subscriptionFilter, simpleExpCtx));
+    }
+
+    return new DocumentSourceSharedOplogCursor(
+        subscriptionFilter, std::move(matchExpr), *startAfter, pExpCtx);
+}
+
+}  // namespace mongo
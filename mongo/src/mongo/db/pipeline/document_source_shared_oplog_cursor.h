@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+
+#include "mongo/db/pipeline/document_source.h"
+#include "mongo/db/pipeline/shared_oplog_reader.h"
+
+namespace mongo {
+
+class Collection;
+
+/**
+ * Feeds a change stream pipeline from the node-wide SharedOplogReader instead of a private scan
+ * of the oplog. Used in place of a DocumentSourceCursor when the pipeline begins with a
+ * DocumentSourceOplogMatch.
+ *
+ * While the cursor is attached to the shared reader, it only consumes the entries which the
+ * reader has already matched against its filter. When detached, it scans the oplog by itself,
+ * with the same semantics as the oplog replay collection scan it replaces, until it can attach
+ * again.
+ */
+class DocumentSourceSharedOplogCursor final : public DocumentSource {
+public:
+    /**
+     * Returns nullptr if the shared reader cannot serve a change stream with oplog filter
+     * 'filter', in which case the caller should fall back to a DocumentSourceCursor.
+     */
+    static boost::intrusive_ptr<DocumentSourceSharedOplogCursor> create(
+        Collection* oplog,
+        const BSONObj& filter,
+        const boost::intrusive_ptr<ExpressionContext>& expCtx);
+
+    GetNextResult getNext() final;
+
+    const char* getSourceName() const final;
+
+    Value serialize(boost::optional<ExplainOptions::Verbosity> explain = boost::none) const final;
+
+    StageConstraints constraints(Pipeline::SplitState pipeState) const final {
+        StageConstraints constraints(StreamType::kStreaming,
+                                     PositionRequirement::kFirst,
+                                     HostTypeRequirement::kAnyShard,
+                                     DiskUseRequirement::kNoDiskUse,
+                                     FacetRequirement::kNotAllowed);
+
+        constraints.requiresInputDocSource = false;
+        return constraints;
+    }
+
+    /**
+     * Returns the timestamp of the newest oplog entry which has been evaluated for this cursor
+     * and whose result has been returned, whether or not it matched.
+     */
+    Timestamp getLatestOplogTimestamp() const {
+        return _latestOplogTimestamp;
+    }
+
+protected:
+    void doDispose() final;
+
+private:
+    DocumentSourceSharedOplogCursor(const BSONObj& filterObj,
+                                    std::unique_ptr<MatchExpression> filter,
+                                    Timestamp startAfter,
+                                    const boost::intrusive_ptr<ExpressionContext>& expCtx);
+    ~DocumentSourceSharedOplogCursor();
+
+    /**
+     * Fills '_currentBatch', waiting for new oplog entries if this is an awaitData getMore.
+     */
+    void loadBatch();
+
+    /**
+     * Takes the entries queued for this cursor by the shared reader, refilling the reader first
+     * if none are queued. Returns false if the subscription is detached and nothing was queued.
+     */
+    bool readShared(Collection* oplog);
+
+    /**
+     * Scans the oplog past this cursor's position without going through the shared reader.
+     */
+    void readPrivately(Collection* oplog);
+
+    bool shouldWaitForInserts() const;
+
+    std::deque<SharedOplogReader::EntryPtr> _currentBatch;
+
+    // The newest oplog entry evaluated when '_currentBatch' was loaded.
+    Timestamp _batchScannedThrough;
+    Timestamp _latestOplogTimestamp;
+
+    const Timestamp _startAfter;
+    std::shared_ptr<SharedOplogReader::Subscription> _subscription;
+};
+
+}  // namespace mongo
@@ -32,6 +32,7 @@
 
 #include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/document_source_group.h"
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/lite_parsed_document_source.h"
 #include "mongo/db/pipeline/value.h"
@@ -49,7 +50,7 @@ public:
              bool preserveNullAndEmptyArrays,
              const boost::optional<FieldPath>& indexPath);
     /** Reset the unwinder to unwind a new document. */
-    void resetDocument(const Document& document);
+    void resetDocument(Document document);
 
     /**
      * @return the next document unwound from the document provided to resetDocument(), using
@@ -93,13 +94,16 @@ DocumentSourceUnwind::Unwinder::Unwinder(const FieldPath& unwindPath,
       _preserveNullAndEmptyArrays(preserveNullAndEmptyArrays),
       _indexPath(indexPath) {}
 
-void DocumentSourceUnwind::Unwinder::resetDocument(const Document& document) {
+void DocumentSourceUnwind::Unwinder::resetDocument(Document document) {
     // Reset document specific attributes.
-    _output.reset(document);
     _unwindPathFieldIndexes.clear();
     _index = 0;
     _inputArray = document.getNestedField(_unwindPath, &_unwindPathFieldIndexes);
     _haveNext = true;
+
+    // Take ownership of 'document' so that, if the caller has released it, the first output
+    // document does not have to be copied.
+    _output.reset(std::move(document));
 }
 
 DocumentSource::GetNextResult DocumentSourceUnwind::Unwinder::getNext() {
@@ -206,6 +210,28 @@ DocumentSource::GetNextResult DocumentSourceUnwind::getNext() {
     return nextOut;
 }
 
+void DocumentSourceUnwind::unwindDocument(Document input,
+                                          const stdx::function<void(Document)>& consumer) {
+    _unwinder->resetDocument(std::move(input));
+    for (auto nextOut = _unwinder->getNext(); !nextOut.isEOF(); nextOut = _unwinder->getNext()) {
+        consumer(nextOut.releaseDocument());
+    }
+}
+
+Pipeline::SourceContainer::iterator DocumentSourceUnwind::doOptimizeAt(
+    Pipeline::SourceContainer::iterator itr, Pipeline::SourceContainer* container) {
+    invariant(*itr == this);
+
+    auto nextGroup = dynamic_cast<DocumentSourceGroup*>((*std::next(itr)).get());
+    if (!nextGroup || !nextGroup->absorbUnwind(this)) {
+        return std::next(itr);
+    }
+
+    // Give the stage before us a chance to optimize with the $group now that we are gone.
+    auto groupItr = container->erase(itr);
+    return groupItr == container->begin() ? groupItr : std::prev(groupItr);
+}
+
 BSONObjSet DocumentSourceUnwind::getOutputSorts() {
     BSONObjSet out = SimpleBSONObjComparator::kInstance.makeBSONObjSet();
     std::string unwoundPath = getUnwindPath();
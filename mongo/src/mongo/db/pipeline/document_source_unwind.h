@@ -30,6 +30,7 @@
 
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/field_path.h"
+#include "mongo/stdx/functional.h"
 
 namespace mongo {
 
@@ -83,6 +84,22 @@ public:
         return _indexPath;
     }
 
+    /**
+     * Unwinds 'input' without going through getNext(), passing each document this stage would have
+     * produced from it to 'consumer' in turn. Used by a $group which has absorbed this stage. If
+     * 'consumer' does not retain the document it is given, the next one is built by modifying it
+     * in place rather than by copying it.
+     */
+    void unwindDocument(Document input, const stdx::function<void(Document)>& consumer);
+
+protected:
+    /**
+     * Attempts to hand this stage over to an immediately following $group, which will then unwind
+     * each input document itself rather than receiving every unwound document through getNext().
+     */
+    Pipeline::SourceContainer::iterator doOptimizeAt(Pipeline::SourceContainer::iterator itr,
+                                                     Pipeline::SourceContainer* container) final;
+
 private:
     DocumentSourceUnwind(const boost::intrusive_ptr<ExpressionContext>& pExpCtx,
                          const FieldPath& fieldPath,
@@ -0,0 +1,379 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/document_source_window.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/lite_parsed_document_source.h"
+#include "mongo/db/pipeline/value.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+using std::vector;
+
+REGISTER_DOCUMENT_SOURCE(window,
+                         LiteParsedDocumentSourceDefault::parse,
+                         DocumentSourceWindow::createFromBson);
+
+constexpr StringData DocumentSourceWindow::kStageName;
+
+namespace {
+
+const StringData kUnboundedBound = "unbounded"_sd;
+const StringData kCurrentBound = "current"_sd;
+
+boost::optional<long long> parseBound(BSONElement elem, bool isLower) {
+    if (elem.type() == BSONType::String) {
+        if (elem.valueStringData() == kCurrentBound) {
+            return 0LL;
+        }
+        if (isLower && elem.valueStringData() == kUnboundedBound) {
+            return boost::none;
+        }
+    } else if (elem.isNumber()) {
+        const long long bound = elem.numberLong();
+        if (static_cast<double>(bound) == elem.numberDouble() &&
+            std::abs(bound) <= std::numeric_limits<int>::max()) {
+            return bound;
+        }
+    }
+
+    uasserted(40679,
+              str::stream() << "$window " << (isLower ? "lower" : "upper")
+                            << " bound must be an integer or '"
+                            << kCurrentBound
+                            << "'"
+                            << (isLower ? " or 'unbounded'" : ", since the window cannot extend "
+                                                              "to the end of the partition")
+                            << ", but found: "
+                            << elem.toString(false));
+}
+
+DocumentSourceWindow::Bounds parseBounds(BSONElement elem) {
+    uassert(40680,
+            str::stream() << "$window 'window' must be of the form {documents: [<lower>, <upper>]}"
+                          << ", but found: "
+                          << elem.toString(false),
+            elem.type() == BSONType::Object && elem.Obj().nFields() == 1 &&
+                elem.Obj().firstElementFieldName() == "documents"_sd &&
+                elem.Obj().firstElement().type() == BSONType::Array);
+
+    const auto bounds = elem.Obj().firstElement().Array();
+    uassert(40681,
+            "$window 'documents' must contain exactly a lower and an upper bound",
+            bounds.size() == 2);
+
+    DocumentSourceWindow::Bounds result;
+    result.lower = parseBound(bounds[0], true);
+    result.upper = *parseBound(bounds[1], false);
+    uassert(40682,
+            "$window lower bound must not be greater than its upper bound",
+            !result.lower || *result.lower <= result.upper);
+    return result;
+}
+
+}  // namespace
+
+DocumentSourceWindow::DocumentSourceWindow(const intrusive_ptr<ExpressionContext>& pExpCtx,
+                                           intrusive_ptr<Expression> partitionBy,
+                                           vector<WindowField> fields,
+                                           size_t maxMemoryUsageBytes)
+    : DocumentSource(pExpCtx),
+      _partitionBy(std::move(partitionBy)),
+      _fields(std::move(fields)),
+      _maxMemoryUsageBytes(maxMemoryUsageBytes) {
+    for (auto&& field : _fields) {
+        field.accumulator = field.statement.makeAccumulator(pExpCtx);
+        if (field.bounds.lower) {
+            _maxLookBehind = std::max(_maxLookBehind, -*field.bounds.lower);
+        }
+        _maxLookBehind = std::max(_maxLookBehind, -field.bounds.upper);
+        _maxLookAhead = std::max(_maxLookAhead, field.bounds.upper);
+    }
+}
+
+intrusive_ptr<DocumentSource> DocumentSourceWindow::createFromBson(
+    BSONElement elem, const intrusive_ptr<ExpressionContext>& pExpCtx) {
+    uassert(40683,
+            str::stream() << "$window specification must be an object, but found: "
+                          << typeName(elem.type()),
+            elem.type() == BSONType::Object);
+    return create(pExpCtx, elem.Obj());
+}
+
+intrusive_ptr<DocumentSourceWindow> DocumentSourceWindow::create(
+    const intrusive_ptr<ExpressionContext>& pExpCtx,
+    const BSONObj& spec,
+    size_t maxMemoryUsageBytes) {
+    VariablesParseState vps = pExpCtx->variablesParseState;
+    intrusive_ptr<Expression> partitionBy;
+    vector<WindowField> fields;
+
+    for (auto&& specElem : spec) {
+        const auto optionName = specElem.fieldNameStringData();
+        if (optionName == "partitionBy"_sd) {
+            partitionBy = Expression::parseOperand(pExpCtx, specElem, vps);
+        } else if (optionName == "output"_sd) {
+            uassert(40684,
+                    "$window 'output' must be an object",
+                    specElem.type() == BSONType::Object);
+            for (auto&& outputElem : specElem.Obj()) {
+                uassert(40692,
+                        str::stream() << "The field '" << outputElem.fieldNameStringData()
+                                      << "' must be an accumulator object",
+                        outputElem.type() == BSONType::Object);
+
+                // Everything except the window is the accumulator, which is parsed as for $group.
+                BSONObjBuilder accumulatorBuilder;
+                Bounds bounds;
+                for (auto&& elem : outputElem.Obj()) {
+                    if (elem.fieldNameStringData() == "window"_sd) {
+                        bounds = parseBounds(elem);
+                    } else {
+                        accumulatorBuilder.append(elem);
+                    }
+                }
+                const BSONObj statementObj =
+                    BSON(outputElem.fieldNameStringData() << accumulatorBuilder.obj());
+                fields.push_back({AccumulationStatement::parseAccumulationStatement(
+                                      pExpCtx, statementObj.firstElement(), vps),
+                                  bounds,
+                                  nullptr});
+            }
+        } else {
+            uasserted(40685, str::stream() << "unrecognized $window option: " << optionName);
+        }
+    }
+
+    uassert(40686, "$window must specify at least one 'output' field", !fields.empty());
+    return new DocumentSourceWindow(
+        pExpCtx, std::move(partitionBy), std::move(fields), maxMemoryUsageBytes);
+}
+
+DocumentSource::GetNextResult DocumentSourceWindow::getNext() {
+    pExpCtx->checkForInterrupt();
+
+    while (!canProduceNext()) {
+        if (_partitionComplete) {
+            if (!_nextPartitionFirstDocument) {
+                return GetNextResult::makeEOF();
+            }
+            startNextPartition();
+            continue;
+        }
+
+        auto input = pSource->getNext();
+        if (input.isPaused()) {
+            return input;
+        } else if (input.isEOF()) {
+            _inputExhausted = true;
+            _partitionComplete = true;
+            continue;
+        }
+
+        auto document = input.releaseDocument();
+        Value partitionKey = _partitionBy ? _partitionBy->evaluate(document) : Value();
+        if (numRead() == 0) {
+            _partitionKey = std::move(partitionKey);
+        } else if (pExpCtx->getValueComparator().evaluate(partitionKey != _partitionKey)) {
+            // The current partition is complete, so its remaining documents can be returned before
+            // this one starts the next.
+            _nextPartitionKey = std::move(partitionKey);
+            _nextPartitionFirstDocument = std::move(document);
+            _partitionComplete = true;
+            continue;
+        }
+        bufferDocument(std::move(document));
+    }
+
+    return produceNext();
+}
+
+bool DocumentSourceWindow::canProduceNext() const {
+    if (_nextPosition >= numRead()) {
+        return false;
+    }
+    return _partitionComplete || _nextPosition + _maxLookAhead < numRead();
+}
+
+Document DocumentSourceWindow::produceNext() {
+    MutableDocument output(std::move(_buffer[_nextPosition - _bufferStart].document));
+    for (size_t i = 0; i < _fields.size(); ++i) {
+        output.setField(_fields[i].statement.fieldName, computeField(i, _nextPosition));
+    }
+    ++_nextPosition;
+
+    // Only the inputs of the documents still within reach of a later window are kept.
+    while (!_buffer.empty() && _bufferStart < _nextPosition - _maxLookBehind) {
+        _bufferMemoryUsageBytes -= _buffer.front().memoryUsageBytes;
+        _buffer.pop_front();
+        ++_bufferStart;
+    }
+
+    checkMemoryUsage();
+    return output.freeze();
+}
+
+Value DocumentSourceWindow::computeField(size_t fieldIndex, long long position) {
+    WindowField& field = _fields[fieldIndex];
+    long long last = position + field.bounds.upper;
+    if (_partitionComplete) {
+        last = std::min(last, numRead() - 1);
+    }
+
+    if (!field.bounds.lower) {
+        // The window grows from the start of the partition, so the accumulator only needs the
+        // documents which have entered it since the previous position.
+        for (; field.numAccumulated <= last; ++field.numAccumulated) {
+            const auto& buffered = _buffer[field.numAccumulated - _bufferStart];
+            field.accumulator->process(buffered.inputs[fieldIndex], false);
+        }
+        return field.accumulator->getValue(false);
+    }
+
+    // Accumulators cannot remove inputs, so a sliding window is accumulated afresh each time.
+    const long long first = std::max(0LL, position + *field.bounds.lower);
+    _windowInputs.clear();
+    for (long long i = first; i <= last; ++i) {
+        _windowInputs.push_back(_buffer[i - _bufferStart].inputs[fieldIndex]);
+    }
+    field.accumulator->reset();
+    field.accumulator->processBatch(_windowInputs, false);
+    return field.accumulator->getValue(false);
+}
+
+void DocumentSourceWindow::bufferDocument(Document document) {
+    BufferedDocument buffered{std::move(document), {}, 0};
+    buffered.inputs.reserve(_fields.size());
+    buffered.memoryUsageBytes = buffered.document.getApproximateSize();
+    for (auto&& field : _fields) {
+        buffered.inputs.push_back(field.statement.expression->evaluate(buffered.document));
+        buffered.memoryUsageBytes += buffered.inputs.back().getApproximateSize();
+    }
+
+    _bufferMemoryUsageBytes += buffered.memoryUsageBytes;
+    _buffer.push_back(std::move(buffered));
+    checkMemoryUsage();
+}
+
+void DocumentSourceWindow::startNextPartition() {
+    _buffer.clear();
+    _bufferMemoryUsageBytes = 0;
+    _bufferStart = 0;
+    _nextPosition = 0;
+    for (auto&& field : _fields) {
+        field.accumulator->reset();
+        field.numAccumulated = 0;
+    }
+
+    _partitionKey = std::move(_nextPartitionKey);
+    _nextPartitionKey = Value();
+    _partitionComplete = false;
+    Document first = std::move(*_nextPartitionFirstDocument);
+    _nextPartitionFirstDocument = boost::none;
+    bufferDocument(std::move(first));
+}
+
+void DocumentSourceWindow::checkMemoryUsage() const {
+    size_t memoryUsageBytes = _bufferMemoryUsageBytes;
+    for (auto&& field : _fields) {
+        if (!field.bounds.lower) {
+            memoryUsageBytes += field.accumulator->memUsageForSorter();
+        }
+    }
+    uassert(40687,
+            str::stream() << "Exceeded memory limit for $window, max " << _maxMemoryUsageBytes
+                          << " bytes. Consider narrowing the windows or using accumulators which "
+                             "do not grow with their input.",
+            memoryUsageBytes <= _maxMemoryUsageBytes);
+}
+
+void DocumentSourceWindow::doDispose() {
+    _buffer.clear();
+    _bufferMemoryUsageBytes = 0;
+    _nextPartitionFirstDocument = boost::none;
+    for (auto&& field : _fields) {
+        field.accumulator->reset();
+    }
+}
+
+intrusive_ptr<DocumentSource> DocumentSourceWindow::optimize() {
+    if (_partitionBy) {
+        _partitionBy = _partitionBy->optimize();
+    }
+    for (auto&& field : _fields) {
+        field.statement.expression = field.statement.expression->optimize();
+    }
+    return this;
+}
+
+DocumentSource::GetDepsReturn DocumentSourceWindow::getDependencies(DepsTracker* deps) const {
+    if (_partitionBy) {
+        _partitionBy->addDependencies(deps);
+    }
+    for (auto&& field : _fields) {
+        field.statement.expression->addDependencies(deps);
+    }
+
+    // Every input field is passed through, so later stages determine the remaining dependencies.
+    return SEE_NEXT;
+}
+
+Value DocumentSourceWindow::serialize(boost::optional<ExplainOptions::Verbosity> explain) const {
+    MutableDocument spec;
+    if (_partitionBy) {
+        spec["partitionBy"] = _partitionBy->serialize(static_cast<bool>(explain));
+    }
+
+    MutableDocument output;
+    for (auto&& field : _fields) {
+        const Value lower =
+            field.bounds.lower ? Value(*field.bounds.lower) : Value(kUnboundedBound);
+        output[field.statement.fieldName] =
+            Value(DOC(field.accumulator->getOpName()
+                      << field.statement.expression->serialize(static_cast<bool>(explain))
+                      << "window"
+                      << DOC("documents" << DOC_ARRAY(lower << Value(field.bounds.upper)))));
+    }
+    spec["output"] = output.freezeToValue();
+
+    return Value(DOC(getSourceName() << spec.freeze()));
+}
+
+}  // namespace mongo
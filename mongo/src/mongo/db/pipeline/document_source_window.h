@@ -0,0 +1,212 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "mongo/db/pipeline/accumulation_statement.h"
+#include "mongo/db/pipeline/accumulator.h"
+#include "mongo/db/pipeline/document_source.h"
+
+namespace mongo {
+
+/**
+ * The $window stage adds fields computed by accumulators over a window of the documents around
+ * each input document, such as running totals and moving averages. Its input must already be
+ * grouped by the 'partitionBy' expression, for example by a preceding $sort, and each window only
+ * spans documents within one partition:
+ *
+ * {$window: {
+ *     partitionBy: <expression>,
+ *     output: {
+ *         <field>: {<accumulator>: <expression>, window: {documents: [<lower>, <upper>]}},
+ *         ...
+ *     }
+ * }}
+ *
+ * The bounds are positions relative to the current document; 'lower' may also be "unbounded" to
+ * start at the beginning of the partition, and either may be "current". A window defaults to
+ * ["unbounded", "current"]. The stage streams its input and only holds as many documents as the
+ * widest window requires, rather than a whole partition.
+ */
+class DocumentSourceWindow final : public DocumentSource, public SplittableDocumentSource {
+public:
+    static constexpr StringData kStageName = "$window"_sd;
+    static const size_t kDefaultMaxMemoryUsageBytes = 100 * 1024 * 1024;
+
+    /**
+     * The range of documents, relative to the current one, which a field is computed over. A
+     * 'lower' of boost::none means the range starts at the beginning of the partition.
+     */
+    struct Bounds {
+        boost::optional<long long> lower;
+        long long upper = 0;
+    };
+
+    /**
+     * Parses the user-supplied BSON into a $window stage.
+     *
+     * Throws a AssertionException if 'elem' is an invalid $window specification.
+     */
+    static boost::intrusive_ptr<DocumentSource> createFromBson(
+        BSONElement elem, const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
+
+    /**
+     * Parses 'spec', the value of a $window stage, into a stage which fails the query if the
+     * documents and accumulator state it holds exceed 'maxMemoryUsageBytes'.
+     */
+    static boost::intrusive_ptr<DocumentSourceWindow> create(
+        const boost::intrusive_ptr<ExpressionContext>& pExpCtx,
+        const BSONObj& spec,
+        size_t maxMemoryUsageBytes = kDefaultMaxMemoryUsageBytes);
+
+    StageConstraints constraints(Pipeline::SplitState pipeState) const final {
+        return {StreamType::kStreaming,
+                PositionRequirement::kNone,
+                HostTypeRequirement::kNone,
+                DiskUseRequirement::kNoDiskUse,
+                FacetRequirement::kAllowed};
+    }
+
+    GetNextResult getNext() final;
+
+    const char* getSourceName() const final {
+        return kStageName.rawData();
+    }
+
+    Value serialize(boost::optional<ExplainOptions::Verbosity> explain = boost::none) const final;
+    boost::intrusive_ptr<DocumentSource> optimize() final;
+    GetDepsReturn getDependencies(DepsTracker* deps) const final;
+
+    BSONObjSet getOutputSorts() final {
+        return pSource ? pSource->getOutputSorts()
+                       : SimpleBSONObjComparator::kInstance.makeBSONObjSet();
+    }
+
+    // Virtuals for SplittableDocumentSource. A partition may span shards, so this stage must run
+    // on the merger.
+    boost::intrusive_ptr<DocumentSource> getShardSource() final {
+        return nullptr;
+    }
+    std::list<boost::intrusive_ptr<DocumentSource>> getMergeSources() final {
+        return {this};
+    }
+
+protected:
+    void doDispose() final;
+
+private:
+    /**
+     * A field added to each document, computed by 'statement' over the documents in 'bounds'.
+     */
+    struct WindowField {
+        AccumulationStatement statement;
+        Bounds bounds;
+        boost::intrusive_ptr<Accumulator> accumulator;
+
+        // For a window which starts at the beginning of the partition, the number of documents in
+        // the partition which have already been passed to 'accumulator'.
+        long long numAccumulated = 0;
+    };
+
+    /**
+     * A document which has been read but is either yet to be returned or may still be part of the
+     * window of a later document. 'inputs' holds the value of each window field's expression.
+     */
+    struct BufferedDocument {
+        Document document;
+        std::vector<Value> inputs;
+        size_t memoryUsageBytes;
+    };
+
+    DocumentSourceWindow(const boost::intrusive_ptr<ExpressionContext>& pExpCtx,
+                         boost::intrusive_ptr<Expression> partitionBy,
+                         std::vector<WindowField> fields,
+                         size_t maxMemoryUsageBytes);
+
+    /**
+     * Returns true if the next document in the partition has all the documents its windows need.
+     */
+    bool canProduceNext() const;
+
+    /**
+     * Computes the window fields of the next document in the partition and returns it, then
+     * releases any buffered documents that no later window needs.
+     */
+    Document produceNext();
+
+    /**
+     * Clears the buffer and the window accumulators, then buffers the first document of the next
+     * partition if one has been read.
+     */
+    void startNextPartition();
+
+    void bufferDocument(Document document);
+
+    /**
+     * Returns the value of the window field at 'fieldIndex' for the document at 'position' within
+     * the partition.
+     */
+    Value computeField(size_t fieldIndex, long long position);
+
+    void checkMemoryUsage() const;
+
+    // The number of documents which have been read from the current partition.
+    long long numRead() const {
+        return _bufferStart + static_cast<long long>(_buffer.size());
+    }
+
+    boost::intrusive_ptr<Expression> _partitionBy;
+    std::vector<WindowField> _fields;
+    const size_t _maxMemoryUsageBytes;
+
+    // How many documents before and after the current one any window can include.
+    long long _maxLookBehind = 0;
+    long long _maxLookAhead = 0;
+
+    std::deque<BufferedDocument> _buffer;
+    size_t _bufferMemoryUsageBytes = 0;
+
+    // The position within the partition of the first buffered document and of the next document
+    // to be returned.
+    long long _bufferStart = 0;
+    long long _nextPosition = 0;
+
+    Value _partitionKey;
+    Value _nextPartitionKey;
+    boost::optional<Document> _nextPartitionFirstDocument;
+    bool _partitionComplete = false;
+    bool _inputExhausted = false;
+
+    // Reused to pass the inputs of a sliding window to its accumulator.
+    std::vector<Value> _windowInputs;
+};
+
+}  // namespace mongo
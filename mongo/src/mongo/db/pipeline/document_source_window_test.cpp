@@ -0,0 +1,227 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <vector>
+
+#include "mongo/bson/bsonmisc.h"
+#include "mongo/bson/json.h"
+#include "mongo/db/pipeline/aggregation_context_fixture.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/document_source_mock.h"
+#include "mongo/db/pipeline/document_source_window.h"
+#include "mongo/db/pipeline/document_value_test_util.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+using boost::intrusive_ptr;
+using std::vector;
+
+// This provides access to getExpCtx(), but we'll use a different name for this test suite.
+using DocumentSourceWindowTest = AggregationContextFixture;
+
+vector<Document> getAll(const intrusive_ptr<DocumentSource>& source) {
+    vector<Document> results;
+    for (auto next = source->getNext(); next.isAdvanced(); next = source->getNext()) {
+        results.push_back(next.releaseDocument());
+    }
+    return results;
+}
+
+vector<Document> runWindow(const intrusive_ptr<ExpressionContext>& expCtx,
+                           const char* spec,
+                           const vector<DocumentSource::GetNextResult>& inputs) {
+    auto window = DocumentSourceWindow::create(expCtx, fromjson(spec));
+    auto mock = DocumentSourceMock::create(std::deque<DocumentSource::GetNextResult>(
+        inputs.begin(), inputs.end()));
+    window->setSource(mock.get());
+    return getAll(window);
+}
+
+TEST_F(DocumentSourceWindowTest, ShouldComputeRunningTotalWithinEachPartition) {
+    auto results = runWindow(getExpCtx(),
+                             "{partitionBy: '$k', output: {total: {$sum: '$x'}}}",
+                             {Document{{"k", 1}, {"x", 1}},
+                              Document{{"k", 1}, {"x", 2}},
+                              Document{{"k", 1}, {"x", 3}},
+                              Document{{"k", 2}, {"x", 10}},
+                              Document{{"k", 2}, {"x", 20}}});
+    ASSERT_EQ(results.size(), 5UL);
+    ASSERT_DOCUMENT_EQ(results[0], (Document{{"k", 1}, {"x", 1}, {"total", 1}}));
+    ASSERT_DOCUMENT_EQ(results[1], (Document{{"k", 1}, {"x", 2}, {"total", 3}}));
+    ASSERT_DOCUMENT_EQ(results[2], (Document{{"k", 1}, {"x", 3}, {"total", 6}}));
+    ASSERT_DOCUMENT_EQ(results[3], (Document{{"k", 2}, {"x", 10}, {"total", 10}}));
+    ASSERT_DOCUMENT_EQ(results[4], (Document{{"k", 2}, {"x", 20}, {"total", 30}}));
+}
+
+TEST_F(DocumentSourceWindowTest, ShouldComputeSlidingWindowsClippedToThePartition) {
+    auto results = runWindow(
+        getExpCtx(),
+        "{partitionBy: '$k', output: {"
+        "    avg: {$avg: '$x', window: {documents: [-1, 1]}},"
+        "    previous: {$push: '$x', window: {documents: [-2, -1]}},"
+        "    next: {$first: '$x', window: {documents: [1, 1]}}}}",
+        {Document{{"k", 1}, {"x", 2}},
+         Document{{"k", 1}, {"x", 4}},
+         Document{{"k", 1}, {"x", 6}},
+         Document{{"k", 2}, {"x", 8}}});
+    ASSERT_EQ(results.size(), 4UL);
+    ASSERT_VALUE_EQ(results[0]["avg"], Value(3.0));
+    ASSERT_VALUE_EQ(results[0]["previous"], Value(vector<Value>{}));
+    ASSERT_VALUE_EQ(results[0]["next"], Value(4));
+    ASSERT_VALUE_EQ(results[1]["avg"], Value(4.0));
+    ASSERT_VALUE_EQ(results[1]["previous"], Value(vector<Value>{Value(2)}));
+    ASSERT_VALUE_EQ(results[2]["avg"], Value(5.0));
+    ASSERT_VALUE_EQ(results[2]["previous"], Value(vector<Value>{Value(2), Value(4)}));
+    ASSERT_TRUE(results[2]["next"].missing());
+    ASSERT_VALUE_EQ(results[3]["avg"], Value(8.0));
+    ASSERT_VALUE_EQ(results[3]["previous"], Value(vector<Value>{}));
+    ASSERT_TRUE(results[3]["next"].missing());
+}
+
+TEST_F(DocumentSourceWindowTest, ShouldTreatAllInputAsOnePartitionWithoutPartitionBy) {
+    auto results = runWindow(getExpCtx(),
+                             "{output: {n: {$sum: 1}, m: {$max: '$x', window: {documents: "
+                             "['unbounded', 'current']}}}}",
+                             {Document{{"x", 5}}, Document{{"x", 3}}, Document{{"x", 7}}});
+    ASSERT_EQ(results.size(), 3UL);
+    ASSERT_VALUE_EQ(results[2]["n"], Value(3));
+    ASSERT_VALUE_EQ(results[1]["m"], Value(5));
+    ASSERT_VALUE_EQ(results[2]["m"], Value(7));
+}
+
+TEST_F(DocumentSourceWindowTest, ShouldPropagatePausesAndWaitForLookAhead) {
+    auto window = DocumentSourceWindow::create(
+        getExpCtx(), fromjson("{output: {next: {$sum: '$x', window: {documents: [1, 1]}}}}"));
+    auto mock = DocumentSourceMock::create({Document{{"x", 1}},
+                                            DocumentSource::GetNextResult::makePauseExecution(),
+                                            Document{{"x", 2}},
+                                            DocumentSource::GetNextResult::makePauseExecution()});
+    window->setSource(mock.get());
+
+    // The first document cannot be returned until the one after it has been read.
+    ASSERT_TRUE(window->getNext().isPaused());
+
+    auto next = window->getNext();
+    ASSERT_TRUE(next.isAdvanced());
+    ASSERT_DOCUMENT_EQ(next.releaseDocument(), (Document{{"x", 1}, {"next", 2}}));
+
+    ASSERT_TRUE(window->getNext().isPaused());
+
+    next = window->getNext();
+    ASSERT_TRUE(next.isAdvanced());
+    ASSERT_DOCUMENT_EQ(next.releaseDocument(), (Document{{"x", 2}, {"next", 0}}));
+
+    ASSERT_TRUE(window->getNext().isEOF());
+    ASSERT_TRUE(window->getNext().isEOF());
+}
+
+TEST_F(DocumentSourceWindowTest, ShouldOnlyBufferDocumentsWithinTheWindows) {
+    const size_t maxMemoryUsageBytes = 16 * 1024;
+    std::deque<DocumentSource::GetNextResult> inputs;
+    for (int i = 0; i < 10000; ++i) {
+        inputs.push_back(Document{{"x", i}});
+    }
+
+    auto window = DocumentSourceWindow::create(
+        getExpCtx(),
+        fromjson("{output: {total: {$sum: '$x'}, avg: {$avg: '$x', window: {documents: [-2, 2]}}}}"),
+        maxMemoryUsageBytes);
+    auto mock = DocumentSourceMock::create(inputs);
+    window->setSource(mock.get());
+    auto results = getAll(window);
+    ASSERT_EQ(results.size(), 10000UL);
+    ASSERT_VALUE_EQ(results.back()["total"], Value(9999LL * 10000 / 2));
+    ASSERT_VALUE_EQ(results.back()["avg"], Value(9998.0));
+
+    // A running $push grows with the partition, so it exceeds the limit.
+    window = DocumentSourceWindow::create(
+        getExpCtx(), fromjson("{output: {all: {$push: '$x'}}}"), maxMemoryUsageBytes);
+    mock = DocumentSourceMock::create(inputs);
+    window->setSource(mock.get());
+    ASSERT_THROWS_CODE(getAll(window), AssertionException, 40687);
+}
+
+TEST_F(DocumentSourceWindowTest, ShouldRoundTripThroughSerialization) {
+    auto window = DocumentSourceWindow::create(
+        getExpCtx(),
+        fromjson("{partitionBy: '$k', output: {s: {$sum: '$x', window: {documents: "
+                 "['unbounded', -1]}}, a: {$avg: '$x', window: {documents: [-3, 'current']}}}}"));
+    vector<Value> serialization;
+    window->serializeToArray(serialization);
+    ASSERT_EQ(serialization.size(), 1UL);
+    ASSERT_VALUE_EQ(
+        serialization[0],
+        Value(fromjson("{$window: {partitionBy: '$k', output: {"
+                       "s: {$sum: '$x', window: {documents: ['unbounded', {$numberLong: '-1'}]}},"
+                       "a: {$avg: '$x', window: {documents: [{$numberLong: '-3'}, "
+                       "{$numberLong: '0'}]}}}}}")));
+
+    auto reparsed = DocumentSourceWindow::createFromBson(
+        serialization[0].getDocument().toBson().firstElement(), getExpCtx());
+    vector<Value> reserialization;
+    reparsed->serializeToArray(reserialization);
+    ASSERT_VALUE_EQ(reserialization[0], serialization[0]);
+}
+
+TEST_F(DocumentSourceWindowTest, ShouldRejectInvalidSpecifications) {
+    auto parse = [&](const char* spec) {
+        return DocumentSourceWindow::createFromBson(fromjson(spec).firstElement(), getExpCtx());
+    };
+    ASSERT_THROWS_CODE(parse("{$window: 1}"), AssertionException, 40683);
+    ASSERT_THROWS_CODE(parse("{$window: {partitionBy: '$k'}}"), AssertionException, 40686);
+    ASSERT_THROWS_CODE(parse("{$window: {output: {a: {$sum: 1}}, sortBy: {a: 1}}}"),
+                       AssertionException,
+                       40685);
+    ASSERT_THROWS_CODE(parse("{$window: {output: {a: {$sum: 1, window: {range: [0, 1]}}}}}"),
+                       AssertionException,
+                       40680);
+    ASSERT_THROWS_CODE(parse("{$window: {output: {a: {$sum: 1, window: {documents: [0]}}}}}"),
+                       AssertionException,
+                       40681);
+    ASSERT_THROWS_CODE(
+        parse("{$window: {output: {a: {$sum: 1, window: {documents: [0, 'unbounded']}}}}}"),
+        AssertionException,
+        40679);
+    ASSERT_THROWS_CODE(
+        parse("{$window: {output: {a: {$sum: 1, window: {documents: [0.5, 1]}}}}}"),
+        AssertionException,
+        40679);
+    ASSERT_THROWS_CODE(parse("{$window: {output: {a: {$sum: 1, window: {documents: [1, 0]}}}}}"),
+                       AssertionException,
+                       40682);
+    ASSERT_THROWS_CODE(parse("{$window: {output: {a: {window: {documents: [0, 0]}}}}}"),
+                       AssertionException,
+                       40692);
+}
+
+}  // namespace
+}  // namespace mongo
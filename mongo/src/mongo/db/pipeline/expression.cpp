@@ -43,6 +43,7 @@
 #include "mongo/db/query/datetime/date_time_support.h"
 #include "mongo/platform/bits.h"
 #include "mongo/platform/decimal128.h"
+#include "mongo/platform/overflow_arithmetic.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/string_map.h"
 #include "mongo/util/summation.h"
@@ -249,10 +250,36 @@ Value ExpressionAdd::evaluate(const Document& root) const {
     BSONType totalType = NumberInt;
     bool haveDate = false;
 
+    // Most sums are of ints and longs, which we can add exactly in a plain 64-bit integer. Do so
+    // until we see any other type or the sum would overflow, and only then switch over to the
+    // general summation below, starting from the integer total so far.
+    long long integralTotal = 0;
     const size_t n = vpOperand.size();
-    for (size_t i = 0; i < n; ++i) {
-        Value val = vpOperand[i]->evaluate(root);
+    size_t i = 0;
+    Value val;
+    for (; i < n; ++i) {
+        val = vpOperand[i]->evaluate(root);
+        const BSONType type = val.getType();
+        if (type != NumberInt && type != NumberLong) {
+            break;
+        }
+        long long sum;
+        if (mongoSignedAddOverflow64(
+                integralTotal, type == NumberInt ? val.getInt() : val.getLong(), &sum)) {
+            break;
+        }
+        integralTotal = sum;
+        if (type == NumberLong) {
+            totalType = NumberLong;
+        }
+    }
+    if (i == n) {
+        return totalType == NumberLong ? Value(integralTotal)
+                                       : Value::createIntOrLong(integralTotal);
+    }
+    nonDecimalTotal.addLong(integralTotal);
 
+    for (;;) {
         switch (val.getType()) {
             case NumberDecimal:
                 decimalTotal = decimalTotal.add(val.getDecimal());
@@ -283,6 +310,11 @@ Value ExpressionAdd::evaluate(const Document& root) const {
                         val.nullish());
                 return Value(BSONNULL);
         }
+
+        if (++i == n) {
+            break;
+        }
+        val = vpOperand[i]->evaluate(root);
     }
 
     if (haveDate) {
@@ -790,11 +822,42 @@ static const CmpLookup cmpLookup[7] = {
 };
 }
 
+namespace {
+/**
+ * Compares two numbers of the same type directly, since numbers are not affected by the collation
+ * the ValueComparator would otherwise apply. Returns boost::none if 'lhs' and 'rhs' are not both
+ * ints, both longs, or both non-NaN doubles.
+ */
+boost::optional<int> compareSameTypeNumbers(const Value& lhs, const Value& rhs) {
+    if (lhs.getType() != rhs.getType()) {
+        return boost::none;
+    }
+    switch (lhs.getType()) {
+        case NumberInt:
+            return lhs.getInt() < rhs.getInt() ? -1 : lhs.getInt() > rhs.getInt() ? 1 : 0;
+        case NumberLong:
+            return lhs.getLong() < rhs.getLong() ? -1 : lhs.getLong() > rhs.getLong() ? 1 : 0;
+        case NumberDouble: {
+            const double left = lhs.getDouble();
+            const double right = rhs.getDouble();
+            if (std::isnan(left) || std::isnan(right)) {
+                return boost::none;  // NaN sorts below all other numbers.
+            }
+            return left < right ? -1 : left > right ? 1 : 0;
+        }
+        default:
+            return boost::none;
+    }
+}
+}  // namespace
+
 Value ExpressionCompare::evaluate(const Document& root) const {
     Value pLeft(vpOperand[0]->evaluate(root));
     Value pRight(vpOperand[1]->evaluate(root));
 
-    int cmp = getExpressionContext()->getValueComparator().compare(pLeft, pRight);
+    auto sameTypeCmp = compareSameTypeNumbers(pLeft, pRight);
+    int cmp = sameTypeCmp ? *sameTypeCmp
+                          : getExpressionContext()->getValueComparator().compare(pLeft, pRight);
 
     // Make cmp one of 1, 0, or -1.
     if (cmp == 0) {
@@ -1815,7 +1878,12 @@ intrusive_ptr<ExpressionFieldPath> ExpressionFieldPath::parse(
 ExpressionFieldPath::ExpressionFieldPath(const boost::intrusive_ptr<ExpressionContext>& expCtx,
                                          const string& theFieldPath,
                                          Variables::Id variable)
-    : Expression(expCtx), _fieldPath(theFieldPath), _variable(variable) {}
+    : Expression(expCtx), _fieldPath(theFieldPath), _variable(variable) {
+    _fieldHashes.reserve(_fieldPath.getPathLength());
+    for (size_t i = 0; i < _fieldPath.getPathLength(); ++i) {
+        _fieldHashes.push_back(Document::hashFieldName(_fieldPath.getFieldName(i)));
+    }
+}
 
 intrusive_ptr<Expression> ExpressionFieldPath::optimize() {
     if (_variable == Variables::kRemoveId) {
@@ -1865,10 +1933,10 @@ Value ExpressionFieldPath::evaluatePath(size_t index, const Document& input) con
 
     /* if we've hit the end of the path, stop */
     if (index == _fieldPath.getPathLength() - 1)
-        return input[_fieldPath.getFieldName(index)];
+        return input.getField(_fieldPath.getFieldName(index), _fieldHashes[index]);
 
     // Try to dive deeper
-    const Value val = input[_fieldPath.getFieldName(index)];
+    const Value val = input.getField(_fieldPath.getFieldName(index), _fieldHashes[index]);
     switch (val.getType()) {
         case Object:
             return evaluatePath(index + 1, val.getDocument());
@@ -1902,6 +1970,24 @@ Value ExpressionFieldPath::evaluate(const Document& root) const {
     }
 }
 
+Value ExpressionFieldPath::evaluateOnBSON(const BSONObj& root) const {
+    invariant(isRootFieldPath() && _fieldPath.getPathLength() > 1);
+
+    BSONElement elem = root[_fieldPath.getFieldName(1)];
+    for (size_t i = 2; i < _fieldPath.getPathLength(); ++i) {
+        switch (elem.type()) {
+            case Object:
+                elem = elem.embeddedObject()[_fieldPath.getFieldName(i)];
+                break;
+            case Array:
+                return evaluate(Document(root));
+            default:
+                return Value();
+        }
+    }
+    return elem.eoo() ? Value() : Value(elem);
+}
+
 Value ExpressionFieldPath::serialize(bool explain) const {
     if (_fieldPath.getFieldName(0) == "CURRENT" && _fieldPath.getPathLength() > 1) {
         // use short form for "$$CURRENT.foo" but not just "$$CURRENT"
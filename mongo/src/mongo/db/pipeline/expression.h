@@ -370,9 +370,7 @@ public:
         if (n == 1) {
             Value singleVal = this->vpOperand[0]->evaluate(root);
             if (singleVal.getType() == Array) {
-                for (const Value& val : singleVal.getArray()) {
-                    accum.process(val, false);
-                }
+                accum.processBatch(singleVal.getArray(), false);
             } else {
                 accum.process(singleVal, false);
             }
@@ -1076,6 +1074,12 @@ public:
         return _fieldPath;
     }
 
+    /**
+     * Evaluates this path, which must be a path within $$ROOT, directly against the BSON form of
+     * 'root'. Falls back to converting 'root' to a Document if the path traverses an array.
+     */
+    Value evaluateOnBSON(const BSONObj& root) const;
+
     ComputedPaths getComputedPaths(const std::string& exprFieldPath,
                                    Variables::Id renamingVar) const final;
 
@@ -1107,6 +1111,10 @@ private:
 
     const FieldPath _fieldPath;
     const Variables::Id _variable;
+
+    // The hash of each component of '_fieldPath', so that looking up a component in a document
+    // does not have to hash its name every time.
+    std::vector<unsigned> _fieldHashes;
 };
 
 
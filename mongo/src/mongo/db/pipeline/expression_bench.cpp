@@ -0,0 +1,80 @@
+/**
+ *    Copyright (C) 2017 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kQuery
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/expression_context_for_test.h"
+#include "mongo/db/pipeline/field_path.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+namespace {
+
+// Times field path evaluation against the same lookups done by field name, as the evaluator did
+// before it cached the hash of each path component. This is a manual benchmark, so it only logs
+// its results.
+TEST(ExpressionFieldPathBench, CachedFieldHashesAgainstLookupsByName) {
+    boost::intrusive_ptr<ExpressionContextForTest> expCtx(new ExpressionContextForTest());
+    const FieldPath path("field17.x");
+    auto expression = ExpressionFieldPath::create(expCtx, path.fullPath());
+
+    // Twenty fields is enough for the document to be looked up through its hash table.
+    MutableDocument input;
+    for (int i = 0; i < 20; ++i) {
+        input.addField(str::stream() << "field" << i, Value(Document{{"x", i}}));
+    }
+    const Document doc = input.freeze();
+
+    const long long kIterations = 10 * 1000 * 1000;
+    long long total = 0;
+    Timer timer;
+    for (long long i = 0; i < kIterations; ++i) {
+        total += doc[path.getFieldName(0)].getDocument()[path.getFieldName(1)].getInt();
+    }
+    const long long byNameMicros = timer.micros();
+
+    timer.reset();
+    for (long long i = 0; i < kIterations; ++i) {
+        total += expression->evaluate(doc).getInt();
+    }
+    const long long cachedMicros = timer.micros();
+
+    log() << "evaluated " << path.fullPath() << " " << kIterations << " times: by name "
+          << byNameMicros << "us, with cached hashes " << cachedMicros << "us (checksum " << total
+          << ")";
+}
+
+}  // namespace
+}  // namespace mongo
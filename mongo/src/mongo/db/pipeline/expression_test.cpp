@@ -936,6 +936,35 @@ TEST_F(ExpressionTruncTest, NullArg) {
 
 /* ------------------------- Old-style tests -------------------------- */
 
+/**
+ * Field paths look up their fields with hashes computed when the expression is built, and must
+ * find the same values as lookups by name, including in documents large enough to be searched
+ * through their hash table.
+ */
+TEST(ExpressionFieldPathTest, CachedFieldHashesFindTheSameFieldsAsLookupsByName) {
+    intrusive_ptr<ExpressionContextForTest> expCtx(new ExpressionContextForTest());
+
+    for (int numFields : {1, 8, 20, 100}) {
+        MutableDocument input;
+        for (int i = 0; i < numFields; ++i) {
+            input.addField(str::stream() << "field" << i, Value(Document{{"x", i}}));
+        }
+        const Document doc = input.freeze();
+
+        for (int i = 0; i <= numFields; ++i) {
+            const FieldPath path(std::string(str::stream() << "field" << i << ".x"));
+            auto expression = ExpressionFieldPath::create(expCtx, path.fullPath());
+            const Value byName = doc[path.getFieldName(0)].missing()
+                ? Value()
+                : doc[path.getFieldName(0)].getDocument()[path.getFieldName(1)];
+            ASSERT_VALUE_EQ(expression->evaluate(doc), byName);
+            ASSERT_VALUE_EQ(doc.getField(path.getFieldName(0),
+                                         Document::hashFieldName(path.getFieldName(0))),
+                            doc[path.getFieldName(0)]);
+        }
+    }
+}
+
 namespace Add {
 
 class ExpectedResultBase {
@@ -1137,6 +1166,20 @@ class IntLongOverflowToDouble : public TwoOperandBase {
     }
 };
 
+/** A sum of longs that overflows part way through is still computed exactly. */
+class LongOverflowThenBackInRange : public ExpectedResultBase {
+    void populateOperands(intrusive_ptr<ExpressionNary>& expression) {
+        intrusive_ptr<ExpressionContextForTest> expCtx(new ExpressionContextForTest());
+        expression->addOperand(
+            ExpressionConstant::create(expCtx, Value(numeric_limits<long long>::max())));
+        expression->addOperand(ExpressionConstant::create(expCtx, Value(1LL)));
+        expression->addOperand(ExpressionConstant::create(expCtx, Value(-1)));
+    }
+    BSONObj expectedResult() {
+        return BSON("" << numeric_limits<long long>::max());
+    }
+};
+
 /** Adding an int and a double produces a double. */
 class IntDouble : public TwoOperandBase {
     BSONObj operand1() {
@@ -2499,6 +2542,26 @@ public:
     }
 };
 
+/** Fields are found in documents large enough to be looked up through their hash table. */
+class LargeDocument {
+public:
+    void run() {
+        intrusive_ptr<ExpressionContextForTest> expCtx(new ExpressionContextForTest());
+        intrusive_ptr<Expression> expression = ExpressionFieldPath::create(expCtx, "f7.g7");
+        MutableDocument inner;
+        for (int i = 0; i < 8; ++i) {
+            inner.addField(str::stream() << "g" << i, Value(i));
+        }
+        const Document innerDoc = inner.freeze();
+        MutableDocument outer;
+        for (int i = 0; i < 8; ++i) {
+            outer.addField(str::stream() << "f" << i, Value(innerDoc));
+        }
+        assertBinaryEqual(fromjson("{'':7}"), toBson(expression->evaluate(outer.freeze())));
+        assertBinaryEqual(fromjson("{}"), toBson(expression->evaluate(innerDoc)));
+    }
+};
+
 /** Add to a BSONObj. */
 class AddToBsonObj {
 public:
@@ -5351,6 +5414,7 @@ public:
         add<Add::Undefined>();
         add<Add::IntInt>();
         add<Add::IntIntNoOverflow>();
+        add<Add::LongOverflowThenBackInRange>();
         add<Add::IntLong>();
         add<Add::IntLongOverflowToDouble>();
         add<Add::IntDouble>();
@@ -5460,6 +5524,7 @@ public:
         add<FieldPath::NestedWithinArray>();
         add<FieldPath::MultipleArrayValues>();
         add<FieldPath::ExpandNestedArrays>();
+        add<FieldPath::LargeDocument>();
         add<FieldPath::AddToBsonObj>();
         add<FieldPath::AddToBsonArray>();
 
@@ -32,6 +32,9 @@
 
 #include "mongo/db/pipeline/pipeline_d.h"
 
+#include <set>
+
+#include "mongo/base/counter.h"
 #include "mongo/bson/simple_bsonobj_comparator.h"
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/auth/authorization_session.h"
@@ -40,6 +43,8 @@
 #include "mongo/db/catalog/database_holder.h"
 #include "mongo/db/catalog/document_validation.h"
 #include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/concurrency/d_concurrency.h"
 #include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/db/db_raii.h"
@@ -47,24 +52,29 @@
 #include "mongo/db/exec/fetch.h"
 #include "mongo/db/exec/index_iterator.h"
 #include "mongo/db/exec/multi_iterator.h"
+#include "mongo/db/exec/pipeline_group.h"
 #include "mongo/db/exec/shard_filter.h"
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/index/index_access_method.h"
 #include "mongo/db/matcher/extensions_callback_real.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/db/pipeline/change_stream_post_image_cache.h"
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/document_source_change_stream.h"
 #include "mongo/db/pipeline/document_source_cursor.h"
+#include "mongo/db/pipeline/document_source_group.h"
 #include "mongo/db/pipeline/document_source_match.h"
 #include "mongo/db/pipeline/document_source_merge_cursors.h"
 #include "mongo/db/pipeline/document_source_sample.h"
 #include "mongo/db/pipeline/document_source_sample_from_random_cursor.h"
+#include "mongo/db/pipeline/document_source_shared_oplog_cursor.h"
 #include "mongo/db/pipeline/document_source_single_document_transformation.h"
 #include "mongo/db/pipeline/document_source_sort.h"
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/query/collation/collator_interface.h"
 #include "mongo/db/query/get_executor.h"
 #include "mongo/db/query/plan_summary_stats.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/s/collection_metadata.h"
 #include "mongo/db/s/collection_sharding_state.h"
@@ -81,9 +91,15 @@
 #include "mongo/s/chunk_manager.h"
 #include "mongo/s/chunk_version.h"
 #include "mongo/s/grid.h"
+#include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/memory.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/exit.h"
+#include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
 #include "mongo/util/net/sock.h"
+#include "mongo/util/scopeguard.h"
 #include "mongo/util/time_support.h"
 
 namespace mongo {
@@ -95,6 +111,61 @@ using std::unique_ptr;
 
 namespace {
 
+Counter64 postImageBatchedLookups;
+Counter64 postImageCacheHits;
+Counter64 postImageCacheMisses;
+
+ServerStatusMetricField<Counter64> displayPostImageBatchedLookups(
+    "changeStreams.postImageLookup.batches", &postImageBatchedLookups);
+ServerStatusMetricField<Counter64> displayPostImageCacheHits(
+    "changeStreams.postImageLookup.cacheHits", &postImageCacheHits);
+ServerStatusMetricField<Counter64> displayPostImageCacheMisses(
+    "changeStreams.postImageLookup.cacheMisses", &postImageCacheMisses);
+
+// Makes the $out writer pool refuse every batch, so that $out inserts them all itself.
+MONGO_FP_DECLARE(outWriterPoolRejectsBatches);
+
+// Every $out on the node shares these writers, which is why there are more of them than any one
+// $out uses at a time.
+const size_t kMaxOutWriterThreads = 16;
+
+const auto getOutWriterPoolDecoration =
+    ServiceContext::declareDecoration<std::unique_ptr<ThreadPool>>();
+stdx::mutex outWriterPoolMutex;
+
+/**
+ * Returns the pool of threads which insert batches on behalf of $out. It is created on first use
+ * and is shut down with the server. Returns nullptr once shutdown has begun.
+ */
+ThreadPool* getOutWriterPool(ServiceContext* serviceContext) {
+    stdx::lock_guard<stdx::mutex> lk(outWriterPoolMutex);
+    auto& pool = getOutWriterPoolDecoration(serviceContext);
+    if (!pool) {
+        if (globalInShutdownDeprecated()) {
+            return nullptr;
+        }
+
+        ThreadPool::Options options;
+        options.poolName = "AggregateOutWriterPool";
+        options.threadNamePrefix = "aggOutWriter-";
+        options.minThreads = 0;
+        options.maxThreads = kMaxOutWriterThreads;
+        options.onCreateThread = [](const std::string& name) {
+            Client::initThread(name);
+            AuthorizationSession::get(cc())->grantInternalAuthorization();
+        };
+        pool = stdx::make_unique<ThreadPool>(options);
+        pool->startup();
+
+        // Batches which are scheduled once the pool is shut down are inserted by their $out.
+        registerShutdownTask([rawPool = pool.get()] {
+            rawPool->shutdown();
+            rawPool->join();
+        });
+    }
+    return pool.get();
+}
+
 class MongodProcessInterface final
     : public DocumentSourceNeedsMongoProcessInterface::MongoProcessInterface {
 public:
@@ -127,6 +198,110 @@ public:
         return _client.getLastErrorDetailed();
     }
 
+    Status insertBatches(const NamespaceString& ns,
+                         const std::vector<std::vector<BSONObj>>& batches) final {
+        // Each writer inserts through its own client and operation context, so its writes are
+        // replicated exactly as if the batch had been inserted on this thread. The caller's
+        // writes which follow are ordered after all of these in the oplog, so waiting for write
+        // concern on them covers the batches as well.
+        std::vector<Status> statuses(batches.size(), Status::OK());
+        stdx::mutex mutex;
+        stdx::condition_variable allDone;
+        size_t remaining = batches.size();
+
+        // The writers' operations are not visible to killOp on this one, so they are tracked here
+        // and killed when this operation is interrupted. Writers which have not started yet fail
+        // with 'interruptStatus' instead of inserting.
+        std::set<OperationContext*> writerOpCtxs;
+        Status interruptStatus = Status::OK();
+
+        const bool bypassDocumentValidation = _ctx->bypassDocumentValidation;
+        auto insertBatch = [&](size_t i) {
+            Status status = Status::OK();
+            try {
+                auto opCtx = cc().makeOperationContext();
+                {
+                    stdx::lock_guard<stdx::mutex> lk(mutex);
+                    uassertStatusOK(interruptStatus);
+                    writerOpCtxs.insert(opCtx.get());
+                }
+                ON_BLOCK_EXIT([&] {
+                    stdx::lock_guard<stdx::mutex> lk(mutex);
+                    writerOpCtxs.erase(opCtx.get());
+                });
+
+                boost::optional<DisableDocumentValidation> maybeDisableValidation;
+                if (bypassDocumentValidation)
+                    maybeDisableValidation.emplace(opCtx.get());
+
+                DBDirectClient client(opCtx.get());
+                client.insert(ns.ns(), batches[i]);
+                BSONObj err = client.getLastErrorDetailed();
+                if (!DBClientBase::getLastErrorString(err).empty()) {
+                    status = {ErrorCodes::OperationFailed, err.toString()};
+                }
+            } catch (const DBException&) {
+                status = exceptionToStatus();
+            }
+
+            stdx::lock_guard<stdx::mutex> lk(mutex);
+            statuses[i] = std::move(status);
+            if (--remaining == 0) {
+                allDone.notify_all();
+            }
+        };
+
+        // This thread's Client already has an operation context, so the batches it inserts itself
+        // go through the caller's.
+        auto insertBatchOnThisThread = [&](size_t i) {
+            Status status = Status::OK();
+            try {
+                BSONObj err = insert(ns, batches[i]);
+                if (!DBClientBase::getLastErrorString(err).empty()) {
+                    status = {ErrorCodes::OperationFailed, err.toString()};
+                }
+            } catch (const DBException&) {
+                status = exceptionToStatus();
+            }
+            stdx::lock_guard<stdx::mutex> lk(mutex);
+            statuses[i] = std::move(status);
+            --remaining;
+        };
+
+        // This thread inserts the first batch itself, and any batch the pool can't take.
+        auto pool = getOutWriterPool(_ctx->opCtx->getServiceContext());
+        for (size_t i = 1; i < batches.size(); ++i) {
+            if (!pool || MONGO_FAIL_POINT(outWriterPoolRejectsBatches) ||
+                !pool->schedule([&insertBatch, i] { insertBatch(i); }).isOK()) {
+                insertBatchOnThisThread(i);
+            }
+        }
+        if (!batches.empty()) {
+            insertBatchOnThisThread(0);
+        }
+
+        stdx::unique_lock<stdx::mutex> lk(mutex);
+        try {
+            _ctx->opCtx->waitForConditionOrInterrupt(allDone, lk, [&] { return remaining == 0; });
+        } catch (const DBException& ex) {
+            // The writers still refer to this frame, so they must finish before it is unwound.
+            interruptStatus = ex.toStatus();
+            for (auto&& writerOpCtx : writerOpCtxs) {
+                stdx::lock_guard<Client> clientLock(*writerOpCtx->getClient());
+                writerOpCtx->getServiceContext()->killOperation(writerOpCtx, ex.code());
+            }
+            allDone.wait(lk, [&] { return remaining == 0; });
+            throw;
+        }
+
+        for (auto&& status : statuses) {
+            if (!status.isOK()) {
+                return status;
+            }
+        }
+        return Status::OK();
+    }
+
 	//DocumentSourceIndexStats::getNext()е
 	//db.collection.aggregate({"$indexStats":{}})õ
     CollectionIndexUsageMap getIndexStats(OperationContext* opCtx,
@@ -417,6 +592,104 @@ public:
         return lookedUpDocument;
     }
 
+    std::vector<boost::optional<Document>> lookupDocumentsByKey(
+        const NamespaceString& nss,
+        UUID collectionUUID,
+        const std::vector<Document>& documentKeys,
+        Timestamp clusterTime) final {
+        std::vector<boost::optional<Document>> results(documentKeys.size());
+
+        auto foreignExpCtx =
+            _ctx->copyWith(nss, collectionUUID, _getCollectionDefaultCollator(nss, collectionUUID));
+
+        // The shared cache compares _id values bytewise, so it only serves collections with the
+        // simple default collation.
+        const size_t cacheSizeBytes = internalChangeStreamPostImageCacheSizeBytes.load();
+        const Milliseconds cacheMaxAge{internalChangeStreamPostImageCacheMaxAgeMillis.load()};
+        auto* cache = (cacheSizeBytes > 0 && !foreignExpCtx->getCollator())
+            ? &ChangeStreamPostImageCache::get(_ctx->opCtx->getServiceContext())
+            : nullptr;
+        const Date_t now = _ctx->opCtx->getServiceContext()->getFastClockSource()->now();
+
+        // Keys made up of just an _id are fetched together by a single $in, which visits the _id
+        // index once in key order. Any other document key is looked up on its own.
+        auto pendingIds =
+            foreignExpCtx->getValueComparator().makeOrderedValueMap<std::vector<size_t>>();
+        for (size_t i = 0; i < documentKeys.size(); ++i) {
+            const auto& documentKey = documentKeys[i];
+            const auto id = documentKey["_id"];
+            if (documentKey.size() != 1 || id.missing()) {
+                results[i] = lookupSingleDocument(nss, collectionUUID, documentKey, boost::none);
+                continue;
+            }
+            if (cache &&
+                cache->lookup(collectionUUID, id, clusterTime, now, cacheMaxAge, &results[i])) {
+                postImageCacheHits.increment();
+                continue;
+            }
+            pendingIds[id].push_back(i);
+        }
+
+        if (pendingIds.empty()) {
+            return results;
+        }
+        if (cache) {
+            postImageCacheMisses.increment(pendingIds.size());
+        }
+        postImageBatchedLookups.increment();
+
+        BSONArrayBuilder ids;
+        for (auto&& pending : pendingIds) {
+            pending.first.addToBsonArray(&ids);
+        }
+        auto swPipeline = makePipeline(
+            {BSON("$match" << BSON("_id" << BSON("$in" << ids.arr())))}, foreignExpCtx);
+        if (swPipeline == ErrorCodes::NamespaceNotFound) {
+            return results;
+        }
+        auto pipeline = uassertStatusOK(std::move(swPipeline));
+
+        std::vector<bool> found(documentKeys.size(), false);
+        while (auto lookedUpDocument = pipeline->getNext()) {
+            auto pending = pendingIds.find((*lookedUpDocument)["_id"]);
+            if (pending == pendingIds.end()) {
+                continue;
+            }
+            for (auto i : pending->second) {
+                uassert(ErrorCodes::TooManyMatchingDocuments,
+                        str::stream() << "found more than one document with document key "
+                                      << documentKeys[i].toString()
+                                      << " ["
+                                      << results[i]->toString()
+                                      << ", "
+                                      << lookedUpDocument->toString()
+                                      << "]",
+                        !found[i]);
+                found[i] = true;
+                results[i] = lookedUpDocument;
+            }
+        }
+
+        if (cache) {
+            for (auto&& pending : pendingIds) {
+                cache->insert(collectionUUID,
+                              pending.first,
+                              results[pending.second.front()],
+                              clusterTime,
+                              now,
+                              cacheMaxAge,
+                              cacheSizeBytes);
+            }
+        }
+        return results;
+    }
+
+    bool setShouldWaitForInserts(bool shouldWait) final {
+        bool previous = shouldWaitForInserts(_ctx->opCtx);
+        shouldWaitForInserts(_ctx->opCtx) = shouldWait;
+        return previous;
+    }
+
 private:
     /**
      * Looks up the collection default collator for the collection given by 'collectionUUID'. A
@@ -531,7 +804,8 @@ StatusWith<std::unique_ptr<PlanExecutor, PlanExecutor::Deleter>> attemptToGetExe
     BSONObj projectionObj,
     BSONObj sortObj,
     const AggregationRequest* aggRequest,
-    const size_t plannerOpts) {
+    const size_t plannerOpts,
+    const boost::optional<std::string>& distinctFirstField = boost::none) {
     auto qr = stdx::make_unique<QueryRequest>(nss);
     qr->setTailableMode(pExpCtx->tailableMode);
     qr->setOplogReplay(oplogReplay);
@@ -567,10 +841,46 @@ StatusWith<std::unique_ptr<PlanExecutor, PlanExecutor::Deleter>> attemptToGetExe
         return {cq.getStatus()};
     }
 
+    if (distinctFirstField) {
+        return getExecutorDistinctFirst(opCtx,
+                                        collection,
+                                        std::move(cq.getValue()),
+                                        *distinctFirstField,
+                                        PlanExecutor::YIELD_AUTO,
+                                        plannerOpts);
+    }
+
     return getExecutorFind(
         opCtx, collection, nss, std::move(cq.getValue()), PlanExecutor::YIELD_AUTO, plannerOpts);
 }
 
+/**
+ * If the $sort at the front of 'sources' is directly followed by a $group which only needs the
+ * first document of each group, and the sort orders the documents by the group key first, returns
+ * the field they are grouped by. The query can then use a DISTINCT_SCAN to produce just the first
+ * document for each value of that field.
+ */
+boost::optional<std::string> getDistinctScanFieldForGroup(const Pipeline::SourceContainer& sources,
+                                                          const DocumentSourceSort& sortStage,
+                                                          const BSONObj& sortObj) {
+    if (sortStage.getLimitSrc() || sources.size() < 2) {
+        return boost::none;
+    }
+
+    auto groupStage = dynamic_cast<DocumentSourceGroup*>(std::next(sources.begin())->get());
+    if (!groupStage) {
+        return boost::none;
+    }
+
+    auto groupField = groupStage->getFirstDocumentGroupField();
+    BSONElement firstSortElem = sortObj.firstElement();
+    if (!groupField || !firstSortElem.isNumber() ||
+        firstSortElem.fieldNameStringData() != *groupField) {
+        return boost::none;
+    }
+    return groupField;
+}
+
 BSONObj removeSortKeyMetaProjection(BSONObj projectionObj) {
     if (!projectionObj[Document::metaFieldSortKey]) {
         return projectionObj;
@@ -652,6 +962,17 @@ void PipelineD::prepareCursorSource(Collection* collection,
         }
     }
 
+    // Change streams read the oplog through the shared oplog reader where possible, rather than
+    // each running its own oplog scan. Explain still describes the scan it would otherwise run.
+    if (oplogReplay && collection && !expCtx->explain &&
+        internalChangeStreamUseSharedOplogReader.load()) {
+        if (auto sharedCursor =
+                DocumentSourceSharedOplogCursor::create(collection, queryObj, expCtx)) {
+            pipeline->addInitialSource(sharedCursor);
+            return;
+        }
+    }
+
     // Find the set of fields in the source documents depended on by this pipeline.
     DepsTracker deps = pipeline->getDependencies(DocumentSourceMatch::isTextQuery(queryObj)
                                                      ? DepsTracker::MetadataAvailable::kTextScore
@@ -699,8 +1020,32 @@ void PipelineD::prepareCursorSource(Collection* collection,
         }
     }
 
+    // If the query results go straight into a $group, run the $group within the PlanExecutor so
+    // that it accumulates the results as BSON, rather than each result first being converted to a
+    // Document.
+    intrusive_ptr<DocumentSourceGroup> pushedDownGroup;
+    if (!sources.empty() && internalQueryPushDownAggregationGroup.load()) {
+        auto groupStage = dynamic_cast<DocumentSourceGroup*>(sources.front().get());
+        if (groupStage && groupStage->canAccumulateBSON()) {
+            pushedDownGroup = groupStage;
+            sources.pop_front();
+            pushedDownGroup->setSource(nullptr);
+
+            WorkingSet* ws = exec->getWorkingSet();
+            exec->wrapRootStage([&](std::unique_ptr<PlanStage> root) {
+                return stdx::make_unique<PipelineGroupStage>(
+                    expCtx->opCtx, pushedDownGroup, ws, std::move(root));
+            });
+        }
+    }
+
     addCursorSource(
         collection, pipeline, expCtx, std::move(exec), deps, queryObj, sortObj, projForQuery);
+
+    if (pushedDownGroup) {
+        auto cursor = static_cast<DocumentSourceCursor*>(sources.front().get());
+        cursor->addPushedDownStage(pushedDownGroup);
+    }
 }
 
 StatusWith<std::unique_ptr<PlanExecutor, PlanExecutor::Deleter>> PipelineD::prepareExecutor(
@@ -757,6 +1102,37 @@ StatusWith<std::unique_ptr<PlanExecutor, PlanExecutor::Deleter>> PipelineD::prep
     const BSONObj emptyProjection;
     const BSONObj metaSortProjection = BSON("$meta"
                                             << "sortKey");
+    if (sortStage && !oplogReplay && internalQueryAggregationUseDistinctScanForFirst.load()) {
+        // A "first document per key" $sort and $group only needs the first document of each group,
+        // so see if the query system can skip directly from each group's first document to the
+        // next group's by way of a DISTINCT_SCAN, rather than scanning every document.
+        if (auto distinctField =
+                getDistinctScanFieldForGroup(pipeline->_sources, *sortStage, *sortObj)) {
+            auto swExecutorDistinct =
+                attemptToGetExecutor(opCtx,
+                                     collection,
+                                     nss,
+                                     expCtx,
+                                     oplogReplay,
+                                     queryObj,
+                                     *projectionObj,
+                                     *sortObj,
+                                     aggRequest,
+                                     plannerOpts & ~QueryPlannerParams::NO_UNCOVERED_PROJECTIONS,
+                                     distinctField);
+            if (swExecutorDistinct.isOK()) {
+                // The query system provides both the sort and the projection.
+                pipeline->_sources.pop_front();
+                return std::move(swExecutorDistinct.getValue());
+            } else if (swExecutorDistinct == ErrorCodes::QueryPlanKilled) {
+                return {ErrorCodes::OperationFailed,
+                        str::stream() << "Failed to determine whether query system can provide a "
+                                         "distinct scan for a $group: "
+                                      << swExecutorDistinct.getStatus().toString()};
+            }
+        }
+    }
+
     if (sortStage) {
         // See if the query system can provide a non-blocking sort.
         auto swExecutorSort =
@@ -909,6 +1285,10 @@ Timestamp PipelineD::getLatestOplogTimestamp(const Pipeline* pipeline) {
             dynamic_cast<DocumentSourceCursor*>(pipeline->_sources.front().get())) {
         return docSourceCursor->getLatestOplogTimestamp();
     }
+    if (auto sharedCursor =
+            dynamic_cast<DocumentSourceSharedOplogCursor*>(pipeline->_sources.front().get())) {
+        return sharedCursor->getLatestOplogTimestamp();
+    }
     return Timestamp();
 }
 
@@ -115,6 +115,35 @@ void assertPipelineOptimizesTo(std::string inputPipeJson, std::string outputPipe
     assertPipelineOptimizesAndSerializesTo(inputPipeJson, outputPipeJson, outputPipeJson);
 }
 
+TEST(PipelineOptimizationTest, GroupShouldAbsorbPrecedingUnwind) {
+    string inputPipe =
+        "[{$unwind: '$items'}"
+        ",{$group: {_id: '$items.k', total: {$sum: '$items.v'}}}]";
+    string outputPipe =
+        "[{$group: {_id: '$items.k', total: {$sum: '$items.v'}, "
+        "$unwinding: {path: '$items', preserveNullAndEmptyArrays: false}}}]";
+    string serializedPipe =
+        "[{$unwind: {path: '$items'}}"
+        ",{$group: {_id: '$items.k', total: {$sum: '$items.v'}}}]";
+    assertPipelineOptimizesAndSerializesTo(inputPipe, outputPipe, serializedPipe);
+}
+
+TEST(PipelineOptimizationTest, GroupShouldAbsorbOnlyOneUnwind) {
+    string inputPipe =
+        "[{$unwind: '$a'}"
+        ",{$unwind: {path: '$b', includeArrayIndex: 'i'}}"
+        ",{$group: {_id: '$b'}}]";
+    string outputPipe =
+        "[{$unwind: {path: '$a'}}"
+        ",{$group: {_id: '$b', $unwinding: {path: '$b', preserveNullAndEmptyArrays: false, "
+        "includeArrayIndex: 'i'}}}]";
+    string serializedPipe =
+        "[{$unwind: {path: '$a'}}"
+        ",{$unwind: {path: '$b', includeArrayIndex: 'i'}}"
+        ",{$group: {_id: '$b'}}]";
+    assertPipelineOptimizesAndSerializesTo(inputPipe, outputPipe, serializedPipe);
+}
+
 TEST(PipelineOptimizationTest, MoveSkipBeforeProject) {
     assertPipelineOptimizesTo("[{$project: {a : 1}}, {$skip : 5}]",
                               "[{$skip : 5}, {$project: {_id: true, a : true}}]");
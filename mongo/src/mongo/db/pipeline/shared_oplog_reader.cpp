@@ -0,0 +1,343 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/shared_oplog_reader.h"
+
+#include <algorithm>
+
+#include "mongo/bson/simple_bsonobj_comparator.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/service_context.h"
+#include "mongo/util/scopeguard.h"
+
+namespace mongo {
+
+namespace {
+
+const auto getSharedOplogReader = ServiceContext::declareDecoration<SharedOplogReader>();
+
+}  // namespace
+
+SharedOplogReader::Entry::Entry(BSONObj oplogEntry)
+    : obj(oplogEntry.getOwned()),
+      ts(obj["ts"].timestamp()),
+      ns(obj["ns"].valueStringData()),
+      isCommand(obj["op"].valueStringData() == "c") {}
+
+SharedOplogReader::Subscription::Subscription(std::shared_ptr<const MatchExpression> filter,
+                                              NamespaceString nss,
+                                              Timestamp startAfter)
+    : _filter(std::move(filter)), _ns(nss.ns()), _scannedThrough(startAfter) {
+    invariant(_filter);
+}
+
+bool SharedOplogReader::Subscription::matches(const Entry& entry) const {
+    // Commands are always evaluated, since they may name the target namespace in a field other
+    // than "ns" (e.g. the "to" field of a cross-database rename).
+    if (!entry.isCommand && entry.ns != _ns) {
+        return false;
+    }
+    return _filter->matchesBSON(entry.obj);
+}
+
+std::deque<SharedOplogReader::EntryPtr> SharedOplogReader::Subscription::drain(
+    Timestamp* scannedThrough) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    std::deque<EntryPtr> entries;
+    entries.swap(_queue);
+    _queueBytes = 0;
+    *scannedThrough = _scannedThrough;
+    return entries;
+}
+
+void SharedOplogReader::Subscription::advance(Timestamp ts) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    invariant(!_attached);
+    if (ts > _scannedThrough) {
+        _scannedThrough = ts;
+    }
+}
+
+Timestamp SharedOplogReader::Subscription::getScannedThrough() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _scannedThrough;
+}
+
+bool SharedOplogReader::Subscription::isAttached() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _attached;
+}
+
+bool SharedOplogReader::Subscription::_offer_inlock(const std::vector<EntryPtr>& entries,
+                                                    const std::vector<size_t>& matched,
+                                                    size_t maxQueueBytes) {
+    for (size_t i : matched) {
+        const EntryPtr& entry = entries[i];
+        if (entry->ts <= _scannedThrough) {
+            continue;
+        }
+
+        // Always accept at least one entry so that a single large entry cannot wedge the queue.
+        if (!_queue.empty() && _queueBytes + entry->size() > maxQueueBytes) {
+            if (i > 0 && entries[i - 1]->ts > _scannedThrough) {
+                _scannedThrough = entries[i - 1]->ts;
+            }
+            return false;
+        }
+        _queue.push_back(entry);
+        _queueBytes += entry->size();
+        _scannedThrough = entry->ts;
+    }
+
+    if (!entries.empty() && entries.back()->ts > _scannedThrough) {
+        _scannedThrough = entries.back()->ts;
+    }
+    return true;
+}
+
+SharedOplogReader& SharedOplogReader::get(ServiceContext* service) {
+    return getSharedOplogReader(service);
+}
+
+std::shared_ptr<SharedOplogReader::Subscription> SharedOplogReader::subscribe(
+    const BSONObj& filterObj,
+    std::unique_ptr<MatchExpression> filter,
+    NamespaceString nss,
+    Timestamp startAfter) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    auto group = std::find_if(_groups.begin(), _groups.end(), [&](const FilterGroup& group) {
+        return group.ns == nss.ns() &&
+            SimpleBSONObjComparator::kInstance.evaluate(group.filterObj == filterObj);
+    });
+    if (group == _groups.end()) {
+        _groups.push_back({filterObj.getOwned(), nss.ns(), std::move(filter), {}});
+        group = _groups.end() - 1;
+    }
+
+    auto subscription = std::make_shared<Subscription>(group->filter, std::move(nss), startAfter);
+    group->subscriptions.push_back(subscription);
+    return subscription;
+}
+
+void SharedOplogReader::unsubscribe(const std::shared_ptr<Subscription>& subscription) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    for (auto group = _groups.begin(); group != _groups.end(); ++group) {
+        auto& subscriptions = group->subscriptions;
+        auto it = std::find(subscriptions.begin(), subscriptions.end(), subscription);
+        if (it == subscriptions.end()) {
+            continue;
+        }
+
+        subscriptions.erase(it);
+        if (subscriptions.empty()) {
+            _groups.erase(group);
+        }
+        return;
+    }
+}
+
+bool SharedOplogReader::attach(OperationContext* opCtx,
+                               Subscription* subscription,
+                               const Limits& limits) {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    // Entries read by an in-progress refill are only offered to the subscriptions which were
+    // attached when it started, so a subscription must not attach in the middle of one.
+    _waitForRefill_inlock(opCtx, lk);
+
+    stdx::lock_guard<stdx::mutex> subscriptionLk(subscription->_mutex);
+    if (subscription->_attached) {
+        return true;
+    }
+
+    const Timestamp position = subscription->_scannedThrough;
+    const bool othersAttached = std::any_of(
+        _groups.begin(), _groups.end(), [subscription](const FilterGroup& group) {
+            return std::any_of(group.subscriptions.begin(),
+                               group.subscriptions.end(),
+                               [subscription](const std::shared_ptr<Subscription>& other) {
+                                   return other.get() != subscription && other->_attached;
+                               });
+        });
+    if (!othersAttached && (position < _coveredAfter || position > _readThrough)) {
+        _reposition_inlock(position);
+    } else if (position < _coveredAfter) {
+        return false;
+    }
+
+    auto it = std::upper_bound(
+        _buffer.begin(), _buffer.end(), position, [](Timestamp ts, const EntryPtr& entry) {
+            return ts < entry->ts;
+        });
+    const std::vector<EntryPtr> entries(it, _buffer.end());
+    std::vector<size_t> matched;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (subscription->matches(*entries[i])) {
+            matched.push_back(i);
+        }
+    }
+    if (!subscription->_offer_inlock(entries, matched, limits.maxQueueBytes)) {
+        return false;
+    }
+
+    subscription->_attached = true;
+    return true;
+}
+
+StatusWith<SharedOplogReader::RefillResult> SharedOplogReader::refill(OperationContext* opCtx,
+                                                                      const FetchFn& fetch,
+                                                                      const Limits& limits) {
+    RefillResult result;
+
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    if (_refilling) {
+        _waitForRefill_inlock(opCtx, lk);
+        return result;
+    }
+
+    // The attached subscriptions of each filter group, which all share its filter.
+    std::vector<std::vector<std::shared_ptr<Subscription>>> attachedGroups;
+    for (auto&& group : _groups) {
+        std::vector<std::shared_ptr<Subscription>> attached;
+        for (auto&& subscription : group.subscriptions) {
+            if (subscription->_attached) {
+                attached.push_back(subscription);
+            }
+        }
+        if (!attached.empty()) {
+            attachedGroups.push_back(std::move(attached));
+        }
+    }
+    if (attachedGroups.empty()) {
+        return result;
+    }
+
+    _refilling = true;
+    const Timestamp after = _readThrough;
+    const BSONObj lastRead = _lastRead;
+    lk.unlock();
+
+    ON_BLOCK_EXIT([this, &lk] {
+        if (!lk.owns_lock()) {
+            lk.lock();
+        }
+        _refilling = false;
+        _refillDone.notify_all();
+    });
+
+    auto swOplogEntries = fetch(after, lastRead);
+    if (!swOplogEntries.isOK()) {
+        // Our position is gone, so nothing retained can be trusted to be contiguous with what
+        // comes next. Every subscription falls back to checking its own position.
+        lk.lock();
+        for (auto&& group : _groups) {
+            for (auto&& subscription : group.subscriptions) {
+                stdx::lock_guard<stdx::mutex> subscriptionLk(subscription->_mutex);
+                if (subscription->_attached) {
+                    subscription->_attached = false;
+                    ++result.subscriptionsDetached;
+                }
+            }
+        }
+        _reposition_inlock(after);
+        return swOplogEntries.getStatus();
+    }
+
+    // Decode each entry once; the same Entry objects are shared by all queues and the buffer.
+    std::vector<EntryPtr> entries;
+    entries.reserve(swOplogEntries.getValue().size());
+    for (auto&& oplogEntry : swOplogEntries.getValue()) {
+        entries.push_back(std::make_shared<const Entry>(std::move(oplogEntry)));
+    }
+
+    result.performed = true;
+    if (entries.empty()) {
+        return result;
+    }
+
+    std::vector<size_t> matched;
+    for (auto&& attached : attachedGroups) {
+        // The subscriptions of a group share its filter, so any of them can evaluate it.
+        matched.clear();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i]->isCommand || entries[i]->ns == attached.front()->_ns) {
+                ++result.filterEvaluations;
+                if (attached.front()->matches(*entries[i])) {
+                    matched.push_back(i);
+                }
+            }
+        }
+
+        for (auto&& subscription : attached) {
+            stdx::lock_guard<stdx::mutex> subscriptionLk(subscription->_mutex);
+            if (!subscription->_offer_inlock(entries, matched, limits.maxQueueBytes)) {
+                // Applying backpressure to the reader would stall every other subscription, so
+                // a consumer which cannot keep up is left to catch up on its own.
+                subscription->_attached = false;
+                ++result.subscriptionsDetached;
+            }
+        }
+    }
+
+    lk.lock();
+    for (auto&& entry : entries) {
+        _bufferBytes += entry->size();
+        _buffer.push_back(entry);
+    }
+    _readThrough = _buffer.back()->ts;
+    _lastRead = _buffer.back()->obj;
+    while (_bufferBytes > limits.maxBufferBytes && !_buffer.empty()) {
+        _coveredAfter = _buffer.front()->ts;
+        _bufferBytes -= _buffer.front()->size();
+        _buffer.pop_front();
+    }
+
+    result.entriesRead = entries.size();
+    return result;
+}
+
+size_t SharedOplogReader::getBufferedBytes() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _bufferBytes;
+}
+
+void SharedOplogReader::_waitForRefill_inlock(OperationContext* opCtx,
+                                              stdx::unique_lock<stdx::mutex>& lk) {
+    opCtx->waitForConditionOrInterrupt(_refillDone, lk, [this] { return !_refilling; });
+}
+
+void SharedOplogReader::_reposition_inlock(Timestamp ts) {
+    _buffer.clear();
+    _bufferBytes = 0;
+    _coveredAfter = ts;
+    _readThrough = ts;
+    _lastRead = BSONObj();
+}
+
+}  // namespace mongo
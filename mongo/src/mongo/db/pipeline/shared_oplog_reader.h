@@ -0,0 +1,239 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status_with.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bson/timestamp.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+class OperationContext;
+class ServiceContext;
+
+/**
+ * A node-wide service which reads the oplog once on behalf of all change stream cursors.
+ *
+ * Each cursor registers a Subscription holding its oplog filter, less the lower bound on "ts" which
+ * the subscription tracks by itself. Subscriptions on the same namespace with identical filters,
+ * such as change streams with the same options opened at different times, form one filter group.
+ * Whenever new oplog entries are read, each entry is decoded once and evaluated once against the
+ * filter of each group with attached subscriptions. The subscriptions of the group then queue
+ * references to the matching entries, which are the same entries the buffer retains, so an entry
+ * is held in memory once however many queues it is on. The buffer keeps the most recently read
+ * entries, so that a new or lagging subscription can catch up without going back to storage.
+ *
+ * The entries referenced by a queue are bounded as well. A subscription whose consumer falls too
+ * far behind is detached rather than allowed to stall the reader or keep entries alive without
+ * limit; a detached subscription reads the oplog by itself until its position is covered by the
+ * buffer again, and then re-attaches.
+ *
+ * There is no dedicated thread: whichever subscriber first needs entries past the end of the
+ * buffer performs the read through refill(), while concurrent subscribers wait for it to finish.
+ */
+class SharedOplogReader {
+    MONGO_DISALLOW_COPYING(SharedOplogReader);
+
+public:
+    /**
+     * A decoded oplog entry. 'ns' points into 'obj'.
+     */
+    struct Entry {
+        explicit Entry(BSONObj oplogEntry);
+
+        size_t size() const {
+            return static_cast<size_t>(obj.objsize());
+        }
+
+        BSONObj obj;
+        Timestamp ts;
+        StringData ns;
+        bool isCommand;
+    };
+
+    // Entries are immutable once decoded, so the buffer and every queue share them.
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    /**
+     * The per-cursor state: its group's filter, its queue of matching entries, and the timestamp
+     * up to which the oplog has been evaluated on its behalf.
+     */
+    class Subscription {
+        MONGO_DISALLOW_COPYING(Subscription);
+
+    public:
+        /**
+         * 'filter' must be evaluated with the simple collation. Only command entries and entries
+         * on 'nss' are passed to the filter. Entries at or before 'startAfter' are never delivered.
+         */
+        Subscription(std::shared_ptr<const MatchExpression> filter,
+                     NamespaceString nss,
+                     Timestamp startAfter);
+
+        /**
+         * Returns true if 'entry' should be delivered to this subscription.
+         */
+        bool matches(const Entry& entry) const;
+
+        /**
+         * Removes and returns all queued entries, and reports in 'scannedThrough' the timestamp of
+         * the newest oplog entry evaluated for this subscription.
+         */
+        std::deque<EntryPtr> drain(Timestamp* scannedThrough);
+
+        /**
+         * Records that a detached subscription has evaluated the oplog up to 'ts' by itself.
+         */
+        void advance(Timestamp ts);
+
+        Timestamp getScannedThrough() const;
+
+        bool isAttached() const;
+
+    private:
+        friend class SharedOplogReader;
+
+        // Queues the entries of 'entries' at the positions in 'matched' which are newer than
+        // '_scannedThrough', and advances it past all of 'entries', which are in timestamp order.
+        // Returns false, advancing only up to the entry before it, if an entry would grow the
+        // queue beyond 'maxQueueBytes'. Requires '_mutex'.
+        bool _offer_inlock(const std::vector<EntryPtr>& entries,
+                           const std::vector<size_t>& matched,
+                           size_t maxQueueBytes);
+
+        const std::shared_ptr<const MatchExpression> _filter;
+        const std::string _ns;
+
+        mutable stdx::mutex _mutex;
+        std::deque<EntryPtr> _queue;
+        size_t _queueBytes = 0;
+        Timestamp _scannedThrough;
+        bool _attached = false;
+    };
+
+    struct Limits {
+        // Upper bound on the size of the retained entries.
+        size_t maxBufferBytes;
+
+        // Upper bound on the size of the entries referenced by the queue of any one subscription.
+        size_t maxQueueBytes;
+    };
+
+    struct RefillResult {
+        // False if this call only waited for a concurrent refill.
+        bool performed = false;
+        size_t entriesRead = 0;
+        size_t subscriptionsDetached = 0;
+
+        // The number of times an entry was evaluated against a filter.
+        size_t filterEvaluations = 0;
+    };
+
+    /**
+     * Returns oplog entries newer than 'after', in timestamp order. 'lastRead' is the entry at
+     * 'after' as previously returned, or an empty object if the reader has not read any entry
+     * since it was last positioned. Should fail with CappedPositionLost if 'lastRead' is no
+     * longer in the oplog or has been replaced by a different entry.
+     */
+    using FetchFn = stdx::function<StatusWith<std::vector<BSONObj>>(Timestamp after,
+                                                                    const BSONObj& lastRead)>;
+
+    SharedOplogReader() = default;
+
+    static SharedOplogReader& get(ServiceContext* service);
+
+    /**
+     * Registers a subscription to the entries on 'nss' matching 'filter', which is parsed from
+     * 'filterObj'. If another subscription on 'nss' has an identical 'filterObj', the new one
+     * joins its filter group and 'filter' is discarded.
+     */
+    std::shared_ptr<Subscription> subscribe(const BSONObj& filterObj,
+                                            std::unique_ptr<MatchExpression> filter,
+                                            NamespaceString nss,
+                                            Timestamp startAfter);
+
+    void unsubscribe(const std::shared_ptr<Subscription>& subscription);
+
+    /**
+     * Tries to attach a detached subscription, queueing any retained entries newer than its
+     * position. If no other subscription is attached, the buffer is repositioned at the
+     * subscription's position. Returns whether the subscription is attached afterwards; it stays
+     * detached if its position is older than the retained entries or if its queue overflows
+     * while catching up.
+     */
+    bool attach(OperationContext* opCtx, Subscription* subscription, const Limits& limits);
+
+    /**
+     * Reads the next entries through 'fetch' and fans them out to the attached subscriptions. If
+     * another refill is already in progress, waits for it instead. A failed fetch detaches every
+     * subscription and discards the retained entries.
+     */
+    StatusWith<RefillResult> refill(OperationContext* opCtx,
+                                    const FetchFn& fetch,
+                                    const Limits& limits);
+
+    size_t getBufferedBytes() const;
+
+private:
+    void _waitForRefill_inlock(OperationContext* opCtx, stdx::unique_lock<stdx::mutex>& lk);
+
+    void _reposition_inlock(Timestamp ts);
+
+    mutable stdx::mutex _mutex;
+    stdx::condition_variable _refillDone;
+    bool _refilling = false;
+
+    struct FilterGroup {
+        BSONObj filterObj;
+        std::string ns;
+        std::shared_ptr<const MatchExpression> filter;
+        std::vector<std::shared_ptr<Subscription>> subscriptions;
+    };
+
+    std::vector<FilterGroup> _groups;
+
+    // The buffer holds every oplog entry in ('_coveredAfter', '_readThrough'].
+    std::deque<EntryPtr> _buffer;
+    size_t _bufferBytes = 0;
+    Timestamp _coveredAfter;
+    Timestamp _readThrough;
+    BSONObj _lastRead;
+};
+
+}  // namespace mongo
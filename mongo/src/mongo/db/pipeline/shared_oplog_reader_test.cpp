@@ -0,0 +1,261 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/shared_oplog_reader.h"
+
+#include "mongo/bson/bsonmisc.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/matcher/expression_parser.h"
+#include "mongo/db/pipeline/expression_context_for_test.h"
+#include "mongo/db/query/query_test_service_context.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+const NamespaceString kNss("test.coll");
+const NamespaceString kOtherNss("test.other");
+const SharedOplogReader::Limits kDefaultLimits{1024 * 1024, 1024 * 1024};
+
+BSONObj makeOplogEntry(unsigned secs, const NamespaceString& nss, StringData op = "i") {
+    return BSON("ts" << Timestamp(secs, 0) << "h" << static_cast<long long>(secs) << "op" << op
+                     << "ns"
+                     << nss.ns()
+                     << "o"
+                     << BSON("_id" << static_cast<int>(secs)));
+}
+
+class SharedOplogReaderTest : public unittest::Test {
+protected:
+    SharedOplogReaderTest() : _opCtx(_serviceContext.makeOperationContext()) {}
+
+    OperationContext* opCtx() {
+        return _opCtx.get();
+    }
+
+    std::shared_ptr<SharedOplogReader::Subscription> subscribe(const BSONObj& filter,
+                                                               const NamespaceString& nss,
+                                                               Timestamp startAfter) {
+        auto expr = uassertStatusOK(
+            MatchExpressionParser::parse(filter, new ExpressionContextForTest()));
+        return reader.subscribe(filter, std::move(expr), nss, startAfter);
+    }
+
+    std::shared_ptr<SharedOplogReader::Subscription> subscribeToNss(const NamespaceString& nss,
+                                                                    Timestamp startAfter) {
+        return subscribe(BSON("ns" << nss.ns()), nss, startAfter);
+    }
+
+    /**
+     * Returns a FetchFn serving 'oplog', which counts its calls in 'fetches'.
+     */
+    SharedOplogReader::FetchFn fetchFrom(const std::vector<BSONObj>& oplog) {
+        return [this, oplog](Timestamp after, const BSONObj&) {
+            ++fetches;
+            std::vector<BSONObj> entries;
+            for (auto&& entry : oplog) {
+                if (entry["ts"].timestamp() > after) {
+                    entries.push_back(entry);
+                }
+            }
+            return StatusWith<std::vector<BSONObj>>(std::move(entries));
+        };
+    }
+
+    static std::vector<Timestamp> drainTimestamps(SharedOplogReader::Subscription* subscription) {
+        Timestamp scannedThrough;
+        std::vector<Timestamp> timestamps;
+        for (auto&& entry : subscription->drain(&scannedThrough)) {
+            timestamps.push_back(entry->ts);
+        }
+        return timestamps;
+    }
+
+    SharedOplogReader reader;
+    int fetches = 0;
+
+private:
+    QueryTestServiceContext _serviceContext;
+    ServiceContext::UniqueOperationContext _opCtx;
+};
+
+TEST_F(SharedOplogReaderTest, SingleReadIsFannedOutToEachMatchingSubscription) {
+    auto first = subscribeToNss(kNss, Timestamp(1, 0));
+    auto second = subscribeToNss(kOtherNss, Timestamp(1, 0));
+    ASSERT_TRUE(reader.attach(opCtx(), first.get(), kDefaultLimits));
+    ASSERT_TRUE(reader.attach(opCtx(), second.get(), kDefaultLimits));
+
+    auto result = uassertStatusOK(reader.refill(opCtx(),
+                                                fetchFrom({makeOplogEntry(2, kNss),
+                                                           makeOplogEntry(3, kOtherNss),
+                                                           makeOplogEntry(4, kNss)}),
+                                                kDefaultLimits));
+    ASSERT_TRUE(result.performed);
+    ASSERT_EQ(result.entriesRead, 3U);
+    ASSERT_EQ(fetches, 1);
+
+    ASSERT(drainTimestamps(first.get()) ==
+           std::vector<Timestamp>({Timestamp(2, 0), Timestamp(4, 0)}));
+    ASSERT(drainTimestamps(second.get()) == std::vector<Timestamp>({Timestamp(3, 0)}));
+    ASSERT_EQ(first->getScannedThrough(), Timestamp(4, 0));
+    ASSERT_EQ(second->getScannedThrough(), Timestamp(4, 0));
+}
+
+TEST_F(SharedOplogReaderTest, SubscriptionsWithTheSameFilterShareItsEvaluationAndEntries) {
+    auto first = subscribeToNss(kNss, Timestamp(1, 0));
+    auto second = subscribeToNss(kNss, Timestamp(2, 0));
+    auto other = subscribeToNss(kOtherNss, Timestamp(1, 0));
+    ASSERT_TRUE(reader.attach(opCtx(), first.get(), kDefaultLimits));
+    ASSERT_TRUE(reader.attach(opCtx(), second.get(), kDefaultLimits));
+    ASSERT_TRUE(reader.attach(opCtx(), other.get(), kDefaultLimits));
+
+    auto result = uassertStatusOK(reader.refill(opCtx(),
+                                                fetchFrom({makeOplogEntry(2, kNss),
+                                                           makeOplogEntry(3, kOtherNss),
+                                                           makeOplogEntry(4, kNss)}),
+                                                kDefaultLimits));
+
+    // The filter on kNss is evaluated once for each of its two entries, not once per
+    // subscription, and the filter on kOtherNss once for its entry.
+    ASSERT_EQ(result.filterEvaluations, 3U);
+
+    Timestamp scannedThrough;
+    auto firstEntries = first->drain(&scannedThrough);
+    auto secondEntries = second->drain(&scannedThrough);
+    ASSERT_EQ(firstEntries.size(), 2U);
+    ASSERT_EQ(secondEntries.size(), 1U);
+    ASSERT_EQ(firstEntries.back().get(), secondEntries.front().get());
+    ASSERT(drainTimestamps(other.get()) == std::vector<Timestamp>({Timestamp(3, 0)}));
+
+    reader.unsubscribe(first);
+    reader.unsubscribe(second);
+    reader.unsubscribe(other);
+}
+
+TEST_F(SharedOplogReaderTest, CommandEntriesAreEvaluatedForEveryNamespace) {
+    auto subscription = subscribe(BSON("op"
+                                       << "c"),
+                                  kNss,
+                                  Timestamp(1, 0));
+    ASSERT_TRUE(reader.attach(opCtx(), subscription.get(), kDefaultLimits));
+
+    uassertStatusOK(reader.refill(opCtx(),
+                                  fetchFrom({makeOplogEntry(2, kOtherNss),
+                                             makeOplogEntry(3, kOtherNss.getCommandNS(), "c")}),
+                                  kDefaultLimits));
+    ASSERT(drainTimestamps(subscription.get()) == std::vector<Timestamp>({Timestamp(3, 0)}));
+}
+
+TEST_F(SharedOplogReaderTest, NewSubscriptionCatchesUpFromBufferWithoutFetching) {
+    auto first = subscribeToNss(kNss, Timestamp(1, 0));
+    ASSERT_TRUE(reader.attach(opCtx(), first.get(), kDefaultLimits));
+    uassertStatusOK(reader.refill(
+        opCtx(),
+        fetchFrom({makeOplogEntry(2, kNss), makeOplogEntry(3, kNss), makeOplogEntry(4, kNss)}),
+        kDefaultLimits));
+    ASSERT_EQ(fetches, 1);
+
+    auto second = subscribeToNss(kNss, Timestamp(2, 0));
+    ASSERT_TRUE(reader.attach(opCtx(), second.get(), kDefaultLimits));
+    ASSERT_EQ(fetches, 1);
+    ASSERT(drainTimestamps(second.get()) ==
+           std::vector<Timestamp>({Timestamp(3, 0), Timestamp(4, 0)}));
+}
+
+TEST_F(SharedOplogReaderTest, SubscriptionOlderThanBufferStaysDetached) {
+    auto first = subscribeToNss(kNss, Timestamp(1, 0));
+    const SharedOplogReader::Limits limits{1, 1024 * 1024};
+    ASSERT_TRUE(reader.attach(opCtx(), first.get(), limits));
+    uassertStatusOK(reader.refill(
+        opCtx(), fetchFrom({makeOplogEntry(2, kNss), makeOplogEntry(3, kNss)}), limits));
+    ASSERT_EQ(reader.getBufferedBytes(), 0U);
+
+    auto second = subscribeToNss(kNss, Timestamp(1, 0));
+    ASSERT_FALSE(reader.attach(opCtx(), second.get(), limits));
+    ASSERT_FALSE(second->isAttached());
+
+    // Once it has caught up on its own, it can attach.
+    second->advance(Timestamp(3, 0));
+    ASSERT_TRUE(reader.attach(opCtx(), second.get(), limits));
+}
+
+TEST_F(SharedOplogReaderTest, SlowSubscriptionIsDetachedWithoutAffectingOthers) {
+    const auto entrySize = static_cast<size_t>(makeOplogEntry(2, kNss).objsize());
+    const SharedOplogReader::Limits limits{1024 * 1024, entrySize};
+    auto slow = subscribeToNss(kNss, Timestamp(1, 0));
+    auto other = subscribeToNss(kNss, Timestamp(1, 0));
+    ASSERT_TRUE(reader.attach(opCtx(), slow.get(), limits));
+    ASSERT_TRUE(reader.attach(opCtx(), other.get(), limits));
+
+    auto result = uassertStatusOK(
+        reader.refill(opCtx(), fetchFrom({makeOplogEntry(2, kNss)}), limits));
+    ASSERT_EQ(result.subscriptionsDetached, 0U);
+    ASSERT(drainTimestamps(other.get()) == std::vector<Timestamp>({Timestamp(2, 0)}));
+
+    result = uassertStatusOK(reader.refill(
+        opCtx(), fetchFrom({makeOplogEntry(2, kNss), makeOplogEntry(3, kNss)}), limits));
+    ASSERT_EQ(result.subscriptionsDetached, 1U);
+    ASSERT_FALSE(slow->isAttached());
+    ASSERT_EQ(slow->getScannedThrough(), Timestamp(2, 0));
+    ASSERT_TRUE(other->isAttached());
+    ASSERT(drainTimestamps(other.get()) == std::vector<Timestamp>({Timestamp(3, 0)}));
+
+    // After draining, the slow subscription catches up from the buffer.
+    ASSERT(drainTimestamps(slow.get()) == std::vector<Timestamp>({Timestamp(2, 0)}));
+    ASSERT_TRUE(reader.attach(opCtx(), slow.get(), limits));
+    ASSERT(drainTimestamps(slow.get()) == std::vector<Timestamp>({Timestamp(3, 0)}));
+}
+
+TEST_F(SharedOplogReaderTest, FailedFetchDetachesEverySubscription) {
+    auto subscription = subscribeToNss(kNss, Timestamp(1, 0));
+    ASSERT_TRUE(reader.attach(opCtx(), subscription.get(), kDefaultLimits));
+
+    auto swResult = reader.refill(opCtx(),
+                                  [](Timestamp, const BSONObj&) {
+                                      return StatusWith<std::vector<BSONObj>>(
+                                          ErrorCodes::CappedPositionLost, "position lost");
+                                  },
+                                  kDefaultLimits);
+    ASSERT_EQ(swResult.getStatus(), ErrorCodes::CappedPositionLost);
+    ASSERT_FALSE(subscription->isAttached());
+}
+
+TEST_F(SharedOplogReaderTest, RefillWithoutAttachedSubscriptionsDoesNotFetch) {
+    auto subscription = subscribeToNss(kNss, Timestamp(1, 0));
+    auto result = uassertStatusOK(
+        reader.refill(opCtx(), fetchFrom({makeOplogEntry(2, kNss)}), kDefaultLimits));
+    ASSERT_FALSE(result.performed);
+    ASSERT_EQ(fetches, 0);
+
+    reader.unsubscribe(subscription);
+}
+
+}  // namespace
+}  // namespace mongo
@@ -124,5 +124,9 @@ public:
                                                    boost::optional<BSONObj> readConcern) {
         MONGO_UNREACHABLE;
     }
+
+    bool setShouldWaitForInserts(bool shouldWait) override {
+        MONGO_UNREACHABLE;
+    }
 };
 }  // namespace mongo
@@ -50,11 +50,27 @@ const char kInternalLatestOplogTimestampField[] = "$_internalLatestOplogTimestam
 }  // namespace
 
 CursorResponseBuilder::CursorResponseBuilder(bool isInitialResponse,
-                                             BSONObjBuilder* commandResponse)
+                                             BSONObjBuilder* commandResponse,
+                                             MessageSegmentSink* segmentSink)
     : _responseInitialLen(commandResponse->bb().len()),
       _commandResponse(commandResponse),
       _cursorObject(commandResponse->subobjStart(kCursorField)),
-      _batch(_cursorObject.subarrayStart(isInitialResponse ? kBatchFieldInitial : kBatchField)) {}
+      _batch(_cursorObject.subarrayStart(isInitialResponse ? kBatchFieldInitial : kBatchField)),
+      _segmentSink(segmentSink && segmentSink->buildsInto(commandResponse->bb()) ? segmentSink
+                                                                                 : nullptr),
+      _minSegmentBytes(_segmentSink ? _segmentSink->minSegmentBytes() : 0) {}
+
+void CursorResponseBuilder::_appendSegment(const BSONObj& obj) {
+    // The batch holds an empty object in place of 'obj', which the sink sends instead.
+    _batch.append(BSONObj());
+    const int placeholderOffset = _commandResponse->bb().len() - BSONObj::kMinBSONLength;
+    _segmentSink->addSegment({placeholderOffset,
+                              BSONObj::kMinBSONLength,
+                              obj.sharedBuffer(),
+                              obj.objdata(),
+                              obj.objsize()});
+    _segmentGrowth += obj.objsize() - BSONObj::kMinBSONLength;
+}
 
 void CursorResponseBuilder::done(CursorId cursorId, StringData cursorNamespace) {
     invariant(_active);
@@ -72,6 +88,9 @@ void CursorResponseBuilder::abandon() {
     invariant(_active);
     _batch.doneFast();
     _cursorObject.doneFast();
+    if (_segmentSink) {
+        _segmentSink->discardSegmentsFrom(_responseInitialLen);
+    }
     _commandResponse->bb().setlen(_responseInitialLen);  // Removes everything we've added.
     _active = false;
 }
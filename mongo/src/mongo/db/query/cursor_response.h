@@ -35,6 +35,7 @@
 #include "mongo/bson/bsonobj.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/util/net/message.h"
 
 namespace mongo {
 
@@ -53,8 +54,14 @@ public:
      *
      * If the builder goes out of scope without a call to done(), any data appended to the
      * builder will be removed.
+     *
+     * If 'segmentSink' is given and builds the message 'commandResponse' appends to, owned
+     * documents of at least its minSegmentBytes() are added to the batch as segments rather than
+     * copied.
      */
-    CursorResponseBuilder(bool isInitialResponse, BSONObjBuilder* commandResponse);
+    CursorResponseBuilder(bool isInitialResponse,
+                          BSONObjBuilder* commandResponse,
+                          MessageSegmentSink* segmentSink = nullptr);
 
     ~CursorResponseBuilder() {
         if (_active)
@@ -63,11 +70,15 @@ public:
 
     size_t bytesUsed() const {
         invariant(_active);
-        return _batch.len();
+        return _batch.len() + _segmentGrowth;
     }
 
     void append(const BSONObj& obj) {
         invariant(_active);
+        if (_segmentSink && obj.isOwned() && obj.objsize() >= _minSegmentBytes) {
+            _appendSegment(obj);
+            return;
+        }
         _batch.append(obj);
     }
 
@@ -89,12 +100,20 @@ public:
     void abandon();
 
 private:
+    void _appendSegment(const BSONObj& obj);
+
     const int _responseInitialLen;  // Must be the first member so its initializer runs first.
     bool _active = true;
     BSONObjBuilder* const _commandResponse;
     BSONObjBuilder _cursorObject;
     BSONArrayBuilder _batch;
     Timestamp _latestOplogTimestamp;
+
+    MessageSegmentSink* const _segmentSink;
+    const int _minSegmentBytes;
+
+    // How many more bytes the batch takes on the wire than in '_batch'.
+    int _segmentGrowth = 0;
 };
 
 /**
@@ -30,7 +30,10 @@
 
 #include "mongo/db/query/cursor_response.h"
 
+#include <string>
+
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/net/op_msg.h"
 
 namespace mongo {
 
@@ -330,6 +333,83 @@ TEST(CursorResponseTest, serializeLatestOplogEntry) {
     ASSERT_EQ(*reparsedResponse.getLastOplogTimestamp(), Timestamp(1, 2));
 }
 
+TEST(CursorResponseBuilderTest, LargeOwnedDocumentsAreSentAsSegments) {
+    const BSONObj small = BSON("_id" << 1);
+    const BSONObj large = BSON("_id" << 2 << "s" << std::string(100, 'x'));
+    const BSONObj unowned(large.objdata());
+    ASSERT_FALSE(unowned.isOwned());
+
+    OpMsgBuilder msgBuilder;
+    msgBuilder.enableSegments(64);
+    {
+        auto body = msgBuilder.beginBody();
+        CursorResponseBuilder batch(true, &body, &msgBuilder);
+        batch.append(small);
+        batch.append(large);
+        batch.append(unowned);
+
+        // The reply limit counts the bytes the segment adds on the wire.
+        ASSERT_EQ(batch.bytesUsed(),
+                  static_cast<size_t>(body.bb().len() + large.objsize() -
+                                      BSONObj::kMinBSONLength));
+        batch.done(CursorId(0), "db.coll");
+        body.append("ok", 1);
+    }
+
+    auto msg = msgBuilder.finish();
+    ASSERT_EQ(msg.segments().size(), 1U);
+    ASSERT_EQ(static_cast<const void*>(msg.segments()[0].data), large.objdata());
+
+    msg.makeContiguous();
+    auto result = CursorResponse::parseFromBSON(OpMsg::parse(msg).body);
+    ASSERT_OK(result.getStatus());
+    const auto& docs = result.getValue().getBatch();
+    ASSERT_EQ(docs.size(), 3U);
+    ASSERT_BSONOBJ_EQ(docs[0], small);
+    ASSERT_BSONOBJ_EQ(docs[1], large);
+    ASSERT_BSONOBJ_EQ(docs[2], large);
+}
+
+TEST(CursorResponseBuilderTest, AbandonDiscardsSegments) {
+    const BSONObj large = BSON("_id" << 1 << "s" << std::string(100, 'x'));
+
+    OpMsgBuilder msgBuilder;
+    msgBuilder.enableSegments(64);
+    {
+        auto body = msgBuilder.beginBody();
+        {
+            CursorResponseBuilder batch(true, &body, &msgBuilder);
+            batch.append(large);
+        }
+        body.append("ok", 1);
+    }
+
+    auto msg = msgBuilder.finish();
+    ASSERT_TRUE(msg.isContiguous());
+    ASSERT_BSONOBJ_EQ(OpMsg::parse(msg).body, BSON("ok" << 1));
+}
+
+TEST(CursorResponseBuilderTest, CopiesIntoBuildersOfOtherMessages) {
+    const BSONObj large = BSON("_id" << 1 << "s" << std::string(100, 'x'));
+
+    OpMsgBuilder msgBuilder;
+    msgBuilder.enableSegments(64);
+    msgBuilder.beginBody();
+
+    BSONObjBuilder response;
+    {
+        CursorResponseBuilder batch(true, &response, &msgBuilder);
+        batch.append(large);
+        batch.done(CursorId(0), "db.coll");
+    }
+    response.append("ok", 1);
+
+    auto result = CursorResponse::parseFromBSON(response.obj());
+    ASSERT_OK(result.getStatus());
+    ASSERT_EQ(result.getValue().getBatch().size(), 1U);
+    ASSERT_BSONOBJ_EQ(result.getValue().getBatch()[0], large);
+}
+
 }  // namespace
 
 }  // namespace mongo
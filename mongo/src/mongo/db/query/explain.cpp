@@ -361,6 +361,7 @@ void Explain::statsToBSON(const PlanStageStats& stats,
         if (verbosity >= ExplainOptions::Verbosity::kExecStats) {
             bob->appendNumber("memUsage", spec->memUsage);
             bob->appendNumber("memLimit", spec->memLimit);
+            bob->appendNumber("seenMemUsage", spec->seenMemUsage);
 
             bob->appendNumber("flaggedButPassed", spec->flaggedButPassed);
             bob->appendNumber("flaggedInProgress", spec->flaggedInProgress);
@@ -528,6 +529,7 @@ void Explain::statsToBSON(const PlanStageStats& stats,
             bob->appendNumber("seeks", spec->seeks);
             bob->appendNumber("dupsTested", spec->dupsTested);
             bob->appendNumber("dupsDropped", spec->dupsDropped);
+            bob->appendNumber("dupsMemUsage", spec->dupsMemUsage);
             bob->appendNumber("seenInvalidated", spec->seenInvalidated);
         }
     } else if (STAGE_OR == stats.stageType) {
@@ -536,6 +538,7 @@ void Explain::statsToBSON(const PlanStageStats& stats,
         if (verbosity >= ExplainOptions::Verbosity::kExecStats) {
             bob->appendNumber("dupsTested", spec->dupsTested);
             bob->appendNumber("dupsDropped", spec->dupsDropped);
+            bob->appendNumber("dupsMemUsage", spec->dupsMemUsage);
             bob->appendNumber("recordIdsForgotten", spec->recordIdsForgotten);
         }
     } else if (STAGE_LIMIT == stats.stageType) {
@@ -550,6 +553,13 @@ void Explain::statsToBSON(const PlanStageStats& stats,
         if (verbosity >= ExplainOptions::Verbosity::kExecStats) {
             bob->appendNumber("chunkSkips", spec->chunkSkips);
         }
+    } else if (STAGE_PIPELINE_GROUP == stats.stageType) {
+        PipelineGroupStats* spec = static_cast<PipelineGroupStats*>(stats.specific.get());
+        bob->append("groupSpec", spec->groupSpec);
+
+        if (verbosity >= ExplainOptions::Verbosity::kExecStats) {
+            bob->appendNumber("nGroups", spec->nGroups);
+        }
     } else if (STAGE_SKIP == stats.stageType) {
         SkipStats* spec = static_cast<SkipStats*>(stats.specific.get());
         bob->appendNumber("skipAmount", spec->skip);
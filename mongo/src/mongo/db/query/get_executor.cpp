@@ -1607,31 +1607,36 @@ StatusWith<unique_ptr<PlanExecutor, PlanExecutor::Deleter>> getExecutorCount(
 // Distinct hack
 //
 
-bool turnIxscanIntoDistinctIxscan(QuerySolution* soln, const string& field) {
+bool turnIxscanIntoDistinctIxscan(QuerySolution* soln,
+                                  const string& field,
+                                  bool strictDistinctOnly) {
     QuerySolutionNode* root = soln->root.get();
 
     // Solution must have a filter.
-    if (soln->filterData.isEmpty()) {
+    if (!strictDistinctOnly && soln->filterData.isEmpty()) {
         return false;
     }
 
-    // Root stage must be a project.
-    if (STAGE_PROJECTION != root->getType()) {
+    // Root stage must be a project. When the results must be strictly distinct, a fetch with no
+    // projection above it is also allowed, since it is left in place.
+    QuerySolutionNode* projectionChild = root;
+    if (STAGE_PROJECTION == root->getType()) {
+        projectionChild = root->children[0];
+    } else if (!strictDistinctOnly || STAGE_FETCH != root->getType()) {
         return false;
     }
 
     // Child should be either an ixscan or fetch.
-    if (STAGE_IXSCAN != root->children[0]->getType() &&
-        STAGE_FETCH != root->children[0]->getType()) {
+    if (STAGE_IXSCAN != projectionChild->getType() && STAGE_FETCH != projectionChild->getType()) {
         return false;
     }
 
     IndexScanNode* indexScanNode = nullptr;
     FetchNode* fetchNode = nullptr;
-    if (STAGE_IXSCAN == root->children[0]->getType()) {
-        indexScanNode = static_cast<IndexScanNode*>(root->children[0]);
+    if (STAGE_IXSCAN == projectionChild->getType()) {
+        indexScanNode = static_cast<IndexScanNode*>(projectionChild);
     } else {
-        fetchNode = static_cast<FetchNode*>(root->children[0]);
+        fetchNode = static_cast<FetchNode*>(projectionChild);
         // If the fetch has a filter, we're out of luck. We can't skip all keys with a given value,
         // since one of them may key a document that passes the filter.
         if (fetchNode->filter) {
@@ -1669,6 +1674,20 @@ bool turnIxscanIntoDistinctIxscan(QuerySolution* soln, const string& field) {
         }
         ++fieldNo;
     }
+    if (fieldNo == indexScanNode->index.keyPattern.nFields()) {
+        return false;
+    }
+
+    // The distinct scan only skips keys which share the values of all the preceding index fields,
+    // so a value may be returned once for every combination of them unless each is a single point.
+    if (strictDistinctOnly) {
+        for (int i = 0; i < fieldNo; ++i) {
+            const auto& intervals = indexScanNode->bounds.fields[i].intervals;
+            if (intervals.size() != 1 || !intervals[0].isPoint()) {
+                return false;
+            }
+        }
+    }
 
     // We should not use a distinct scan if the field over which we are computing the distinct is
     // multikey.
@@ -1692,7 +1711,12 @@ bool turnIxscanIntoDistinctIxscan(QuerySolution* soln, const string& field) {
     distinctNode->bounds = indexScanNode->bounds;
     distinctNode->fieldNo = fieldNo;
 
-    if (fetchNode) {
+    if (fetchNode && strictDistinctOnly) {
+        // Any projection was requested by the caller rather than added for the distinct command,
+        // so it is kept. The FETCH=>IXSCAN part of the tree becomes FETCH=>DISTINCT_SCAN.
+        std::unique_ptr<IndexScanNode> ownedIsn(indexScanNode);
+        fetchNode->children[0] = distinctNode.release();
+    } else if (fetchNode) {
         // If there is a fetch node, then there is no need for the projection. The fetch node should
         // become the new root, with the distinct as its child. The PROJECT=>FETCH=>IXSCAN tree
         // should become FETCH=>DISTINCT_SCAN.
@@ -1909,4 +1933,71 @@ StatusWith<unique_ptr<PlanExecutor, PlanExecutor::Deleter>> getExecutorDistinct(
     return getExecutor(opCtx, collection, parsedDistinct->releaseQuery(), yieldPolicy);
 }
 
+StatusWith<unique_ptr<PlanExecutor, PlanExecutor::Deleter>> getExecutorDistinctFirst(
+    OperationContext* opCtx,
+    Collection* collection,
+    unique_ptr<CanonicalQuery> canonicalQuery,
+    const std::string& field,
+    PlanExecutor::YieldPolicy yieldPolicy,
+    size_t plannerOptions) {
+    if (!collection) {
+        return {ErrorCodes::BadValue, "no collection to scan for distinct values"};
+    }
+
+    // A shard filter would discard an orphaned first document without the scan then going back
+    // for the next document with the same value, so that value would be lost.
+    if (ShardingState::get(opCtx)->needCollectionMetadata(opCtx, canonicalQuery->ns())) {
+        return {ErrorCodes::BadValue,
+                "cannot use a distinct scan on a collection which requires shard filtering"};
+    }
+
+    QueryPlannerParams plannerParams;
+    plannerParams.options = plannerOptions | QueryPlannerParams::NO_TABLE_SCAN;
+    fillOutPlannerParams(opCtx, collection, canonicalQuery.get(), &plannerParams);
+
+    if (canonicalQuery->getQueryRequest().getCollation().isEmpty() &&
+        collection->getDefaultCollator()) {
+        canonicalQuery->setCollator(collection->getDefaultCollator()->clone());
+    }
+
+    vector<QuerySolution*> rawSolutions;
+    Status status = QueryPlanner::plan(*canonicalQuery, plannerParams, &rawSolutions);
+    vector<unique_ptr<QuerySolution>> solutions;
+    for (auto rawSolution : rawSolutions) {
+        solutions.emplace_back(rawSolution);
+    }
+    if (!status.isOK()) {
+        return status;
+    }
+
+    for (auto&& solution : solutions) {
+        if (!turnIxscanIntoDistinctIxscan(solution.get(), field, true)) {
+            continue;
+        }
+
+        unique_ptr<WorkingSet> ws = make_unique<WorkingSet>();
+        PlanStage* rawRoot;
+        verify(
+            StageBuilder::build(opCtx, collection, *canonicalQuery, *solution, ws.get(), &rawRoot));
+        unique_ptr<PlanStage> root(rawRoot);
+
+        LOG(2) << "Using distinct scan for the first document of each value of '" << field
+               << "': " << redact(canonicalQuery->toStringShort())
+               << ", planSummary: " << redact(Explain::getPlanSummary(root.get()));
+
+        return PlanExecutor::make(opCtx,
+                                  std::move(ws),
+                                  std::move(root),
+                                  std::move(solution),
+                                  std::move(canonicalQuery),
+                                  collection,
+                                  yieldPolicy);
+    }
+
+    return {ErrorCodes::BadValue,
+            str::stream() << "no plan can skip to the next value of '" << field
+                          << "' for query: "
+                          << redact(canonicalQuery->toStringShort())};
+}
+
 }  // namespace mongo
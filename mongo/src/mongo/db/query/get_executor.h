@@ -100,8 +100,13 @@ StatusWith<std::unique_ptr<PlanExecutor, PlanExecutor::Deleter>> getExecutorFind
  *
  * If the provided solution could be mutated successfully, returns true, otherwise returns
  * false.
+ *
+ * If 'strictDistinctOnly' is true, the solution is only mutated if the DistinctNode will return
+ * each value of 'field' exactly once, and any projection in the solution is preserved.
  */
-bool turnIxscanIntoDistinctIxscan(QuerySolution* soln, const std::string& field);
+bool turnIxscanIntoDistinctIxscan(QuerySolution* soln,
+                                  const std::string& field,
+                                  bool strictDistinctOnly = false);
 
 /*
  * Get an executor for a query executing as part of a distinct command.
@@ -117,6 +122,23 @@ StatusWith<std::unique_ptr<PlanExecutor, PlanExecutor::Deleter>> getExecutorDist
     ParsedDistinct* parsedDistinct,
     PlanExecutor::YieldPolicy yieldPolicy);
 
+/**
+ * Get an executor for a query which only needs the first result, in the query's sort order, for
+ * each distinct value of 'field'. For example, an aggregation whose $sort is followed by a $group
+ * on 'field' with only $first accumulators. The executor uses a DISTINCT_SCAN which skips from the
+ * first index key of each value straight to the next value, so only one document is fetched per
+ * value instead of one per matching document.
+ *
+ * Returns a non-OK status if there is no index which can provide such a plan.
+ */
+StatusWith<std::unique_ptr<PlanExecutor, PlanExecutor::Deleter>> getExecutorDistinctFirst(
+    OperationContext* opCtx,
+    Collection* collection,
+    std::unique_ptr<CanonicalQuery> canonicalQuery,
+    const std::string& field,
+    PlanExecutor::YieldPolicy yieldPolicy,
+    size_t plannerOptions = QueryPlannerParams::DEFAULT);
+
 /*
  * Get a PlanExecutor for a query executing as part of a count command.
  *
@@ -315,6 +315,13 @@ PlanStage* PlanExecutor::getRootStage() const {
     return _root.get();
 }
 
+void PlanExecutor::wrapRootStage(
+    stdx::function<std::unique_ptr<PlanStage>(std::unique_ptr<PlanStage>)> makeRoot) {
+    invariant(!_everDetachedFromOperationContext && _currentState == kUsable);
+    _root = makeRoot(std::move(_root));
+    invariant(_root);
+}
+
 CanonicalQuery* PlanExecutor::getCanonicalQuery() const {
     return _cq.get();
 }
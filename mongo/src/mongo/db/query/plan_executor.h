@@ -37,6 +37,7 @@
 #include "mongo/db/query/query_solution.h"
 #include "mongo/db/storage/snapshot.h"
 #include "mongo/platform/unordered_set.h"
+#include "mongo/stdx/functional.h"
 
 namespace mongo {
 
@@ -261,6 +262,14 @@ public:
      */
     PlanStage* getRootStage() const;
 
+    /**
+     * Replaces the stage tree with the one returned by 'makeRoot', which is given ownership of the
+     * current tree. The new stages must use this executor's WorkingSet. Must only be called before
+     * any results have been requested from the executor.
+     */
+    void wrapRootStage(
+        stdx::function<std::unique_ptr<PlanStage>(std::unique_ptr<PlanStage>)> makeRoot);
+
     /**
      * Get the query that this executor is executing, without transferring ownership.
      */
@@ -542,10 +542,26 @@ bool QueryPlannerAccess::orNeedsFetch(const ScanBuildingState* scanState) {
     } else if (scanState->loosestBounds == IndexBoundsBuilder::INEXACT_FETCH) {
         return true;
     } else {
+        // Predicates over multikey paths are recorded as INEXACT_FETCH by handleFilterOr(), so
+        // every INEXACT_COVERED predicate here can be evaluated against the index keys.
         invariant(scanState->loosestBounds == IndexBoundsBuilder::INEXACT_COVERED);
-        const IndexEntry& index = scanState->indices[scanState->currentIndexNumber];
-        return index.multikey;
+        return false;
+    }
+}
+
+// static
+bool QueryPlannerAccess::canUseCoveredFilter(const IndexEntry& index, size_t pos) {
+    if (!index.multikey) {
+        return true;
     }
+
+    // Without path-level multikey metadata we must assume that every field is multikey.
+    if (index.multikeyPaths.empty()) {
+        return false;
+    }
+
+    invariant(pos < index.multikeyPaths.size());
+    return index.multikeyPaths[pos].empty();
 }
 
 //scanState.currentScan QuerySolutionNodeϢֵout
@@ -1253,7 +1269,7 @@ QuerySolutionNode* QueryPlannerAccess::buildIndexedDataAccess(const CanonicalQue
             if (tightness == IndexBoundsBuilder::EXACT) {
                 return soln;
             } else if (tightness == IndexBoundsBuilder::INEXACT_COVERED &&
-                       !indices[tag->index].multikey) {
+                       canUseCoveredFilter(indices[tag->index], tag->pos)) {
                 verify(NULL == soln->filter.get());
                 soln->filter.reset(autoRoot.release());
                 return soln;
@@ -1387,8 +1403,17 @@ void QueryPlannerAccess::handleFilterOr(ScanBuildingState* scanState) {
         // for affixing later.
         ++scanState->curChild;
     } else {
-        if (scanState->tightness < scanState->loosestBounds) {
-            scanState->loosestBounds = scanState->tightness;
+        const IndexEntry& index = scanState->indices[scanState->currentIndexNumber];
+        IndexBoundsBuilder::BoundsTightness tightness = scanState->tightness;
+        if (tightness == IndexBoundsBuilder::INEXACT_COVERED &&
+            !canUseCoveredFilter(index, scanState->ixtag->pos)) {
+            // The predicate is over a multikey path, so it cannot be evaluated as a covered
+            // filter. See handleFilterAnd() for why.
+            tightness = IndexBoundsBuilder::INEXACT_FETCH;
+        }
+
+        if (tightness < scanState->loosestBounds) {
+            scanState->loosestBounds = tightness;
         }
 
         // Detach 'child' and add it to 'curOr'.
@@ -1412,18 +1437,21 @@ void QueryPlannerAccess::handleFilterAnd(ScanBuildingState* scanState) {
         root->getChildVector()->erase(root->getChildVector()->begin() + scanState->curChild);
         delete child;
     } else if (scanState->tightness == IndexBoundsBuilder::INEXACT_COVERED &&
-               (INDEX_TEXT == index.type || !index.multikey)) {
+               (INDEX_TEXT == index.type ||
+                canUseCoveredFilter(index, scanState->ixtag->pos))) {
         // The bounds are not exact, but the information needed to
         // evaluate the predicate is in the index key. Remove the
         // MatchExpression from its parent and attach it to the filter
         // of the index scan we're building.
         //
-        // We can only use this optimization if the index is NOT multikey.
-        // Suppose that we had the multikey index {x: 1} and a document
-        // {x: ["a", "b"]}. Now if we query for {x: /b/} the filter might
-        // ever only be applied to the index key "a". We'd incorrectly
+        // We can only use this optimization if the predicate's path is NOT
+        // multikey. Suppose that we had the multikey index {x: 1} and a
+        // document {x: ["a", "b"]}. Now if we query for {x: /b/} the filter
+        // might ever only be applied to the index key "a". We'd incorrectly
         // conclude that the document does not match the query :( so we
-        // gotta stick to non-multikey indices.
+        // gotta stick to non-multikey paths. Other fields of the index may
+        // still be multikey, as every index key then repeats the one value
+        // of the predicate's path.
         root->getChildVector()->erase(root->getChildVector()->begin() + scanState->curChild);
 
         addFilterToSolutionNode(scanState->currentScan.get(), child, root->matchType());
@@ -391,6 +391,14 @@ public:
      */
     static bool orNeedsFetch(const ScanBuildingState* scanState);
 
+    /**
+     * Returns true if a predicate over the 'pos'-th field of 'index' can be evaluated against the
+     * index keys. This is always the case for a non-multikey index. For a multikey index, the
+     * path-level multikey metadata must show that the field has no multikey components, so that
+     * every index key holds the document's one and only value for the field.
+     */
+    static bool canUseCoveredFilter(const IndexEntry& index, size_t pos);
+
     static void finishTextNode(QuerySolutionNode* node, const IndexEntry& index);
 
     /**
@@ -77,9 +77,33 @@ MONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceCursorBatchSizeBytes, int, 4
 
 MONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceLookupCacheSizeBytes, int, 100 * 1024 * 1024);
 
+MONGO_EXPORT_SERVER_PARAMETER(internalQueryPushDownAggregationGroup, bool, true);
+
+MONGO_EXPORT_SERVER_PARAMETER(internalQueryAggregationUseDistinctScanForFirst, bool, true);
+
+MONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceOutWriterThreads, int, 4);
+
+MONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceOutDeferIndexBuilds, bool, true);
+
+MONGO_EXPORT_SERVER_PARAMETER(internalChangeStreamUseSharedOplogReader, bool, true);
+
+MONGO_EXPORT_SERVER_PARAMETER(internalChangeStreamSharedOplogBufferBytes, int, 64 * 1024 * 1024);
+
+MONGO_EXPORT_SERVER_PARAMETER(internalChangeStreamSubscriptionBufferBytes, int, 16 * 1024 * 1024);
+
+MONGO_EXPORT_SERVER_PARAMETER(internalChangeStreamPostImageLookupBatchSize, int, 100);
+
+MONGO_EXPORT_SERVER_PARAMETER(internalChangeStreamPostImageCacheSizeBytes, int, 0);
+
+MONGO_EXPORT_SERVER_PARAMETER(internalChangeStreamPostImageCacheMaxAgeMillis, int, 1000);
+
 MONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerGenerateCoveredWholeIndexScans, bool, false);
 
 MONGO_EXPORT_SERVER_PARAMETER(internalQueryIgnoreUnknownJSONSchemaKeywords, bool, false);
 
 MONGO_EXPORT_SERVER_PARAMETER(internalQueryProhibitBlockingMergeOnMongoS, bool, false);
+
+MONGO_EXPORT_SERVER_PARAMETER(internalQueryEnableIdPointOperations, bool, true);
+
+MONGO_EXPORT_SERVER_PARAMETER(internalQueryFetchBatchSize, int, 0);
 }  // namespace mongo
@@ -129,5 +129,49 @@ extern AtomicInt32 internalDocumentSourceCursorBatchSizeBytes;
 
 extern AtomicInt32 internalDocumentSourceLookupCacheSizeBytes;
 
+// Whether a $group which directly follows the query is run within the PlanExecutor when possible.
+extern AtomicBool internalQueryPushDownAggregationGroup;
+
+// Whether a $sort followed by a $group with only $first accumulators may use a DISTINCT_SCAN.
+extern AtomicBool internalQueryAggregationUseDistinctScanForFirst;
+
+// The number of insert batches $out hands to concurrent writers at a time, at most 16.
+extern AtomicInt32 internalDocumentSourceOutWriterThreads;
+
+// Whether $out builds the secondary indexes of its temporary collection after loading it, rather
+// than maintaining them during the inserts.
+extern AtomicBool internalDocumentSourceOutDeferIndexBuilds;
+
+// Whether change stream cursors read the oplog through the node-wide shared oplog reader.
+extern AtomicBool internalChangeStreamUseSharedOplogReader;
+
+// The number of bytes of recent oplog entries retained by the shared oplog reader.
+extern AtomicInt32 internalChangeStreamSharedOplogBufferBytes;
+
+// The number of bytes of matching oplog entries the queue of any one change stream cursor may
+// refer to before it is detached from the shared oplog reader. The entries are shared with the
+// reader's buffer and the other queues, so this bounds what a lagging cursor keeps alive.
+extern AtomicInt32 internalChangeStreamSubscriptionBufferBytes;
+
+// The maximum number of change stream events read ahead so that their "updateLookup" post-images
+// can be fetched together.
+extern AtomicInt32 internalChangeStreamPostImageLookupBatchSize;
+
+// The size of the post-image cache shared by change streams on a node, or 0 to disable it.
+extern AtomicInt32 internalChangeStreamPostImageCacheSizeBytes;
+
+// How long an entry in the shared post-image cache may be reused.
+extern AtomicInt32 internalChangeStreamPostImageCacheMaxAgeMillis;
+
 extern AtomicBool internalQueryProhibitBlockingMergeOnMongoS;
+
+// Whether finds, updates and deletes on an exact _id value are served straight from the _id index
+// and record store, without canonicalizing the query or building a PlanExecutor.
+extern AtomicBool internalQueryEnableIdPointOperations;
+
+// The number of RecordIds a FETCH stage collects from its child before reading their documents
+// in RecordId order, or 0 or 1 to read each document as soon as its RecordId arrives. Batching
+// turns random reads of cold documents into ordered ones, but may read up to a batch of documents
+// which a limit above the FETCH never asks for.
+extern AtomicInt32 internalQueryFetchBatchSize;
 }  // namespace mongo
@@ -1453,6 +1453,74 @@ TEST_F(QueryPlannerTest, CanCoverNonMultikeyDottedField) {
         "bounds: {'a.y':[[1,1,true,true]],'b.z':[[2,2,true,true]]}}}}}");
 }
 
+TEST_F(QueryPlannerTest, CanAttachCoveredFilterOnNonMultikeyFieldWithPathLevelMultikeyInfo) {
+    MultikeyPaths multikeyPaths{{}, {0U}};
+    addIndex(BSON("a" << 1 << "tags" << 1), multikeyPaths);
+    runQueryAsCommand(fromjson("{find: 'testns', filter: {a: /foo/}, projection: {_id: 0, a: 1}}"));
+
+    assertNumSolutions(2U);
+    assertSolutionExists("{proj: {spec: {_id: 0, a: 1}, node: {cscan: {dir: 1}}}}");
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, a: 1}, node: {ixscan: {pattern: {a: 1, tags: 1},"
+        "filter: {a: /foo/}}}}}");
+}
+
+TEST_F(QueryPlannerTest, CannotAttachCoveredFilterOnMultikeyFieldWithPathLevelMultikeyInfo) {
+    MultikeyPaths multikeyPaths{{}, {0U}};
+    addIndex(BSON("a" << 1 << "tags" << 1), multikeyPaths);
+    runQueryAsCommand(
+        fromjson("{find: 'testns', filter: {a: 1, tags: /foo/}, projection: {_id: 0, a: 1}}"));
+
+    assertNumSolutions(2U);
+    assertSolutionExists("{proj: {spec: {_id: 0, a: 1}, node: {cscan: {dir: 1}}}}");
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, a: 1}, node: {fetch: {filter: {tags: /foo/}, node: {ixscan: "
+        "{pattern: {a: 1, tags: 1}, filter: null}}}}}}");
+}
+
+TEST_F(QueryPlannerTest, CannotAttachCoveredFilterWithoutPathLevelMultikeyInfo) {
+    const bool multikey = true;
+    addIndex(BSON("a" << 1 << "tags" << 1), multikey);
+    runQueryAsCommand(fromjson("{find: 'testns', filter: {a: /foo/}, projection: {_id: 0, a: 1}}"));
+
+    assertNumSolutions(2U);
+    assertSolutionExists("{proj: {spec: {_id: 0, a: 1}, node: {cscan: {dir: 1}}}}");
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, a: 1}, node: {fetch: {filter: {a: /foo/}, node: {ixscan: "
+        "{pattern: {a: 1, tags: 1}, filter: null}}}}}}");
+}
+
+TEST_F(QueryPlannerTest, CanCoverOrOfRegexesOnNonMultikeyFieldWithPathLevelMultikeyInfo) {
+    MultikeyPaths multikeyPaths{{}, {0U}};
+    addIndex(BSON("a" << 1 << "tags" << 1), multikeyPaths);
+    runQueryAsCommand(fromjson(
+        "{find: 'testns', filter: {$or: [{a: /foo/}, {a: /bar/}]}, projection: {_id: 0, a: 1}}"));
+
+    assertNumSolutions(2U);
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, a: 1}, node: {cscan: {dir: 1, filter: {$or: [{a: /foo/}, "
+        "{a: /bar/}]}}}}}");
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, a: 1}, node: {ixscan: {pattern: {a: 1, tags: 1}, "
+        "filter: {$or: [{a: /foo/}, {a: /bar/}]}}}}}");
+}
+
+TEST_F(QueryPlannerTest, MustFetchOrOfRegexesOnMultikeyFieldWithPathLevelMultikeyInfo) {
+    MultikeyPaths multikeyPaths{{0U}, {}};
+    addIndex(BSON("tags" << 1 << "a" << 1), multikeyPaths);
+    runQueryAsCommand(fromjson(
+        "{find: 'testns', filter: {$or: [{tags: /foo/}, {tags: /bar/}]}, "
+        "projection: {_id: 0, a: 1}}"));
+
+    assertNumSolutions(2U);
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, a: 1}, node: {cscan: {dir: 1, filter: {$or: [{tags: /foo/}, "
+        "{tags: /bar/}]}}}}}");
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, a: 1}, node: {fetch: {filter: {$or: [{tags: /foo/}, "
+        "{tags: /bar/}]}, node: {ixscan: {pattern: {tags: 1, a: 1}, filter: null}}}}}}");
+}
+
 TEST_F(QueryPlannerTest, ContainedOrElemMatchValue) {
     addIndex(BSON("b" << 1 << "a" << 1));
     addIndex(BSON("c" << 1 << "a" << 1));
@@ -378,6 +378,7 @@ PlanStage* buildStages(OperationContext* opCtx,     //
         case STAGE_MULTI_ITERATOR:
         case STAGE_MULTI_PLAN: //MultiPlanStageprepareExecution->MultiPlanStage::addPlanʼ
         case STAGE_OPLOG_START:
+        case STAGE_PIPELINE_GROUP:
         case STAGE_PIPELINE_PROXY:
         case STAGE_QUEUED_DATA:
         case STAGE_SUBPLAN:
@@ -108,15 +108,18 @@ enum StageType { //
     // Stage for running aggregation pipelines.
     STAGE_PIPELINE_PROXY, //25
 
+    // Stage for running a $group pushed down from an aggregation pipeline.
+    STAGE_PIPELINE_GROUP,
+
     STAGE_QUEUED_DATA,
     //ӦQuerySolutionNodeΪShardingFilterNodeӦstageΪShardFilterStage
     STAGE_SHARDING_FILTER,
     //ӦQuerySolutionNodeΪSkipNodeӦstageΪSkipStage
     STAGE_SKIP,
     //ӦQuerySolutionNodeΪSortNodeӦstageΪSTAGE_SORT
-    STAGE_SORT,  //29 SortStage
+    STAGE_SORT,  //30 SortStage
     //ӦQuerySolutionNodeΪSortKeyGeneratorNodeӦstageΪSortKeyGeneratorStage
-    STAGE_SORT_KEY_GENERATOR, //30  SortKeyGeneratorStage
+    STAGE_SORT_KEY_GENERATOR, //31  SortKeyGeneratorStage
     //ӦQuerySolutionNodeΪMergeSortNodeӦstageΪMergeSortStage
     STAGE_SORT_MERGE,
     //ע:STAGE_SUBPLANûжӦQuerySolutionNodeӦstageΪSubplanStage
@@ -126,7 +129,7 @@ enum StageType { //
     //ӦQuerySolutionNodeΪTextNodeӦstageΪTextStage
     STAGE_TEXT,
     STAGE_TEXT_OR,
-    STAGE_TEXT_MATCH, //35
+    STAGE_TEXT_MATCH, //36
 
     STAGE_UNKNOWN,
 
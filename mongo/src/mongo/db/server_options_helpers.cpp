@@ -821,9 +821,11 @@ Status storeServerOptions(const moe::Environment& params) {
     if (params.count("net.transportLayer")) {
         serverGlobalParams.transportLayer = params["net.transportLayer"].as<std::string>();
         if (serverGlobalParams.transportLayer != "asio" &&
-            serverGlobalParams.transportLayer != "legacy") {
+            serverGlobalParams.transportLayer != "legacy" &&
+            serverGlobalParams.transportLayer != "io_uring") {
             return {ErrorCodes::BadValue,
-                    "Unsupported value for transportLayer. Must be \"asio\" or \"legacy\""};
+                    "Unsupported value for transportLayer. Must be \"asio\", \"legacy\" or "
+                    "\"io_uring\""};
         }
     }
 
@@ -65,6 +65,7 @@
 #include "mongo/db/s/sharded_connection_info.h"
 #include "mongo/db/s/sharding_state.h"
 #include "mongo/db/server_options.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/session_catalog.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/db/stats/top.h"
@@ -79,6 +80,7 @@
 #include "mongo/rpc/reply_builder_interface.h"
 #include "mongo/s/grid.h"
 #include "mongo/s/stale_exception.h"
+#include "mongo/transport/session.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
 #include "mongo/util/net/message.h"
@@ -93,6 +95,10 @@ MONGO_FP_DECLARE(respondWithNotPrimaryInCommandDispatch);
 namespace {
 using logger::LogComponent;
 
+// Documents in cursor batches of at least this many bytes are sent from their own buffers rather
+// than copied into the reply. 0 copies every document.
+MONGO_EXPORT_SERVER_PARAMETER(replySegmentMinBytes, int, 4096);
+
 // The command names for which to check out a session.
 //
 // Note: Eval should check out a session because it defaults to running under a global write lock,
@@ -458,6 +464,16 @@ bool runCommandImpl(OperationContext* opCtx,
 
     BSONObjBuilder inPlaceReplyBob = replyBuilder->getInPlaceReplyBuilder(bytesToReserve);
 
+    // Only replies that go straight to a network session may reference documents; anything else
+    // reads the reply as a contiguous buffer.
+    auto const previousSegmentSink = Command::getReplySegmentSink(opCtx);
+    const int minSegmentBytes = replySegmentMinBytes.load();
+    const bool useSegments = minSegmentBytes > 0 && opCtx->getClient()->session() &&
+        !opCtx->getClient()->isInDirectClient();
+    Command::setReplySegmentSink(
+        opCtx, useSegments ? replyBuilder->enableSegments(minSegmentBytes) : nullptr);
+    ON_BLOCK_EXIT([&] { Command::setReplySegmentSink(opCtx, previousSegmentSink); });
+
 	//ReadConcern
     Status rcStatus = waitForReadConcern(
         opCtx, repl::ReadConcernArgs::get(opCtx), command->allowsAfterClusterTime(cmd));
@@ -539,6 +555,9 @@ bool runCommandImpl(OperationContext* opCtx,
 
         if (!linearizableReadStatus.isOK()) {
             inPlaceReplyBob.resetToEmpty();
+            if (auto segmentSink = Command::getReplySegmentSink(opCtx)) {
+                segmentSink->discardSegmentsFrom(0);
+            }
             auto result = Command::appendCommandStatus(inPlaceReplyBob, linearizableReadStatus);
             inPlaceReplyBob.doneFast();
             BSONObjBuilder metadataBob;
@@ -584,6 +603,24 @@ MONGO_FP_DECLARE(skipCheckingForNotMasterInCommandDispatch);
  */ 
 //mongosServiceEntryPointMongos::handleRequest->Strategy::clientCommand->runCommand
 //mongod:ServiceEntryPointMongod::handleRequest->runCommands->execCommandDatabase
+/**
+ * Queues the storage engine tickets of the operation under 'dbname' when fair ticket scheduling
+ * is enabled. Operations of internal clients keep queueing as internal operations, which are
+ * served first, and nested direct client operations keep the tenant of the outer operation.
+ */
+void setTicketSchedulingTenant(OperationContext* opCtx, StringData dbname) {
+    Client* client = opCtx->getClient();
+    if (client->isInDirectClient()) {
+        return;
+    }
+
+    const auto& session = client->session();
+    if (!session || (session->getTags() & transport::Session::kInternalClient)) {
+        return;
+    }
+    opCtx->lockState()->setTicketSchedulingTenant(dbname);
+}
+
 void execCommandDatabase(OperationContext* opCtx,
                          Command* command,
                          const OpMsgRequest& request,
@@ -617,6 +654,7 @@ void execCommandDatabase(OperationContext* opCtx,
             ErrorCodes::InvalidNamespace,
             str::stream() << "Invalid database name: '" << dbname << "'",
             NamespaceString::validDBName(dbname, NamespaceString::DollarInDbNameBehavior::Allow));
+        setTicketSchedulingTenant(opCtx, dbname);
 
         std::unique_ptr<MaintenanceModeSetter> mmSetter;
 
@@ -1261,6 +1299,10 @@ DbResponse ServiceEntryPointMongod::handleRequest(OperationContext* opCtx, const
         isCommand = true;
     }
 
+    if (!isCommand && ns) {
+        setTicketSchedulingTenant(opCtx, nsString.db());
+    }
+
 	//ȡӦcurrentOp
     CurOp& currentOp = *CurOp::get(opCtx);
     {
@@ -32,6 +32,7 @@
 
 #include "mongo/db/client.h"
 #include "mongo/db/commands/server_status.h"
+#include "mongo/db/concurrency/admission_control.h"
 #include "mongo/db/concurrency/lock_stats.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/operation_context.h"
@@ -136,5 +137,23 @@ public:
 
 } lockStatsServerStatusSection;
 
+
+class LoadSheddingServerStatusSection : public ServerStatusSection {
+public:
+    LoadSheddingServerStatusSection() : ServerStatusSection("loadShedding") {}
+
+    virtual bool includeByDefault() const {
+        return true;
+    }
+
+    virtual BSONObj generateSection(OperationContext* opCtx,
+                                    const BSONElement& configElement) const {
+        BSONObjBuilder ret;
+        AdmissionControl::appendStats(&ret);
+        return ret.obj();
+    }
+
+} loadSheddingServerStatusSection;
+
 }  // namespace
 }  // namespace mongo
@@ -175,6 +175,20 @@ void OperationLatencyHistogram::append(bool includeHistograms, BSONObjBuilder* b
     _append(_commands, "commands", includeHistograms, builder);
 }
 
+void OperationLatencyHistogram::_mergeData(const HistogramData& other, HistogramData* data) {
+    for (int i = 0; i < kMaxBuckets; i++) {
+        data->buckets[i] += other.buckets[i];
+    }
+    data->entryCount += other.entryCount;
+    data->sum += other.sum;
+}
+
+void OperationLatencyHistogram::merge(const OperationLatencyHistogram& other) {
+    _mergeData(other._reads, &_reads);
+    _mergeData(other._writes, &_writes);
+    _mergeData(other._commands, &_commands);
+}
+
 /*
 histogram: [
   { micros: NumberLong(1), count: NumberLong(10) },
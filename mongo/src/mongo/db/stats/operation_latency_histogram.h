@@ -67,6 +67,11 @@ public:
      */
     void append(bool includeHistograms, BSONObjBuilder* builder) const;
 
+    /**
+     * Adds the buckets and totals of 'other' to this histogram.
+     */
+    void merge(const OperationLatencyHistogram& other);
+
 private:
     struct HistogramData {
         std::array<uint64_t, kMaxBuckets> buckets{};
@@ -85,6 +90,8 @@ private:
 
     void _incrementData(uint64_t latency, int bucket, HistogramData* data);
 
+    static void _mergeData(const HistogramData& other, HistogramData* data);
+
     HistogramData _reads, _writes, _commands;
 };
 }  // namespace mongo
@@ -89,4 +89,30 @@ TEST(OperationLatencyHistogram, CheckBucketCountsAndTotalLatency) {
         ASSERT_EQUALS(bucket["count"].Long(), (i < kMaxBuckets - 1) ? 3 : 2);
     }
 }
+
+TEST(OperationLatencyHistogram, MergeMatchesSingleHistogram) {
+    OperationLatencyHistogram single;
+    OperationLatencyHistogram first;
+    OperationLatencyHistogram second;
+    for (int i = 0; i < kMaxBuckets; i++) {
+        single.increment(kLowerBounds[i], Command::ReadWriteType::kRead);
+        single.increment(kLowerBounds[i], Command::ReadWriteType::kCommand);
+        single.increment(i, Command::ReadWriteType::kWrite);
+
+        OperationLatencyHistogram& shard = (i % 2) ? first : second;
+        shard.increment(kLowerBounds[i], Command::ReadWriteType::kRead);
+        shard.increment(kLowerBounds[i], Command::ReadWriteType::kCommand);
+        shard.increment(i, Command::ReadWriteType::kWrite);
+    }
+
+    OperationLatencyHistogram merged;
+    merged.merge(first);
+    merged.merge(second);
+
+    BSONObjBuilder singleBuilder;
+    single.append(true, &singleBuilder);
+    BSONObjBuilder mergedBuilder;
+    merged.append(true, &mergedBuilder);
+    ASSERT_BSONOBJ_EQ(singleBuilder.obj(), mergedBuilder.obj());
+}
 }  // namespace mongo
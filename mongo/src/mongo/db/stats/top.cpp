@@ -33,6 +33,10 @@
 
 #include "mongo/db/stats/top.h"
 
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
 #include "mongo/db/jsobj.h"
 #include "mongo/db/service_context.h"
 #include "mongo/util/log.h"
@@ -73,6 +77,19 @@ Top::CollectionData::CollectionData(const CollectionData& older, const Collectio
       remove(older.remove, newer.remove),
       commands(older.commands, newer.commands) {}
 
+void Top::CollectionData::merge(const CollectionData& other) {
+    total.add(other.total);
+    readLock.add(other.readLock);
+    writeLock.add(other.writeLock);
+    queries.add(other.queries);
+    getmore.add(other.getmore);
+    insert.add(other.insert);
+    update.add(other.update);
+    remove.add(other.remove);
+    commands.add(other.commands);
+    opLatencyHistogram.merge(other.opLatencyHistogram);
+}
+
 // static
 Top& Top::get(ServiceContext* service) {
     return getTop(service);
@@ -96,17 +113,22 @@ void Top::record(OperationContext* opCtx,
     if (ns[0] == '?')
         return;
 
+    if ((command || logicalOp == LogicalOp::opQuery) && _hasLastDropped.load()) {
+        stdx::lock_guard<SimpleMutex> lk(_lastDroppedLock);
+        if (ns == _lastDropped) {
+            _lastDropped = "";
+            _hasLastDropped.store(false);
+            return;
+        }
+    }
+
 	//ݱMapҵñڱжӦhashλ
     auto hashedNs = UsageMap::HashedKey(ns);
-    stdx::lock_guard<SimpleMutex> lk(_lock);
+    Shard& shard = _getShard(opCtx);
+    stdx::lock_guard<SimpleMutex> lk(shard.lock);
 
-	//nsѾɾıֱӷ
-    if ((command || logicalOp == LogicalOp::opQuery) && ns == _lastDropped) {
-        _lastDropped = "";
-        return;
-    }
 	//ҵıӦCollectionData
-    CollectionData& coll = _usage[hashedNs];
+    CollectionData& coll = shard.usage[hashedNs];
 	//ʼͳ
     _record(opCtx, coll, logicalOp, lockType, micros, readWriteType);
 }
@@ -162,25 +184,49 @@ void Top::_record(OperationContext* opCtx,
 
 //ɾҪոñͳϢusageƳ
 void Top::collectionDropped(StringData ns, bool databaseDropped) {
-    stdx::lock_guard<SimpleMutex> lk(_lock);
-    _usage.erase(ns);
+    for (auto& shard : _shards) {
+        stdx::lock_guard<SimpleMutex> lk(shard.lock);
+        shard.usage.erase(ns);
+    }
+
     if (!databaseDropped) {
         // If a collection drop occurred, there will be a subsequent call to record for this
         // collection namespace which must be ignored. This does not apply to a database drop.
+        stdx::lock_guard<SimpleMutex> lk(_lastDroppedLock);
         _lastDropped = ns.toString();
+        _hasLastDropped.store(true);
     }
 }
 
 void Top::cloneMap(Top::UsageMap& out) const {
-    stdx::lock_guard<SimpleMutex> lk(_lock);
-    out = _usage;
+    out = _mergeUsage();
+}
+
+Top::Shard& Top::_getShard(OperationContext* opCtx) {
+#if defined(__linux__)
+    const int cpu = sched_getcpu();
+    if (cpu >= 0) {
+        return _shards[cpu % kNumShards];
+    }
+#endif
+    return _shards[std::hash<Client*>()(opCtx->getClient()) % kNumShards];
+}
+
+Top::UsageMap Top::_mergeUsage() const {
+    UsageMap merged;
+    for (const auto& shard : _shards) {
+        stdx::lock_guard<SimpleMutex> lk(shard.lock);
+        for (const auto& entry : shard.usage) {
+            merged[entry.first].merge(entry.second);
+        }
+    }
+    return merged;
 }
 //
 //ServiceEntryPointMongod::handleRequest->Top::incrementGlobalLatencyStatsлȡдʱͳ(db.serverStatus().opLatencies)
 //TopCommand::run->Top::appendȡϸcountʱͳ(db.runCommand( { top: 1 } ))
 void Top::append(BSONObjBuilder& b) {
-    stdx::lock_guard<SimpleMutex> lk(_lock);
-    _appendToUsageMap(b, _usage);
+    _appendToUsageMap(b, _mergeUsage());
 }
 
 //Top::append
@@ -228,9 +274,17 @@ void Top::_appendStatsEntry(BSONObjBuilder& b, const char* statsName, const Usag
 //Ķ д commandʱͳ
 void Top::appendLatencyStats(StringData ns, bool includeHistograms, BSONObjBuilder* builder) {
     auto hashedNs = UsageMap::HashedKey(ns);
-    stdx::lock_guard<SimpleMutex> lk(_lock);
+    OperationLatencyHistogram histogram;
+    for (const auto& shard : _shards) {
+        stdx::lock_guard<SimpleMutex> lk(shard.lock);
+        auto it = shard.usage.find(hashedNs);
+        if (it != shard.usage.end()) {
+            histogram.merge(it->second.opLatencyHistogram);
+        }
+    }
+
     BSONObjBuilder latencyStatsBuilder;
-    _usage[hashedNs].opLatencyHistogram.append(includeHistograms, &latencyStatsBuilder);
+    histogram.append(includeHistograms, &latencyStatsBuilder);
     builder->append("ns", ns);
     builder->append("latencyStats", latencyStatsBuilder.obj());
 }
@@ -263,15 +317,19 @@ featdoc_1:PRIMARY>
 void Top::incrementGlobalLatencyStats(OperationContext* opCtx,
                                       uint64_t latency,
                                       Command::ReadWriteType readWriteType) {
-    stdx::lock_guard<SimpleMutex> guard(_lock);
-    _incrementHistogram(opCtx, latency, &_globalHistogramStats, readWriteType);
+    Shard& shard = _getShard(opCtx);
+    stdx::lock_guard<SimpleMutex> guard(shard.lock);
+    _incrementHistogram(opCtx, latency, &shard.globalHistogramStats, readWriteType);
 }
 
 //GlobalHistogramServerStatusSectiongenerateSectionӿڵãdb.serverStatus().opLatenciesȡʱϢ
 void Top::appendGlobalLatencyStats(bool includeHistograms, BSONObjBuilder* builder) {
-    stdx::lock_guard<SimpleMutex> guard(_lock);
-	//OperationLatencyHistogram::append
-    _globalHistogramStats.append(includeHistograms, builder);
+    OperationLatencyHistogram histogram;
+    for (const auto& shard : _shards) {
+        stdx::lock_guard<SimpleMutex> guard(shard.lock);
+        histogram.merge(shard.globalHistogramStats);
+    }
+    histogram.append(includeHistograms, builder);
 }
 
 //Top::incrementGlobalLatencyStats  дʱ
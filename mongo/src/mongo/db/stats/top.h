@@ -34,9 +34,11 @@
 #include "mongo/db/commands.h"
 #include "mongo/db/operation_context.h"
 #include "mongo/db/stats/operation_latency_histogram.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/net/message.h"
 #include "mongo/util/string_map.h"
+#include "mongo/util/with_alignment.h"
 
 namespace mongo {
 
@@ -65,6 +67,11 @@ public:
             count++;
             time += micros;
         }
+
+        void add(const UsageData& other) {
+            count += other.count;
+            time += other.time;
+        }
     };
 
     //db.runCommand( { top: 1 } )еͳϢopʱ
@@ -76,6 +83,11 @@ public:
          */
         CollectionData() {}
         CollectionData(const CollectionData& older, const CollectionData& newer);
+
+        /**
+         * Adds the counters and histograms of 'other' to this.
+         */
+        void merge(const CollectionData& other);
         //ܵģ[queries,commands]
         UsageData total;
         
@@ -164,18 +176,39 @@ private:
                              OperationLatencyHistogram* histogram,
                              Command::ReadWriteType readWriteType);
 
-    mutable SimpleMutex _lock;
-    //дdb.serverStatus().opLatenciesؼбͳ ---ȫγ
-    //db.collection.latencyStats( { histograms:true})  --- γ
-    //db.collection.latencyStats( { histograms:false}) --- γ
+    /**
+     * One shard of the usage statistics. Operations record into the shard of the CPU they are
+     * running on, so the operation path only ever takes an uncontended shard mutex. Readers
+     * merge all shards. A collection has an entry only in the shards which recorded operations
+     * against it.
+     */
+    struct Shard {
+        mutable SimpleMutex lock;
+        //дdb.serverStatus().opLatenciesؼбͳ ---ȫγ
+        //db.collection.latencyStats( { histograms:true})  --- γ
+        //db.collection.latencyStats( { histograms:false}) --- γ
+        //Top._globalHistogramStatsȫ(б)Ĳʱͳ-ȫγ
+        //CollectionData.opLatencyHistogramǱĶдcommandͳ-γ
+        OperationLatencyHistogram globalHistogramStats;
+        //ÿϸqpsʱͳ   db.runCommand( { top: 1 } )ȡ
+        UsageMap usage;
+    };
+
+    enum { kNumShards = 16 };
+
+    Shard& _getShard(OperationContext* opCtx);
+
+    /**
+     * Returns the merged usage of all shards.
+     */
+    UsageMap _mergeUsage() const;
 
+    CacheAligned<Shard> _shards[kNumShards];
 
-    
-    //Top._globalHistogramStatsȫ(б)Ĳʱͳ-ȫγ
-    //CollectionData.opLatencyHistogramǱĶдcommandͳ-γ
-    OperationLatencyHistogram _globalHistogramStats;
-    //ÿϸqpsʱͳ   db.runCommand( { top: 1 } )ȡ
-    UsageMap _usage;  //mapÿռһοTop::record
+    // The last dropped namespace is rare and global state, so it is guarded separately and only
+    // checked on the operation path when the flag says there is one pending.
+    mutable SimpleMutex _lastDroppedLock;
+    AtomicBool _hasLastDropped;
     std::string _lastDropped;
 };
 
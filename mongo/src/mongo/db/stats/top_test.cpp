@@ -28,7 +28,12 @@
 
 #include "mongo/platform/basic.h"
 
+#include <vector>
+
+#include "mongo/db/client.h"
+#include "mongo/db/service_context_noop.h"
 #include "mongo/db/stats/top.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/unittest/unittest.h"
 
 namespace {
@@ -39,4 +44,77 @@ TEST(TopTest, CollectionDropped) {
     Top().collectionDropped("coll");
 }
 
+const int kThreads = 8;
+const int kOpsPerThread = 1000;
+
+void recordFromManyThreads(ServiceContext* serviceContext, Top* top, StringData ns) {
+    std::vector<stdx::thread> threads;
+    for (int i = 0; i < kThreads; i++) {
+        threads.emplace_back([serviceContext, top, ns] {
+            auto client = serviceContext->makeClient("TopTest");
+            auto opCtx = client->makeOperationContext();
+            for (int op = 0; op < kOpsPerThread; op++) {
+                top->record(opCtx.get(),
+                            ns,
+                            LogicalOp::opInsert,
+                            Top::LockType::WriteLocked,
+                            10,
+                            false,
+                            Command::ReadWriteType::kWrite);
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+TEST(TopTest, RecordsFromManyThreadsAreMerged) {
+    ServiceContextNoop serviceContext;
+    Top top;
+    recordFromManyThreads(&serviceContext, &top, "test.coll");
+
+    Top::UsageMap usage;
+    top.cloneMap(usage);
+    ASSERT_EQUALS(1U, usage.size());
+
+    const Top::CollectionData& coll = usage["test.coll"];
+    ASSERT_EQUALS(kThreads * kOpsPerThread, coll.total.count);
+    ASSERT_EQUALS(kThreads * kOpsPerThread, coll.insert.count);
+    ASSERT_EQUALS(kThreads * kOpsPerThread, coll.writeLock.count);
+    ASSERT_EQUALS(10LL * kThreads * kOpsPerThread, coll.total.time);
+    ASSERT_EQUALS(0, coll.readLock.count);
+}
+
+TEST(TopTest, CollectionDroppedClearsAllShards) {
+    ServiceContextNoop serviceContext;
+    Top top;
+    recordFromManyThreads(&serviceContext, &top, "test.coll");
+    recordFromManyThreads(&serviceContext, &top, "test.other");
+
+    top.collectionDropped("test.coll");
+
+    Top::UsageMap usage;
+    top.cloneMap(usage);
+    ASSERT_EQUALS(1U, usage.size());
+    ASSERT_EQUALS(kThreads * kOpsPerThread, usage["test.other"].total.count);
+
+    // The command which dropped the collection records against it afterwards, and is ignored.
+    auto client = serviceContext.makeClient("TopTest");
+    auto opCtx = client->makeOperationContext();
+    for (int i = 0; i < 2; i++) {
+        top.record(opCtx.get(),
+                   "test.coll",
+                   LogicalOp::opCommand,
+                   Top::LockType::WriteLocked,
+                   10,
+                   true,
+                   Command::ReadWriteType::kCommand);
+    }
+
+    top.cloneMap(usage);
+    ASSERT_EQUALS(1, usage["test.coll"].commands.count);
+}
+
 }  // namespace
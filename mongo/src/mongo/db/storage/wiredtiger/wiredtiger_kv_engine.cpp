@@ -74,6 +74,8 @@
 #include "mongo/platform/atomic_word.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/util/background.h"
+#include "mongo/util/concurrency/adaptive_ticket_sizer.h"
+#include "mongo/util/concurrency/fair_ticket_scheduler.h"
 #include "mongo/util/concurrency/idle_thread_block.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/exit.h"
@@ -334,11 +336,177 @@ TicketHolder openReadTransaction(128);
 TicketServerParameter openReadTransactionParam(&openReadTransaction,
                                                "wiredTigerConcurrentReadTransactions");
 
+// Share the two pools above between databases when fairTicketSchedulingEnabled is set.
+FairTicketScheduler writeTicketScheduler(&openWriteTransaction);
+FairTicketScheduler readTicketScheduler(&openReadTransaction);
+
+// When enabled, the WTTicketController thread resizes the two pools above from latency and
+// eviction feedback, within [wiredTigerAdaptiveTicketsMin, wiredTigerAdaptiveTicketsMax], and
+// overrides any explicit wiredTigerConcurrent{Read,Write}Transactions setting.
+MONGO_EXPORT_SERVER_PARAMETER(wiredTigerAdaptiveTicketsEnabled, bool, false);
+MONGO_EXPORT_SERVER_PARAMETER(wiredTigerAdaptiveTicketsMin, int, 16);
+MONGO_EXPORT_SERVER_PARAMETER(wiredTigerAdaptiveTicketsMax, int, 512);
+
+AdaptiveTicketSizer writeTicketSizer;
+AdaptiveTicketSizer readTicketSizer;
+
 stdx::function<bool(StringData)> initRsOplogBackgroundThreadCallback = [](StringData) -> bool {
     fassertFailed(40358);
 };
 }  // namespace
 
+/**
+ * Drives the adaptive sizing of openReadTransaction and openWriteTransaction. Ticket usage is
+ * sampled frequently since it changes from one operation to the next, while decisions are made
+ * over a longer interval so that each one is based on enough completed operations.
+ */
+class WiredTigerKVEngine::WiredTigerTicketController : public BackgroundJob {
+public:
+    static const int kSampleIntervalMillis = 10;
+    static const int kSamplesPerDecision = 100;
+
+    explicit WiredTigerTicketController(WT_CONNECTION* conn)
+        : BackgroundJob(false /* deleteSelf */), _conn(conn) {}
+
+    virtual string name() const {
+        return "WTTicketController";
+    }
+
+    virtual void run() {
+        Client::initThread(name().c_str());
+
+        LOG(1) << "starting " << name() << " thread";
+
+        Pool write("write", &openWriteTransaction, &writeTicketSizer);
+        Pool read("read", &openReadTransaction, &readTicketSizer);
+        bool wasEnabled = false;
+        int samples = 0;
+        Date_t intervalStart;
+        int64_t stallMicrosAtStart = 0;
+
+        while (!_shuttingDown.load()) {
+            {
+                MONGO_IDLE_THREAD_BLOCK;
+                sleepmillis(kSampleIntervalMillis);
+            }
+
+            if (!wiredTigerAdaptiveTicketsEnabled.load()) {
+                if (wasEnabled) {
+                    write.sizer->reset();
+                    read.sizer->reset();
+                }
+                wasEnabled = false;
+                continue;
+            }
+
+            if (!wasEnabled || samples == kSamplesPerDecision) {
+                if (wasEnabled) {
+                    const Date_t now = Date_t::now();
+                    const double elapsedMicros =
+                        std::max<int64_t>(1, durationCount<Microseconds>(now - intervalStart));
+                    const double stallMicros = _evictionStallMicros() - stallMicrosAtStart;
+                    const double inFlight = static_cast<double>(write.usedSum + read.usedSum) /
+                        kSamplesPerDecision;
+                    const double evictionStall =
+                        std::max(0.0, stallMicros / (elapsedMicros * std::max(1.0, inFlight)));
+                    write.decide(elapsedMicros, evictionStall);
+                    read.decide(elapsedMicros, evictionStall);
+                }
+
+                wasEnabled = true;
+                samples = 0;
+                intervalStart = Date_t::now();
+                stallMicrosAtStart = _evictionStallMicros();
+                write.startInterval();
+                read.startInterval();
+                continue;
+            }
+
+            write.observe();
+            read.observe();
+            ++samples;
+        }
+        LOG(1) << "stopping " << name() << " thread";
+    }
+
+    void shutdown() {
+        _shuttingDown.store(true);
+        wait();
+    }
+
+private:
+    struct Pool {
+        Pool(const char* name, TicketHolder* holder, AdaptiveTicketSizer* sizer)
+            : name(name), holder(holder), sizer(sizer) {}
+
+        void startInterval() {
+            releasedAtStart = holder->numReleased();
+            usedSum = 0;
+            saturatedSamples = 0;
+        }
+
+        void observe() {
+            usedSum += holder->used();
+            if (holder->available() <= 0) {
+                ++saturatedSamples;
+            }
+        }
+
+        void decide(double elapsedMicros, double evictionStall) {
+            AdaptiveTicketSizer::Sample sample;
+            sample.inFlight = static_cast<double>(usedSum) / kSamplesPerDecision;
+            sample.throughput =
+                (holder->numReleased() - releasedAtStart) * 1000 * 1000 / elapsedMicros;
+            sample.saturation = static_cast<double>(saturatedSamples) / kSamplesPerDecision;
+            sample.evictionStall = evictionStall;
+
+            // TicketHolder cannot shrink below 5 tickets.
+            const int minSize = std::max(5, wiredTigerAdaptiveTicketsMin.load());
+            const int maxSize = std::max(minSize, wiredTigerAdaptiveTicketsMax.load());
+            const int currentSize = holder->outof();
+            const int newSize = sizer->nextSize(currentSize, sample, minSize, maxSize);
+            if (newSize == currentSize) {
+                return;
+            }
+
+            LOG(2) << "resizing " << name << " tickets from " << currentSize << " to " << newSize;
+            Status status = holder->resize(newSize);
+            if (!status.isOK()) {
+                warning() << "failed to resize " << name << " tickets to " << newSize << ": "
+                          << status;
+            }
+        }
+
+        const char* name;
+        TicketHolder* holder;
+        AdaptiveTicketSizer* sizer;
+
+        uint64_t releasedAtStart = 0;
+        long long usedSum = 0;
+        int saturatedSamples = 0;
+    };
+
+    /**
+     * Returns the total time application threads have spent evicting pages or waiting for cache
+     * space, or 0 if statistics are unavailable.
+     */
+    int64_t _evictionStallMicros() {
+        WiredTigerSession session(_conn);
+        int64_t total = 0;
+        for (int key : {WT_STAT_CONN_APPLICATION_EVICT_TIME, WT_STAT_CONN_APPLICATION_CACHE_TIME}) {
+            auto value = WiredTigerUtil::getStatisticsValueAs<int64_t>(
+                session.getSession(), "statistics:", "statistics=(fast)", key);
+            if (value.isOK()) {
+                total += value.getValue();
+            }
+        }
+        return total;
+    }
+
+    WT_CONNECTION* _conn;
+    AtomicBool _shuttingDown{false};
+};
+
 /*
 wiredtiger:
 //error_check(wiredtiger_open(home, NULL, CONN_CONFIG, &conn));
@@ -497,6 +665,9 @@ WiredTigerKVEngine::WiredTigerKVEngine(const std::string& canonicalName,
         _checkpointThread->go();
     }
 
+    _ticketController = stdx::make_unique<WiredTigerTicketController>(_conn);
+    _ticketController->go();
+
 	//WiredTigerKVEngine::WiredTigerKVEngineгʼӦWiredTigerKVEngine._sizeStorerUri="table:sizeStorer"
     _sizeStorerUri = "table:sizeStorer";
     WiredTigerSession session(_conn);
@@ -516,6 +687,7 @@ WiredTigerKVEngine::WiredTigerKVEngine(const std::string& canonicalName,
 
 	//WiredTigerKVEngine::WiredTigerKVEngine->Locker::setGlobalThrottling
     Locker::setGlobalThrottling(&openReadTransaction, &openWriteTransaction);
+    Locker::setGlobalTicketScheduling(&readTicketScheduler, &writeTicketScheduler);
 }
 
 
@@ -559,6 +731,31 @@ void WiredTigerKVEngine::appendGlobalStats(BSONObjBuilder& b) {
         bbb.append("totalTickets", openReadTransaction.outof());
         bbb.done();
     }
+    {
+        BSONObjBuilder bbb(bb.subobjStart("adaptive"));
+        bbb.append("enabled", wiredTigerAdaptiveTicketsEnabled.load());
+        {
+            BSONObjBuilder sizerBuilder(bbb.subobjStart("write"));
+            writeTicketSizer.report(&sizerBuilder);
+        }
+        {
+            BSONObjBuilder sizerBuilder(bbb.subobjStart("read"));
+            readTicketSizer.report(&sizerBuilder);
+        }
+        bbb.done();
+    }
+    {
+        BSONObjBuilder bbb(bb.subobjStart("fairScheduling"));
+        {
+            BSONObjBuilder schedulerBuilder(bbb.subobjStart("write"));
+            writeTicketScheduler.report(&schedulerBuilder);
+        }
+        {
+            BSONObjBuilder schedulerBuilder(bbb.subobjStart("read"));
+            readTicketScheduler.report(&schedulerBuilder);
+        }
+        bbb.done();
+    }
     bb.done();
 }
 
@@ -588,6 +785,8 @@ void WiredTigerKVEngine::cleanShutdown() {
             _journalFlusher->shutdown();
         if (_checkpointThread)
             _checkpointThread->shutdown();
+        if (_ticketController)
+            _ticketController->shutdown();
         _sizeStorer.reset();
         _sessionCache->shuttingDown();
 
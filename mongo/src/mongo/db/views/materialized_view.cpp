@@ -0,0 +1,438 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/views/materialized_view.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/matcher/expression_parser.h"
+#include "mongo/db/matcher/extensions_callback_noop.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/parsed_add_fields.h"
+#include "mongo/db/pipeline/pipeline.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+using parsed_aggregation_projection::ParsedAddFields;
+using parsed_aggregation_projection::ParsedAggregationProjection;
+
+constexpr StringData MaterializedViewPipeline::kCountFieldName;
+constexpr StringData MaterializedViewPipeline::kGroupKeyFieldName;
+constexpr StringData MaterializedViewPipeline::kStateFieldName;
+constexpr StringData MaterializedViewPipeline::kBackingCollectionPrefix;
+
+namespace {
+
+Status notSupported(const std::string& reason) {
+    return {ErrorCodes::OptionNotSupportedOnView,
+            str::stream() << "cannot materialize view: " << reason};
+}
+
+/**
+ * Returns the object 'element' holds, or an empty object if it is missing.
+ */
+BSONObj objectOrEmpty(const BSONElement& element) {
+    return element.type() == BSONType::Object ? element.Obj() : BSONObj();
+}
+
+}  // namespace
+
+StatusWith<std::unique_ptr<MaterializedViewPipeline>> MaterializedViewPipeline::parse(
+    const intrusive_ptr<ExpressionContext>& expCtx, const std::vector<BSONObj>& pipeline) {
+    std::unique_ptr<MaterializedViewPipeline> parsed(new MaterializedViewPipeline(expCtx));
+
+    if (pipeline.empty() || pipeline.back().firstElementFieldName() != StringData("$group")) {
+        return notSupported("the pipeline must end with a $group stage");
+    }
+
+    try {
+        for (size_t i = 0; i + 1 < pipeline.size(); ++i) {
+            const BSONElement stageSpec = pipeline[i].firstElement();
+            const StringData stageName = stageSpec.fieldNameStringData();
+            if (stageSpec.type() != BSONType::Object) {
+                return notSupported(str::stream() << stageName
+                                                  << " specification must be an object");
+            }
+
+            Stage stage;
+            if (stageName == "$match") {
+                auto statusWithMatcher =
+                    MatchExpressionParser::parse(stageSpec.Obj(),
+                                                 expCtx,
+                                                 ExtensionsCallbackNoop(),
+                                                 Pipeline::kAllowedMatcherFeatures);
+                if (!statusWithMatcher.isOK()) {
+                    return statusWithMatcher.getStatus();
+                }
+                stage.filter = std::move(statusWithMatcher.getValue());
+            } else if (stageName == "$project") {
+                stage.projection = ParsedAggregationProjection::create(expCtx, stageSpec.Obj());
+                stage.projection->optimize();
+            } else if (stageName == "$addFields") {
+                stage.projection = ParsedAddFields::create(expCtx, stageSpec.Obj());
+                stage.projection->optimize();
+            } else {
+                return notSupported(str::stream() << "stage " << stageName
+                                                  << " cannot be maintained incrementally; only "
+                                                     "$match, $project and $addFields may precede "
+                                                     "the final $group");
+            }
+            parsed->_stages.push_back(std::move(stage));
+        }
+
+        const BSONElement groupSpec = pipeline.back().firstElement();
+        if (groupSpec.type() != BSONType::Object) {
+            return notSupported("$group specification must be an object");
+        }
+
+        const auto& vps = expCtx->variablesParseState;
+        for (auto&& groupField : groupSpec.Obj()) {
+            const StringData fieldName = groupField.fieldNameStringData();
+            if (fieldName == "_id") {
+                parsed->_idExpression =
+                    Expression::parseOperand(expCtx, groupField, vps)->optimize();
+                continue;
+            }
+
+            if (fieldName == kCountFieldName || fieldName == kStateFieldName ||
+                fieldName.find('.') != std::string::npos ||
+                fieldName.startsWith("$")) {
+                return notSupported(str::stream() << "invalid $group output field name '"
+                                                  << fieldName
+                                                  << "'");
+            }
+
+            if (groupField.type() != BSONType::Object || groupField.Obj().nFields() != 1) {
+                return notSupported(str::stream() << "the $group field '" << fieldName
+                                                  << "' must specify one accumulator");
+            }
+
+            const BSONElement accumulatorSpec = groupField.Obj().firstElement();
+            const StringData accumulatorName = accumulatorSpec.fieldNameStringData();
+            AccumulatedField field;
+            if (accumulatorName == "$sum") {
+                field.op = AccumulatedField::Op::kSum;
+            } else if (accumulatorName == "$avg") {
+                field.op = AccumulatedField::Op::kAvg;
+            } else {
+                return notSupported(str::stream() << "accumulator " << accumulatorName
+                                                  << " is not decomposable; only $sum and $avg "
+                                                     "are supported");
+            }
+            field.fieldName = fieldName.toString();
+            field.expression = Expression::parseOperand(expCtx, accumulatorSpec, vps)->optimize();
+            parsed->_accumulatedFields.push_back(std::move(field));
+        }
+    } catch (const DBException& ex) {
+        return ex.toStatus();
+    }
+
+    if (!parsed->_idExpression) {
+        return notSupported("a group specification must include an _id");
+    }
+
+    return {std::move(parsed)};
+}
+
+NamespaceString MaterializedViewPipeline::backingNamespace(const NamespaceString& viewNss) {
+    return NamespaceString(viewNss.db(), kBackingCollectionPrefix.toString() + viewNss.coll());
+}
+
+bool MaterializedViewPipeline::isBackingNamespace(const NamespaceString& nss) {
+    return nss.coll().startsWith(kBackingCollectionPrefix);
+}
+
+std::vector<BSONObj> MaterializedViewPipeline::readPipeline() const {
+    BSONObjBuilder projection;
+    projection.append("_id", str::stream() << "$_id." << kGroupKeyFieldName);
+    for (auto&& field : _accumulatedFields) {
+        projection.append(field.fieldName, true);
+    }
+
+    // Groups whose documents have all been removed keep their backing document with a zero count;
+    // they are not part of the view.
+    return {BSON("$match" << BSON(kCountFieldName << BSON("$gt" << 0))),
+            BSON("$project" << projection.obj())};
+}
+
+boost::optional<Document> MaterializedViewPipeline::transform(const BSONObj& doc) const {
+    Document current(doc);
+    bool transformed = false;
+    for (auto&& stage : _stages) {
+        if (stage.filter) {
+            if (!stage.filter->matchesBSON(transformed ? current.toBson() : doc)) {
+                return boost::none;
+            }
+        } else {
+            current = stage.projection->applyTransformation(current);
+            transformed = true;
+        }
+    }
+    return current;
+}
+
+Value MaterializedViewPipeline::computeGroupKey(const Document& doc) const {
+    Value key = _idExpression->evaluate(doc);
+    return key.missing() ? Value(BSONNULL) : key;
+}
+
+void MaterializedViewDelta::PartialSum::add(const Value& input, bool isRemove) {
+    const long long sign = isRemove ? -1 : 1;
+    switch (input.getType()) {
+        case NumberInt:
+            nInt += sign;
+            nonDecimalTotal.addLong(sign * input.getInt());
+            return;
+        case NumberLong:
+            nLong += sign;
+            if (isRemove && input.getLong() == std::numeric_limits<long long>::min()) {
+                // The negation does not fit a long long, but is exactly representable as a double.
+                nonDecimalTotal.addDouble(-static_cast<double>(input.getLong()));
+            } else {
+                nonDecimalTotal.addLong(sign * input.getLong());
+            }
+            return;
+        case NumberDouble: {
+            nDouble += sign;
+            const double value = input.getDouble();
+            if (std::isnan(value)) {
+                nNaN += sign;
+            } else if (std::isinf(value)) {
+                (value > 0 ? nPositiveInfinity : nNegativeInfinity) += sign;
+            } else {
+                nonDecimalTotal.addDouble(sign * value);
+            }
+            return;
+        }
+        case NumberDecimal: {
+            nDecimal += sign;
+            const Decimal128 value = input.getDecimal();
+            if (value.isNaN()) {
+                nNaN += sign;
+            } else if (value.isInfinite()) {
+                (value.isNegative() ? nNegativeInfinity : nPositiveInfinity) += sign;
+            } else {
+                decimalTotal = isRemove ? decimalTotal.subtract(value) : decimalTotal.add(value);
+            }
+            return;
+        }
+        default:
+            // $sum and $avg ignore non-numeric values.
+            return;
+    }
+}
+
+void MaterializedViewDelta::PartialSum::merge(const PartialSum& other) {
+    double sum, error;
+    std::tie(sum, error) = other.nonDecimalTotal.getDoubleDouble();
+    nonDecimalTotal.addDouble(sum);
+    nonDecimalTotal.addDouble(error);
+
+    // Once removals cancel out the leading part of the sum, the remainder holds all of it. Summing
+    // the two parts afresh makes the leading part the nearest double to the sum again.
+    std::tie(sum, error) = nonDecimalTotal.getDoubleDouble();
+    nonDecimalTotal = DoubleDoubleSummation();
+    nonDecimalTotal.addDouble(sum);
+    nonDecimalTotal.addDouble(error);
+
+    decimalTotal = decimalTotal.add(other.decimalTotal);
+    nInt += other.nInt;
+    nLong += other.nLong;
+    nDouble += other.nDouble;
+    nDecimal += other.nDecimal;
+    nNaN += other.nNaN;
+    nPositiveInfinity += other.nPositiveInfinity;
+    nNegativeInfinity += other.nNegativeInfinity;
+}
+
+bool MaterializedViewDelta::PartialSum::isEmpty() const {
+    double sum, error;
+    std::tie(sum, error) = nonDecimalTotal.getDoubleDouble();
+    return sum == 0 && error == 0 && decimalTotal.isZero() && nInt == 0 && nLong == 0 &&
+        nDouble == 0 && nDecimal == 0 && nNaN == 0 && nPositiveInfinity == 0 &&
+        nNegativeInfinity == 0;
+}
+
+long long MaterializedViewDelta::PartialSum::count() const {
+    return nInt + nLong + nDouble + nDecimal;
+}
+
+Value MaterializedViewDelta::PartialSum::sum() const {
+    // The result has the widest type of the inputs, as for AccumulatorSum::getValue().
+    const bool isDecimal = nDecimal > 0;
+    if (nNaN > 0 || (nPositiveInfinity > 0 && nNegativeInfinity > 0)) {
+        return isDecimal ? Value(Decimal128::kPositiveNaN)
+                         : Value(std::numeric_limits<double>::quiet_NaN());
+    }
+    if (nPositiveInfinity > 0) {
+        return isDecimal ? Value(Decimal128::kPositiveInfinity)
+                         : Value(std::numeric_limits<double>::infinity());
+    }
+    if (nNegativeInfinity > 0) {
+        return isDecimal ? Value(Decimal128::kNegativeInfinity)
+                         : Value(-std::numeric_limits<double>::infinity());
+    }
+
+    if (isDecimal) {
+        double sum, error;
+        std::tie(sum, error) = nonDecimalTotal.getDoubleDouble();
+        Decimal128 total;  // zero
+        if (sum != 0) {
+            total = total.add(Decimal128(sum, Decimal128::kRoundTo34Digits));
+            total = total.add(Decimal128(error, Decimal128::kRoundTo34Digits));
+        }
+        return Value(total.add(decimalTotal));
+    }
+    if (nDouble > 0 || !nonDecimalTotal.fitsLong()) {
+        return Value(nonDecimalTotal.getDouble());
+    }
+    if (nLong > 0) {
+        return Value(nonDecimalTotal.getLong());
+    }
+    return Value::createIntOrLong(nonDecimalTotal.getLong());
+}
+
+Value MaterializedViewDelta::PartialSum::average() const {
+    // The average of no numeric values is null, matching $avg.
+    const long long n = count();
+    if (n == 0) {
+        return Value(BSONNULL);
+    }
+    if (nDecimal > 0) {
+        return Value(sum().getDecimal().divide(Decimal128(static_cast<int64_t>(n))));
+    }
+    return Value(sum().coerceToDouble() / static_cast<double>(n));
+}
+
+MaterializedViewDelta::PartialSum MaterializedViewDelta::PartialSum::parse(
+    const BSONObj& state) {
+    PartialSum partial;
+    if (state.isEmpty()) {
+        return partial;
+    }
+    partial.nonDecimalTotal.addDouble(state["sum"].Double());
+    partial.nonDecimalTotal.addDouble(state["error"].Double());
+    partial.decimalTotal = state["decimal"].Decimal();
+    partial.nInt = state["nInt"].Long();
+    partial.nLong = state["nLong"].Long();
+    partial.nDouble = state["nDouble"].Long();
+    partial.nDecimal = state["nDecimal"].Long();
+    partial.nNaN = state["nNaN"].Long();
+    partial.nPositiveInfinity = state["nPositiveInfinity"].Long();
+    partial.nNegativeInfinity = state["nNegativeInfinity"].Long();
+    return partial;
+}
+
+BSONObj MaterializedViewDelta::PartialSum::toBSON() const {
+    double sum, error;
+    std::tie(sum, error) = nonDecimalTotal.getDoubleDouble();
+    return BSON("sum" << sum << "error" << error << "decimal" << decimalTotal << "nInt" << nInt
+                      << "nLong"
+                      << nLong
+                      << "nDouble"
+                      << nDouble
+                      << "nDecimal"
+                      << nDecimal
+                      << "nNaN"
+                      << nNaN
+                      << "nPositiveInfinity"
+                      << nPositiveInfinity
+                      << "nNegativeInfinity"
+                      << nNegativeInfinity);
+}
+
+void MaterializedViewDelta::_add(const BSONObj& doc, bool isRemove) {
+    auto transformed = _pipeline->transform(doc);
+    if (!transformed) {
+        return;
+    }
+
+    // The group key is wrapped in the backing document _id, so keys which cannot be an _id, such
+    // as arrays, are grouped on like any other.
+    const Value key = _pipeline->computeGroupKey(*transformed);
+    auto& group =
+        _groups[BSON("_id" << BSON(MaterializedViewPipeline::kGroupKeyFieldName << key))];
+    const auto& fields = _pipeline->getAccumulatedFields();
+    group.sums.resize(fields.size());
+
+    group.count += isRemove ? -1 : 1;
+    for (size_t i = 0; i < fields.size(); ++i) {
+        group.sums[i].add(fields[i].expression->evaluate(*transformed), isRemove);
+    }
+}
+
+std::vector<BSONObj> MaterializedViewDelta::changedGroups() const {
+    std::vector<BSONObj> changed;
+    for (auto&& entry : _groups) {
+        const GroupDelta& group = entry.second;
+        if (group.count != 0 ||
+            std::any_of(group.sums.begin(), group.sums.end(), [](const PartialSum& sum) {
+                return !sum.isEmpty();
+            })) {
+            changed.push_back(entry.first);
+        }
+    }
+    return changed;
+}
+
+BSONObj MaterializedViewDelta::applyTo(const BSONObj& groupId, const BSONObj& backingDoc) const {
+    using Op = MaterializedViewPipeline::AccumulatedField::Op;
+
+    auto it = _groups.find(groupId);
+    invariant(it != _groups.end());
+    const GroupDelta& group = it->second;
+
+    const auto& fields = _pipeline->getAccumulatedFields();
+    const BSONObj oldState = objectOrEmpty(backingDoc[MaterializedViewPipeline::kStateFieldName]);
+
+    BSONObjBuilder newDoc;
+    newDoc.append(groupId.firstElement());
+    newDoc.append(MaterializedViewPipeline::kCountFieldName,
+                  backingDoc[MaterializedViewPipeline::kCountFieldName].numberLong() + group.count);
+
+    BSONObjBuilder newState;
+    for (size_t i = 0; i < fields.size(); ++i) {
+        PartialSum partial = PartialSum::parse(objectOrEmpty(oldState[fields[i].fieldName]));
+        partial.merge(group.sums[i]);
+        const Value result = fields[i].op == Op::kSum ? partial.sum() : partial.average();
+        result.addToBsonObj(&newDoc, fields[i].fieldName);
+        newState.append(fields[i].fieldName, partial.toBSON());
+    }
+    newDoc.append(MaterializedViewPipeline::kStateFieldName, newState.obj());
+    return newDoc.obj();
+}
+
+}  // namespace mongo
@@ -0,0 +1,237 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mongo/base/status_with.h"
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bson/simple_bsonobj_comparator.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/parsed_aggregation_projection.h"
+#include "mongo/platform/decimal128.h"
+#include "mongo/util/summation.h"
+
+namespace mongo {
+
+/**
+ * The parsed form of a materialized view definition. A materialized view pipeline is a sequence
+ * of $match, $project and $addFields stages followed by a single $group whose accumulators are
+ * decomposable, that is, their result over a set of documents can be adjusted when a document
+ * enters or leaves the set without revisiting the rest of the set. Only $sum and $avg qualify.
+ *
+ * The results are stored in a backing collection with one document per group. Each backing
+ * document holds the group key wrapped in its _id, since the key may be a value such as an array
+ * which cannot be an _id itself, the number of source documents in the group, the value of each
+ * accumulator, and the state needed to adjust those values without loss of precision;
+ * readPipeline() turns the backing documents into the user-visible view documents.
+ */
+class MaterializedViewPipeline {
+public:
+    // Name of the backing document field counting the source documents in the group.
+    static constexpr StringData kCountFieldName = "_mvCount"_sd;
+
+    // Name of the field of the backing document _id holding the group key.
+    static constexpr StringData kGroupKeyFieldName = "_mvKey"_sd;
+
+    // Name of the backing document field holding the compensated sums behind each accumulator.
+    static constexpr StringData kStateFieldName = "_mvState"_sd;
+
+    // Prefix of the backing collection name; the view's collection name follows it.
+    static constexpr StringData kBackingCollectionPrefix = "system.materialized."_sd;
+
+    /**
+     * Parses 'pipeline' as a materialized view definition. Returns
+     * ErrorCodes::OptionNotSupportedOnView if the pipeline contains stages or accumulators which
+     * cannot be maintained incrementally.
+     */
+    static StatusWith<std::unique_ptr<MaterializedViewPipeline>> parse(
+        const boost::intrusive_ptr<ExpressionContext>& expCtx,
+        const std::vector<BSONObj>& pipeline);
+
+    /**
+     * Returns the namespace of the collection which stores the results for the view 'viewNss'.
+     */
+    static NamespaceString backingNamespace(const NamespaceString& viewNss);
+
+    /**
+     * Returns whether 'nss' names the backing collection of a materialized view.
+     */
+    static bool isBackingNamespace(const NamespaceString& nss);
+
+    /**
+     * Returns the pipeline which, when run over the backing collection, produces the documents of
+     * the view.
+     */
+    std::vector<BSONObj> readPipeline() const;
+
+    /**
+     * Runs the $match/$project/$addFields prefix of the pipeline over 'doc'. Returns boost::none
+     * if the document is filtered out, otherwise the document that would reach the $group.
+     */
+    boost::optional<Document> transform(const BSONObj& doc) const;
+
+    /**
+     * Computes the group key of 'doc', which must have been produced by transform().
+     */
+    Value computeGroupKey(const Document& doc) const;
+
+    /**
+     * An accumulator of the view's $group. Both $sum and $avg are maintained from the sum of the
+     * numeric inputs and their number by type.
+     */
+    struct AccumulatedField {
+        enum class Op { kSum, kAvg };
+
+        std::string fieldName;
+        Op op;
+        boost::intrusive_ptr<Expression> expression;
+    };
+
+    const std::vector<AccumulatedField>& getAccumulatedFields() const {
+        return _accumulatedFields;
+    }
+
+    const boost::intrusive_ptr<ExpressionContext>& getExpressionContext() const {
+        return _expCtx;
+    }
+
+private:
+    /**
+     * A single stage of the pipeline prefix in front of the $group. Exactly one of 'filter' and
+     * 'projection' is set.
+     */
+    struct Stage {
+        std::unique_ptr<MatchExpression> filter;
+        std::unique_ptr<parsed_aggregation_projection::ParsedAggregationProjection> projection;
+    };
+
+    explicit MaterializedViewPipeline(const boost::intrusive_ptr<ExpressionContext>& expCtx)
+        : _expCtx(expCtx) {}
+
+    boost::intrusive_ptr<ExpressionContext> _expCtx;
+    std::vector<Stage> _stages;
+    boost::intrusive_ptr<Expression> _idExpression;
+    std::vector<AccumulatedField> _accumulatedFields;
+};
+
+/**
+ * Collects the changes a set of source document writes make to the groups of a materialized view.
+ * Deltas of documents landing in the same group are combined, so each touched group results in a
+ * single write of the backing collection.
+ */
+class MaterializedViewDelta {
+public:
+    explicit MaterializedViewDelta(const MaterializedViewPipeline* pipeline)
+        : _pipeline(pipeline),
+          _groups(SimpleBSONObjComparator::kInstance.makeBSONObjIndexedMap<GroupDelta>()) {}
+
+    /**
+     * Records that 'doc' was added to the source collection.
+     */
+    void addInsert(const BSONObj& doc) {
+        _add(doc, false);
+    }
+
+    /**
+     * Records that 'doc' was removed from the source collection.
+     */
+    void addRemove(const BSONObj& doc) {
+        _add(doc, true);
+    }
+
+    bool isEmpty() const {
+        return _groups.empty();
+    }
+
+    /**
+     * Returns the backing document _id of each group whose count or accumulators changed.
+     */
+    std::vector<BSONObj> changedGroups() const;
+
+    /**
+     * Returns the backing document of the group with the backing document _id 'groupId' once the
+     * delta is applied to 'backingDoc', its current backing document, or to an empty group if
+     * 'backingDoc' is empty.
+     */
+    BSONObj applyTo(const BSONObj& groupId, const BSONObj& backingDoc) const;
+
+private:
+    /**
+     * The sum of the numeric inputs of an accumulator. Finite non-decimal inputs are summed with
+     * extra precision like $sum does, so that removing an input exactly undoes adding it, while
+     * NaN and infinite inputs, which cannot be subtracted again, are only counted.
+     */
+    struct PartialSum {
+        void add(const Value& input, bool isRemove);
+        void merge(const PartialSum& other);
+        bool isEmpty() const;
+
+        // The number of numeric inputs, which $avg divides by.
+        long long count() const;
+
+        // The $sum of the inputs, of the widest numeric type among them.
+        Value sum() const;
+        Value average() const;
+
+        static PartialSum parse(const BSONObj& state);
+        BSONObj toBSON() const;
+
+        DoubleDoubleSummation nonDecimalTotal;
+        Decimal128 decimalTotal;
+        long long nInt = 0;
+        long long nLong = 0;
+        long long nDouble = 0;
+        long long nDecimal = 0;
+        long long nNaN = 0;
+        long long nPositiveInfinity = 0;
+        long long nNegativeInfinity = 0;
+    };
+
+    struct GroupDelta {
+        long long count = 0;
+        std::vector<PartialSum> sums;
+    };
+
+    void _add(const BSONObj& doc, bool isRemove);
+
+    const MaterializedViewPipeline* _pipeline;
+
+    // Keyed by the backing document _id.
+    BSONObjIndexedMap<GroupDelta> _groups;
+};
+
+}  // namespace mongo
@@ -0,0 +1,531 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/views/materialized_view_maintenance.h"
+
+#include <map>
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/concurrency/d_concurrency.h"
+#include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/curop.h"
+#include "mongo/db/db_raii.h"
+#include "mongo/db/dbhelpers.h"
+#include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/op_observer.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/query/collation/collation_index_key.h"
+#include "mongo/db/query/internal_plans.h"
+#include "mongo/db/repl/oplog.h"
+#include "mongo/db/service_context.h"
+#include "mongo/db/views/materialized_view.h"
+#include "mongo/db/views/view.h"
+#include "mongo/db/views/view_catalog.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+namespace {
+
+// The document about to be deleted by this operation, stashed between aboutToDelete() and
+// onDelete() when the collection has materialized views.
+const auto pendingDeletedDoc = OperationContext::declareDecoration<boost::optional<BSONObj>>();
+
+// The number of source documents populate() applies to the backing collection per batch.
+const int kBuildBatchSize = 1000;
+
+/**
+ * The progress of the build of a materialized view: the _id index key of the last source document
+ * it has applied, or boost::none before the first batch.
+ */
+struct BuildProgress {
+    boost::optional<BSONObj> lastScannedKey;
+};
+
+/**
+ * The materialized views being built on this node, by name. Entries are added by build() and
+ * removed when populate() finishes or the view is dropped.
+ */
+struct MaterializedViewBuilds {
+    stdx::mutex mutex;
+    std::map<std::string, std::shared_ptr<BuildProgress>> inProgress;
+};
+
+const auto getMaterializedViewBuilds = ServiceContext::declareDecoration<MaterializedViewBuilds>();
+
+std::shared_ptr<BuildProgress> lookupBuild(OperationContext* opCtx,
+                                           const NamespaceString& viewNss) {
+    auto& builds = getMaterializedViewBuilds(opCtx->getServiceContext());
+    stdx::lock_guard<stdx::mutex> lk(builds.mutex);
+    auto it = builds.inProgress.find(viewNss.ns());
+    return it == builds.inProgress.end() ? nullptr : it->second;
+}
+
+void restoreBuild(OperationContext* opCtx,
+                  const NamespaceString& viewNss,
+                  const std::shared_ptr<BuildProgress>& progress) {
+    auto& builds = getMaterializedViewBuilds(opCtx->getServiceContext());
+    stdx::lock_guard<stdx::mutex> lk(builds.mutex);
+    builds.inProgress[viewNss.ns()] = progress;
+}
+
+void removeBuild(OperationContext* opCtx,
+                 const NamespaceString& viewNss,
+                 const std::shared_ptr<BuildProgress>& progress) {
+    auto& builds = getMaterializedViewBuilds(opCtx->getServiceContext());
+    stdx::lock_guard<stdx::mutex> lk(builds.mutex);
+    auto it = builds.inProgress.find(viewNss.ns());
+    if (it != builds.inProgress.end() && (!progress || it->second == progress)) {
+        builds.inProgress.erase(it);
+    }
+}
+
+/**
+ * Returns the key of 'doc' in the _id index of 'source', which orders the scan of populate().
+ */
+BSONObj idIndexKey(const Collection* source, const BSONObj& doc) {
+    BSONObjBuilder keyBuilder;
+    CollationIndexKey::collationAwareIndexKeyAppend(
+        doc["_id"], source->getDefaultCollator(), &keyBuilder);
+    return keyBuilder.obj();
+}
+
+/**
+ * Returns the documents of 'docs', written to 'source', which must be reflected in 'view': all of
+ * them, unless 'view' is being built, in which case only those the build has already scanned.
+ * The build reads the others in their current state when its scan reaches them.
+ */
+std::vector<BSONObj> docsToMaintain(OperationContext* opCtx,
+                                    const Collection* source,
+                                    const ViewDefinition& view,
+                                    const std::vector<BSONObj>& docs) {
+    auto progress = lookupBuild(opCtx, view.name());
+    if (!progress) {
+        return docs;
+    }
+
+    // The build holds the source collection in MODE_S while it advances, so the progress cannot
+    // change under a writer.
+    std::vector<BSONObj> scanned;
+    if (progress->lastScannedKey) {
+        for (auto&& doc : docs) {
+            if (idIndexKey(source, doc).woCompare(*progress->lastScannedKey) <= 0) {
+                scanned.push_back(doc);
+            }
+        }
+    }
+    return scanned;
+}
+
+/**
+ * Returns the materialized views which must be maintained for a write to 'nss' by 'opCtx'.
+ */
+std::vector<std::shared_ptr<ViewDefinition>> materializedViewsToMaintain(
+    OperationContext* opCtx, const NamespaceString& nss) {
+    if (!opCtx->writesAreReplicated() || nss.isSystem() || nss.isLocal()) {
+        return {};
+    }
+
+    Database* db = dbHolder().get(opCtx, nss.db());
+    if (!db) {
+        return {};
+    }
+    return db->getViewCatalog()->lookupMaterializedViewsOn(opCtx, nss);
+}
+
+std::unique_ptr<MaterializedViewPipeline> parsePipeline(OperationContext* opCtx,
+                                                        const ViewDefinition& view) {
+    boost::intrusive_ptr<ExpressionContext> expCtx = new ExpressionContext(opCtx, nullptr);
+    expCtx->ns = view.viewOn();
+    return uassertStatusOK(MaterializedViewPipeline::parse(expCtx, view.pipeline()));
+}
+
+/**
+ * Applies 'delta' to the backing collection of 'view'. The backing documents are replaced
+ * directly, as the view catalog does for system.views, rather than through the update path, which
+ * does not allow writes to system collections.
+ */
+void applyDelta(OperationContext* opCtx,
+                Database* db,
+                const ViewDefinition& view,
+                const MaterializedViewDelta& delta) {
+    const NamespaceString backingNss = MaterializedViewPipeline::backingNamespace(view.name());
+    Lock::CollectionLock collLock(opCtx->lockState(), backingNss.ns(), MODE_IX);
+    Collection* backing = db->getCollection(opCtx, backingNss);
+    uassert(ErrorCodes::NamespaceNotFound,
+            str::stream() << "backing collection " << backingNss.ns()
+                          << " of materialized view "
+                          << view.name().ns()
+                          << " does not exist",
+            backing);
+
+    const bool enforceQuota = false;
+    OpDebug* const opDebug = &CurOp::get(opCtx)->debug();
+    for (auto&& query : delta.changedGroups()) {
+        RecordId id = Helpers::findById(opCtx, backing, query);
+
+        Snapshotted<BSONObj> oldDoc;
+        if (id.isNull() || !backing->findDoc(opCtx, id, &oldDoc)) {
+            BSONObj newDoc = delta.applyTo(query, BSONObj());
+            uassertStatusOK(
+                backing->insertDocument(opCtx, InsertStatement(newDoc), opDebug, enforceQuota));
+            continue;
+        }
+
+        BSONObj newDoc = delta.applyTo(query, oldDoc.value());
+        OplogUpdateEntryArgs args;
+        args.nss = backingNss;
+        args.uuid = backing->uuid();
+        args.update = newDoc;
+        args.criteria = query;
+        args.fromMigrate = false;
+
+        // Only the aggregates change; the _id, which is the only indexed field, does not.
+        const bool indexesAffected = false;
+        backing->updateDocument(
+            opCtx, id, oldDoc, newDoc, enforceQuota, indexesAffected, opDebug, &args);
+    }
+}
+
+/**
+ * Applies the effect of replacing the documents 'removed' with the documents 'inserted' in the
+ * collection 'nss' to each of 'views'.
+ */
+void applyWrites(OperationContext* opCtx,
+                 const NamespaceString& nss,
+                 const std::vector<std::shared_ptr<ViewDefinition>>& views,
+                 const std::vector<BSONObj>& removed,
+                 const std::vector<BSONObj>& inserted) {
+    Database* db = dbHolder().get(opCtx, nss.db());
+    Collection* source = db->getCollection(opCtx, nss);
+    for (auto&& view : views) {
+        auto pipeline = parsePipeline(opCtx, *view);
+        MaterializedViewDelta delta(pipeline.get());
+        for (auto&& doc : docsToMaintain(opCtx, source, *view, removed)) {
+            delta.addRemove(doc);
+        }
+        for (auto&& doc : docsToMaintain(opCtx, source, *view, inserted)) {
+            delta.addInsert(doc);
+        }
+
+        if (!delta.isEmpty()) {
+            applyDelta(opCtx, db, *view, delta);
+        }
+    }
+}
+
+/**
+ * Drops the backing collection of 'view' and builds it again from the collection the view is
+ * defined on, replacing any build of the view in progress.
+ */
+void rebuild(OperationContext* opCtx, Database* db, const ViewDefinition& view) {
+    const NamespaceString viewNss = view.name();
+    auto previous = lookupBuild(opCtx, viewNss);
+    if (previous) {
+        removeBuild(opCtx, viewNss, previous);
+        opCtx->recoveryUnit()->onRollback(
+            [opCtx, viewNss, previous] { restoreBuild(opCtx, viewNss, previous); });
+    }
+
+    const NamespaceString backingNss = MaterializedViewPipeline::backingNamespace(viewNss);
+    uassertStatusOK(db->dropCollectionEvenIfSystem(opCtx, backingNss));
+    MaterializedViewMaintenance::build(opCtx, db, view);
+}
+
+/**
+ * Returns whether the backing collections of the materialized views in 'db' must be rebuilt for a
+ * change to the collections they are defined on.
+ */
+bool mustRebuild(OperationContext* opCtx, Database* db) {
+    // Secondaries receive the rebuild from the primary, and the backing collections of a database
+    // being dropped go with it.
+    return opCtx->writesAreReplicated() && !db->isDropPending(opCtx);
+}
+
+}  // namespace
+
+void MaterializedViewMaintenance::build(OperationContext* opCtx,
+                                        Database* db,
+                                        const ViewDefinition& view) {
+    invariant(opCtx->lockState()->isDbLockedForMode(db->name(), MODE_X));
+    invariant(view.isMaterialized());
+
+    const NamespaceString backingNss = MaterializedViewPipeline::backingNamespace(view.name());
+    db->createCollection(opCtx, backingNss.ns(), CollectionOptions());
+
+    // Secondaries receive the writes of the build on the primary to the backing collection.
+    if (!opCtx->writesAreReplicated()) {
+        return;
+    }
+
+    Collection* source = db->getCollection(opCtx, view.viewOn());
+    if (!source || source->numRecords(opCtx) == 0) {
+        // The view fills up as documents are inserted into the collection.
+        return;
+    }
+    uassert(ErrorCodes::OptionNotSupportedOnView,
+            str::stream() << "cannot create materialized view " << view.name().ns() << " on "
+                          << view.viewOn().ns()
+                          << ", which has no _id index",
+            source->getIndexCatalog()->findIdIndex(opCtx));
+
+    auto& builds = getMaterializedViewBuilds(opCtx->getServiceContext());
+    {
+        stdx::lock_guard<stdx::mutex> lk(builds.mutex);
+        auto inserted =
+            builds.inProgress.emplace(view.name().ns(), std::make_shared<BuildProgress>());
+        uassert(ErrorCodes::BackgroundOperationInProgressForNamespace,
+                str::stream() << "a previous build of materialized view " << view.name().ns()
+                              << " is still in progress",
+                inserted.second);
+    }
+
+    const NamespaceString viewNss = view.name();
+    opCtx->recoveryUnit()->onRollback([opCtx, viewNss] { removeBuild(opCtx, viewNss, nullptr); });
+}
+
+Status MaterializedViewMaintenance::populate(OperationContext* opCtx,
+                                             const NamespaceString& viewNss) {
+    auto progress = lookupBuild(opCtx, viewNss);
+    if (!progress) {
+        return Status::OK();
+    }
+
+    LOG(1) << "building materialized view " << viewNss;
+    try {
+        bool done = false;
+        while (!done) {
+            opCtx->checkForInterrupt();
+            done = writeConflictRetry(opCtx, "buildMaterializedView", viewNss.ns(), [&] {
+                AutoGetDb autoDb(opCtx, viewNss.db(), MODE_IX);
+                Database* db = autoDb.getDb();
+                auto view = db ? db->getViewCatalog()->lookup(opCtx, viewNss.ns()) : nullptr;
+                if (!view || lookupBuild(opCtx, viewNss) != progress) {
+                    // The view was dropped, or its build replaced by a rebuild.
+                    return true;
+                }
+
+                // Writers to the source collection wait for the batch, so the progress is
+                // advanced atomically with the backing collection writes.
+                Lock::CollectionLock sourceLock(opCtx->lockState(), view->viewOn().ns(), MODE_S);
+                Collection* source = db->getCollection(opCtx, view->viewOn());
+                if (!source) {
+                    // The build was replaced when the source collection was dropped or renamed.
+                    return true;
+                }
+                IndexDescriptor* idIndex = source->getIndexCatalog()->findIdIndex(opCtx);
+                invariant(idIndex);
+
+                auto exec = InternalPlanner::indexScan(
+                    opCtx,
+                    source,
+                    idIndex,
+                    progress->lastScannedKey ? *progress->lastScannedKey : BSON("" << MINKEY),
+                    BSON("" << MAXKEY),
+                    progress->lastScannedKey ? BoundInclusion::kIncludeEndKeyOnly
+                                             : BoundInclusion::kIncludeBothStartAndEndKeys,
+                    PlanExecutor::NO_YIELD,
+                    InternalPlanner::FORWARD,
+                    InternalPlanner::IXSCAN_FETCH);
+
+                auto pipeline = parsePipeline(opCtx, *view);
+                MaterializedViewDelta delta(pipeline.get());
+                BSONObj doc;
+                BSONObj lastId;
+                PlanExecutor::ExecState state = PlanExecutor::IS_EOF;
+                for (int n = 0; n < kBuildBatchSize; ++n) {
+                    state = exec->getNext(&doc, nullptr);
+                    if (state != PlanExecutor::ADVANCED) {
+                        break;
+                    }
+                    delta.addInsert(doc);
+                    lastId = doc["_id"].wrap();
+                }
+                if (state == PlanExecutor::FAILURE || state == PlanExecutor::DEAD) {
+                    uassertStatusOK(WorkingSetCommon::getMemberObjectStatus(doc));
+                }
+
+                if (!delta.isEmpty()) {
+                    WriteUnitOfWork wunit(opCtx);
+                    applyDelta(opCtx, db, *view, delta);
+                    wunit.commit();
+                }
+
+                if (state != PlanExecutor::ADVANCED) {
+                    removeBuild(opCtx, viewNss, progress);
+                    return true;
+                }
+                progress->lastScannedKey = idIndexKey(source, lastId);
+                return false;
+            });
+        }
+    } catch (const DBException& ex) {
+        removeBuild(opCtx, viewNss, progress);
+        warning() << "failed to build materialized view " << viewNss << ", dropping it: "
+                  << redact(ex.toStatus());
+        try {
+            writeConflictRetry(opCtx, "dropMaterializedView", viewNss.ns(), [&] {
+                Lock::DBLock dbLock(opCtx, viewNss.db(), MODE_X);
+                Database* db = dbHolder().get(opCtx, viewNss.db());
+                if (db && db->getViewCatalog()->lookup(opCtx, viewNss.ns())) {
+                    WriteUnitOfWork wunit(opCtx);
+                    uassertStatusOK(db->dropView(opCtx, viewNss.ns()));
+                    wunit.commit();
+                }
+            });
+        } catch (const DBException& dropEx) {
+            error() << "failed to drop materialized view " << viewNss
+                    << " after its build failed: " << redact(dropEx.toStatus());
+        }
+        return ex.toStatus();
+    }
+    return Status::OK();
+}
+
+void MaterializedViewMaintenance::drop(OperationContext* opCtx,
+                                       Database* db,
+                                       const ViewDefinition& view) {
+    invariant(opCtx->lockState()->isDbLockedForMode(db->name(), MODE_X));
+    invariant(view.isMaterialized());
+
+    const NamespaceString backingNss = MaterializedViewPipeline::backingNamespace(view.name());
+    uassertStatusOK(db->dropCollectionEvenIfSystem(opCtx, backingNss));
+
+    const NamespaceString viewNss = view.name();
+    opCtx->recoveryUnit()->onCommit([opCtx, viewNss] { removeBuild(opCtx, viewNss, nullptr); });
+}
+
+void MaterializedViewMaintenance::onInserts(OperationContext* opCtx,
+                                            const NamespaceString& nss,
+                                            std::vector<InsertStatement>::const_iterator begin,
+                                            std::vector<InsertStatement>::const_iterator end) {
+    auto views = materializedViewsToMaintain(opCtx, nss);
+    if (views.empty()) {
+        return;
+    }
+
+    std::vector<BSONObj> inserted;
+    for (auto it = begin; it != end; ++it) {
+        inserted.push_back(it->doc);
+    }
+    applyWrites(opCtx, nss, views, {}, inserted);
+}
+
+void MaterializedViewMaintenance::onUpdate(OperationContext* opCtx,
+                                           const NamespaceString& nss,
+                                           const BSONObj& preImageDoc,
+                                           const BSONObj& updatedDoc) {
+    auto views = materializedViewsToMaintain(opCtx, nss);
+    if (views.empty()) {
+        return;
+    }
+    applyWrites(opCtx, nss, views, {preImageDoc}, {updatedDoc});
+}
+
+void MaterializedViewMaintenance::aboutToDelete(OperationContext* opCtx,
+                                                const NamespaceString& nss,
+                                                const BSONObj& doc) {
+    auto& pending = pendingDeletedDoc(opCtx);
+    pending = boost::none;
+    if (!materializedViewsToMaintain(opCtx, nss).empty()) {
+        pending = doc.getOwned();
+    }
+}
+
+void MaterializedViewMaintenance::onDelete(OperationContext* opCtx, const NamespaceString& nss) {
+    auto& pending = pendingDeletedDoc(opCtx);
+    if (!pending) {
+        return;
+    }
+
+    BSONObj deletedDoc = std::move(*pending);
+    pending = boost::none;
+
+    auto views = materializedViewsToMaintain(opCtx, nss);
+    applyWrites(opCtx, nss, views, {deletedDoc}, {});
+}
+
+void MaterializedViewMaintenance::onDropCollection(OperationContext* opCtx,
+                                                   Database* db,
+                                                   const NamespaceString& nss) {
+    if (!mustRebuild(opCtx, db)) {
+        return;
+    }
+
+    // The collection is gone, so the rebuilt views are empty.
+    for (auto&& view : materializedViewsToMaintain(opCtx, nss)) {
+        rebuild(opCtx, db, *view);
+    }
+}
+
+void MaterializedViewMaintenance::onRenameCollection(OperationContext* opCtx,
+                                                     Database* db,
+                                                     const NamespaceString& from,
+                                                     const NamespaceString& to) {
+    invariant(opCtx->lockState()->isDbLockedForMode(db->name(), MODE_X));
+    if (!mustRebuild(opCtx, db)) {
+        return;
+    }
+
+    for (auto&& view : materializedViewsToMaintain(opCtx, from)) {
+        rebuild(opCtx, db, *view);
+    }
+    for (auto&& view : materializedViewsToMaintain(opCtx, to)) {
+        rebuild(opCtx, db, *view);
+    }
+}
+
+void MaterializedViewMaintenance::populateViewsOn(OperationContext* opCtx,
+                                                  const NamespaceString& nss) {
+    std::vector<NamespaceString> viewNames;
+    {
+        AutoGetDb autoDb(opCtx, nss.db(), MODE_IS);
+        Database* db = autoDb.getDb();
+        if (!db) {
+            return;
+        }
+        for (auto&& view : db->getViewCatalog()->lookupMaterializedViewsOn(opCtx, nss)) {
+            viewNames.push_back(view->name());
+        }
+    }
+
+    for (auto&& viewNss : viewNames) {
+        // populate() logs the failure and drops the view.
+        populate(opCtx, viewNss).ignore();
+    }
+}
+
+}  // namespace mongo
@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/bson/bsonobj.h"
+
+namespace mongo {
+
+class Database;
+class NamespaceString;
+class OperationContext;
+class ViewDefinition;
+struct InsertStatement;
+
+/**
+ * Keeps the backing collections of materialized views in step with the collections they are
+ * defined on. The OpObserver reports every write to a collection; writes to collections with
+ * materialized views are turned into rewrites of the affected groups in the backing
+ * collection, applied in the same WriteUnitOfWork as the write itself. Dropping or renaming a
+ * collection with materialized views drops their backing collections and builds them again.
+ *
+ * The backing collection writes are replicated like any other write, so maintenance only happens
+ * on the node that accepted the original write: it is skipped whenever writes are not replicated,
+ * which covers oplog application on secondaries and during initial sync.
+ */
+class MaterializedViewMaintenance {
+public:
+    /**
+     * Creates the empty backing collection for the materialized view 'view'. If the collection the
+     * view is defined on has documents, and this node accepted the write creating the view, the
+     * view is registered as being built and populate() must be called once the creation has
+     * committed.
+     *
+     * Must be called in a WriteUnitOfWork with the database locked in MODE_X.
+     */
+    static void build(OperationContext* opCtx, Database* db, const ViewDefinition& view);
+
+    /**
+     * Fills the backing collection of the materialized view 'viewNss' registered by build(), if
+     * any. The collection the view is defined on is scanned in _id order in batches, each applied
+     * in its own WriteUnitOfWork, and the locks taken for a batch are released before the next.
+     * While the build is in progress, writes are only reflected in the view for documents the
+     * scan has already passed; the scan picks up the others as it reaches them.
+     *
+     * If the build fails the view is dropped, and the error is returned.
+     *
+     * Must not be called in a WriteUnitOfWork.
+     */
+    static Status populate(OperationContext* opCtx, const NamespaceString& viewNss);
+
+    /**
+     * Drops the backing collection of the materialized view 'view'.
+     *
+     * Must be called in a WriteUnitOfWork with the database locked in MODE_X.
+     */
+    static void drop(OperationContext* opCtx, Database* db, const ViewDefinition& view);
+
+    /**
+     * Called by the OpObserver for writes to the collection 'nss'. Each updates the groups of the
+     * materialized views defined on 'nss' in the backing collections.
+     */
+    static void onInserts(OperationContext* opCtx,
+                          const NamespaceString& nss,
+                          std::vector<InsertStatement>::const_iterator begin,
+                          std::vector<InsertStatement>::const_iterator end);
+    static void onUpdate(OperationContext* opCtx,
+                         const NamespaceString& nss,
+                         const BSONObj& preImageDoc,
+                         const BSONObj& updatedDoc);
+
+    /**
+     * The OpObserver is only told the _id of a deleted document. Stashes the full document on
+     * 'opCtx' before it is deleted, if 'nss' has materialized views, so that the following
+     * onDelete() can remove it from its group.
+     */
+    static void aboutToDelete(OperationContext* opCtx,
+                              const NamespaceString& nss,
+                              const BSONObj& doc);
+    static void onDelete(OperationContext* opCtx, const NamespaceString& nss);
+
+    /**
+     * Called by Database::dropCollection() once the collection 'nss' has been dropped. Replaces
+     * the backing collections of the materialized views defined on 'nss' with empty ones.
+     */
+    static void onDropCollection(OperationContext* opCtx,
+                                 Database* db,
+                                 const NamespaceString& nss);
+
+    /**
+     * Called in the WriteUnitOfWork renaming the collection 'from' to 'to' within 'db', after the
+     * rename. The backing collections of the materialized views defined on either are dropped and
+     * built again: the views on 'from' are left empty, and the views on 'to' are registered to be
+     * built from the renamed collection, so populateViewsOn() must be called for 'to' once the
+     * rename has committed.
+     *
+     * Must be called with the database locked in MODE_X.
+     */
+    static void onRenameCollection(OperationContext* opCtx,
+                                   Database* db,
+                                   const NamespaceString& from,
+                                   const NamespaceString& to);
+
+    /**
+     * Calls populate() for each materialized view defined on 'nss'. Views whose build fails are
+     * dropped; the failure is logged.
+     *
+     * Must not be called in a WriteUnitOfWork.
+     */
+    static void populateViewsOn(OperationContext* opCtx, const NamespaceString& nss);
+};
+
+}  // namespace mongo
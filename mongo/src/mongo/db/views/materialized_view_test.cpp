@@ -0,0 +1,275 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "mongo/bson/bsonmisc.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bson/json.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/db/pipeline/expression_context_for_test.h"
+#include "mongo/db/views/materialized_view.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+std::vector<BSONObj> makePipeline(std::vector<std::string> stages) {
+    std::vector<BSONObj> pipeline;
+    for (auto&& stage : stages) {
+        pipeline.push_back(fromjson(stage));
+    }
+    return pipeline;
+}
+
+std::unique_ptr<MaterializedViewPipeline> parseOrFail(std::vector<std::string> stages) {
+    boost::intrusive_ptr<ExpressionContextForTest> expCtx(new ExpressionContextForTest());
+    auto status = MaterializedViewPipeline::parse(expCtx, makePipeline(std::move(stages)));
+    ASSERT_OK(status.getStatus());
+    return std::move(status.getValue());
+}
+
+/**
+ * Returns the _id of the backing document of the group with key 'key'.
+ */
+BSONObj groupId(const Value& key) {
+    return BSON("_id" << BSON("_mvKey" << key));
+}
+
+Status parseStatus(std::vector<std::string> stages) {
+    boost::intrusive_ptr<ExpressionContextForTest> expCtx(new ExpressionContextForTest());
+    return MaterializedViewPipeline::parse(expCtx, makePipeline(std::move(stages))).getStatus();
+}
+
+TEST(MaterializedViewPipelineTest, AcceptsMatchProjectAndDecomposableGroup) {
+    ASSERT_OK(parseStatus({"{$match: {a: {$gt: 0}}}",
+                           "{$project: {k: 1, v: {$multiply: ['$a', 2]}}}",
+                           "{$addFields: {w: 1}}",
+                           "{$group: {_id: '$k', total: {$sum: '$v'}, n: {$sum: 1}, "
+                           "avg: {$avg: '$v'}}}"}));
+}
+
+TEST(MaterializedViewPipelineTest, RejectsPipelineNotEndingInGroup) {
+    ASSERT_EQ(parseStatus({"{$match: {a: 1}}"}), ErrorCodes::OptionNotSupportedOnView);
+    ASSERT_EQ(parseStatus({"{$group: {_id: '$k'}}", "{$match: {a: 1}}"}),
+              ErrorCodes::OptionNotSupportedOnView);
+}
+
+TEST(MaterializedViewPipelineTest, RejectsNonDecomposableAccumulators) {
+    ASSERT_EQ(parseStatus({"{$group: {_id: '$k', m: {$max: '$v'}}}"}),
+              ErrorCodes::OptionNotSupportedOnView);
+    ASSERT_EQ(parseStatus({"{$group: {_id: '$k', p: {$push: '$v'}}}"}),
+              ErrorCodes::OptionNotSupportedOnView);
+}
+
+TEST(MaterializedViewPipelineTest, RejectsUnsupportedStages) {
+    ASSERT_EQ(parseStatus({"{$unwind: '$a'}", "{$group: {_id: '$k', n: {$sum: 1}}}"}),
+              ErrorCodes::OptionNotSupportedOnView);
+    ASSERT_EQ(parseStatus({"{$limit: 10}", "{$group: {_id: '$k', n: {$sum: 1}}}"}),
+              ErrorCodes::OptionNotSupportedOnView);
+}
+
+TEST(MaterializedViewPipelineTest, RejectsReservedFieldNames) {
+    ASSERT_EQ(parseStatus({"{$group: {_id: '$k', _mvCount: {$sum: 1}}}"}),
+              ErrorCodes::OptionNotSupportedOnView);
+    ASSERT_EQ(parseStatus({"{$group: {_id: '$k', _mvState: {$sum: 1}}}"}),
+              ErrorCodes::OptionNotSupportedOnView);
+}
+
+TEST(MaterializedViewPipelineTest, BackingNamespaceIsSystemCollectionInSameDatabase) {
+    const NamespaceString backingNss =
+        MaterializedViewPipeline::backingNamespace(NamespaceString("db.view"));
+    ASSERT_EQ(backingNss, NamespaceString("db.system.materialized.view"));
+    ASSERT(MaterializedViewPipeline::isBackingNamespace(backingNss));
+    ASSERT_FALSE(MaterializedViewPipeline::isBackingNamespace(NamespaceString("db.view")));
+}
+
+TEST(MaterializedViewPipelineTest, ReadPipelineFiltersEmptyGroupsAndUnwrapsGroupKeys) {
+    auto pipeline = parseOrFail({"{$group: {_id: '$k', total: {$sum: '$v'}, avg: {$avg: '$v'}}}"});
+    auto readPipeline = pipeline->readPipeline();
+    ASSERT_EQ(readPipeline.size(), 2UL);
+    ASSERT_BSONOBJ_EQ(readPipeline[0], fromjson("{$match: {_mvCount: {$gt: 0}}}"));
+    ASSERT_BSONOBJ_EQ(readPipeline[1],
+                      fromjson("{$project: {_id: '$_id._mvKey', total: true, avg: true}}"));
+}
+
+TEST(MaterializedViewDeltaTest, InsertsIntoSameGroupAreCombined) {
+    auto pipeline = parseOrFail({"{$group: {_id: '$k', total: {$sum: '$v'}}}"});
+    MaterializedViewDelta delta(pipeline.get());
+    delta.addInsert(BSON("_id" << 1 << "k"
+                               << "a"
+                               << "v"
+                               << 2));
+    delta.addInsert(BSON("_id" << 2 << "k"
+                               << "a"
+                               << "v"
+                               << 3));
+
+    auto groups = delta.changedGroups();
+    ASSERT_EQ(groups.size(), 1UL);
+    ASSERT_BSONOBJ_EQ(groups[0], groupId(Value("a"_sd)));
+
+    BSONObj backingDoc = delta.applyTo(groups[0], BSONObj());
+    ASSERT_BSONOBJ_EQ(backingDoc["_id"].wrap(), groups[0]);
+    ASSERT_EQ(backingDoc["_mvCount"].numberLong(), 2LL);
+    ASSERT_EQ(backingDoc["total"].type(), NumberInt);
+    ASSERT_EQ(backingDoc["total"].numberInt(), 5);
+}
+
+TEST(MaterializedViewDeltaTest, RemoveNegatesContribution) {
+    auto pipeline = parseOrFail({"{$group: {_id: '$k', total: {$sum: '$v'}, avg: {$avg: '$v'}}}"});
+    MaterializedViewDelta inserts(pipeline.get());
+    inserts.addInsert(BSON("_id" << 1 << "k" << 7 << "v" << 2.5));
+    inserts.addInsert(BSON("_id" << 2 << "k" << 7 << "v" << 1.5));
+    BSONObj backingDoc = inserts.applyTo(groupId(Value(7)), BSONObj());
+    ASSERT_EQ(backingDoc["total"].numberDouble(), 4.0);
+    ASSERT_EQ(backingDoc["avg"].numberDouble(), 2.0);
+
+    MaterializedViewDelta remove(pipeline.get());
+    remove.addRemove(BSON("_id" << 1 << "k" << 7 << "v" << 2.5));
+    backingDoc = remove.applyTo(groupId(Value(7)), backingDoc);
+    ASSERT_EQ(backingDoc["_mvCount"].numberLong(), 1LL);
+    ASSERT_EQ(backingDoc["total"].numberDouble(), 1.5);
+    ASSERT_EQ(backingDoc["avg"].numberDouble(), 1.5);
+
+    MaterializedViewDelta removeLast(pipeline.get());
+    removeLast.addRemove(BSON("_id" << 2 << "k" << 7 << "v" << 1.5));
+    backingDoc = removeLast.applyTo(groupId(Value(7)), backingDoc);
+    ASSERT_EQ(backingDoc["_mvCount"].numberLong(), 0LL);
+    ASSERT_EQ(backingDoc["avg"].type(), jstNULL);
+}
+
+TEST(MaterializedViewDeltaTest, RemovedDoublesDoNotLosePrecisionOfTheRest) {
+    auto pipeline = parseOrFail({"{$group: {_id: null, total: {$sum: '$v'}}}"});
+    MaterializedViewDelta inserts(pipeline.get());
+    inserts.addInsert(BSON("_id" << 1 << "v" << 1e20));
+    inserts.addInsert(BSON("_id" << 2 << "v" << 1.0));
+    BSONObj backingDoc = inserts.applyTo(groupId(Value(BSONNULL)), BSONObj());
+
+    // Adding and subtracting 1e20 as doubles would lose the 1.
+    MaterializedViewDelta remove(pipeline.get());
+    remove.addRemove(BSON("_id" << 1 << "v" << 1e20));
+    backingDoc = remove.applyTo(groupId(Value(BSONNULL)), backingDoc);
+    ASSERT_EQ(backingDoc["total"].type(), NumberDouble);
+    ASSERT_EQ(backingDoc["total"].numberDouble(), 1.0);
+}
+
+TEST(MaterializedViewDeltaTest, RemovingTheOnlyDoubleOrNaNRestoresTheSum) {
+    auto pipeline = parseOrFail({"{$group: {_id: null, total: {$sum: '$v'}}}"});
+    MaterializedViewDelta inserts(pipeline.get());
+    inserts.addInsert(BSON("_id" << 1 << "v" << 1));
+    inserts.addInsert(BSON("_id" << 2 << "v" << std::numeric_limits<double>::quiet_NaN()));
+    BSONObj backingDoc = inserts.applyTo(groupId(Value(BSONNULL)), BSONObj());
+    ASSERT(std::isnan(backingDoc["total"].numberDouble()));
+
+    MaterializedViewDelta remove(pipeline.get());
+    remove.addRemove(BSON("_id" << 2 << "v" << std::numeric_limits<double>::quiet_NaN()));
+    backingDoc = remove.applyTo(groupId(Value(BSONNULL)), backingDoc);
+    ASSERT_EQ(backingDoc["total"].type(), NumberInt);
+    ASSERT_EQ(backingDoc["total"].numberInt(), 1);
+}
+
+TEST(MaterializedViewDeltaTest, UpdateWithinGroupOnlyAdjustsSums) {
+    auto pipeline = parseOrFail({"{$group: {_id: '$k', total: {$sum: '$v'}}}"});
+    MaterializedViewDelta delta(pipeline.get());
+    delta.addRemove(BSON("_id" << 1 << "k" << 1 << "v" << 10));
+    delta.addInsert(BSON("_id" << 1 << "k" << 1 << "v" << 4));
+
+    auto groups = delta.changedGroups();
+    ASSERT_EQ(groups.size(), 1UL);
+    BSONObj backingDoc = delta.applyTo(groups[0], BSONObj());
+    ASSERT_EQ(backingDoc["_mvCount"].numberLong(), 0LL);
+    ASSERT_EQ(backingDoc["total"].numberInt(), -6);
+}
+
+TEST(MaterializedViewDeltaTest, UpdateNotAffectingViewProducesNoWrites) {
+    auto pipeline = parseOrFail({"{$group: {_id: '$k', total: {$sum: '$v'}}}"});
+    MaterializedViewDelta delta(pipeline.get());
+    delta.addRemove(BSON("_id" << 1 << "k" << 1 << "v" << 10 << "other" << 1));
+    delta.addInsert(BSON("_id" << 1 << "k" << 1 << "v" << 10 << "other" << 2));
+
+    ASSERT_FALSE(delta.isEmpty());
+    ASSERT_EQ(delta.changedGroups().size(), 0UL);
+}
+
+TEST(MaterializedViewDeltaTest, UpdateMovingDocumentBetweenGroupsTouchesBoth) {
+    auto pipeline = parseOrFail({"{$group: {_id: '$k', n: {$sum: 1}}}"});
+    MaterializedViewDelta delta(pipeline.get());
+    delta.addRemove(BSON("_id" << 1 << "k" << 1));
+    delta.addInsert(BSON("_id" << 1 << "k" << 2));
+
+    auto groups = delta.changedGroups();
+    ASSERT_EQ(groups.size(), 2UL);
+    ASSERT_BSONOBJ_EQ(groups[0], groupId(Value(1)));
+    ASSERT_EQ(delta.applyTo(groups[0], BSONObj())["n"].numberInt(), -1);
+    ASSERT_BSONOBJ_EQ(groups[1], groupId(Value(2)));
+    ASSERT_EQ(delta.applyTo(groups[1], BSONObj())["n"].numberInt(), 1);
+}
+
+TEST(MaterializedViewDeltaTest, ArrayGroupKeysAreWrappedInTheId) {
+    auto pipeline = parseOrFail({"{$group: {_id: '$k', n: {$sum: 1}}}"});
+    MaterializedViewDelta delta(pipeline.get());
+    delta.addInsert(BSON("_id" << 1 << "k" << BSON_ARRAY(1 << 2)));
+
+    auto groups = delta.changedGroups();
+    ASSERT_EQ(groups.size(), 1UL);
+    ASSERT_BSONOBJ_EQ(groups[0], BSON("_id" << BSON("_mvKey" << BSON_ARRAY(1 << 2))));
+}
+
+TEST(MaterializedViewDeltaTest, FilteredDocumentsDoNotContribute) {
+    auto pipeline =
+        parseOrFail({"{$match: {v: {$gt: 5}}}", "{$group: {_id: null, total: {$sum: '$v'}}}"});
+    MaterializedViewDelta delta(pipeline.get());
+    delta.addInsert(BSON("_id" << 1 << "v" << 3));
+    ASSERT_TRUE(delta.isEmpty());
+
+    delta.addInsert(BSON("_id" << 2 << "v" << 6));
+    auto groups = delta.changedGroups();
+    ASSERT_EQ(groups.size(), 1UL);
+    ASSERT_BSONOBJ_EQ(groups[0], groupId(Value(BSONNULL)));
+}
+
+TEST(MaterializedViewDeltaTest, ProjectionRunsBeforeGroup) {
+    auto pipeline = parseOrFail({"{$project: {g: {$mod: ['$x', 2]}, v: '$y'}}",
+                                 "{$group: {_id: '$g', total: {$sum: '$v'}}}"});
+    MaterializedViewDelta delta(pipeline.get());
+    delta.addInsert(BSON("_id" << 1 << "x" << 3 << "y" << 10));
+
+    auto groups = delta.changedGroups();
+    ASSERT_EQ(groups.size(), 1UL);
+    ASSERT_BSONOBJ_EQ(groups[0], groupId(Value(1)));
+    ASSERT_EQ(delta.applyTo(groups[0], BSONObj())["total"].numberInt(), 10);
+}
+
+}  // namespace
+}  // namespace mongo
@@ -46,12 +46,15 @@ public:
     /**
      * In the database 'dbName', create a new view 'viewName' on the view or collection
      * 'viewOnName'. Neither 'viewName' nor 'viewOnName' should include the name of the database.
+     * A 'materialized' view stores its results in a backing collection instead of re-running its
+     * pipeline on every read.
      */
     ViewDefinition(StringData dbName,
                    StringData viewName,
                    StringData viewOnName,
                    const BSONObj& pipeline,
-                   std::unique_ptr<CollatorInterface> collation);
+                   std::unique_ptr<CollatorInterface> collation,
+                   bool materialized = false);
 
     /**
      * Copying a view 'other' clones its collator and does a simple copy of all other fields.
@@ -89,6 +92,14 @@ public:
         return _collator.get();
     }
 
+    /**
+     * Returns whether the results of this view are stored in a backing collection which is kept
+     * up to date as the underlying collection changes.
+     */
+    bool isMaterialized() const {
+        return _materialized;
+    }
+
     void setViewOn(const NamespaceString& viewOnNss);
 
     /**
@@ -101,5 +112,6 @@ private:
     NamespaceString _viewOnNss;
     std::unique_ptr<CollatorInterface> _collator;
     std::vector<BSONObj> _pipeline;
+    bool _materialized = false;
 };
 }  // namespace mongo
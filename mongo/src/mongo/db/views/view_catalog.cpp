@@ -38,7 +38,9 @@
 #include "mongo/base/status_with.h"
 #include "mongo/base/string_data.h"
 #include "mongo/bson/util/builder.h"
+#include "mongo/base/counter.h"
 #include "mongo/db/commands/feature_compatibility_version_command_parser.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/operation_context.h"
 #include "mongo/db/pipeline/aggregation_request.h"
@@ -52,6 +54,7 @@
 #include "mongo/db/query/collation/collator_factory_interface.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/recovery_unit.h"
+#include "mongo/db/views/materialized_view.h"
 #include "mongo/db/views/resolved_view.h"
 #include "mongo/db/views/view.h"
 #include "mongo/db/views/view_graph.h"
@@ -59,6 +62,17 @@
 
 namespace mongo {
 namespace {
+
+// Counts how often resolveView() found a view in the resolved view cache. Together these give the
+// hit rate of the cache.
+Counter64 resolvedViewCacheHits;
+Counter64 resolvedViewCacheMisses;
+
+ServerStatusMetricField<Counter64> displayResolvedViewCacheHits("views.resolvedViewCache.hits",
+                                                                &resolvedViewCacheHits);
+ServerStatusMetricField<Counter64> displayResolvedViewCacheMisses(
+    "views.resolvedViewCache.misses", &resolvedViewCacheMisses);
+
 StatusWith<std::unique_ptr<CollatorInterface>> parseCollator(OperationContext* opCtx,
                                                              BSONObj collationSpec) {
     // If 'collationSpec' is empty, return the null collator, which represents the "simple"
@@ -142,6 +156,9 @@ Status ViewCatalog::_reloadIfNeeded_inlock(OperationContext* opCtx) {
 
     // Need to reload, first clear our cache.
     _viewMap.clear();
+    _resolvedViews.clear();
+    _parsedPipelines.clear();
+    _hasMaterializedViews.store(false);
 
     Status status = _durable->iterate(opCtx, [&](const BSONObj& view) -> Status {
         BSONObj collationSpec = view.hasField("collation") ? view["collation"].Obj() : BSONObj();
@@ -163,11 +180,17 @@ Status ViewCatalog::_reloadIfNeeded_inlock(OperationContext* opCtx) {
             }
         }
 
+        const bool materialized = view["materialized"].trueValue();
+        if (materialized) {
+            _hasMaterializedViews.store(true);
+        }
+
         _viewMap[viewName.ns()] = std::make_shared<ViewDefinition>(viewName.db(),
                                                                    viewName.coll(),
                                                                    view["viewOn"].str(),
                                                                    pipeline,
-                                                                   std::move(collator.getValue()));
+                                                                   std::move(collator.getValue()),
+                                                                   materialized);
         return Status::OK();
     });
     _valid.store(status.isOK());
@@ -192,7 +215,8 @@ Status ViewCatalog::_createOrUpdateView_inlock(OperationContext* opCtx,
                                                const NamespaceString& viewName,
                                                const NamespaceString& viewOn,
                                                const BSONArray& pipeline,
-                                               std::unique_ptr<CollatorInterface> collator) {
+                                               std::unique_ptr<CollatorInterface> collator,
+                                               bool materialized) {
     _requireValidCatalog_inlock(opCtx);
 
     // Build the BSON definition for this view to be saved in the durable view catalog. If the
@@ -204,10 +228,17 @@ Status ViewCatalog::_createOrUpdateView_inlock(OperationContext* opCtx,
     if (collator) {
         viewDefBuilder.append("collation", collator->getSpec().toBSON());
     }
+    if (materialized) {
+        viewDefBuilder.append("materialized", true);
+    }
 
     BSONObj ownedPipeline = pipeline.getOwned();
-    auto view = std::make_shared<ViewDefinition>(
-        viewName.db(), viewName.coll(), viewOn.coll(), ownedPipeline, std::move(collator));
+    auto view = std::make_shared<ViewDefinition>(viewName.db(),
+                                                 viewName.coll(),
+                                                 viewOn.coll(),
+                                                 ownedPipeline,
+                                                 std::move(collator),
+                                                 materialized);
 
     // Check that the resulting dependency graph is acyclic and within the maximum depth.
     Status graphStatus = _upsertIntoGraph(opCtx, *(view.get()));
@@ -217,8 +248,15 @@ Status ViewCatalog::_createOrUpdateView_inlock(OperationContext* opCtx,
 
     _durable->upsert(opCtx, viewName, viewDefBuilder.obj());
     _viewMap[viewName.ns()] = view;
+    _resolvedViews.clear();
+    _parsedPipelines.clear();
+    if (materialized) {
+        _hasMaterializedViews.store(true);
+    }
     opCtx->recoveryUnit()->onRollback([this, viewName]() {
         this->_viewMap.erase(viewName.ns());
+        this->_resolvedViews.clear();
+        this->_parsedPipelines.clear();
         this->_viewGraphNeedsRefresh = true;
     });
 
@@ -325,6 +363,13 @@ StatusWith<stdx::unordered_set<NamespaceString>> ViewCatalog::_validatePipeline_
         }
     }
 
+    if (viewDef.isMaterialized()) {
+        auto materializedStatus = MaterializedViewPipeline::parse(expCtx, viewDef.pipeline());
+        if (!materializedStatus.isOK()) {
+            return materializedStatus.getStatus();
+        }
+    }
+
     return std::move(involvedNamespaces);
 }
 
@@ -349,7 +394,8 @@ Status ViewCatalog::createView(OperationContext* opCtx,
                                const NamespaceString& viewName,
                                const NamespaceString& viewOn,
                                const BSONArray& pipeline,
-                               const BSONObj& collation) {
+                               const BSONObj& collation,
+                               bool materialized) {
     stdx::lock_guard<stdx::mutex> lk(_mutex);
 
     if (viewName.db() != viewOn.db())
@@ -372,8 +418,18 @@ Status ViewCatalog::createView(OperationContext* opCtx,
     if (!collator.isOK())
         return collator.getStatus();
 
+    if (materialized) {
+        if (_lookup_inlock(opCtx, viewOn.ns()))
+            return Status(ErrorCodes::OptionNotSupportedOnView,
+                          "A materialized view must be defined directly on a collection");
+
+        if (collator.getValue())
+            return Status(ErrorCodes::OptionNotSupportedOnView,
+                          "A materialized view must use the simple collation");
+    }
+
     return _createOrUpdateView_inlock(
-        opCtx, viewName, viewOn, pipeline, std::move(collator.getValue()));
+        opCtx, viewName, viewOn, pipeline, std::move(collator.getValue()), materialized);
 }
 
 Status ViewCatalog::modifyView(OperationContext* opCtx,
@@ -395,9 +451,16 @@ Status ViewCatalog::modifyView(OperationContext* opCtx,
         return Status(ErrorCodes::InvalidNamespace,
                       str::stream() << "invalid name for 'viewOn': " << viewOn.coll());
 
+    if (viewPtr->isMaterialized())
+        return Status(ErrorCodes::OptionNotSupportedOnView,
+                      str::stream() << "cannot modify materialized view " << viewName.ns()
+                                    << "; drop and recreate it instead");
+
     ViewDefinition savedDefinition = *viewPtr;
     opCtx->recoveryUnit()->onRollback([this, opCtx, viewName, savedDefinition]() {
         this->_viewMap[viewName.ns()] = std::make_shared<ViewDefinition>(savedDefinition);
+        this->_resolvedViews.clear();
+        this->_parsedPipelines.clear();
     });
 
     return _createOrUpdateView_inlock(
@@ -405,7 +468,8 @@ Status ViewCatalog::modifyView(OperationContext* opCtx,
         viewName,
         viewOn,
         pipeline,
-        CollatorInterface::cloneCollator(savedDefinition.defaultCollator()));
+        CollatorInterface::cloneCollator(savedDefinition.defaultCollator()),
+        false);
 }
 
 Status ViewCatalog::dropView(OperationContext* opCtx, const NamespaceString& viewName) {
@@ -425,9 +489,13 @@ Status ViewCatalog::dropView(OperationContext* opCtx, const NamespaceString& vie
     _durable->remove(opCtx, viewName);
     _viewGraph.remove(savedDefinition.name());
     _viewMap.erase(viewName.ns());
+    _resolvedViews.clear();
+    _parsedPipelines.clear();
     opCtx->recoveryUnit()->onRollback([this, opCtx, viewName, savedDefinition]() {
         this->_viewGraphNeedsRefresh = true;
         this->_viewMap[viewName.ns()] = std::make_shared<ViewDefinition>(savedDefinition);
+        this->_resolvedViews.clear();
+        this->_parsedPipelines.clear();
     });
 
     // We may get invalidated, but we're exclusively locked, so the change must be ours.
@@ -464,12 +532,78 @@ std::shared_ptr<ViewDefinition> ViewCatalog::lookup(OperationContext* opCtx, Str
     return _lookup_inlock(opCtx, ns);
 }
 
-StatusWith<ResolvedView> ViewCatalog::resolveView(OperationContext* opCtx,
-                                                  const NamespaceString& nss) {
+std::vector<std::shared_ptr<ViewDefinition>> ViewCatalog::lookupMaterializedViewsOn(
+    OperationContext* opCtx, const NamespaceString& nss) {
+    std::vector<std::shared_ptr<ViewDefinition>> views;
+    if (_valid.load() && !_hasMaterializedViews.load())
+        return views;
+
     stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (!_valid.load() && !_reloadIfNeeded_inlock(opCtx).isOK())
+        return views;
+
+    for (auto&& view : _viewMap) {
+        if (view.second->isMaterialized() && view.second->viewOn() == nss)
+            views.push_back(view.second);
+    }
+    return views;
+}
+
+StatusWith<ResolvedView> ViewCatalog::resolveView(
+    OperationContext* opCtx,
+    const NamespaceString& nss,
+    std::shared_ptr<const LiteParsedPipeline>* parsedPipeline) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+
+    auto parse = [&](const ResolvedView& view) {
+        return std::make_shared<const LiteParsedPipeline>(
+            AggregationRequest(view.getNamespace(), view.getPipeline()));
+    };
+
+    // The cache is cleared whenever the catalog is reloaded, so it may only be consulted while the
+    // catalog is valid.
+    if (_valid.load()) {
+        auto it = _resolvedViews.find(nss.ns());
+        if (it != _resolvedViews.end()) {
+            resolvedViewCacheHits.increment();
+            if (parsedPipeline) {
+                auto& parsed = _parsedPipelines[nss.ns()];
+                if (!parsed) {
+                    parsed = parse(it->second);
+                }
+                *parsedPipeline = parsed;
+            }
+            return it->second;
+        }
+    }
+
+    auto resolvedView = _resolveView_inlock(opCtx, nss);
+    if (!resolvedView.isOK()) {
+        return resolvedView;
+    }
+
+    std::shared_ptr<const LiteParsedPipeline> parsed;
+    if (parsedPipeline) {
+        parsed = parse(resolvedView.getValue());
+        *parsedPipeline = parsed;
+    }
+
+    if (_valid.load() && resolvedView.getValue().getNamespace() != nss) {
+        resolvedViewCacheMisses.increment();
+        _resolvedViews.emplace(nss.ns(), resolvedView.getValue());
+        if (parsed) {
+            _parsedPipelines[nss.ns()] = std::move(parsed);
+        }
+    }
+    return resolvedView;
+}
+
+StatusWith<ResolvedView> ViewCatalog::_resolveView_inlock(OperationContext* opCtx,
+                                                          const NamespaceString& nss) {
     const NamespaceString* resolvedNss = &nss;
     std::vector<BSONObj> resolvedPipeline;
     BSONObj collation;
+    NamespaceString backingNss;
 
     for (int i = 0; i < ViewGraph::kMaxViewDepth; i++) {
         auto view = _lookup_inlock(opCtx, resolvedNss->ns());
@@ -488,10 +622,28 @@ StatusWith<ResolvedView> ViewCatalog::resolveView(OperationContext* opCtx,
                 {*resolvedNss, std::move(resolvedPipeline), std::move(collation)});
         }
 
-        resolvedNss = &(view->viewOn());
         collation = view->defaultCollator() ? view->defaultCollator()->getSpec().toBSON()
                                             : CollationSpec::kSimpleSpec;
 
+        // A materialized view reads its precomputed results from the backing collection rather
+        // than running its pipeline over 'viewOn'.
+        if (view->isMaterialized()) {
+            boost::intrusive_ptr<ExpressionContext> expCtx = new ExpressionContext(opCtx, nullptr);
+            auto materialized = MaterializedViewPipeline::parse(expCtx, view->pipeline());
+            if (!materialized.isOK()) {
+                return materialized.getStatus();
+            }
+
+            backingNss = MaterializedViewPipeline::backingNamespace(view->name());
+            resolvedNss = &backingNss;
+            auto readPipeline = materialized.getValue()->readPipeline();
+            resolvedPipeline.insert(
+                resolvedPipeline.begin(), readPipeline.begin(), readPipeline.end());
+            continue;
+        }
+
+        resolvedNss = &(view->viewOn());
+
         // Prepend the underlying view's pipeline to the current working pipeline.
         const std::vector<BSONObj>& toPrepend = view->pipeline();
         resolvedPipeline.insert(resolvedPipeline.begin(), toPrepend.begin(), toPrepend.end());
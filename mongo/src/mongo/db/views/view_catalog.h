@@ -47,6 +47,7 @@
 #include "mongo/util/string_map.h"
 
 namespace mongo {
+class LiteParsedPipeline;
 class OperationContext;
 
 /**
@@ -79,13 +80,18 @@ public:
      * database's catalog, so the check for an existing collection with the same name must be done
      * before calling createView.
      *
+     * If 'materialized' is true, the pipeline must be maintainable incrementally (see
+     * MaterializedViewPipeline) and 'viewOn' must be a collection. Creating and populating the
+     * backing collection is up to the caller.
+     *
      * Must be in WriteUnitOfWork. View creation rolls back if the unit of work aborts.
      */
     Status createView(OperationContext* opCtx,
                       const NamespaceString& viewName,
                       const NamespaceString& viewOn,
                       const BSONArray& pipeline,
-                      const BSONObj& collation);
+                      const BSONObj& collation,
+                      bool materialized = false);
 
     /**
      * Drop the view named 'viewName'.
@@ -110,12 +116,28 @@ public:
      */
     std::shared_ptr<ViewDefinition> lookup(OperationContext* opCtx, StringData nss);
 
+    /**
+     * Returns the materialized views defined directly on the collection 'nss'. This is called for
+     * every write, so it returns without taking the catalog mutex when the database has no
+     * materialized views.
+     */
+    std::vector<std::shared_ptr<ViewDefinition>> lookupMaterializedViewsOn(
+        OperationContext* opCtx, const NamespaceString& nss);
+
     /**
      * Resolve the views on 'nss', transforming the pipeline appropriately. This function returns a
      * fully-resolved view definition containing the backing namespace, the resolved pipeline and
      * the collation to use for the operation.
+     *
+     * If 'parsedPipeline' is not null, it is set to the resolved pipeline parsed into a
+     * LiteParsedPipeline, which callers use to find the other namespaces the view reads from.
+     *
+     * Resolved views and their parsed pipelines are cached until any view in the catalog changes.
      */
-    StatusWith<ResolvedView> resolveView(OperationContext* opCtx, const NamespaceString& nss);
+    StatusWith<ResolvedView> resolveView(
+        OperationContext* opCtx,
+        const NamespaceString& nss,
+        std::shared_ptr<const LiteParsedPipeline>* parsedPipeline = nullptr);
 
     /**
      * Reload the views catalog if marked invalid. No-op if already valid. Does only minimal
@@ -140,7 +162,8 @@ private:
                                       const NamespaceString& viewName,
                                       const NamespaceString& viewOn,
                                       const BSONArray& pipeline,
-                                      std::unique_ptr<CollatorInterface> collator);
+                                      std::unique_ptr<CollatorInterface> collator,
+                                      bool materialized);
     /**
      * Parses the view definition pipeline, attempts to upsert into the view graph, and refreshes
      * the graph if necessary. Returns an error status if the resulting graph would be invalid.
@@ -163,6 +186,9 @@ private:
                                      const std::vector<NamespaceString>& refs);
 
     std::shared_ptr<ViewDefinition> _lookup_inlock(OperationContext* opCtx, StringData ns);
+
+    StatusWith<ResolvedView> _resolveView_inlock(OperationContext* opCtx,
+                                                 const NamespaceString& nss);
     Status _reloadIfNeeded_inlock(OperationContext* opCtx);
 
     void _requireValidCatalog_inlock(OperationContext* opCtx) {
@@ -172,8 +198,15 @@ private:
 
     stdx::mutex _mutex;  // Protects all members, except for _valid.
     ViewMap _viewMap;
+
+    // Views which have been resolved since the view definitions last changed, by namespace. A view
+    // depends on the definitions of the views it is defined on, so any change clears all of them.
+    std::map<std::string, ResolvedView> _resolvedViews;
+    // The pipelines of '_resolvedViews' parsed on request, cleared along with them.
+    std::map<std::string, std::shared_ptr<const LiteParsedPipeline>> _parsedPipelines;
     DurableViewCatalog* _durable;
     AtomicBool _valid;
+    AtomicBool _hasMaterializedViews;  // Only reset when the catalog is reloaded.
     ViewGraph _viewGraph;
     bool _viewGraphNeedsRefresh = true;  // Defers initializing the graph until the first insert.
 };
@@ -39,6 +39,7 @@
 #include "mongo/bson/bsonobjbuilder.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/pipeline/lite_parsed_pipeline.h"
 #include "mongo/db/query/collation/collator_factory_interface.h"
 #include "mongo/db/query/query_test_service_context.h"
 #include "mongo/db/repl/replication_coordinator_mock.h"
@@ -642,6 +643,82 @@ TEST_F(ViewCatalogFixture, ResolveViewCorrectlyExtractsDefaultCollation) {
                       expectedCollation.getValue()->getSpec().toBSON());
 }
 
+TEST_F(ViewCatalogFixture, ResolveViewReflectsChangesToUnderlyingViewsAfterCaching) {
+    const NamespaceString view1("db.view1");
+    const NamespaceString view2("db.view2");
+    const NamespaceString viewOn("db.coll");
+    const BSONObj match1 = BSON("$match" << BSON("foo" << 1));
+    const BSONObj match2 = BSON("$match" << BSON("foo" << 2));
+    const BSONObj match3 = BSON("$match" << BSON("foo" << 3));
+
+    ASSERT_OK(
+        viewCatalog.createView(opCtx.get(), view1, viewOn, BSON_ARRAY(match1), emptyCollation));
+    ASSERT_OK(
+        viewCatalog.createView(opCtx.get(), view2, view1, BSON_ARRAY(match2), emptyCollation));
+
+    auto assertResolvesTo = [&](const NamespaceString& view,
+                                const NamespaceString& expectedNss,
+                                const std::vector<BSONObj>& expectedPipeline) {
+        // Resolve twice so that the second result comes from the cache.
+        for (int i = 0; i < 2; ++i) {
+            auto resolvedView = viewCatalog.resolveView(opCtx.get(), view);
+            ASSERT_OK(resolvedView.getStatus());
+            ASSERT_EQ(resolvedView.getValue().getNamespace(), expectedNss);
+            const auto& pipeline = resolvedView.getValue().getPipeline();
+            ASSERT_EQ(expectedPipeline.size(), pipeline.size());
+            ASSERT(std::equal(expectedPipeline.begin(),
+                              expectedPipeline.end(),
+                              pipeline.begin(),
+                              SimpleBSONObjComparator::kInstance.makeEqualTo()));
+        }
+    };
+
+    assertResolvesTo(view2, viewOn, {match1, match2});
+
+    ASSERT_OK(viewCatalog.modifyView(opCtx.get(), view1, viewOn, BSON_ARRAY(match3)));
+    assertResolvesTo(view1, viewOn, {match3});
+    assertResolvesTo(view2, viewOn, {match3, match2});
+
+    ASSERT_OK(viewCatalog.dropView(opCtx.get(), view1));
+    assertResolvesTo(view2, view1, {match2});
+
+    // The durable catalog is empty, so reloading it removes the remaining view.
+    viewCatalog.invalidate();
+    assertResolvesTo(view2, view2, {});
+}
+
+TEST_F(ViewCatalogFixture, ResolveViewCachesParsedPipelineUntilViewsChange) {
+    const NamespaceString viewName("db.view");
+    const NamespaceString viewOn("db.coll");
+    const BSONObj lookup = BSON("$lookup" << BSON("from"
+                                                  << "fcoll"
+                                                  << "as"
+                                                  << "as"
+                                                  << "pipeline"
+                                                  << BSONArray()));
+
+    ASSERT_OK(viewCatalog.createView(
+        opCtx.get(), viewName, viewOn, BSON_ARRAY(lookup), emptyCollation));
+
+    std::shared_ptr<const LiteParsedPipeline> first;
+    ASSERT_OK(viewCatalog.resolveView(opCtx.get(), viewName, &first).getStatus());
+    ASSERT(first);
+    ASSERT(first->getInvolvedNamespaces().count(NamespaceString("db.fcoll")));
+
+    std::shared_ptr<const LiteParsedPipeline> second;
+    ASSERT_OK(viewCatalog.resolveView(opCtx.get(), viewName, &second).getStatus());
+    ASSERT_EQ(first.get(), second.get());
+
+    ASSERT_OK(viewCatalog.modifyView(
+        opCtx.get(), viewName, viewOn, BSON_ARRAY(BSON("$match" << BSON("x" << 1)))));
+
+    std::shared_ptr<const LiteParsedPipeline> third;
+    ASSERT_OK(viewCatalog.resolveView(opCtx.get(), viewName, &third).getStatus());
+    ASSERT(third);
+    ASSERT_NOT_EQUALS(first.get(), third.get());
+    ASSERT(third->getInvolvedNamespaces().count(NamespaceString("db.fcoll")) == 0);
+}
+
 TEST_F(ViewCatalogFixture, InvalidateThenReload) {
     const NamespaceString viewName("db.view");
     const NamespaceString viewOn("db.coll");
@@ -0,0 +1,163 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/client/dbclientcursor.h"
+#include "mongo/db/client.h"
+#include "mongo/db/dbdirectclient.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/dbtests/dbtests.h"
+#include "mongo/util/timer.h"
+
+namespace IdPointOperations {
+
+const char* const kDb = "unittests";
+const char* const kColl = "id_point_operations";
+const char* const kNs = "unittests.id_point_operations";
+
+const int kNumDocs = 1000;
+const int kNumOps = 20000;
+
+/**
+ * Compares exact _id finds, updates and deletes served directly from the _id index against the
+ * same operations run through a PlanExecutor, and logs the throughput of each.
+ */
+class Base {
+public:
+    Base() : _opCtxPtr(cc().makeOperationContext()), _client(_opCtxPtr.get()) {
+        _client.dropCollection(kNs);
+        for (int i = 0; i < kNumDocs; ++i) {
+            _client.insert(kNs, BSON("_id" << i << "x" << 0 << "s" << std::string(100, 'a')));
+        }
+    }
+
+    virtual ~Base() {
+        internalQueryEnableIdPointOperations.store(_savedKnob);
+        _client.dropCollection(kNs);
+    }
+
+protected:
+    BSONObj findById(int id) {
+        BSONObj reply;
+        BSONObj cmd = BSON("find" << kColl << "filter" << BSON("_id" << id));
+        ASSERT(_client.runCommand(kDb, cmd, reply)) << reply;
+        ASSERT_EQ(0LL, reply["cursor"]["id"].numberLong());
+        std::vector<BSONElement> batch = reply["cursor"]["firstBatch"].Array();
+        return batch.empty() ? BSONObj() : batch[0].Obj().getOwned();
+    }
+
+    void logThroughput(StringData what, bool fastPath, const Timer& timer) {
+        const double seconds = std::max(timer.micros(), 1LL) / 1000000.0;
+        unittest::log() << what << (fastPath ? " with" : " without")
+                        << " the _id point path: " << static_cast<long long>(kNumOps / seconds)
+                        << " ops/sec";
+    }
+
+    const ServiceContext::UniqueOperationContext _opCtxPtr;
+    DBDirectClient _client;
+
+private:
+    const bool _savedKnob = internalQueryEnableIdPointOperations.load();
+};
+
+class PointReads : public Base {
+public:
+    void run() {
+        for (bool fastPath : {false, true}) {
+            internalQueryEnableIdPointOperations.store(fastPath);
+
+            Timer timer;
+            for (int i = 0; i < kNumOps; ++i) {
+                BSONObj doc = findById(i % kNumDocs);
+                ASSERT_EQ(i % kNumDocs, doc["_id"].numberInt());
+            }
+            logThroughput("point reads", fastPath, timer);
+
+            ASSERT(findById(kNumDocs).isEmpty());
+        }
+    }
+};
+
+class PointUpdates : public Base {
+public:
+    void run() {
+        int expected = 0;
+        for (bool fastPath : {false, true}) {
+            internalQueryEnableIdPointOperations.store(fastPath);
+
+            Timer timer;
+            for (int i = 0; i < kNumOps; ++i) {
+                _client.update(kNs, BSON("_id" << i % kNumDocs), BSON("$inc" << BSON("x" << 1)));
+            }
+            logThroughput("point updates", fastPath, timer);
+            expected += kNumOps / kNumDocs;
+
+            for (int id = 0; id < kNumDocs; ++id) {
+                ASSERT_EQ(expected, findById(id)["x"].numberInt());
+            }
+
+            // An update which matches no document does not upsert unless asked to.
+            _client.update(kNs, BSON("_id" << kNumDocs), BSON("$set" << BSON("x" << 1)));
+            ASSERT(findById(kNumDocs).isEmpty());
+            _client.update(kNs, BSON("_id" << kNumDocs), BSON("$set" << BSON("x" << 1)), true);
+            ASSERT_EQ(1, findById(kNumDocs)["x"].numberInt());
+            _client.remove(kNs, BSON("_id" << kNumDocs));
+            ASSERT(findById(kNumDocs).isEmpty());
+        }
+    }
+};
+
+class PointDeletes : public Base {
+public:
+    void run() {
+        internalQueryEnableIdPointOperations.store(true);
+        for (int id = 0; id < kNumDocs; id += 2) {
+            _client.remove(kNs, BSON("_id" << id));
+        }
+        ASSERT_EQ(static_cast<unsigned long long>(kNumDocs / 2), _client.count(kNs));
+        for (int id = 0; id < kNumDocs; ++id) {
+            ASSERT_EQ(id % 2 == 0, findById(id).isEmpty());
+        }
+    }
+};
+
+class All : public Suite {
+public:
+    All() : Suite("id_point_operations") {}
+
+    void setupTests() {
+        add<PointReads>();
+        add<PointUpdates>();
+        add<PointDeletes>();
+    }
+};
+
+SuiteInstance<All> idPointOperations;
+
+}  // namespace IdPointOperations
@@ -0,0 +1,281 @@
+/**
+ *    Copyright (C) 2017 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+/**
+ * This file tests the maintenance of materialized views through the collection write paths.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/mutable/document.h"
+#include "mongo/client/dbclientcursor.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/client.h"
+#include "mongo/db/db_raii.h"
+#include "mongo/db/dbdirectclient.h"
+#include "mongo/db/dbhelpers.h"
+#include "mongo/db/op_observer.h"
+#include "mongo/db/service_context.h"
+#include "mongo/dbtests/dbtests.h"
+
+namespace MaterializedViewTests {
+
+static const NamespaceString nss("unittests.MaterializedViewSource");
+static const NamespaceString viewNss("unittests.MaterializedViewTotals");
+static const NamespaceString backingNss("unittests.system.materialized.MaterializedViewTotals");
+static const NamespaceString stagingNss("unittests.MaterializedViewStaging");
+
+class MaterializedViewBase {
+public:
+    MaterializedViewBase() : _client(&_opCtx) {
+        OldClientWriteContext ctx(&_opCtx, nss.ns());
+        _client.dropCollection(viewNss.ns());
+        _client.dropCollection(nss.ns());
+        _client.dropCollection(stagingNss.ns());
+        _client.createCollection(nss.ns());
+    }
+
+    virtual ~MaterializedViewBase() {
+        OldClientWriteContext ctx(&_opCtx, nss.ns());
+        _client.dropCollection(viewNss.ns());
+        _client.dropCollection(nss.ns());
+        _client.dropCollection(stagingNss.ns());
+    }
+
+    void createView() {
+        BSONObj result;
+        ASSERT(_client.runCommand(
+            nss.db().toString(),
+            BSON("create" << viewNss.coll() << "viewOn" << nss.coll() << "materialized" << true
+                          << "pipeline"
+                          << BSON_ARRAY(BSON("$group" << BSON("_id"
+                                                              << "$k"
+                                                              << "n"
+                                                              << BSON("$sum" << 1))))),
+            result))
+            << result;
+    }
+
+    BSONArray viewContents() {
+        BSONObj result;
+        ASSERT(_client.runCommand(nss.db().toString(),
+                                  BSON("find" << viewNss.coll() << "sort" << BSON("_id" << 1)),
+                                  result))
+            << result;
+        return BSONArray(result["cursor"]["firstBatch"].Obj().getOwned());
+    }
+
+    void renameCollection(const NamespaceString& from, const NamespaceString& to) {
+        BSONObj result;
+        ASSERT(_client.runCommand(
+            "admin",
+            BSON("renameCollection" << from.ns() << "to" << to.ns() << "dropTarget" << true),
+            result))
+            << result;
+    }
+
+protected:
+    const ServiceContext::UniqueOperationContext _txnPtr = cc().makeOperationContext();
+    OperationContext& _opCtx = *_txnPtr;
+    DBDirectClient _client;
+};
+
+/**
+ * An update which rewrites a document in place through updateDocumentWithDamages() moves the
+ * document between groups like any other update.
+ */
+class InPlaceUpdateMovesDocumentBetweenGroups : public MaterializedViewBase {
+public:
+    void run() {
+        _client.insert(nss.ns(), BSON("_id" << 1 << "k"
+                                            << "a"));
+        _client.insert(nss.ns(), BSON("_id" << 2 << "k"
+                                            << "a"));
+        createView();
+        ASSERT_BSONOBJ_EQ(BSON("0" << BSON("_id"
+                                           << "a"
+                                           << "n"
+                                           << 2)),
+                          viewContents());
+
+        {
+            OldClientWriteContext ctx(&_opCtx, nss.ns());
+            Collection* coll = ctx.getCollection();
+            ASSERT(coll->updateWithDamagesSupported());
+
+            WriteUnitOfWork wunit(&_opCtx);
+            RecordId id = Helpers::findById(&_opCtx, coll, BSON("_id" << 2));
+            Snapshotted<BSONObj> oldObj;
+            ASSERT(coll->findDoc(&_opCtx, id, &oldObj));
+
+            // A string of the same length can be overwritten in place.
+            mutablebson::Document doc(oldObj.value(), mutablebson::Document::kInPlaceEnabled);
+            ASSERT_OK(doc.root().findFirstChildNamed("k").setValueString("b"));
+            mutablebson::DamageVector damages;
+            const char* source = nullptr;
+            ASSERT(doc.getInPlaceUpdates(&damages, &source));
+            ASSERT_FALSE(damages.empty());
+
+            OplogUpdateEntryArgs args;
+            args.nss = nss;
+            args.uuid = coll->uuid();
+            args.update = BSON("$set" << BSON("k"
+                                              << "b"));
+            args.criteria = BSON("_id" << 2);
+
+            const RecordData oldRec(oldObj.value().objdata(), oldObj.value().objsize());
+            Snapshotted<RecordData> snap(oldObj.snapshotId(), oldRec);
+            ASSERT_OK(coll->updateDocumentWithDamages(&_opCtx, id, snap, source, damages, &args)
+                          .getStatus());
+            ASSERT(args.preImageDoc);
+            ASSERT_BSONOBJ_EQ(BSON("_id" << 2 << "k"
+                                         << "a"),
+                              *args.preImageDoc);
+            wunit.commit();
+        }
+
+        ASSERT_BSONOBJ_EQ(BSON("0" << BSON("_id"
+                                           << "a"
+                                           << "n"
+                                           << 1)
+                                   << "1"
+                                   << BSON("_id"
+                                           << "b"
+                                           << "n"
+                                           << 1)),
+                          viewContents());
+    }
+};
+
+/**
+ * Creating a materialized view on a collection larger than one build batch fills the backing
+ * collection from all of it.
+ */
+class BuildSpansSeveralBatches : public MaterializedViewBase {
+public:
+    void run() {
+        const int nDocs = 2500;
+        for (int i = 0; i < nDocs; ++i) {
+            _client.insert(nss.ns(), BSON("_id" << i << "k" << (i % 2 ? "odd" : "even")));
+        }
+        createView();
+        ASSERT_BSONOBJ_EQ(BSON("0" << BSON("_id"
+                                           << "even"
+                                           << "n"
+                                           << nDocs / 2)
+                                   << "1"
+                                   << BSON("_id"
+                                           << "odd"
+                                           << "n"
+                                           << nDocs / 2)),
+                          viewContents());
+
+        // Once built, the view is maintained for writes to any document.
+        _client.insert(nss.ns(), BSON("_id" << nDocs << "k"
+                                            << "even"));
+        _client.remove(nss.ns(), BSON("_id" << 1));
+        ASSERT_BSONOBJ_EQ(BSON("0" << BSON("_id"
+                                           << "even"
+                                           << "n"
+                                           << nDocs / 2 + 1)
+                                   << "1"
+                                   << BSON("_id"
+                                           << "odd"
+                                           << "n"
+                                           << nDocs / 2 - 1)),
+                          viewContents());
+    }
+};
+
+/**
+ * Dropping the collection a materialized view is defined on leaves the view empty, and the view
+ * is maintained for the collection created in its place.
+ */
+class DropOfSourceEmptiesView : public MaterializedViewBase {
+public:
+    void run() {
+        _client.insert(nss.ns(), BSON("_id" << 1 << "k"
+                                            << "a"));
+        createView();
+        _client.dropCollection(nss.ns());
+        ASSERT_BSONOBJ_EQ(BSONObj(), viewContents());
+        ASSERT(_client.exists(backingNss.ns()));
+        ASSERT_EQ(0U, _client.count(backingNss.ns()));
+
+        _client.insert(nss.ns(), BSON("_id" << 2 << "k"
+                                            << "b"));
+        ASSERT_BSONOBJ_EQ(BSON("0" << BSON("_id"
+                                           << "b"
+                                           << "n"
+                                           << 1)),
+                          viewContents());
+    }
+};
+
+/**
+ * Renaming a collection onto the collection a materialized view is defined on rebuilds the view
+ * from the renamed collection, and renaming it away empties the view.
+ */
+class RenameRebuildsView : public MaterializedViewBase {
+public:
+    void run() {
+        _client.insert(nss.ns(), BSON("_id" << 1 << "k"
+                                            << "a"));
+        createView();
+        _client.insert(stagingNss.ns(), BSON("_id" << 1 << "k"
+                                                   << "b"));
+        _client.insert(stagingNss.ns(), BSON("_id" << 2 << "k"
+                                                   << "b"));
+
+        renameCollection(stagingNss, nss);
+        ASSERT_BSONOBJ_EQ(BSON("0" << BSON("_id"
+                                           << "b"
+                                           << "n"
+                                           << 2)),
+                          viewContents());
+
+        renameCollection(nss, stagingNss);
+        ASSERT_BSONOBJ_EQ(BSONObj(), viewContents());
+    }
+};
+
+class All : public Suite {
+public:
+    All() : Suite("materialized_view") {}
+
+    void setupTests() {
+        add<InPlaceUpdateMovesDocumentBetweenGroups>();
+        add<BuildSpansSeveralBatches>();
+        add<DropOfSourceEmptiesView>();
+        add<RenameRebuildsView>();
+    }
+};
+
+SuiteInstance<All> all;
+
+}  // namespace MaterializedViewTests
@@ -71,6 +71,10 @@ public:
         _builder.resumeBody().appendElements(metadata);
         return *this;
     }
+    MessageSegmentSink* enableSegments(int minBytes) override {
+        _builder.enableSegments(minBytes);
+        return &_builder;
+    }
     rpc::Protocol getProtocol() const override {
         return rpc::Protocol::kOpMsg;
     }
@@ -39,6 +39,7 @@ namespace mongo {
 class BSONObj;
 class BSONObjBuilder;
 class Message;
+class MessageSegmentSink;
 
 namespace rpc {
 
@@ -64,6 +65,15 @@ public:
 
     virtual ReplyBuilderInterface& setMetadata(const BSONObj& metadata) = 0;
 
+    /**
+     * Returns a sink that lets documents of at least 'minBytes' in the in-place reply be sent
+     * from their own buffers rather than copied, or nullptr if this protocol always builds
+     * contiguous replies.
+     */
+    virtual MessageSegmentSink* enableSegments(int minBytes) {
+        return nullptr;
+    }
+
     /**
      * Sets the reply for this command. If an engaged StatusWith<BSONObj> is passed, the command
      * reply will be set to the contained BSONObj, augmented with the element {ok, 1.0} if it
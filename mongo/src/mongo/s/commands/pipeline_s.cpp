@@ -173,6 +173,12 @@ public:
         MONGO_UNREACHABLE;
     }
 
+    bool setShouldWaitForInserts(bool shouldWait) final {
+        // Stages on mongos do not read ahead of their consumer, since waiting for new data there
+        // is governed by the cursor's awaitData timeout rather than by this operation.
+        MONGO_UNREACHABLE;
+    }
+
     boost::optional<Document> lookupSingleDocument(const NamespaceString& nss,
                                                    UUID collectionUUID,
                                                    const Document& filter,
@@ -0,0 +1,516 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kNetwork
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/config.h"
+
+#ifdef MONGO_CONFIG_HAVE_LINUX_IO_URING
+
+#include "mongo/transport/io_uring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "mongo/stdx/memory.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/errno_util.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+namespace transport {
+namespace {
+
+int ioUringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(
+        syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int ringFd, unsigned opcode, const void* arg, unsigned nrArgs) {
+    return static_cast<int>(syscall(__NR_io_uring_register, ringFd, opcode, arg, nrArgs));
+}
+
+template <typename T>
+T* ringField(void* ring, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+// The kernel reads the submission queue tail and writes the completion queue tail concurrently
+// with us, so the ring indices need acquire/release ordering.
+unsigned loadAcquire(const unsigned* index) {
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+void storeRelease(unsigned* index, unsigned value) {
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+Status errnoStatus(int err, StringData what) {
+    return {ErrorCodes::OperationFailed,
+            str::stream() << what << " failed: " << errnoWithDescription(err)};
+}
+
+#ifndef IORING_FEAT_FAST_POLL
+#define IORING_FEAT_FAST_POLL (1U << 5)
+#endif
+
+/**
+ * Every idle session keeps a read outstanding. Before Linux 5.7 the kernel hands a read of a
+ * socket with no data to a bounded pool of its own workers, and before 5.5 it may drop
+ * completions which do not fit in the completion queue, so idle sessions could starve every other
+ * operation. Kernels with IORING_FEAT_FAST_POLL poll sockets instead, and never drop completions.
+ */
+Status checkFeatures(const io_uring_params& params) {
+    if (!(params.features & IORING_FEAT_FAST_POLL)) {
+        return {ErrorCodes::OperationFailed,
+                "io_uring on this kernel does not poll sockets (IORING_FEAT_FAST_POLL, Linux 5.7)"};
+    }
+    return Status::OK();
+}
+
+}  // namespace
+
+struct IOUring::Operation {
+    unsigned opcode = IORING_OP_NOP;
+    int fd = -1;
+    iovec iov{nullptr, 0};
+
+    // Set instead of 'iov' for vectored writes.
+    std::vector<iovec> iovecs;
+
+    int bufferIndex = -1;
+    Completion completion;
+};
+
+Status IOUring::probe() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    const int ringFd = ioUringSetup(2, &params);
+    if (ringFd < 0) {
+        return errnoStatus(errno, "io_uring_setup");
+    }
+    ::close(ringFd);
+    return checkFeatures(params);
+}
+
+StatusWith<std::unique_ptr<IOUring>> IOUring::create(const Options& options) {
+    std::unique_ptr<IOUring> ring(new IOUring(options));
+    auto status = ring->_init();
+    if (!status.isOK()) {
+        return status;
+    }
+    ring->_registerBuffers();
+    return std::move(ring);
+}
+
+IOUring::IOUring(const Options& options) : _options(options) {}
+
+IOUring::~IOUring() {
+    if (_sq.sqes) {
+        munmap(_sq.sqes, _sqesSize);
+    }
+    if (_cqRing) {
+        munmap(_cqRing, _cqRingSize);
+    }
+    if (_sqRing) {
+        munmap(_sqRing, _sqRingSize);
+    }
+    // Closing the ring also unregisters the buffer pool, so it can be unmapped afterwards.
+    if (_ringFd >= 0) {
+        ::close(_ringFd);
+    }
+    if (_eventFd >= 0) {
+        ::close(_eventFd);
+    }
+    if (_bufferPool) {
+        munmap(_bufferPool, _bufferPoolSize);
+    }
+}
+
+Status IOUring::_init() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    _ringFd = ioUringSetup(_options.queueDepth, &params);
+    if (_ringFd < 0) {
+        return errnoStatus(errno, "io_uring_setup");
+    }
+    auto featuresStatus = checkFeatures(params);
+    if (!featuresStatus.isOK()) {
+        return featuresStatus;
+    }
+
+    const auto mapRing = [this](size_t size, off_t offset, void** out) {
+        auto addr =
+            mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, offset);
+        if (addr == MAP_FAILED) {
+            return errnoStatus(errno, "mmap of an io_uring queue");
+        }
+        *out = addr;
+        return Status::OK();
+    };
+
+    _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+    void* sqes = nullptr;
+    auto status = mapRing(_sqRingSize, IORING_OFF_SQ_RING, &_sqRing);
+    if (status.isOK()) {
+        status = mapRing(_cqRingSize, IORING_OFF_CQ_RING, &_cqRing);
+    }
+    if (status.isOK()) {
+        status = mapRing(_sqesSize, IORING_OFF_SQES, &sqes);
+    }
+    if (!status.isOK()) {
+        return status;
+    }
+
+    _sq.head = ringField<unsigned>(_sqRing, params.sq_off.head);
+    _sq.tail = ringField<unsigned>(_sqRing, params.sq_off.tail);
+    _sq.ringMask = ringField<unsigned>(_sqRing, params.sq_off.ring_mask);
+    _sq.ringEntries = ringField<unsigned>(_sqRing, params.sq_off.ring_entries);
+    _sq.array = ringField<unsigned>(_sqRing, params.sq_off.array);
+    _sq.sqes = static_cast<io_uring_sqe*>(sqes);
+
+    _cq.head = ringField<unsigned>(_cqRing, params.cq_off.head);
+    _cq.tail = ringField<unsigned>(_cqRing, params.cq_off.tail);
+    _cq.ringMask = ringField<unsigned>(_cqRing, params.cq_off.ring_mask);
+    _cq.ringEntries = ringField<unsigned>(_cqRing, params.cq_off.ring_entries);
+    _cq.cqes = ringField<io_uring_cqe>(_cqRing, params.cq_off.cqes);
+
+    // run() keeps a read of this eventfd outstanding, and other threads write to it to wake
+    // run() out of io_uring_enter() when they queue work.
+    _eventFd = eventfd(0, EFD_CLOEXEC);
+    if (_eventFd < 0) {
+        return errnoStatus(errno, "eventfd");
+    }
+    _doorbell = stdx::make_unique<Operation>();
+    _doorbell->opcode = IORING_OP_READV;
+    _doorbell->fd = _eventFd;
+    _doorbell->iov = {&_doorbellValue, sizeof(_doorbellValue)};
+
+    return Status::OK();
+}
+
+void IOUring::_registerBuffers() {
+    const auto count = _options.registeredBuffers;
+    const auto size = _options.registeredBufferSize;
+    if (count == 0 || size == 0) {
+        return;
+    }
+
+    _bufferPoolSize = count * size;
+    auto pool =
+        mmap(nullptr, _bufferPoolSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pool == MAP_FAILED) {
+        warning() << "Could not allocate io_uring buffers: " << errnoWithDescription();
+        return;
+    }
+    _bufferPool = static_cast<char*>(pool);
+
+    std::vector<iovec> iovecs(count);
+    for (size_t i = 0; i < count; ++i) {
+        iovecs[i] = {_bufferPool + i * size, size};
+    }
+    if (ioUringRegister(_ringFd, IORING_REGISTER_BUFFERS, iovecs.data(), count) < 0) {
+        // Kernels before 5.12 charge registered buffers against RLIMIT_MEMLOCK, which is often
+        // too small for the pool. Everything still works through unregistered buffers.
+        warning() << "Could not register " << count << " io_uring buffers, continuing without "
+                  << "them: " << errnoWithDescription();
+        munmap(_bufferPool, _bufferPoolSize);
+        _bufferPool = nullptr;
+        return;
+    }
+
+    _freeBuffers.reserve(count);
+    for (size_t i = count; i > 0; --i) {
+        _freeBuffers.push_back(static_cast<int>(i - 1));
+    }
+}
+
+bool IOUring::tryAcquireBuffer(Buffer* buffer, size_t keepFree) {
+    stdx::lock_guard<stdx::mutex> lk(_bufferMutex);
+    if (_freeBuffers.size() <= keepFree) {
+        return false;
+    }
+    buffer->index = _freeBuffers.back();
+    buffer->size = _options.registeredBufferSize;
+    buffer->data = _bufferPool + buffer->index * buffer->size;
+    _freeBuffers.pop_back();
+    return true;
+}
+
+void IOUring::releaseBuffer(const Buffer& buffer) {
+    invariant(buffer.index >= 0);
+    stdx::lock_guard<stdx::mutex> lk(_bufferMutex);
+    _freeBuffers.push_back(buffer.index);
+}
+
+void IOUring::read(int fd, char* data, size_t len, Completion cb) {
+    _queue(IORING_OP_READV, fd, data, len, -1, std::move(cb));
+}
+
+void IOUring::write(int fd, const char* data, size_t len, Completion cb) {
+    _queue(IORING_OP_WRITEV, fd, const_cast<char*>(data), len, -1, std::move(cb));
+}
+
+void IOUring::write(int fd, const std::vector<ConstDataRange>& ranges, Completion cb) {
+    auto op = stdx::make_unique<Operation>();
+    op->opcode = IORING_OP_WRITEV;
+    op->fd = fd;
+    const size_t count = std::min<size_t>(ranges.size(), IOV_MAX);
+    op->iovecs.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        op->iovecs.push_back({const_cast<char*>(ranges[i].data()), ranges[i].length()});
+    }
+    op->completion = std::move(cb);
+    _queue(std::move(op));
+}
+
+void IOUring::readFixed(int fd, const Buffer& buffer, size_t offset, size_t len, Completion cb) {
+    invariant(offset + len <= buffer.size);
+    _queue(IORING_OP_READ_FIXED, fd, buffer.data + offset, len, buffer.index, std::move(cb));
+}
+
+void IOUring::writeFixed(int fd, const Buffer& buffer, size_t offset, size_t len, Completion cb) {
+    invariant(offset + len <= buffer.size);
+    _queue(IORING_OP_WRITE_FIXED, fd, buffer.data + offset, len, buffer.index, std::move(cb));
+}
+
+void IOUring::_queue(
+    unsigned opcode, int fd, char* data, size_t len, int bufferIndex, Completion cb) {
+    auto op = stdx::make_unique<Operation>();
+    op->opcode = opcode;
+    op->fd = fd;
+    op->iov = {data, len};
+    op->bufferIndex = bufferIndex;
+    op->completion = std::move(cb);
+    _queue(std::move(op));
+}
+
+void IOUring::_queue(std::unique_ptr<Operation> op) {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    if (_shutdown) {
+        lk.unlock();
+        _completed.fetchAndAdd(1);
+        op->completion(-ECANCELED);
+        return;
+    }
+
+    _queued.push_back(std::move(op));
+
+    // Only the first operation queued while run() may be asleep pays for a wakeup; the rest are
+    // picked up by the same io_uring_enter() call.
+    const bool wake = _runnerBlocked;
+    _runnerBlocked = false;
+    lk.unlock();
+
+    if (wake) {
+        _wakeRunner();
+    }
+}
+
+void IOUring::_wakeRunner() {
+    const uint64_t one = 1;
+    // This only fails if the counter would overflow, in which case a wakeup is already pending.
+    auto written = ::write(_eventFd, &one, sizeof(one));
+    dassert(written == static_cast<ssize_t>(sizeof(one)));
+}
+
+void IOUring::shutdown() {
+    bool wake;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _shutdown = true;
+        wake = _runnerBlocked;
+        _runnerBlocked = false;
+    }
+
+    if (wake) {
+        _wakeRunner();
+    }
+}
+
+IOUring::Stats IOUring::stats() const {
+    Stats stats;
+    stats.enterCalls = _enterCalls.load();
+    stats.submitted = _submitted.load();
+    stats.fixedSubmitted = _fixedSubmitted.load();
+    stats.completed = _completed.load();
+    return stats;
+}
+
+void IOUring::run() {
+    std::deque<Operation*> ready;
+    std::vector<std::pair<Operation*, int>> completed;
+
+    while (true) {
+        bool shuttingDown;
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            for (auto& op : _queued) {
+                ready.push_back(op.release());
+            }
+            _queued.clear();
+            shuttingDown = _shutdown;
+            _runnerBlocked = true;
+        }
+
+        if (shuttingDown) {
+            // Operations that were queued but never handed to the kernel are cancelled.
+            for (auto op : ready) {
+                completed.emplace_back(op, -ECANCELED);
+            }
+            ready.clear();
+        }
+
+        const unsigned toSubmit = _fillSubmissionQueue(&ready);
+        const bool wait = completed.empty() && !(shuttingDown && _inFlight == 0);
+        if (toSubmit > 0 || wait) {
+            _enterCalls.fetchAndAdd(1);
+            if (ioUringEnter(_ringFd,
+                             toSubmit,
+                             wait ? 1 : 0,
+                             wait ? IORING_ENTER_GETEVENTS : 0) < 0) {
+                // On EINTR, EAGAIN and EBUSY (completions backed up in the kernel) unconsumed
+                // entries stay in the submission queue and are submitted on the next pass.
+                const auto err = errno;
+                if (err != EINTR && err != EAGAIN && err != EBUSY) {
+                    severe() << "io_uring_enter failed: " << errnoWithDescription(err);
+                    fassertFailed(40690);
+                }
+            }
+        }
+
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _runnerBlocked = false;
+        }
+
+        _reapCompletions(&completed);
+        _completed.fetchAndAdd(completed.size());
+        for (auto& entry : completed) {
+            std::unique_ptr<Operation> op(entry.first);
+            op->completion(entry.second);
+        }
+        completed.clear();
+
+        if (shuttingDown && _inFlight == 0) {
+            return;
+        }
+    }
+}
+
+unsigned IOUring::_fillSubmissionQueue(std::deque<Operation*>* ready) {
+    const unsigned entries = *_sq.ringEntries;
+    const unsigned mask = *_sq.ringMask;
+    const unsigned head = loadAcquire(_sq.head);
+    unsigned tail = *_sq.tail;
+
+    const auto push = [&](Operation* op) {
+        const unsigned index = tail & mask;
+        _prepare(&_sq.sqes[index], op);
+        _sq.array[index] = index;
+        ++tail;
+    };
+
+    if (!_doorbellArmed && tail - head < entries) {
+        push(_doorbell.get());
+        _doorbellArmed = true;
+    }
+
+    while (!ready->empty() && tail - head < entries) {
+        push(ready->front());
+        ready->pop_front();
+        ++_inFlight;
+        _submitted.fetchAndAdd(1);
+    }
+
+    storeRelease(_sq.tail, tail);
+    return tail - head;
+}
+
+void IOUring::_prepare(io_uring_sqe* sqe, Operation* op) {
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = op->opcode;
+    sqe->fd = op->fd;
+    sqe->user_data = reinterpret_cast<uint64_t>(op);
+
+    // The offset stays 0; it is ignored for sockets and eventfds.
+    if (op->opcode == IORING_OP_READ_FIXED || op->opcode == IORING_OP_WRITE_FIXED) {
+        sqe->addr = reinterpret_cast<uint64_t>(op->iov.iov_base);
+        sqe->len = op->iov.iov_len;
+        sqe->buf_index = op->bufferIndex;
+        _fixedSubmitted.fetchAndAdd(1);
+    } else if (!op->iovecs.empty()) {
+        sqe->addr = reinterpret_cast<uint64_t>(op->iovecs.data());
+        sqe->len = op->iovecs.size();
+    } else {
+        sqe->addr = reinterpret_cast<uint64_t>(&op->iov);
+        sqe->len = 1;
+    }
+}
+
+void IOUring::_reapCompletions(std::vector<std::pair<Operation*, int>>* completed) {
+    const unsigned mask = *_cq.ringMask;
+    const unsigned tail = loadAcquire(_cq.tail);
+    unsigned head = *_cq.head;
+
+    for (; head != tail; ++head) {
+        const auto& cqe = _cq.cqes[head & mask];
+        auto op = reinterpret_cast<Operation*>(cqe.user_data);
+        if (op == _doorbell.get()) {
+            _doorbellArmed = false;
+            continue;
+        }
+        completed->emplace_back(op, cqe.res);
+        --_inFlight;
+    }
+
+    storeRelease(_cq.head, head);
+}
+
+}  // namespace transport
+}  // namespace mongo
+
+#endif  // MONGO_CONFIG_HAVE_LINUX_IO_URING
@@ -0,0 +1,220 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "mongo/base/data_range.h"
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status_with.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/stdx/mutex.h"
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace mongo {
+namespace transport {
+
+/**
+ * A thin wrapper around a Linux io_uring instance, driven through the raw system calls so that
+ * no liburing dependency is needed. It requires Linux 5.7, whose io_uring polls sockets rather
+ * than blocking a kernel worker on each outstanding read.
+ *
+ * Any thread may queue operations. One thread calls run(), which hands everything queued since
+ * its previous pass to the kernel in a single io_uring_enter() call and then invokes the
+ * completion callbacks, so operations on many sockets share one system call. Completion
+ * callbacks run on the run() thread and may queue further operations.
+ *
+ * A pool of fixed-size buffers is registered with the kernel when the ring is created. Reads and
+ * writes through those buffers skip the page pinning the kernel otherwise does per operation.
+ */
+class IOUring {
+    MONGO_DISALLOW_COPYING(IOUring);
+
+public:
+    /**
+     * Receives the result of an operation: the number of bytes transferred, or a negated errno.
+     */
+    using Completion = stdx::function<void(int result)>;
+
+    struct Options {
+        unsigned queueDepth = 1024;               // submission queue entries
+        size_t registeredBuffers = 256;           // number of buffers to register
+        size_t registeredBufferSize = 16 * 1024;  // size of each registered buffer
+    };
+
+    /**
+     * A buffer from the registered pool. It must be handed back with releaseBuffer().
+     */
+    struct Buffer {
+        char* data = nullptr;
+        size_t size = 0;
+        int index = -1;
+    };
+
+    struct Stats {
+        long long enterCalls = 0;      // io_uring_enter() calls
+        long long submitted = 0;       // operations handed to the kernel
+        long long fixedSubmitted = 0;  // of which used a registered buffer
+        long long completed = 0;       // operations completed, including cancelled ones
+    };
+
+    /**
+     * Returns OK if this process can create an io_uring instance which polls sockets. Kernels
+     * older than 5.7, and sandboxes that filter the io_uring system calls, fail with a
+     * description of why.
+     */
+    static Status probe();
+
+    static StatusWith<std::unique_ptr<IOUring>> create(const Options& options);
+
+    ~IOUring();
+
+    /**
+     * Takes a buffer from the registered pool. Returns false if no more than 'keepFree' buffers
+     * are left, or if the kernel refused to register the pool.
+     */
+    bool tryAcquireBuffer(Buffer* buffer, size_t keepFree = 0);
+    void releaseBuffer(const Buffer& buffer);
+
+    size_t registeredBufferSize() const {
+        return _options.registeredBufferSize;
+    }
+
+    /**
+     * Queue a read or write on 'fd'. The memory must stay valid until 'cb' has run. The *Fixed
+     * variants transfer into or out of 'buffer', starting 'offset' bytes in.
+     */
+    void read(int fd, char* data, size_t len, Completion cb);
+    void write(int fd, const char* data, size_t len, Completion cb);
+    void readFixed(int fd, const Buffer& buffer, size_t offset, size_t len, Completion cb);
+
+    /**
+     * Queue a vectored write of 'ranges' on 'fd'. Like writev(), it may complete after writing
+     * only some of them, and at most IOV_MAX ranges are submitted at a time.
+     */
+    void write(int fd, const std::vector<ConstDataRange>& ranges, Completion cb);
+    void writeFixed(int fd, const Buffer& buffer, size_t offset, size_t len, Completion cb);
+
+    /**
+     * Submits queued operations and runs completions until shutdown() is called and every
+     * operation already handed to the kernel has completed. Callers must make those operations
+     * finish, for example by shutting down the sockets they target.
+     */
+    void run();
+
+    /**
+     * Makes run() return once the kernel has no more of our operations in flight. Operations
+     * queued from now on complete with -ECANCELED without being submitted.
+     */
+    void shutdown();
+
+    Stats stats() const;
+
+private:
+    struct Operation;
+
+    struct SubmissionQueue {
+        unsigned* head = nullptr;
+        unsigned* tail = nullptr;
+        unsigned* ringMask = nullptr;
+        unsigned* ringEntries = nullptr;
+        unsigned* array = nullptr;
+        io_uring_sqe* sqes = nullptr;
+    };
+
+    struct CompletionQueue {
+        unsigned* head = nullptr;
+        unsigned* tail = nullptr;
+        unsigned* ringMask = nullptr;
+        unsigned* ringEntries = nullptr;
+        io_uring_cqe* cqes = nullptr;
+    };
+
+    explicit IOUring(const Options& options);
+
+    Status _init();
+    void _registerBuffers();
+
+    void _queue(unsigned opcode, int fd, char* data, size_t len, int bufferIndex, Completion cb);
+    void _queue(std::unique_ptr<Operation> op);
+    void _wakeRunner();
+
+    /**
+     * Moves as many ready operations into the submission queue as the rings have room for.
+     * Returns the number of entries waiting to be consumed by the kernel.
+     */
+    unsigned _fillSubmissionQueue(std::deque<Operation*>* ready);
+    void _prepare(io_uring_sqe* sqe, Operation* op);
+    void _reapCompletions(std::vector<std::pair<Operation*, int>>* completed);
+
+    const Options _options;
+
+    int _ringFd = -1;
+    int _eventFd = -1;
+
+    void* _sqRing = nullptr;
+    size_t _sqRingSize = 0;
+    void* _cqRing = nullptr;
+    size_t _cqRingSize = 0;
+    size_t _sqesSize = 0;
+    SubmissionQueue _sq;
+    CompletionQueue _cq;
+
+    // Owned by the run() thread.
+    size_t _inFlight = 0;
+    bool _doorbellArmed = false;
+    std::unique_ptr<Operation> _doorbell;
+    uint64_t _doorbellValue = 0;
+
+    char* _bufferPool = nullptr;
+    size_t _bufferPoolSize = 0;
+    bool _buffersRegistered = false;
+    stdx::mutex _bufferMutex;
+    std::vector<int> _freeBuffers;
+
+    stdx::mutex _mutex;
+    std::vector<std::unique_ptr<Operation>> _queued;
+    bool _runnerBlocked = false;  // The run() thread may be blocked in io_uring_enter().
+    bool _shutdown = false;
+
+    AtomicWord<long long> _enterCalls{0};
+    AtomicWord<long long> _submitted{0};
+    AtomicWord<long long> _fixedSubmitted{0};
+    AtomicWord<long long> _completed{0};
+};
+
+}  // namespace transport
+}  // namespace mongo
@@ -0,0 +1,270 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kDefault
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/config.h"
+
+#ifdef MONGO_CONFIG_HAVE_LINUX_IO_URING
+
+#include "mongo/transport/io_uring.h"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+namespace {
+
+using transport::IOUring;
+
+/**
+ * Owns a ring and the thread running it. Tests bail out early on kernels older than 5.7.
+ */
+class RingFixture {
+public:
+    explicit RingFixture(IOUring::Options options = {}) {
+        auto status = IOUring::probe();
+        if (!status.isOK()) {
+            log() << "Skipping io_uring test: " << status;
+            return;
+        }
+        auto swRing = IOUring::create(options);
+        ASSERT_OK(swRing.getStatus());
+        ring = std::move(swRing.getValue());
+        _runner = stdx::thread([this] { ring->run(); });
+    }
+
+    ~RingFixture() {
+        stop();
+    }
+
+    void stop() {
+        if (_runner.joinable()) {
+            ring->shutdown();
+            _runner.join();
+        }
+    }
+
+    std::unique_ptr<IOUring> ring;
+
+private:
+    stdx::thread _runner;
+};
+
+class SocketPair {
+public:
+    SocketPair() {
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    }
+
+    ~SocketPair() {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+
+    int fds[2];
+};
+
+/**
+ * Collects completion results so a test can wait for a given number of them.
+ */
+class Results {
+public:
+    IOUring::Completion add(int* result) {
+        return [this, result](int res) {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            *result = res;
+            ++_completed;
+            _cv.notify_all();
+        };
+    }
+
+    void waitFor(int count) {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _cv.wait(lk, [&] { return _completed >= count; });
+    }
+
+private:
+    stdx::mutex _mutex;
+    stdx::condition_variable _cv;
+    int _completed = 0;
+};
+
+TEST(IOUringTest, ReadAndWriteThroughRegisteredBuffers) {
+    IOUring::Options options;
+    options.registeredBuffers = 4;
+    options.registeredBufferSize = 4096;
+    RingFixture fixture(options);
+    if (!fixture.ring) {
+        return;
+    }
+    auto& ring = *fixture.ring;
+    SocketPair sockets;
+
+    IOUring::Buffer readBuffer, writeBuffer;
+    ASSERT(ring.tryAcquireBuffer(&readBuffer));
+    ASSERT(ring.tryAcquireBuffer(&writeBuffer));
+    memcpy(writeBuffer.data, "hello", 5);
+
+    Results results;
+    int readResult = 0, writeResult = 0;
+    ring.readFixed(sockets.fds[1], readBuffer, 0, readBuffer.size, results.add(&readResult));
+    ring.writeFixed(sockets.fds[0], writeBuffer, 0, 5, results.add(&writeResult));
+    results.waitFor(2);
+
+    ASSERT_EQ(5, writeResult);
+    ASSERT_EQ(5, readResult);
+    ASSERT_EQ(0, memcmp(readBuffer.data, "hello", 5));
+    ring.releaseBuffer(readBuffer);
+    ring.releaseBuffer(writeBuffer);
+
+    fixture.stop();
+    ASSERT_EQ(2, ring.stats().fixedSubmitted);
+}
+
+TEST(IOUringTest, TryAcquireBufferKeepsBuffersFree) {
+    IOUring::Options options;
+    options.registeredBuffers = 8;
+    RingFixture fixture(options);
+    if (!fixture.ring) {
+        return;
+    }
+    auto& ring = *fixture.ring;
+
+    std::vector<IOUring::Buffer> buffers;
+    IOUring::Buffer buffer;
+    while (ring.tryAcquireBuffer(&buffer, 2)) {
+        buffers.push_back(buffer);
+    }
+    ASSERT_EQ(6U, buffers.size());
+
+    // The reserve is still there for callers that do not hold any back.
+    ASSERT(ring.tryAcquireBuffer(&buffer));
+    ring.releaseBuffer(buffer);
+    for (auto& held : buffers) {
+        ring.releaseBuffer(held);
+    }
+}
+
+TEST(IOUringTest, BatchesOperationsFromManyThreads) {
+    // A queue shallower than the number of outstanding operations also exercises the path where
+    // operations wait in user space for room in the rings.
+    IOUring::Options options;
+    options.queueDepth = 16;
+    RingFixture fixture(options);
+    if (!fixture.ring) {
+        return;
+    }
+    auto& ring = *fixture.ring;
+
+    const int kThreads = 64;
+    const int kRounds = 50;
+    std::vector<std::unique_ptr<SocketPair>> sockets;
+    for (int i = 0; i < kThreads; ++i) {
+        sockets.push_back(stdx::make_unique<SocketPair>());
+    }
+
+    AtomicWord<int> mismatches{0};
+    std::vector<stdx::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&, i] {
+            for (int round = 0; round < kRounds; ++round) {
+                const std::string out = str::stream() << "message " << i << " " << round;
+                char in[64];
+                Results results;
+                int readResult = 0, writeResult = 0;
+                ring.read(sockets[i]->fds[1], in, sizeof(in), results.add(&readResult));
+                ring.write(sockets[i]->fds[0], out.data(), out.size(), results.add(&writeResult));
+                results.waitFor(2);
+                if (writeResult != static_cast<int>(out.size()) ||
+                    readResult != static_cast<int>(out.size()) ||
+                    out != std::string(in, readResult)) {
+                    mismatches.fetchAndAdd(1);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(0, mismatches.load());
+
+    fixture.stop();
+    const auto stats = ring.stats();
+    log() << "submitted " << stats.submitted << " operations in " << stats.enterCalls
+          << " io_uring_enter calls";
+    ASSERT_EQ(kThreads * kRounds * 2, stats.submitted);
+    ASSERT_EQ(stats.submitted, stats.completed);
+    ASSERT_LT(stats.enterCalls, stats.submitted);
+}
+
+TEST(IOUringTest, ShutdownWaitsForInFlightOperationsAndCancelsLaterOnes) {
+    RingFixture fixture;
+    if (!fixture.ring) {
+        return;
+    }
+    auto& ring = *fixture.ring;
+    SocketPair sockets;
+
+    Results results;
+    char in[16];
+    int readResult = 1;
+    ring.read(sockets.fds[1], in, sizeof(in), results.add(&readResult));
+
+    // The pending read completes once its socket is shut down, after which the ring can stop.
+    ::shutdown(sockets.fds[1], SHUT_RDWR);
+    results.waitFor(1);
+    ASSERT_EQ(0, readResult);
+    fixture.stop();
+
+    int cancelledResult = 0;
+    ring.read(sockets.fds[1], in, sizeof(in), results.add(&cancelledResult));
+    results.waitFor(2);
+    ASSERT_EQ(-ECANCELED, cancelledResult);
+}
+
+}  // namespace
+}  // namespace mongo
+
+#endif  // MONGO_CONFIG_HAVE_LINUX_IO_URING
@@ -93,6 +93,14 @@ MONGO_EXPORT_SERVER_PARAMETER(adaptiveServiceExecutorIdlePctThreshold, int, 60);
 //ݹõֵ 
 MONGO_EXPORT_SERVER_PARAMETER(adaptiveServiceExecutorRecursionLimit, int, 8);
 
+// The number of run queues tasks are spread over. -1 means one per core, and 0 queues all tasks
+// in the io_context shared by all worker threads.
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(adaptiveServiceExecutorRunQueues, int, -1);
+
+// A worker thread handles completed network I/O at least once every this many tasks from the run
+// queues, so that connections waiting on I/O are not starved by a long run queue.
+const int kTasksBetweenPolls = 16;
+
 //db.serverStatus().network.serviceExecutorTaskStatsȡ
 constexpr auto kTotalQueued = "totalQueued"_sd;
 constexpr auto kTotalExecuted = "totalExecuted"_sd;
@@ -106,6 +114,8 @@ constexpr auto kTotalTimeQueuedUs = "totalTimeQueuedMicros"_sd;
 constexpr auto kThreadsInUse = "threadsInUse"_sd;
 constexpr auto kThreadsRunning = "threadsRunning"_sd;
 constexpr auto kThreadsPending = "threadsPending"_sd;
+constexpr auto kRunQueues = "runQueues"_sd;
+constexpr auto kTotalStolen = "totalStolen"_sd;
 constexpr auto kExecutorLabel = "executor"_sd;
 constexpr auto kExecutorName = "adaptive"_sd;
 
@@ -163,6 +173,14 @@ struct ServerParameterOptions : public ServiceExecutorAdaptive::Options {
     int recursionLimit() const final {
         return adaptiveServiceExecutorRecursionLimit.load();
     }
+
+    int runQueues() const final {
+        if (adaptiveServiceExecutorRunQueues == -1) {
+            ProcessInfo pi;
+            return pi.getNumAvailableCores().value_or(pi.getNumCores());
+        }
+        return adaptiveServiceExecutorRunQueues;
+    }
 };
 
 }  // namespace
@@ -192,6 +210,11 @@ ServiceExecutorAdaptive::~ServiceExecutorAdaptive() {
 //runMongosServerе
 Status ServiceExecutorAdaptive::start() {
     invariant(!_isRunning.load());
+    if (_runQueues.empty() && _config->runQueues() > 0) {
+        _numRunQueues = _config->runQueues();
+        // A plain new[] does not honor the cache line alignment of the queues before C++17.
+        _runQueues = decltype(_runQueues)(_numRunQueues);
+    }
     _isRunning.store(true);
 	//̳߳ʼ̻߳صServiceExecutorAdaptive::_controllerThreadRoutine
     _controllerThread = stdx::thread(&ServiceExecutorAdaptive::_controllerThreadRoutine, this);
@@ -331,7 +354,9 @@ Status ServiceExecutorAdaptive::schedule(ServiceExecutorAdaptive::Task task, Sch
 	//еwrappedTaskServiceExecutorAdaptive::_workerThreadRoutine
 
 	//kMayRecurseʶ񣬻еݹ
-    if ((flags & kMayRecurse) && //ݹãɱ̴߳
+    // Only the executor's own threads may run the task in place. The io_uring transport layer
+    // completes tickets on its ring thread, which must hand the task to a worker.
+    if ((flags & kMayRecurse) && _localThreadState && //ݹãɱ̴߳
     //ݹñ: (ȡһ+ڶݹ) ̻߳һ߳̿ԴӵΪݸͻ˿첽ģԴͬʱ
     	//ݹȻûﵽޣɱִ̼߳wrappedTask
         (_localThreadState->recursionDepth + 1 < _config->recursionLimit())) {
@@ -339,7 +364,17 @@ Status ServiceExecutorAdaptive::schedule(ServiceExecutorAdaptive::Task task, Sch
         //io_context::dispatch   io_context::dispatch 
         if(_localThreadState->recursionDepth > 2) //ʵԶ2Ӵsource׶κprocess׶εʺ˸ñʶprocessһ׶Ѿûиñʶ
 			log() << "ddd test .... _localThreadState->recursionDepth:" << _localThreadState->recursionDepth;
-        _ioContext->dispatch(std::move(wrappedTask));  
+        if (_numRunQueues > 0) {
+            // Tasks from the run queues do not run inside _ioContext, where dispatch() would
+            // recognize the recursive call, so run the task directly.
+            _lastScheduleTimer.reset();
+            _totalQueued.addAndFetch(1);
+            wrappedTask();
+            return Status::OK();
+        }
+        _ioContext->dispatch(std::move(wrappedTask));
+    } else if (_numRunQueues > 0) {
+        _enqueueTask(std::move(wrappedTask));
     } else { //   io_context::post
     	//ӵscheduleȫֶУȴ̵߳
         _ioContext->post(std::move(wrappedTask));
@@ -383,6 +418,95 @@ bool ServiceExecutorAdaptive::_isStarved() const {
     return (tasksQueued > available);
 }
 
+void ServiceExecutorAdaptive::_enqueueTask(Task task) {
+    // Tasks scheduled by a worker thread stay on its home queue, the others are spread over all
+    // queues.
+    const size_t index = (_localThreadState ? _localThreadState->homeQueue
+                                            : _nextRunQueue.fetchAndAdd(1)) %
+        _numRunQueues;
+    RunQueue& queue = _runQueues[index];
+    {
+        stdx::lock_guard<stdx::mutex> lk(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+        queue.size.addAndFetch(1);
+    }
+
+    // A worker thread announces that it is going to sleep before it checks _runQueueDepth for the
+    // last time, so either it sees this task or we see it sleeping and wake it up.
+    _runQueueDepth.addAndFetch(1);
+    if (_threadsSleeping.load() > 0) {
+        _ioContext->post([] {});
+    }
+}
+
+ServiceExecutorAdaptive::Task ServiceExecutorAdaptive::_popTask(size_t homeQueue) {
+    for (size_t i = 0; i < _numRunQueues; i++) {
+        RunQueue& queue = _runQueues[(homeQueue + i) % _numRunQueues];
+        if (queue.size.load() == 0) {
+            continue;
+        }
+
+        stdx::lock_guard<stdx::mutex> lk(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        Task task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        queue.size.subtractAndFetch(1);
+        _runQueueDepth.subtractAndFetch(1);
+        if (i > 0) {
+            _totalStolen.addAndFetch(1);
+        }
+        return task;
+    }
+    return Task();
+}
+
+void ServiceExecutorAdaptive::_runTasks(const ThreadState& state,
+                                        Milliseconds runTime,
+                                        bool runOne) {
+    const auto deadline = stdx::chrono::steady_clock::now() + runTime.toSystemDuration();
+    int tasksSincePoll = 0;
+
+    // _ioContext stops whenever it runs out of work, which it does between two calls when there
+    // is no network I/O outstanding, but the tasks in the run queues still have to run.
+    if (_ioContext->stopped()) {
+        _ioContext->restart();
+    }
+
+    while (_isRunning.load() && !_ioContext->stopped()) {
+        const auto now = stdx::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return;
+        }
+
+        size_t ran = 0;
+        if (tasksSincePoll >= kTasksBetweenPolls || _runQueueDepth.load() == 0) {
+            ran += _ioContext->poll();
+            tasksSincePoll = 0;
+        }
+        if (auto task = _popTask(state.homeQueue)) {
+            task();
+            ++ran;
+            ++tasksSincePoll;
+        }
+
+        if (ran == 0) {
+            // Nothing to do, so wait in _ioContext for network I/O or a wakeup from
+            // _enqueueTask().
+            _threadsSleeping.addAndFetch(1);
+            if (_runQueueDepth.load() == 0) {
+                ran = _ioContext->run_one_for(deadline - now);
+            }
+            _threadsSleeping.subtractAndFetch(1);
+        }
+
+        if (ran > 0 && runOne) {
+            return;
+        }
+    }
+}
+
 //worker-x߳ĬCPU/2controller̻߳ݸ_controllerThreadRoutineж̬worker߳
 //controller̷ָ߳ظߣôworker߳Ҳӣȥˣworker̸߳Ƿ˳߳
 
@@ -519,7 +643,8 @@ void ServiceExecutorAdaptive::_startWorkerThread() {
 	//warning() << "ddd test   _startWorkerThread:  num1:" << _threads.size();
 	//stdx::list list׷һThreadState
     auto num = _threads.size();
-    auto it = _threads.emplace(_threads.begin(), _tickSource); 
+    const size_t homeQueue = _numRunQueues ? _nextHomeQueue.fetchAndAdd(1) % _numRunQueues : 0;
+    auto it = _threads.emplace(_threads.begin(), _tickSource, homeQueue);
 	warning() << "ddd test   _startWorkerThread: 22222 num2:" << _threads.size();
 
 	//ûִйtask߳
@@ -668,7 +793,9 @@ void ServiceExecutorAdaptive::_workerThreadRoutine(
             //ڸ߳첽УͨServiceStateMachine::_sinkCallback  ServiceStateMachine::_sourceCallbackworker̸߳Ϊconn߳
 
 			//ִServiceExecutorAdaptive::scheduleжӦtask
-			if (stillPending) {
+            if (_numRunQueues > 0) {
+                _runTasks(*state, runTime, stillPending);
+            } else if (stillPending) {
 				//һʱڴ¼ѭͬʱûǲֱio_context stop() ֹͣ  ʱ Ϊֹ
 				//ִһͻ᷵
 				_ioContext->run_one_for(runTime.toSystemDuration());
@@ -765,7 +892,9 @@ void ServiceExecutorAdaptive::appendStats(BSONObjBuilder* bob) const {
             << ticksToMicros(_getThreadTimerTotal(ThreadTimer::Executing), _tickSource)    //
             << kTotalTimeQueuedUs << ticksToMicros(_totalSpentQueued.load(), _tickSource)  //
             << kThreadsRunning << _threadsRunning.load()                                   //
-            << kThreadsPending << _threadsPending.load();
+            << kThreadsPending << _threadsPending.load()                                   //
+            << kRunQueues << static_cast<int>(_numRunQueues)                               //
+            << kTotalStolen << _totalStolen.load();
     section.doneFast();
 }
 
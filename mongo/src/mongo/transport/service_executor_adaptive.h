@@ -28,15 +28,21 @@
 
 #pragma once
 
+#include <deque>
+#include <memory>
 #include <vector>
 
+#include <boost/align/aligned_allocator.hpp>
+
 #include "mongo/db/service_context.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/list.h"
+#include "mongo/stdx/mutex.h"
 #include "mongo/stdx/thread.h"
 #include "mongo/transport/service_executor.h"
 #include "mongo/util/tick_source.h"
+#include "mongo/util/with_alignment.h"
 
 #include <asio.hpp>
 
@@ -91,6 +97,11 @@ public:
         // The maximum allowable depth of recursion for tasks scheduled with the MayRecurse flag
         // before stack unwinding is forced.
         virtual int recursionLimit() const = 0;
+
+        // The number of run queues tasks are spread over, normally one per core. Worker threads
+        // serve their own queue first and steal from the others when it is empty. With zero run
+        // queues every task is queued in the shared io_context instead.
+        virtual int runQueues() const = 0;
     };
 
     explicit ServiceExecutorAdaptive(ServiceContext* ctx, std::shared_ptr<asio::io_context> ioCtx);
@@ -191,7 +202,8 @@ private:
 
     //߳ͳϢ  ע:һ߳һѭִִ+ȴʱ
     struct ThreadState {
-        ThreadState(TickSource* ts) : running(ts), executing(ts) {}
+        ThreadState(TickSource* ts, size_t homeQueue)
+            : running(ts), executing(ts), homeQueue(homeQueue) {}
 
         //̱߳ѭĵʱ䣬IOȴִжӦ¼Ӧtaskʱ,οServiceExecutorAdaptive::_workerThreadRoutine 
         CumulativeTickTimer running;
@@ -201,6 +213,20 @@ private:
         CumulativeTickTimer executing;
         //ͬһִ߳ĵݹ
         int recursionDepth = 0;
+        // The run queue this thread serves first, and which the tasks it schedules go to.
+        const size_t homeQueue;
+    };
+
+    /**
+     * Tasks waiting for a worker thread. Tasks which a worker thread schedules, such as the next
+     * step of the connection it is running, go to its home queue, so a connection tends to stay
+     * on the thread and core whose cache holds its state.
+     */
+    struct RunQueue {
+        stdx::mutex mutex;
+        std::deque<Task> tasks;
+        // Lets threads looking for work skip empty queues without taking their mutex.
+        AtomicWord<int> size{0};
     };
 
     using ThreadList = stdx::list<ThreadState>;
@@ -209,6 +235,9 @@ private:
     void _workerThreadRoutine(int threadId, ThreadList::iterator it);
     void _controllerThreadRoutine();
     bool _isStarved() const;
+    void _enqueueTask(Task task);
+    Task _popTask(size_t homeQueue);
+    void _runTasks(const ThreadState& state, Milliseconds runTime, bool runOne);
     Milliseconds _getThreadJitter() const;
 
     enum class ThreadTimer { Running, Executing };
@@ -297,11 +326,25 @@ private:
     //̼߳ͳ
     static thread_local ThreadState* _localThreadState;
 
+    // The run queues, or none if tasks are queued in _ioContext.
+    std::vector<CacheAligned<RunQueue>, boost::alignment::aligned_allocator<CacheAligned<RunQueue>>>
+        _runQueues;
+    size_t _numRunQueues = 0;
+    AtomicWord<unsigned> _nextRunQueue{0};
+    AtomicWord<unsigned> _nextHomeQueue{0};
+
+    // Tasks in all run queues, and worker threads blocked in _ioContext waiting for work. A task
+    // enqueued while a thread is blocked wakes it with an empty handler.
+    AtomicWord<int> _runQueueDepth{0};
+    AtomicWord<int> _threadsSleeping{0};
+
     // These counters are only used for reporting in serverStatus.
     //ܵ
     AtomicWord<int64_t> _totalQueued{0};
     //ִе
     AtomicWord<int64_t> _totalExecuted{0};
+    // Tasks which a worker thread took from another thread's home queue.
+    AtomicWord<int64_t> _totalStolen{0};
     //񱻵ӣִι̵ʱ䣬Ҳǵȴȵʱ
     AtomicWord<TickSource::Tick> _totalSpentQueued{0};
 
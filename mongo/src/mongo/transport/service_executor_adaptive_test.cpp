@@ -72,6 +72,10 @@ struct TestOptions : public ServiceExecutorAdaptive::Options {
     int maxRecursion() const final {
         return 0;
     }
+
+    int runQueues() const final {
+        return 2;
+    }
 };
 
 class ServiceExecutorAdaptiveFixture : public unittest::Test {
@@ -0,0 +1,176 @@
+/**
+ *    Copyright (C) 2017 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kDefault;
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "mongo/db/service_context_noop.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/transport/service_executor_adaptive.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/log.h"
+#include "mongo/util/time_support.h"
+#include "mongo/util/timer.h"
+
+#include <asio.hpp>
+
+namespace mongo {
+namespace {
+using namespace transport;
+
+/**
+ * Runs the executor with a worker thread per core, which never exit for being idle.
+ */
+struct StressTestOptions : public ServiceExecutorAdaptive::Options {
+    explicit StressTestOptions(int runQueues) : _runQueues(runQueues) {}
+
+    int reservedThreads() const final {
+        return std::max(stdx::thread::hardware_concurrency(), 2U);
+    }
+
+    Milliseconds workerThreadRunTime() const final {
+        return Milliseconds{1000};
+    }
+
+    int runTimeJitter() const final {
+        return 0;
+    }
+
+    Milliseconds stuckThreadTimeout() const final {
+        return Milliseconds{250};
+    }
+
+    Microseconds maxQueueLatency() const final {
+        return Microseconds{500};
+    }
+
+    int idlePctThreshold() const final {
+        return 0;
+    }
+
+    int recursionLimit() const final {
+        return 8;
+    }
+
+    int runQueues() const final {
+        return _runQueues;
+    }
+
+private:
+    const int _runQueues;
+};
+
+/**
+ * Simulates kConnections connections, each sending kRequests requests one after another, and logs
+ * the request throughput and the distribution of the time requests spend queued.
+ */
+void runStressTest(int runQueues) {
+    const int kConnections = 20000;
+    const int kRequests = 20;
+
+    auto ioCtx = std::make_shared<asio::io_context>();
+    ServiceExecutorAdaptive executor(
+        getGlobalServiceContext(), ioCtx, stdx::make_unique<StressTestOptions>(runQueues));
+    ASSERT_OK(executor.start());
+
+    // Each request works on the state of its connection, which stays warm in the cache of the
+    // core that served the previous request only if the connection stays on that core.
+    struct Connection {
+        std::array<uint64_t, 64> state{};
+        int requests = 0;
+    };
+    std::vector<Connection> connections(kConnections);
+    std::vector<int64_t> queuedMicros(kConnections * kRequests);
+
+    stdx::mutex mutex;
+    stdx::condition_variable allDone;
+    int connectionsDone = 0;
+
+    stdx::function<void(int)> scheduleRequest = [&](int id) {
+        const auto scheduled = curTimeMicros64();
+        auto task = [&, id, scheduled] {
+            Connection& connection = connections[id];
+            queuedMicros[id * kRequests + connection.requests] = curTimeMicros64() - scheduled;
+            for (auto& word : connection.state) {
+                word = word * 31 + id;
+            }
+
+            if (++connection.requests < kRequests) {
+                scheduleRequest(id);
+                return;
+            }
+            stdx::lock_guard<stdx::mutex> lk(mutex);
+            if (++connectionsDone == kConnections) {
+                allDone.notify_all();
+            }
+        };
+        invariantOK(executor.schedule(std::move(task), ServiceExecutor::kEmptyFlags));
+    };
+
+    Timer timer;
+    for (int id = 0; id < kConnections; id++) {
+        scheduleRequest(id);
+    }
+    {
+        stdx::unique_lock<stdx::mutex> lk(mutex);
+        allDone.wait(lk, [&] { return connectionsDone == kConnections; });
+    }
+    const auto elapsedMicros = timer.micros();
+    ASSERT_OK(executor.shutdown(Seconds{10}));
+
+    std::sort(queuedMicros.begin(), queuedMicros.end());
+    auto percentile = [&](double pct) {
+        return queuedMicros[static_cast<size_t>(pct / 100 * (queuedMicros.size() - 1))];
+    };
+
+    BSONObjBuilder stats;
+    executor.appendStats(&stats);
+    log() << "adaptive executor with " << runQueues << " run queues: "
+          << queuedMicros.size() * 1000000 / std::max(elapsedMicros, 1LL) << " requests/s, "
+          << "queued p50 " << percentile(50) << "us, p99 " << percentile(99) << "us, p99.9 "
+          << percentile(99.9) << "us, " << stats.obj();
+}
+
+// Compares the tasks queued in the io_context of the adaptive executor against the same load on
+// per-thread run queues. This is a manual benchmark, so it only logs its results.
+TEST(ServiceExecutorAdaptiveBench, SharedQueueAgainstRunQueues) {
+    setGlobalServiceContext(stdx::make_unique<ServiceContextNoop>());
+    runStressTest(0);
+    runStressTest(std::max(stdx::thread::hardware_concurrency(), 2U));
+}
+
+}  // namespace
+}  // namespace mongo
@@ -32,6 +32,8 @@
 
 #include "mongo/transport/service_executor_synchronous.h"
 
+#include <algorithm>
+
 #include "mongo/db/server_parameters.h"
 #include "mongo/stdx/thread.h"
 #include "mongo/transport/service_entry_point_utils.h"
@@ -47,8 +49,16 @@ namespace {
 // value.
 MONGO_EXPORT_SERVER_PARAMETER(synchronousServiceExecutorRecursionLimit, int, 8);
 
+// Worker threads whose connection closed are parked for reuse by new connections, up to this many
+// at a time, and exit once they have been parked this long.
+MONGO_EXPORT_SERVER_PARAMETER(synchronousServiceExecutorMaxParkedThreads, int, 64);
+MONGO_EXPORT_SERVER_PARAMETER(synchronousServiceExecutorParkedThreadIdleMillis, int, 60000);
+
 //ǰ߳Ҳǵǰconn߳
 constexpr auto kThreadsRunning = "threadsRunning"_sd;
+constexpr auto kThreadsParked = "threadsParked"_sd;
+constexpr auto kThreadsCreated = "threadsCreated"_sd;
+constexpr auto kThreadsReused = "threadsReused"_sd;
 constexpr auto kExecutorLabel = "executor"_sd;
 constexpr auto kExecutorName = "passthrough"_sd;
 }  // namespace
@@ -82,9 +92,16 @@ Status ServiceExecutorSynchronous::shutdown(Milliseconds timeout) {
 
     _stillRunning.store(false);
 
+    {
+        stdx::lock_guard<stdx::mutex> lk(_parkedMutex);
+        for (auto parked : _parkedThreads) {
+            parked->wakeup.notify_one();
+        }
+    }
+
     stdx::unique_lock<stdx::mutex> lock(_shutdownMutex);
     bool result = _shutdownCondition.wait_for(lock, timeout.toSystemDuration(), [this]() {
-        return _numRunningWorkerThreads.load() == 0;
+        return _numRunningWorkerThreads.load() == 0 && _numParkedThreads.load() == 0;
     });
 
     return result
@@ -151,47 +168,89 @@ Status ServiceExecutorSynchronous::schedule(Task task, ScheduleFlags flags) {
         return Status::OK();
     }
 
-    // First call to schedule() for this connection, spawn a worker thread that will push jobs
-    // into the thread local job queue.
+    // First call to schedule() for this connection, hand it to a parked worker thread or spawn
+    // a worker thread that will push jobs into the thread local job queue.
+    if (_handOffToParkedThread(&task)) {
+        return Status::OK();
+    }
+
     log() << "Starting new executor thread in passthrough mode";
 
-	//conṇ߳߳conn-xxִжӦtask
-    Status status = launchServiceWorkerThread([ this, task = std::move(task) ] {
-		//func̻߳ص
-	
-        int ret = _numRunningWorkerThreads.addAndFetch(1);
+    Status status = launchServiceWorkerThread(
+        [ this, task = std::move(task) ] { _workerThreadRoutine(std::move(task)); });
+    if (status.isOK()) {
+        _threadsCreated.addAndFetch(1);
+    }
+    return status;
+}
+
+void ServiceExecutorSynchronous::_workerThreadRoutine(Task task) {
+    _numRunningWorkerThreads.addAndFetch(1);
 
-		//taskӦ ServiceStateMachine::_runNextInGuard
+    ParkedThread parkedThread;
+    do {
         _localWorkQueue.emplace_back(std::move(task));
-		//ÿӶڸwhileѭIODB storage
         while (!_localWorkQueue.empty() && _stillRunning.loadRelaxed()) {
-			if (_localRecursionDepth > 2)
-				log() << "ddd test Starting while deal ## 333333333333 ServiceExecutorSynchronous::schedule, depth:" << _localRecursionDepth;
             _localRecursionDepth = 1;
-			//log() << "Starting new executor thread in passthrough mode ddd tesst 11 size:" << _localWorkQueue.size() << "  _numRunningWorkerThreads:" << ret;
-			//лȡһtaskִ, taskִйлSSM״̬һֱѭǸ̶߳ӦĿͻ˹رӲŻߵ_localWorkQueue.pop_front();
-			//Ӧ:ServiceStateMachine::_runNextInGuard  ̸߳ӵݰ
-            _localWorkQueue.front()(); 
-			
-            _localWorkQueue.pop_front();  //ȥtaskɾ
-            
-        }
-		ret = _numRunningWorkerThreads.subtractAndFetch(1);
-		//log() << "Starting new executor thread in passthrough mode ddd tesst 22 size:" << _localWorkQueue.size() << "	_numRunningWorkerThreads:" << ret;
-		if (ret == 0) { //һӶϿʱߵif
-        //if (_numRunningWorkerThreads.subtractAndFetch(1) == 0) { //
-        	//˵Ѿûпˣshutdown˳
-        	//mongo shellshutdownʱֻеûκӴڵʱ˳
-            _shutdownCondition.notify_all();
-			//log() << "Starting new executor thread in passthrough mode ddd tesst 44";
+            _localWorkQueue.front()();
+            _localWorkQueue.pop_front();
         }
+        _localWorkQueue.clear();
+
+        task = _park(&parkedThread);
+    } while (task);
 
-		//ͻ˶ӦӶϿʱߵ
-		LOG(3) << "Starting new executor thread in passthrough mode ddd tesst end ";
-		//log() << "Starting new executor thread in passthrough mode ddd tesst end ";
+    if (_numRunningWorkerThreads.load() == 0 && _numParkedThreads.load() == 0) {
+        _shutdownCondition.notify_all();
+    }
+}
+
+ServiceExecutor::Task ServiceExecutorSynchronous::_park(ParkedThread* self) {
+    stdx::unique_lock<stdx::mutex> lk(_parkedMutex);
+    if (!_stillRunning.load() ||
+        _parkedThreads.size() >=
+            static_cast<size_t>(synchronousServiceExecutorMaxParkedThreads.load())) {
+        _numRunningWorkerThreads.subtractAndFetch(1);
+        return Task();
+    }
+
+    // Count the thread as parked before it stops counting as running, so that shutdown() never
+    // sees it as neither.
+    _parkedThreads.push_back(self);
+    _numParkedThreads.addAndFetch(1);
+    _numRunningWorkerThreads.subtractAndFetch(1);
+
+    const Milliseconds idleTimeout{synchronousServiceExecutorParkedThreadIdleMillis.load()};
+    self->wakeup.wait_for(lk, idleTimeout.toSystemDuration(), [&] {
+        return self->task || !_stillRunning.load();
     });
 
-    return status;
+    if (self->task) {
+        // _handOffToParkedThread() took the thread off the list and counted it as running.
+        return std::move(self->task);
+    }
+
+    _parkedThreads.erase(std::find(_parkedThreads.begin(), _parkedThreads.end(), self));
+    _numParkedThreads.subtractAndFetch(1);
+    return Task();
+}
+
+bool ServiceExecutorSynchronous::_handOffToParkedThread(Task* task) {
+    stdx::lock_guard<stdx::mutex> lk(_parkedMutex);
+    if (_parkedThreads.empty()) {
+        return false;
+    }
+
+    // The most recently parked thread is the most likely to still have a warm cache and stack.
+    ParkedThread* parked = _parkedThreads.back();
+    _parkedThreads.pop_back();
+    _numRunningWorkerThreads.addAndFetch(1);
+    _numParkedThreads.subtractAndFetch(1);
+
+    parked->task = std::move(*task);
+    parked->wakeup.notify_one();
+    _threadsReused.addAndFetch(1);
+    return true;
 }
 
 /*
@@ -223,7 +282,9 @@ mongos> db.serverStatus().network
 void ServiceExecutorSynchronous::appendStats(BSONObjBuilder* bob) const {
     BSONObjBuilder section(bob->subobjStart("serviceExecutorTaskStats"));
     section << kExecutorLabel << kExecutorName << kThreadsRunning
-            << static_cast<int>(_numRunningWorkerThreads.loadRelaxed());
+            << static_cast<int>(_numRunningWorkerThreads.loadRelaxed()) << kThreadsParked
+            << static_cast<int>(_numParkedThreads.loadRelaxed()) << kThreadsCreated
+            << _threadsCreated.loadRelaxed() << kThreadsReused << _threadsReused.loadRelaxed();
 }
 
 }  // namespace transport
@@ -29,6 +29,7 @@
 #pragma once
 
 #include <deque>
+#include <vector>
 
 #include "mongo/base/status.h"
 #include "mongo/platform/atomic_word.h"
@@ -70,6 +71,32 @@ public:
     void appendStats(BSONObjBuilder* bob) const override;
 
 private:
+    /**
+     * A worker thread waiting in _park() for a new connection.
+     */
+    struct ParkedThread {
+        stdx::condition_variable wakeup;
+        Task task;
+    };
+
+    /**
+     * Runs 'task' and the tasks it schedules on this thread until the connection ends, then
+     * parks the thread and does the same for each connection handed to it.
+     */
+    void _workerThreadRoutine(Task task);
+
+    /**
+     * Parks this thread until a new connection is handed to it, and returns its first task.
+     * Returns an empty task if the thread should exit instead, because too many threads are
+     * parked, it stayed parked for too long, or the executor is shutting down.
+     */
+    Task _park(ParkedThread* self);
+
+    /**
+     * Hands 'task' to a parked thread and returns true, or returns false if none is parked.
+     */
+    bool _handOffToParkedThread(Task* task);
+
 /* thread_localʼ
 thread_local std::deque<ServiceExecutor::Task> ServiceExecutorSynchronous::_localWorkQueue = {}; //
 thread_local int ServiceExecutorSynchronous::_localRecursionDepth = 0;
@@ -87,6 +114,14 @@ thread_local int64_t ServiceExecutorSynchronous::_localThreadIdleCounter = 0;
     //ǰconn߳οServiceExecutorSynchronous::schedul 
     //ע⣬Ǹȫֵģʾжٸ̣߳ǰ_localWorkQueue̼߳
     AtomicWord<size_t> _numRunningWorkerThreads{0};
+
+    // Parked threads, most recently parked last.
+    stdx::mutex _parkedMutex;
+    std::vector<ParkedThread*> _parkedThreads;
+    AtomicWord<size_t> _numParkedThreads{0};
+
+    AtomicWord<long long> _threadsCreated{0};
+    AtomicWord<long long> _threadsReused{0};
     size_t _numHardwareCores{0}; //cpu
 };
 
@@ -73,6 +73,10 @@ struct TestOptions : public ServiceExecutorAdaptive::Options {
     int recursionLimit() const final {
         return 0;
     }
+
+    int runQueues() const final {
+        return 2;
+    }
 };
 
 class ServiceExecutorAdaptiveFixture : public unittest::Test {
@@ -134,6 +138,123 @@ TEST_F(ServiceExecutorAdaptiveFixture, ScheduleFailsBeforeStartup) {
     scheduleBasicTask(executor.get(), false);
 }
 
+/**
+ * Runs the executor with one worker thread and two run queues. The controller never starts more
+ * threads, so the queue which each task ran from is predictable.
+ */
+struct RunQueueTestOptions : public ServiceExecutorAdaptive::Options {
+    int reservedThreads() const final {
+        return 1;
+    }
+
+    Milliseconds workerThreadRunTime() const final {
+        return Milliseconds{1000};
+    }
+
+    int runTimeJitter() const final {
+        return 0;
+    }
+
+    Milliseconds stuckThreadTimeout() const final {
+        return Seconds{60};
+    }
+
+    Microseconds maxQueueLatency() const final {
+        return duration_cast<Microseconds>(Milliseconds{5});
+    }
+
+    int idlePctThreshold() const final {
+        return 101;
+    }
+
+    int recursionLimit() const final {
+        return 0;
+    }
+
+    int runQueues() const final {
+        return 2;
+    }
+};
+
+class ServiceExecutorAdaptiveRunQueueFixture : public unittest::Test {
+protected:
+    void setUp() override {
+        setGlobalServiceContext(stdx::make_unique<ServiceContextNoop>());
+        executor = stdx::make_unique<ServiceExecutorAdaptive>(
+            getGlobalServiceContext(),
+            std::make_shared<asio::io_context>(),
+            stdx::make_unique<RunQueueTestOptions>());
+    }
+
+    BSONObj stats() {
+        BSONObjBuilder builder;
+        executor->appendStats(&builder);
+        return builder.obj()["serviceExecutorTaskStats"].Obj().getOwned();
+    }
+
+    /**
+     * Waits until 'count' reaches 'expected', which the tasks update under 'mutex'.
+     */
+    void waitForTasks(stdx::mutex& mutex,
+                      stdx::condition_variable& cond,
+                      int& count,
+                      int expected) {
+        stdx::unique_lock<stdx::mutex> lk(mutex);
+        ASSERT(cond.wait_for(
+            lk, Seconds{30}.toSystemDuration(), [&] { return count == expected; }));
+    }
+
+    std::unique_ptr<ServiceExecutorAdaptive> executor;
+};
+
+TEST_F(ServiceExecutorAdaptiveRunQueueFixture, IdleWorkerStealsFromOtherRunQueues) {
+    ASSERT_OK(executor->start());
+    auto guard = MakeGuard([this] { ASSERT_OK(executor->shutdown(Seconds{10})); });
+    ASSERT_EQ(2, stats()["runQueues"].numberInt());
+
+    // Tasks scheduled from outside the executor alternate between the two run queues, and the
+    // only worker thread must steal those queued on the run queue which is not its own.
+    const int kTasks = 10;
+    stdx::mutex mutex;
+    stdx::condition_variable cond;
+    int ran = 0;
+    for (int i = 0; i < kTasks; i++) {
+        ASSERT_OK(executor->schedule(
+            [&] {
+                stdx::lock_guard<stdx::mutex> lk(mutex);
+                if (++ran == kTasks) {
+                    cond.notify_all();
+                }
+            },
+            ServiceExecutor::kEmptyFlags));
+    }
+    waitForTasks(mutex, cond, ran, kTasks);
+    ASSERT_EQ(kTasks / 2, stats()["totalStolen"].numberLong());
+}
+
+TEST_F(ServiceExecutorAdaptiveRunQueueFixture, TasksScheduledByAWorkerStayOnItsRunQueue) {
+    ASSERT_OK(executor->start());
+    auto guard = MakeGuard([this] { ASSERT_OK(executor->shutdown(Seconds{10})); });
+
+    // The first task is queued on the worker thread's own run queue, and each task schedules the
+    // next one from the worker thread, so none is ever stolen.
+    const int kTasks = 20;
+    stdx::mutex mutex;
+    stdx::condition_variable cond;
+    int ran = 0;
+    stdx::function<void()> task = [&] {
+        stdx::lock_guard<stdx::mutex> lk(mutex);
+        if (++ran == kTasks) {
+            cond.notify_all();
+            return;
+        }
+        invariantOK(executor->schedule(task, ServiceExecutor::kEmptyFlags));
+    };
+    ASSERT_OK(executor->schedule(task, ServiceExecutor::kEmptyFlags));
+    waitForTasks(mutex, cond, ran, kTasks);
+    ASSERT_EQ(0, stats()["totalStolen"].numberLong());
+}
+
 TEST_F(ServiceExecutorSynchronousFixture, BasicTaskRuns) {
     ASSERT_OK(executor->start());
     auto guard = MakeGuard([this] { ASSERT_OK(executor->shutdown(Milliseconds{500})); });
@@ -145,6 +266,43 @@ TEST_F(ServiceExecutorSynchronousFixture, ScheduleFailsBeforeStartup) {
     scheduleBasicTask(executor.get(), false);
 }
 
+TEST_F(ServiceExecutorSynchronousFixture, ReusesParkedThreadForNextConnection) {
+    ASSERT_OK(executor->start());
+    auto guard = MakeGuard([this] { ASSERT_OK(executor->shutdown(Milliseconds{500})); });
+
+    auto stats = [this] {
+        BSONObjBuilder builder;
+        executor->appendStats(&builder);
+        return builder.obj()["serviceExecutorTaskStats"].Obj().getOwned();
+    };
+    auto runConnection = [this] {
+        stdx::mutex mutex;
+        stdx::condition_variable cond;
+        boost::optional<stdx::thread::id> threadId;
+        ASSERT_OK(executor->schedule(
+            [&] {
+                stdx::lock_guard<stdx::mutex> lk(mutex);
+                threadId = stdx::this_thread::get_id();
+                cond.notify_all();
+            },
+            ServiceExecutor::kEmptyFlags));
+
+        stdx::unique_lock<stdx::mutex> lk(mutex);
+        cond.wait(lk, [&] { return static_cast<bool>(threadId); });
+        return *threadId;
+    };
+
+    const auto firstThread = runConnection();
+    while (stats()["threadsParked"].numberInt() != 1) {
+        stdx::this_thread::yield();
+    }
+
+    ASSERT(runConnection() == firstThread);
+    BSONObj finalStats = stats();
+    ASSERT_EQ(finalStats["threadsCreated"].numberLong(), 1);
+    ASSERT_EQ(finalStats["threadsReused"].numberLong(), 1);
+}
+
 
 }  // namespace
 }  // namespace mongo
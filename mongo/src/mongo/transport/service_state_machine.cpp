@@ -34,6 +34,7 @@
 
 #include "mongo/config.h"
 #include "mongo/db/client.h"
+#include "mongo/db/concurrency/admission_control.h"
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/stdx/memory.h"
@@ -413,6 +414,7 @@ void ServiceStateMachine::_sourceCallback(Status status) {
 	//log() << "ddd test .. ServiceStateMachine::_sourceCallback ";
 
     if (status.isOK()) {
+        _inMessageArrival = Date_t::now();
 		//봦Ϣ׶  _processMessage
         _state.store(State::Process);
 
@@ -469,6 +471,7 @@ void ServiceStateMachine::_sinkCallback(Status status) {
     } else if (_inExhaust) { //3.6.1汾㣬Ϊexhaustû
     	//ע
     	//ע״̬process   _processMessage   ҪProcess
+        _inMessageArrival = Date_t::now();
         _state.store(State::Process); 
     } else { //ʼս÷֧ _sourceMessage    еݹݴ
         _state.store(State::Source); //ע״̬Source,տͻ
@@ -532,6 +535,7 @@ void ServiceStateMachine::_processMessage(ThreadGuard guard) {
     // Pass sourced Message to handler to generate response.
     //ȡһΨһUniqueOperationContextһͻ˶ӦһUniqueOperationContext
     auto opCtx = Client::getCurrent()->makeOperationContext();
+    AdmissionControl::get(opCtx.get()).setArrivalTime(_inMessageArrival);
 
     // The handleRequest is implemented in a subclass for mongod/mongos and actually all the
     // database work for this request.
@@ -562,6 +566,8 @@ void ServiceStateMachine::_processMessage(ThreadGuard guard) {
         networkCounter.hitLogicalOut(toSink.size());
 
         if (_compressorId) {
+            // Compressors read the message as a single buffer.
+            toSink.makeContiguous();
             auto swm = compressorMgr.compressMessage(toSink, &_compressorId.value());
             uassertStatusOK(swm.getStatus());
             toSink = swm.getValue();
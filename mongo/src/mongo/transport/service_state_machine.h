@@ -281,6 +281,10 @@ private:
     //մmessageϢ  һıľͼ¼ڸmsg, ҲASIOSourceTicket._targetԱ
     Message _inMessage; //ֵServiceStateMachine::_sourceMessage  
 
+    // When _inMessage finished arriving, so that the time it spends queued before execution
+    // counts against its queue time budget.
+    Date_t _inMessageArrival;
+
     //ĬϳʼkUnowned,ʶSSM״̬ڷǻԾ״̬ҪжǷҪ״̬תиֻ߳Զ̬߳ģЧ
     AtomicWord<Ownership> _owned{Ownership::kUnowned};
 #if MONGO_CONFIG_DEBUG_BUILD
@@ -29,6 +29,7 @@
 #pragma once
 
 #include <utility>
+#include <vector>
 
 #include "mongo/base/system_error.h"
 #include "mongo/config.h"
@@ -231,6 +232,25 @@ private:
         //LOG(0) << "ddd test ....2..... opportunisticRead:" << size;
     }
 
+    template <typename Buffer>
+    static void consumeBuffers(Buffer* buffers, size_t size) {
+        *buffers += size;
+    }
+
+    /**
+     * Drops the first 'size' bytes from a sequence of buffers, as written by a vectored write.
+     */
+    static void consumeBuffers(std::vector<asio::const_buffer>* buffers, size_t size) {
+        auto it = buffers->begin();
+        for (; it != buffers->end() && size >= asio::buffer_size(*it); ++it) {
+            size -= asio::buffer_size(*it);
+        }
+        if (it != buffers->end()) {
+            *it += size;
+        }
+        buffers->erase(buffers->begin(), it);
+    }
+
     template <typename Stream, typename ConstBufferSequence, typename CompleteHandler>
     void opportunisticWrite(bool sync,
                             Stream& stream,
@@ -252,8 +272,8 @@ private:
             // size is > 0.
             ConstBufferSequence asyncBuffers(buffers);
             if (size > 0) {
-                asyncBuffers += size;
-                }
+                consumeBuffers(&asyncBuffers, size);
+            }
             //LOG(0) << "ddd test ......... opportunisticWrite";
             //ݵöȡhandlerصִмasiowrite_op::operator
             asio::async_write(stream, asyncBuffers, std::forward<CompleteHandler>(handler));
@@ -198,10 +198,21 @@ void TransportLayerASIO::ASIOSinkTicket::fillImpl() {
         return;
 
 	// TransportLayerASIO::ASIOSession::write
-    session->write(isSync(),
-	   asio::buffer(_msgToSend.buf(), _msgToSend.size()),
-	   //ݳɹcallbackص
-	   [this](const std::error_code& ec, size_t size) { _sinkCallback(ec, size); });
+    auto sinkCallback = [this](const std::error_code& ec, size_t size) {
+        _sinkCallback(ec, size);
+    };
+    if (_msgToSend.isContiguous()) {
+        session->write(isSync(), asio::buffer(_msgToSend.buf(), _msgToSend.size()), sinkCallback);
+        return;
+    }
+
+    // The message references buffers it does not own a copy of; send them with one vectored
+    // write instead of gathering them first.
+    std::vector<asio::const_buffer> buffers;
+    for (const auto& range : _msgToSend.buffers()) {
+        buffers.emplace_back(range.data(), range.length());
+    }
+    session->write(isSync(), buffers, sinkCallback);
 }
 
 //ServiceStateMachine::_sourceMessage->TransportLayerASIO::asyncWait->TransportLayerASIO::ASIOTicket::fill->TransportLayerASIO::ASIOTicket::finishFill
@@ -0,0 +1,651 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kNetwork
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/config.h"
+
+#ifdef MONGO_CONFIG_HAVE_LINUX_IO_URING
+
+#include "mongo/transport/transport_layer_io_uring.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/socket.h>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "asio.hpp"
+
+#include "mongo/base/checked_cast.h"
+#include "mongo/db/server_options.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/service_context.h"
+#include "mongo/db/stats/counters.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/transport/service_entry_point.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/errno_util.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/net/hostandport.h"
+#include "mongo/util/net/sock.h"
+#include "mongo/util/net/ssl_options.h"
+
+namespace mongo {
+namespace transport {
+namespace {
+
+// Sizing of the ring and its registered buffer pool. Sourcing a message keeps a quarter of the
+// registered buffers free for sinks, since idle connections hold theirs until a request arrives.
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(ioUringQueueDepth, int, 1024);
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(ioUringRegisteredBuffers, int, 256);
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(ioUringRegisteredBufferSizeBytes, int, 16 * 1024);
+
+constexpr int kMaxQueueDepth = 32768;        // IORING_MAX_ENTRIES
+constexpr int kMaxRegisteredBuffers = 1024;  // UIO_MAXIOV
+constexpr int kMinRegisteredBufferSize = 1024;
+constexpr int kMaxRegisteredBufferSize = 1024 * 1024;
+
+constexpr auto kHeaderSize = sizeof(MSGHEADER::Value);
+
+// How much to read at once when no registered buffer is free.
+constexpr size_t kUnregisteredReadSize = 4 * 1024;
+
+}  // namespace
+
+/**
+ * A Session over an accepted socket. Besides the socket, it holds the bytes that were received
+ * past the end of the last message sourced from it.
+ */
+class TransportLayerIOUring::IOUringSession : public Session {
+    MONGO_DISALLOW_COPYING(IOUringSession);
+
+public:
+    IOUringSession(std::shared_ptr<Socket> socket, TransportLayerIOUring* tl)
+        : _tl(tl),
+          _socket(std::move(socket)),
+          _remote(_socket->remoteAddr().getAddr(), _socket->remoteAddr().getPort()),
+          _local(_socket->localAddr().getAddr(), _socket->localAddr().getPort()),
+          _registration(tl->_registerSession(this)) {}
+
+    ~IOUringSession() {
+        _tl->_unregisterSession(_registration);
+    }
+
+    TransportLayer* getTransportLayer() const override {
+        return _tl;
+    }
+
+    const HostAndPort& remote() const override {
+        return _remote;
+    }
+
+    const HostAndPort& local() const override {
+        return _local;
+    }
+
+    int fd() const {
+        return _socket->rawFD();
+    }
+
+    bool isOpen() const {
+        return _open.load();
+    }
+
+    /**
+     * Shuts the socket down, which completes any receive or send in flight on it. The
+     * descriptor itself stays open until the session is destroyed.
+     */
+    void shutdown() {
+        if (_open.swap(false)) {
+            ::shutdown(fd(), SHUT_RDWR);
+        }
+    }
+
+    // Only the one source ticket in progress for this session touches the received bytes.
+    size_t buffered() const {
+        return _received.size() - _receivedStart;
+    }
+
+    const char* bufferedData() const {
+        return _received.data() + _receivedStart;
+    }
+
+    void consume(size_t bytes) {
+        _receivedStart += bytes;
+        if (_receivedStart == _received.size()) {
+            _received.clear();
+            _receivedStart = 0;
+        }
+    }
+
+    void append(const char* data, size_t bytes) {
+        _compact();
+        _received.insert(_received.end(), data, data + bytes);
+    }
+
+    /**
+     * Returns space for 'bytes' more bytes at the end of the received bytes. Whatever is not
+     * filled must be given back with shrink().
+     */
+    char* grow(size_t bytes) {
+        _compact();
+        _received.resize(_received.size() + bytes);
+        return _received.data() + _received.size() - bytes;
+    }
+
+    void shrink(size_t bytes) {
+        _received.resize(_received.size() - bytes);
+    }
+
+private:
+    void _compact() {
+        if (_receivedStart > 0) {
+            _received.erase(_received.begin(), _received.begin() + _receivedStart);
+            _receivedStart = 0;
+        }
+    }
+
+    TransportLayerIOUring* const _tl;
+    const std::shared_ptr<Socket> _socket;
+    const HostAndPort _remote;
+    const HostAndPort _local;
+
+    AtomicWord<bool> _open{true};
+
+    std::vector<char> _received;
+    size_t _receivedStart = 0;
+
+    // Initialized last: shutdown() may reach the session as soon as it is registered.
+    const SessionList::iterator _registration;
+};
+
+/**
+ * A TicketImpl for this TransportLayer. Filling it queues operations on the ring, and the fill
+ * callback runs either on the filling thread or on the ring thread.
+ */
+class TransportLayerIOUring::IOUringTicket : public TicketImpl {
+    MONGO_DISALLOW_COPYING(IOUringTicket);
+
+public:
+    IOUringTicket(const IOUringSessionHandle& session, Date_t expiration)
+        : _weakSession(session), _sessionId(session->id()), _expiration(expiration) {}
+
+    SessionId sessionId() const override {
+        return _sessionId;
+    }
+
+    Date_t expiration() const override {
+        return _expiration;
+    }
+
+    void fill(IOUring* ring, TicketCallback cb) {
+        _ring = ring;
+        _fillCallback = std::move(cb);
+
+        // Keep the session, and so its socket, alive until the ticket is filled.
+        _session = _weakSession.lock();
+        if (!_session || !_session->isOpen()) {
+            _finishFill(Ticket::SessionClosedStatus);
+            return;
+        }
+        if (_expiration < Date_t::now()) {
+            _finishFill(Ticket::ExpiredStatus);
+            return;
+        }
+        _fillImpl();
+    }
+
+protected:
+    virtual void _fillImpl() = 0;
+
+    void _finishFill(Status status) {
+        _session.reset();
+        auto fillCallback = std::move(_fillCallback);
+        fillCallback(std::move(status));
+    }
+
+    /**
+     * Translates the result of a failed or zero-length transfer.
+     */
+    static Status _resultToStatus(int result) {
+        if (result == 0) {
+            return {ErrorCodes::HostUnreachable, "Connection closed by peer"};
+        }
+        if (result == -ECANCELED) {
+            return TransportLayer::ShutdownStatus;
+        }
+        return {ErrorCodes::HostUnreachable, errnoWithDescription(-result)};
+    }
+
+    IOUring* _ring = nullptr;
+    IOUringSessionHandle _session;
+
+private:
+    std::weak_ptr<IOUringSession> _weakSession;
+    const SessionId _sessionId;
+    const Date_t _expiration;
+    TicketCallback _fillCallback;
+};
+
+class TransportLayerIOUring::IOUringSourceTicket : public IOUringTicket {
+public:
+    IOUringSourceTicket(const IOUringSessionHandle& session, Date_t expiration, Message* msg)
+        : IOUringTicket(session, expiration), _target(msg) {}
+
+private:
+    void _fillImpl() override {
+        _parse();
+    }
+
+    /**
+     * Completes the ticket if the session already holds a whole message, and otherwise receives
+     * more bytes.
+     */
+    void _parse() {
+        const size_t available = _session->buffered();
+        if (available >= kHeaderSize) {
+            MSGHEADER::ConstView headerView(_session->bufferedData());
+            const auto msgLen = static_cast<size_t>(headerView.getMessageLength());
+            if (msgLen < kHeaderSize || msgLen > MaxMessageSizeBytes) {
+                StringBuilder sb;
+                sb << "recv(): message msgLen " << msgLen << " is invalid. "
+                   << "Min " << kHeaderSize << " Max: " << MaxMessageSizeBytes;
+                const auto str = sb.str();
+                LOG(0) << str;
+                _finishFill(Status(ErrorCodes::ProtocolError, str));
+                return;
+            }
+
+            if (available >= msgLen) {
+                auto buffer = SharedBuffer::allocate(msgLen);
+                memcpy(buffer.get(), _session->bufferedData(), msgLen);
+                _session->consume(msgLen);
+                _finishMessage(std::move(buffer));
+                return;
+            }
+
+            // The rest of a large message is read straight into its final buffer.
+            if (msgLen - available > _ring->registeredBufferSize()) {
+                _body = SharedBuffer::allocate(msgLen);
+                _bodyLen = msgLen;
+                _bodyReceived = available;
+                memcpy(_body.get(), _session->bufferedData(), available);
+                _session->consume(available);
+                _receiveBody();
+                return;
+            }
+        }
+
+        _receive();
+    }
+
+    void _receive() {
+        const size_t keepFree = static_cast<size_t>(ioUringRegisteredBuffers) / 4;
+        if (_ring->tryAcquireBuffer(&_buffer, keepFree)) {
+            _ring->readFixed(_session->fd(), _buffer, 0, _buffer.size, [this](int result) {
+                if (result > 0) {
+                    _session->append(_buffer.data, result);
+                }
+                _ring->releaseBuffer(_buffer);
+                _received(result);
+            });
+            return;
+        }
+
+        auto data = _session->grow(kUnregisteredReadSize);
+        _ring->read(_session->fd(), data, kUnregisteredReadSize, [this](int result) {
+            _session->shrink(kUnregisteredReadSize - std::max(result, 0));
+            _received(result);
+        });
+    }
+
+    void _received(int result) {
+        if (result <= 0) {
+            _finishFill(_resultToStatus(result));
+            return;
+        }
+        _parse();
+    }
+
+    void _receiveBody() {
+        _ring->read(_session->fd(),
+                    _body.get() + _bodyReceived,
+                    _bodyLen - _bodyReceived,
+                    [this](int result) {
+                        if (result <= 0) {
+                            _finishFill(_resultToStatus(result));
+                            return;
+                        }
+                        _bodyReceived += result;
+                        if (_bodyReceived < _bodyLen) {
+                            _receiveBody();
+                            return;
+                        }
+                        _finishMessage(std::move(_body));
+                    });
+    }
+
+    void _finishMessage(SharedBuffer buffer) {
+        _target->setData(std::move(buffer));
+        networkCounter.hitPhysicalIn(_target->size());
+        _finishFill(Status::OK());
+    }
+
+    Message* const _target;
+    IOUring::Buffer _buffer;
+    SharedBuffer _body;
+    size_t _bodyLen = 0;
+    size_t _bodyReceived = 0;
+};
+
+class TransportLayerIOUring::IOUringSinkTicket : public IOUringTicket {
+public:
+    IOUringSinkTicket(const IOUringSessionHandle& session, Date_t expiration, const Message& msg)
+        : IOUringTicket(session, expiration), _msgToSend(msg), _size(msg.size()) {}
+
+private:
+    void _fillImpl() override {
+        // Small messages are copied into a registered buffer; anything else is sent in place.
+        if (_size <= _ring->registeredBufferSize() && _ring->tryAcquireBuffer(&_buffer)) {
+            char* out = _buffer.data;
+            for (const auto& range : _msgToSend.buffers()) {
+                memcpy(out, range.data(), range.length());
+                out += range.length();
+            }
+            _fixed = true;
+        } else if (!_msgToSend.isContiguous()) {
+            _ranges = _msgToSend.buffers();
+        }
+        _send();
+    }
+
+    std::vector<ConstDataRange> _unsentRanges() const {
+        std::vector<ConstDataRange> unsent;
+        size_t skip = _sent;
+        for (const auto& range : _ranges) {
+            if (skip >= range.length()) {
+                skip -= range.length();
+                continue;
+            }
+            unsent.emplace_back(range.data() + skip, range.length() - skip);
+            skip = 0;
+        }
+        return unsent;
+    }
+
+    void _send() {
+        const size_t remaining = _size - _sent;
+        auto sentCallback = [this](int result) { _onSent(result); };
+        if (_fixed) {
+            _ring->writeFixed(_session->fd(), _buffer, _sent, remaining, std::move(sentCallback));
+        } else if (!_ranges.empty()) {
+            _ring->write(_session->fd(), _unsentRanges(), std::move(sentCallback));
+        } else {
+            _ring->write(
+                _session->fd(), _msgToSend.buf() + _sent, remaining, std::move(sentCallback));
+        }
+    }
+
+    void _onSent(int result) {
+        if (result > 0) {
+            _sent += result;
+            if (_sent < _size) {
+                _send();
+                return;
+            }
+        }
+
+        if (_fixed) {
+            _ring->releaseBuffer(_buffer);
+        }
+        if (result <= 0) {
+            _finishFill(_resultToStatus(result));
+            return;
+        }
+        networkCounter.hitPhysicalOut(_size);
+        _finishFill(Status::OK());
+    }
+
+    Message _msgToSend;
+    const size_t _size;
+
+    // The pieces of a message with segments, sent with vectored writes.
+    std::vector<ConstDataRange> _ranges;
+
+    IOUring::Buffer _buffer;
+    bool _fixed = false;
+    size_t _sent = 0;
+};
+
+TransportLayerIOUring::Options::Options(const ServerGlobalParams* params)
+    : port(params->port), ipList(params->bind_ip) {}
+
+TransportLayerIOUring::ListenerIOUring::ListenerIOUring(const Options& opts,
+                                                       TransportLayerIOUring* tl)
+    : Listener("", opts.ipList, opts.port, getGlobalServiceContext(), true), _tl(tl) {}
+
+void TransportLayerIOUring::ListenerIOUring::accepted(std::unique_ptr<AbstractMessagingPort> mp) {
+    // Accepted sockets never get wrapped in a messaging port; see _accepted().
+    MONGO_UNREACHABLE;
+}
+
+void TransportLayerIOUring::ListenerIOUring::_accepted(const std::shared_ptr<Socket>& psocket,
+                                                       long long connectionId) {
+    _tl->_handleNewSocket(psocket);
+}
+
+Status TransportLayerIOUring::checkAvailable() {
+#ifdef MONGO_CONFIG_SSL
+    if (getSSLGlobalParams().sslMode.load() != SSLParams::SSLMode_disabled) {
+        return {ErrorCodes::IllegalOperation, "The io_uring transport layer does not support TLS"};
+    }
+#endif
+    return IOUring::probe();
+}
+
+TransportLayerIOUring::TransportLayerIOUring(const Options& opts, ServiceEntryPoint* sep)
+    : _sep(sep),
+      _options(opts),
+      _workerIOContext(std::make_shared<asio::io_context>()),
+      _listener(stdx::make_unique<ListenerIOUring>(opts, this)) {}
+
+TransportLayerIOUring::~TransportLayerIOUring() = default;
+
+const std::shared_ptr<asio::io_context>& TransportLayerIOUring::getIOContext() {
+    return _workerIOContext;
+}
+
+Ticket TransportLayerIOUring::sourceMessage(const SessionHandle& session,
+                                            Message* message,
+                                            Date_t expiration) {
+    auto ioUringSession = checked_pointer_cast<IOUringSession>(session);
+    return Ticket(
+        this, stdx::make_unique<IOUringSourceTicket>(ioUringSession, expiration, message));
+}
+
+Ticket TransportLayerIOUring::sinkMessage(const SessionHandle& session,
+                                          const Message& message,
+                                          Date_t expiration) {
+    auto ioUringSession = checked_pointer_cast<IOUringSession>(session);
+    return Ticket(this,
+                  stdx::make_unique<IOUringSinkTicket>(ioUringSession, expiration, message));
+}
+
+Status TransportLayerIOUring::wait(Ticket&& ticket) {
+    auto ownedTicket = getOwnedTicketImpl(std::move(ticket));
+    auto ioUringTicket = checked_cast<IOUringTicket*>(ownedTicket.get());
+    if (!_running.load()) {
+        return TransportLayer::ShutdownStatus;
+    }
+
+    stdx::mutex mutex;
+    stdx::condition_variable cv;
+    boost::optional<Status> waitStatus;
+    ioUringTicket->fill(_ring.get(), [&](Status status) {
+        // Notify under the lock: the waiter destroys 'cv' as soon as it sees the status.
+        stdx::lock_guard<stdx::mutex> lk(mutex);
+        waitStatus = std::move(status);
+        cv.notify_one();
+    });
+
+    stdx::unique_lock<stdx::mutex> lk(mutex);
+    cv.wait(lk, [&] { return static_cast<bool>(waitStatus); });
+    return *waitStatus;
+}
+
+void TransportLayerIOUring::asyncWait(Ticket&& ticket, TicketCallback callback) {
+    auto ownedTicket = std::shared_ptr<TicketImpl>(getOwnedTicketImpl(std::move(ticket)));
+    auto ioUringTicket = checked_cast<IOUringTicket*>(ownedTicket.get());
+    if (!_running.load()) {
+        callback(TransportLayer::ShutdownStatus);
+        return;
+    }
+
+    ioUringTicket->fill(
+        _ring.get(),
+        [ callback = std::move(callback), ownedTicket = std::move(ownedTicket) ](Status status) {
+            callback(status);
+        });
+}
+
+void TransportLayerIOUring::end(const SessionHandle& session) {
+    auto ioUringSession = checked_pointer_cast<IOUringSession>(session);
+    ioUringSession->shutdown();
+}
+
+Status TransportLayerIOUring::setup() {
+    if (ioUringQueueDepth < 1 || ioUringQueueDepth > kMaxQueueDepth) {
+        return {ErrorCodes::BadValue,
+                str::stream() << "ioUringQueueDepth must be between 1 and " << kMaxQueueDepth};
+    }
+    if (ioUringRegisteredBuffers < 0 || ioUringRegisteredBuffers > kMaxRegisteredBuffers) {
+        return {ErrorCodes::BadValue,
+                str::stream() << "ioUringRegisteredBuffers must be between 0 and "
+                              << kMaxRegisteredBuffers};
+    }
+    if (ioUringRegisteredBufferSizeBytes < kMinRegisteredBufferSize ||
+        ioUringRegisteredBufferSizeBytes > kMaxRegisteredBufferSize) {
+        return {ErrorCodes::BadValue,
+                str::stream() << "ioUringRegisteredBufferSizeBytes must be between "
+                              << kMinRegisteredBufferSize << " and "
+                              << kMaxRegisteredBufferSize};
+    }
+
+    IOUring::Options ringOptions;
+    ringOptions.queueDepth = static_cast<unsigned>(ioUringQueueDepth);
+    ringOptions.registeredBuffers = static_cast<size_t>(ioUringRegisteredBuffers);
+    ringOptions.registeredBufferSize = static_cast<size_t>(ioUringRegisteredBufferSizeBytes);
+    auto swRing = IOUring::create(ringOptions);
+    if (!swRing.isOK()) {
+        return swRing.getStatus();
+    }
+    _ring = std::move(swRing.getValue());
+
+    if (!_listener->setupSockets()) {
+        error() << "Failed to set up sockets during startup.";
+        return {ErrorCodes::InternalError, "Failed to set up sockets"};
+    }
+
+    return Status::OK();
+}
+
+Status TransportLayerIOUring::start() {
+    if (_running.swap(true)) {
+        return {ErrorCodes::InternalError, "TransportLayer is already running"};
+    }
+
+    try {
+        _ringThread = stdx::thread([this] {
+            setThreadName("io_uring");
+            _ring->run();
+        });
+        _listenerThread = stdx::thread([this] { _listener->initAndListen(); });
+        _listener->waitUntilListening();
+        return Status::OK();
+    } catch (...) {
+        return {ErrorCodes::InternalError, "Failed to start io_uring transport layer threads."};
+    }
+}
+
+void TransportLayerIOUring::shutdown() {
+    if (!_running.swap(false)) {
+        return;
+    }
+
+    ListeningSockets::get()->closeAll();
+    _listener->shutdown();
+    if (_listenerThread.joinable()) {
+        _listenerThread.join();
+    }
+
+    // The ring only stops once nothing is in flight, so interrupt every session's operations.
+    {
+        stdx::lock_guard<stdx::mutex> lk(_sessionsMutex);
+        for (auto session : _sessions) {
+            session->shutdown();
+        }
+    }
+
+    _ring->shutdown();
+    if (_ringThread.joinable()) {
+        _ringThread.join();
+    }
+
+    const auto stats = _ring->stats();
+    log() << "io_uring transport layer submitted " << stats.submitted << " operations ("
+          << stats.fixedSubmitted << " through registered buffers) in " << stats.enterCalls
+          << " io_uring_enter calls";
+}
+
+void TransportLayerIOUring::_handleNewSocket(std::shared_ptr<Socket> socket) {
+    auto session = std::make_shared<IOUringSession>(std::move(socket), this);
+    invariant(_sep);
+    _sep->startSession(std::move(session));
+}
+
+TransportLayerIOUring::SessionList::iterator TransportLayerIOUring::_registerSession(
+    IOUringSession* session) {
+    stdx::lock_guard<stdx::mutex> lk(_sessionsMutex);
+    return _sessions.insert(_sessions.end(), session);
+}
+
+void TransportLayerIOUring::_unregisterSession(SessionList::iterator it) {
+    stdx::lock_guard<stdx::mutex> lk(_sessionsMutex);
+    _sessions.erase(it);
+}
+
+}  // namespace transport
+}  // namespace mongo
+
+#endif  // MONGO_CONFIG_HAVE_LINUX_IO_URING
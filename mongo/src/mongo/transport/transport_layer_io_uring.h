@@ -0,0 +1,173 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/transport/io_uring.h"
+#include "mongo/transport/ticket_impl.h"
+#include "mongo/transport/transport_layer.h"
+#include "mongo/util/net/listen.h"
+
+namespace asio {
+class io_context;
+}  // namespace asio
+
+namespace mongo {
+
+class ServiceEntryPoint;
+class Socket;
+struct ServerGlobalParams;
+
+namespace transport {
+
+/**
+ * A TransportLayer implementation that moves bytes through a Linux io_uring instance.
+ *
+ * Connections are accepted by a Listener, as in TransportLayerLegacy. Receives and sends for
+ * every session are queued on one IOUring and handed to the kernel in batches by a single ring
+ * thread, which also runs their completions. Small messages go through buffers registered with
+ * the ring; bytes that arrive ahead of the message being sourced are kept on the session for the
+ * next sourceMessage().
+ *
+ * With the adaptive service executor, sessions are driven through asyncWait(): the ring thread
+ * runs the completion of each receive or send, and the service state machine schedules the work
+ * that follows on the executor's worker threads, which run getIOContext(). No thread blocks on a
+ * session's socket. With the synchronous executor, each session's thread waits for the ring
+ * thread to complete its tickets.
+ *
+ * Only plaintext connections are supported. Use checkAvailable() before creating one;
+ * TransportLayerManager falls back to asio when it fails.
+ */
+class TransportLayerIOUring final : public TransportLayer {
+    MONGO_DISALLOW_COPYING(TransportLayerIOUring);
+
+public:
+    struct Options {
+        explicit Options(const ServerGlobalParams* params);
+        Options() = default;
+
+        int port = 0;        // port to bind to
+        std::string ipList;  // addresses to bind to
+    };
+
+    /**
+     * Returns OK if this process can use the io_uring transport layer: the kernel lets us create
+     * a ring and TLS is not enabled.
+     */
+    static Status checkAvailable();
+
+    TransportLayerIOUring(const Options& opts, ServiceEntryPoint* sep);
+
+    ~TransportLayerIOUring();
+
+    Ticket sourceMessage(const SessionHandle& session,
+                         Message* message,
+                         Date_t expiration = Ticket::kNoExpirationDate) override;
+
+    Ticket sinkMessage(const SessionHandle& session,
+                       const Message& message,
+                       Date_t expiration = Ticket::kNoExpirationDate) override;
+
+    Status wait(Ticket&& ticket) override;
+    void asyncWait(Ticket&& ticket, TicketCallback callback) override;
+
+    void end(const SessionHandle& session) override;
+
+    Status setup() override;
+    Status start() override;
+
+    void shutdown() override;
+
+    /**
+     * Returns the io_context the adaptive service executor runs its tasks on. The transport layer
+     * itself does no I/O through it.
+     */
+    const std::shared_ptr<asio::io_context>& getIOContext();
+
+private:
+    class IOUringSession;
+    class IOUringTicket;
+    class IOUringSourceTicket;
+    class IOUringSinkTicket;
+
+    using IOUringSessionHandle = std::shared_ptr<IOUringSession>;
+
+    /**
+     * Hands accepted sockets to the transport layer directly, instead of wrapping them in a
+     * MessagingPort.
+     */
+    class ListenerIOUring : public Listener {
+    public:
+        ListenerIOUring(const Options& opts, TransportLayerIOUring* tl);
+
+        void accepted(std::unique_ptr<AbstractMessagingPort> mp) override;
+
+        bool useUnixSockets() const override {
+            return true;
+        }
+
+    private:
+        void _accepted(const std::shared_ptr<Socket>& psocket, long long connectionId) override;
+
+        TransportLayerIOUring* const _tl;
+    };
+
+    using SessionList = std::list<IOUringSession*>;
+
+    void _handleNewSocket(std::shared_ptr<Socket> socket);
+    SessionList::iterator _registerSession(IOUringSession* session);
+    void _unregisterSession(SessionList::iterator it);
+
+    ServiceEntryPoint* const _sep;
+    const Options _options;
+
+    const std::shared_ptr<asio::io_context> _workerIOContext;
+
+    std::unique_ptr<IOUring> _ring;
+    stdx::thread _ringThread;
+
+    std::unique_ptr<ListenerIOUring> _listener;
+    stdx::thread _listenerThread;
+
+    AtomicWord<bool> _running{false};
+
+    // Every live session, so that shutdown() can interrupt their outstanding operations.
+    stdx::mutex _sessionsMutex;
+    SessionList _sessions;
+};
+
+}  // namespace transport
+}  // namespace mongo
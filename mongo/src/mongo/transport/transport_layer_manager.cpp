@@ -26,11 +26,14 @@
  *    it in the license file.
  */
 
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kNetwork
+
 #include "mongo/platform/basic.h"
 
 #include "mongo/transport/transport_layer_manager.h"
 
 #include "mongo/base/status.h"
+#include "mongo/config.h"
 #include "mongo/db/server_options.h"
 #include "mongo/db/service_context.h"
 #include "mongo/stdx/memory.h"
@@ -39,10 +42,15 @@
 #include "mongo/transport/session.h"
 #include "mongo/transport/transport_layer_asio.h"
 #include "mongo/transport/transport_layer_legacy.h"
+#include "mongo/util/log.h"
 #include "mongo/util/net/ssl_types.h"
 #include "mongo/util/time_support.h"
 #include <limits>
 
+#ifdef MONGO_CONFIG_HAVE_LINUX_IO_URING
+#include "mongo/transport/transport_layer_io_uring.h"
+#endif
+
 #include <iostream>
 
 namespace mongo {
@@ -149,7 +157,33 @@ std::unique_ptr<TransportLayer> TransportLayerManager::createWithConfig(
 	//mongosӦServiceEntryPointMongod,mongodӦServiceEntryPointMongos
     auto sep = ctx->getServiceEntryPoint();
 	//net.transportLayerģʽĬasio, legacyģʽ̭
-    if (config->transportLayer == "asio") {
+    if (config->transportLayer == "io_uring") {
+        // io_uring needs a kernel that has and allows it, so fall back to asio instead of failing.
+#ifdef MONGO_CONFIG_HAVE_LINUX_IO_URING
+        auto status = transport::TransportLayerIOUring::checkAvailable();
+        if (status.isOK()) {
+            transport::TransportLayerIOUring::Options opts(config);
+            auto transportLayerIOUring =
+                stdx::make_unique<transport::TransportLayerIOUring>(opts, sep);
+            if (config->serviceExecutor == "adaptive") {
+                // The ring thread completes the tickets, and the executor's workers run the rest.
+                ctx->setServiceExecutor(stdx::make_unique<ServiceExecutorAdaptive>(
+                    ctx, transportLayerIOUring->getIOContext()));
+            } else {
+                ctx->setServiceExecutor(stdx::make_unique<ServiceExecutorSynchronous>(ctx));
+            }
+            transportLayer = std::move(transportLayerIOUring);
+        } else {
+            warning() << "The io_uring transport layer is unavailable, using asio instead: "
+                      << status;
+        }
+#else
+        warning() << "This build does not include the io_uring transport layer, using asio instead";
+#endif
+    }
+
+    if (!transportLayer &&
+        (config->transportLayer == "asio" || config->transportLayer == "io_uring")) {
 		//ȡasioģʽӦϢ
         transport::TransportLayerASIO::Options opts(config);
 
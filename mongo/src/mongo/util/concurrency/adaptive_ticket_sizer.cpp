@@ -0,0 +1,148 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/concurrency/adaptive_ticket_sizer.h"
+
+#include <algorithm>
+
+#include "mongo/bson/bsonobjbuilder.h"
+
+namespace mongo {
+
+// Vegas thresholds, in number of queued operations.
+const double AdaptiveTicketSizer::kAlpha = 2;
+const double AdaptiveTicketSizer::kBeta = 6;
+
+// The pool is only grown when nearly every observation found it empty.
+const double AdaptiveTicketSizer::kSaturatedThreshold = 0.5;
+
+// Shrink once a tenth of the ticket holding time goes to eviction.
+const double AdaptiveTicketSizer::kEvictionStallThreshold = 0.1;
+const double AdaptiveTicketSizer::kEvictionBackoffFactor = 0.8;
+
+// The base latency is allowed to creep upwards by this fraction each interval, so that it
+// follows a workload which has become more expensive rather than pinning the old minimum.
+const double AdaptiveTicketSizer::kBaseLatencyDecay = 0.01;
+
+int AdaptiveTicketSizer::nextSize(int currentSize,
+                                  const Sample& sample,
+                                  int minSize,
+                                  int maxSize) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+
+    maxSize = std::max(minSize, maxSize);
+    const int step = std::max(1, currentSize / 32);
+
+    Decision decision = Decision::kHold;
+    int newSize = currentSize;
+
+    double latencyMicros = 0;
+    double queued = 0;
+    if (sample.throughput > 0 && sample.inFlight > 0) {
+        latencyMicros = sample.inFlight / sample.throughput * 1000 * 1000;
+        if (_baseLatencyMicros == 0 || latencyMicros < _baseLatencyMicros) {
+            _baseLatencyMicros = latencyMicros;
+        } else {
+            _baseLatencyMicros *= 1 + kBaseLatencyDecay;
+        }
+        queued = sample.inFlight * (1 - _baseLatencyMicros / latencyMicros);
+    }
+
+    if (sample.evictionStall > kEvictionStallThreshold) {
+        decision = Decision::kEvictionBackoff;
+        newSize = static_cast<int>(currentSize * kEvictionBackoffFactor);
+    } else if (latencyMicros == 0) {
+        // Nothing completed, so there is nothing to learn from this interval.
+    } else if (queued > kBeta) {
+        decision = Decision::kDecrease;
+        newSize = currentSize - step;
+    } else if (queued < kAlpha && sample.saturation >= kSaturatedThreshold) {
+        decision = Decision::kIncrease;
+        newSize = currentSize + step;
+    }
+
+    newSize = std::max(minSize, std::min(maxSize, newSize));
+    if (newSize > currentSize) {
+        ++_increases;
+    } else if (newSize < currentSize) {
+        if (decision == Decision::kEvictionBackoff) {
+            ++_evictionBackoffs;
+        } else {
+            ++_decreases;
+        }
+    }
+
+    _lastDecision = decision;
+    _lastSample = sample;
+    _lastLatencyMicros = latencyMicros;
+    _lastQueued = queued;
+    _lastSize = newSize;
+    return newSize;
+}
+
+void AdaptiveTicketSizer::reset() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _baseLatencyMicros = 0;
+    _lastDecision = Decision::kNone;
+}
+
+void AdaptiveTicketSizer::report(BSONObjBuilder* builder) const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    builder->append("size", _lastSize);
+    builder->append("lastDecision", decisionName(_lastDecision));
+    builder->append("inFlight", _lastSample.inFlight);
+    builder->append("throughput", _lastSample.throughput);
+    builder->append("saturation", _lastSample.saturation);
+    builder->append("evictionStall", _lastSample.evictionStall);
+    builder->append("latencyMicros", _lastLatencyMicros);
+    builder->append("baseLatencyMicros", _baseLatencyMicros);
+    builder->append("queued", _lastQueued);
+    builder->append("increases", _increases);
+    builder->append("decreases", _decreases);
+    builder->append("evictionBackoffs", _evictionBackoffs);
+}
+
+const char* AdaptiveTicketSizer::decisionName(Decision decision) {
+    switch (decision) {
+        case Decision::kNone:
+            return "none";
+        case Decision::kHold:
+            return "hold";
+        case Decision::kIncrease:
+            return "increase";
+        case Decision::kDecrease:
+            return "decrease";
+        case Decision::kEvictionBackoff:
+            return "evictionBackoff";
+    }
+    MONGO_UNREACHABLE;
+}
+
+}  // namespace mongo
@@ -0,0 +1,113 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+class BSONObjBuilder;
+
+/**
+ * Computes the size of a ticket pool from latency feedback, in the style of TCP Vegas.
+ *
+ * Every interval the caller supplies the average number of tickets in use, the rate at which
+ * tickets were released and how much of the ticket holding time the storage engine spent
+ * stalled on cache eviction. By Little's law the operation latency is inFlight / throughput.
+ * The lowest latency seen recently is taken as the uncontended latency, and
+ *
+ *     queued = inFlight * (1 - baseLatency / latency)
+ *
+ * estimates how many of the ticket holders are only waiting on each other. The pool grows while
+ * that estimate is below 'alpha' and all tickets are being used, and shrinks once it exceeds
+ * 'beta'. Eviction stalls mean more concurrency only adds cache pressure, so they shrink the
+ * pool multiplicatively regardless of latency.
+ */
+class AdaptiveTicketSizer {
+    MONGO_DISALLOW_COPYING(AdaptiveTicketSizer);
+
+public:
+    struct Sample {
+        // Average number of tickets in use over the interval.
+        double inFlight = 0;
+
+        // Tickets released per second over the interval.
+        double throughput = 0;
+
+        // Fraction of the observations in the interval which found no ticket available.
+        double saturation = 0;
+
+        // Fraction of the ticket holding time spent in storage engine eviction or cache waits.
+        double evictionStall = 0;
+    };
+
+    enum class Decision { kNone, kHold, kIncrease, kDecrease, kEvictionBackoff };
+
+    static const double kAlpha;
+    static const double kBeta;
+    static const double kSaturatedThreshold;
+    static const double kEvictionStallThreshold;
+    static const double kEvictionBackoffFactor;
+    static const double kBaseLatencyDecay;
+
+    AdaptiveTicketSizer() = default;
+
+    /**
+     * Returns the pool size to use for the next interval, between 'minSize' and 'maxSize'.
+     */
+    int nextSize(int currentSize, const Sample& sample, int minSize, int maxSize);
+
+    /**
+     * Forgets the learned base latency. Used when the controller is turned off, since the
+     * workload may be entirely different when it is turned back on.
+     */
+    void reset();
+
+    void report(BSONObjBuilder* builder) const;
+
+    static const char* decisionName(Decision decision);
+
+private:
+    mutable stdx::mutex _mutex;
+
+    double _baseLatencyMicros = 0;
+
+    Decision _lastDecision = Decision::kNone;
+    Sample _lastSample;
+    double _lastLatencyMicros = 0;
+    double _lastQueued = 0;
+    int _lastSize = 0;
+
+    long long _increases = 0;
+    long long _decreases = 0;
+    long long _evictionBackoffs = 0;
+};
+
+}  // namespace mongo
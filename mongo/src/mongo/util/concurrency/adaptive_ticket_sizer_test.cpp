@@ -0,0 +1,116 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/adaptive_ticket_sizer.h"
+
+namespace mongo {
+namespace {
+
+AdaptiveTicketSizer::Sample makeSample(double inFlight,
+                                       double throughput,
+                                       double saturation = 1,
+                                       double evictionStall = 0) {
+    AdaptiveTicketSizer::Sample sample;
+    sample.inFlight = inFlight;
+    sample.throughput = throughput;
+    sample.saturation = saturation;
+    sample.evictionStall = evictionStall;
+    return sample;
+}
+
+TEST(AdaptiveTicketSizerTest, GrowsWhileSaturatedAndLatencyIsFlat) {
+    AdaptiveTicketSizer sizer;
+    // 64 operations in flight completing at 64000/s is 1ms each, every interval.
+    ASSERT_EQ(66, sizer.nextSize(64, makeSample(64, 64000), 5, 256));
+    ASSERT_EQ(68, sizer.nextSize(66, makeSample(66, 66000), 5, 256));
+}
+
+TEST(AdaptiveTicketSizerTest, HoldsWhenNotSaturated) {
+    AdaptiveTicketSizer sizer;
+    ASSERT_EQ(64, sizer.nextSize(64, makeSample(10, 10000, 0.1), 5, 256));
+}
+
+TEST(AdaptiveTicketSizerTest, ShrinksWhenLatencyRisesWithoutThroughput) {
+    AdaptiveTicketSizer sizer;
+    ASSERT_EQ(132, sizer.nextSize(128, makeSample(64, 64000), 5, 256));
+
+    // Twice the operations in flight at the same throughput: half of them are queued.
+    ASSERT_EQ(128, sizer.nextSize(132, makeSample(128, 64000), 5, 256));
+}
+
+TEST(AdaptiveTicketSizerTest, HoldsBetweenAlphaAndBeta) {
+    AdaptiveTicketSizer sizer;
+    sizer.nextSize(64, makeSample(64, 64000), 5, 256);
+
+    // Latency 1.0625ms against a roughly 1ms base leaves about 3 operations queued.
+    ASSERT_EQ(64, sizer.nextSize(64, makeSample(68, 64000), 5, 256));
+}
+
+TEST(AdaptiveTicketSizerTest, EvictionStallBacksOffMultiplicatively) {
+    AdaptiveTicketSizer sizer;
+    ASSERT_EQ(80, sizer.nextSize(100, makeSample(100, 100000, 1, 0.5), 5, 256));
+
+    BSONObjBuilder builder;
+    sizer.report(&builder);
+    BSONObj report = builder.obj();
+    ASSERT_EQ("evictionBackoff", report["lastDecision"].String());
+    ASSERT_EQ(1, report["evictionBackoffs"].numberLong());
+    ASSERT_EQ(0, report["decreases"].numberLong());
+}
+
+TEST(AdaptiveTicketSizerTest, ClampsToBounds) {
+    AdaptiveTicketSizer sizer;
+    ASSERT_EQ(64, sizer.nextSize(64, makeSample(64, 64000), 5, 64));
+    ASSERT_EQ(5, sizer.nextSize(6, makeSample(6, 6000, 1, 1), 5, 64));
+    ASSERT_EQ(32, sizer.nextSize(128, makeSample(1, 1000, 0), 5, 32));
+}
+
+TEST(AdaptiveTicketSizerTest, IdleIntervalHolds) {
+    AdaptiveTicketSizer sizer;
+    ASSERT_EQ(64, sizer.nextSize(64, makeSample(0, 0), 5, 256));
+
+    BSONObjBuilder builder;
+    sizer.report(&builder);
+    ASSERT_EQ("hold", builder.obj()["lastDecision"].String());
+}
+
+TEST(AdaptiveTicketSizerTest, ResetForgetsBaseLatency) {
+    AdaptiveTicketSizer sizer;
+    sizer.nextSize(64, makeSample(64, 64000), 5, 256);
+    sizer.reset();
+
+    // Without the 1ms base, a 2ms latency is the new baseline rather than a sign of queueing.
+    ASSERT_EQ(66, sizer.nextSize(64, makeSample(64, 32000), 5, 256));
+}
+
+}  // namespace
+}  // namespace mongo
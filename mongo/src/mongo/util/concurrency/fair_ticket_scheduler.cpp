@@ -0,0 +1,350 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/concurrency/fair_ticket_scheduler.h"
+
+#include <algorithm>
+#include <deque>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+const char FairTicketScheduler::kOverflowTenant[] = "$overflow";
+const char FairTicketScheduler::kInternalTenantReportName[] = "$internal";
+
+namespace {
+
+// Holding time charged for the first tickets of a tenant, before any has been released.
+const double kInitialHoldMicros = 1000;
+
+const int64_t kFirstBucketMicros = 128;
+
+// How often queued operations look for tickets which were returned to the TicketHolder
+// directly, or added by resizing it, rather than handed over by release().
+const Milliseconds kRedispatchInterval(100);
+
+struct Share {
+    double weight = 1;
+    int maxTickets = 0;
+};
+
+stdx::mutex sharesMutex;
+std::map<std::string, Share> shares;
+BSONObj sharesObj;
+AtomicUInt64 sharesGeneration(1);
+
+}  // namespace
+
+struct FairTicketScheduler::Waiter {
+    stdx::condition_variable cv;
+    bool granted = false;
+};
+
+class FairTicketScheduler::Tenant {
+public:
+    explicit Tenant(std::string name) : name(std::move(name)) {}
+
+    bool atLimit() const {
+        return maxTickets > 0 && inFlight >= maxTickets;
+    }
+
+    void recordWait(int64_t micros) {
+        totalWaitMicros += micros;
+        maxWaitMicros = std::max(maxWaitMicros, micros);
+        waitHistogram[waitHistogramBucket(micros)]++;
+    }
+
+    const std::string name;
+
+    uint64_t sharesGeneration = 0;
+    double weight = 1;
+    int maxTickets = 0;
+
+    // Total charge of the tickets granted so far, in microseconds of holding time per unit of
+    // weight.
+    double virtualTime = 0;
+    double expectedHoldMicros = kInitialHoldMicros;
+
+    int inFlight = 0;
+    std::deque<Waiter*> queue;
+
+    long long granted = 0;
+    long long queued = 0;
+    long long timedOut = 0;
+    int64_t totalWaitMicros = 0;
+    int64_t maxWaitMicros = 0;
+    long long waitHistogram[kNumWaitHistogramBuckets] = {};
+};
+
+FairTicketScheduler::FairTicketScheduler(TicketHolder* holder) : _holder(holder) {}
+
+FairTicketScheduler::~FairTicketScheduler() = default;
+
+FairTicketScheduler::Tenant* FairTicketScheduler::acquire(StringData name, Date_t deadline) {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    Tenant* tenant = _getTenant_inlock(name);
+
+    if (_numQueued == 0 && !tenant->atLimit() && _holder->tryAcquire()) {
+        _grant_inlock(tenant);
+        tenant->recordWait(0);
+        return tenant;
+    }
+
+    if (tenant->queue.empty()) {
+        tenant->virtualTime = std::max(tenant->virtualTime, _virtualTime);
+        _active.push_back(tenant);
+    }
+
+    Waiter waiter;
+    tenant->queue.push_back(&waiter);
+    ++tenant->queued;
+    ++_numQueued;
+
+    TicketHolder::WaitScope waiting(_holder);
+    const unsigned long long startMicros = curTimeMicros64();
+
+    _dispatch_inlock();
+    while (!waiter.granted) {
+        const Date_t now = Date_t::now();
+        if (now >= deadline) {
+            tenant->queue.erase(std::find(tenant->queue.begin(), tenant->queue.end(), &waiter));
+            --_numQueued;
+            if (tenant->queue.empty()) {
+                _deactivate_inlock(tenant);
+            }
+            ++tenant->timedOut;
+            return nullptr;
+        }
+
+        waiter.cv.wait_until(lk, std::min(deadline, now + kRedispatchInterval).toSystemTimePoint());
+        if (!waiter.granted) {
+            _dispatch_inlock();
+        }
+    }
+
+    tenant->recordWait(curTimeMicros64() - startMicros);
+    return tenant;
+}
+
+void FairTicketScheduler::release(Tenant* tenant, Microseconds held) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+
+    if (tenant) {
+        --tenant->inFlight;
+
+        // The grant was charged the holding time expected at the time, so charge the difference.
+        const double heldMicros = durationCount<Microseconds>(held);
+        if (!tenant->name.empty()) {
+            tenant->virtualTime += (heldMicros - tenant->expectedHoldMicros) / tenant->weight;
+        }
+        tenant->expectedHoldMicros += (heldMicros - tenant->expectedHoldMicros) / 8;
+    }
+
+    if (Tenant* next = _pickNext_inlock()) {
+        _handOff_inlock(next);
+    } else {
+        _holder->release();
+    }
+}
+
+int FairTicketScheduler::numQueued() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _numQueued;
+}
+
+void FairTicketScheduler::report(BSONObjBuilder* builder) const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+
+    builder->append("queued", _numQueued);
+    BSONObjBuilder tenantsBuilder(builder->subobjStart("tenants"));
+    for (auto&& entry : _tenants) {
+        const Tenant& tenant = *entry.second;
+        BSONObjBuilder tenantBuilder(tenantsBuilder.subobjStart(
+            tenant.name.empty() ? StringData(kInternalTenantReportName) : StringData(tenant.name)));
+        tenantBuilder.append("weight", tenant.weight);
+        tenantBuilder.append("maxTickets", tenant.maxTickets);
+        tenantBuilder.append("queueDepth", static_cast<int>(tenant.queue.size()));
+        tenantBuilder.append("inFlight", tenant.inFlight);
+        tenantBuilder.append("granted", tenant.granted);
+        tenantBuilder.append("queued", tenant.queued);
+        tenantBuilder.append("timedOut", tenant.timedOut);
+        tenantBuilder.append("totalWaitMicros", static_cast<long long>(tenant.totalWaitMicros));
+        tenantBuilder.append("maxWaitMicros", static_cast<long long>(tenant.maxWaitMicros));
+
+        BSONArrayBuilder histogramBuilder(tenantBuilder.subarrayStart("waitHistogram"));
+        for (long long count : tenant.waitHistogram) {
+            histogramBuilder.append(count);
+        }
+    }
+}
+
+Status FairTicketScheduler::setShares(const BSONObj& newShares) {
+    std::map<std::string, Share> parsed;
+    for (auto&& tenantElem : newShares) {
+        if (tenantElem.type() != Object) {
+            return Status(ErrorCodes::BadValue,
+                          str::stream() << "share for '" << tenantElem.fieldName()
+                                        << "' must be an object");
+        }
+
+        Share share;
+        for (auto&& field : tenantElem.Obj()) {
+            const StringData fieldName = field.fieldNameStringData();
+            if (fieldName == "weight") {
+                if (!field.isNumber() || !(field.numberDouble() > 0)) {
+                    return Status(ErrorCodes::BadValue,
+                                  str::stream() << "weight for '" << tenantElem.fieldName()
+                                                << "' must be a positive number");
+                }
+                share.weight = field.numberDouble();
+            } else if (fieldName == "maxTickets") {
+                if (!field.isNumber() || field.numberLong() < 0 ||
+                    field.numberLong() > std::numeric_limits<int>::max()) {
+                    return Status(ErrorCodes::BadValue,
+                                  str::stream() << "maxTickets for '" << tenantElem.fieldName()
+                                                << "' must be a non-negative integer");
+                }
+                share.maxTickets = field.numberInt();
+            } else {
+                return Status(ErrorCodes::BadValue,
+                              str::stream() << "unknown field '" << fieldName << "' in share for '"
+                                            << tenantElem.fieldName()
+                                            << "'");
+            }
+        }
+        parsed[tenantElem.fieldName()] = share;
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(sharesMutex);
+    shares.swap(parsed);
+    sharesObj = newShares.getOwned();
+    sharesGeneration.fetchAndAdd(1);
+    return Status::OK();
+}
+
+BSONObj FairTicketScheduler::getShares() {
+    stdx::lock_guard<stdx::mutex> lk(sharesMutex);
+    return sharesObj;
+}
+
+int FairTicketScheduler::waitHistogramBucket(int64_t micros) {
+    int bucket = 0;
+    int64_t bound = kFirstBucketMicros;
+    while (micros >= bound && bucket < kNumWaitHistogramBuckets - 1) {
+        ++bucket;
+        bound *= 2;
+    }
+    return bucket;
+}
+
+FairTicketScheduler::Tenant* FairTicketScheduler::_getTenant_inlock(StringData name) {
+    auto it = _tenants.find(name.toString());
+    if (it == _tenants.end()) {
+        if (_tenants.size() >= static_cast<size_t>(kMaxTenants)) {
+            name = kOverflowTenant;
+            it = _tenants.find(name.toString());
+        }
+        if (it == _tenants.end()) {
+            auto tenant = stdx::make_unique<Tenant>(name.toString());
+            it = _tenants.emplace(name.toString(), std::move(tenant)).first;
+        }
+    }
+
+    Tenant* tenant = it->second.get();
+    const uint64_t generation = sharesGeneration.load();
+    if (tenant->sharesGeneration != generation) {
+        stdx::lock_guard<stdx::mutex> sharesLock(sharesMutex);
+        auto share = shares.find(tenant->name);
+        tenant->weight = share == shares.end() ? 1 : share->second.weight;
+        tenant->maxTickets = share == shares.end() ? 0 : share->second.maxTickets;
+        tenant->sharesGeneration = generation;
+    }
+    return tenant;
+}
+
+FairTicketScheduler::Tenant* FairTicketScheduler::_pickNext_inlock() {
+    Tenant* next = nullptr;
+    for (Tenant* tenant : _active) {
+        if (tenant->atLimit()) {
+            continue;
+        }
+        if (tenant->name.empty()) {
+            return tenant;
+        }
+        if (!next || tenant->virtualTime < next->virtualTime) {
+            next = tenant;
+        }
+    }
+    return next;
+}
+
+void FairTicketScheduler::_grant_inlock(Tenant* tenant) {
+    ++tenant->inFlight;
+    ++tenant->granted;
+    if (!tenant->name.empty()) {
+        _virtualTime = std::max(_virtualTime, tenant->virtualTime);
+        tenant->virtualTime += tenant->expectedHoldMicros / tenant->weight;
+    }
+}
+
+void FairTicketScheduler::_handOff_inlock(Tenant* tenant) {
+    Waiter* waiter = tenant->queue.front();
+    tenant->queue.pop_front();
+    --_numQueued;
+    if (tenant->queue.empty()) {
+        _deactivate_inlock(tenant);
+    }
+
+    _grant_inlock(tenant);
+    waiter->granted = true;
+    waiter->cv.notify_one();
+}
+
+void FairTicketScheduler::_dispatch_inlock() {
+    while (_numQueued > 0) {
+        Tenant* next = _pickNext_inlock();
+        if (!next || !_holder->tryAcquire()) {
+            return;
+        }
+        _handOff_inlock(next);
+    }
+}
+
+void FairTicketScheduler::_deactivate_inlock(Tenant* tenant) {
+    _active.erase(std::find(_active.begin(), _active.end(), tenant));
+}
+
+}  // namespace mongo
@@ -0,0 +1,155 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+class BSONObjBuilder;
+class TicketHolder;
+
+/**
+ * Hands out the tickets of a TicketHolder fairly between tenants, which are the databases that
+ * operations run against, instead of first-come-first-served.
+ *
+ * Each tenant has a weight, and while tickets are contended every tenant gets a share of the
+ * ticket holding time proportional to its weight, however many operations it queues. This is
+ * start-time fair queueing: a tenant is charged the expected holding time of each ticket it is
+ * granted, divided by its weight, and corrected once the actual holding time is known on
+ * release. The queued tenant with the least charge goes next. A tenant may also be limited to a
+ * maximum number of tickets held at once.
+ *
+ * Operations which do not belong to a tenant, such as replication and other internal work, are
+ * queued under the empty tenant name and always served before any tenant.
+ *
+ * Every ticket of the holder must be released through release() while operations are queued
+ * here, so that it can be handed straight to the next one.
+ */
+class FairTicketScheduler {
+    MONGO_DISALLOW_COPYING(FairTicketScheduler);
+
+public:
+    class Tenant;
+
+    static const int kNumWaitHistogramBuckets = 16;
+    static const int kMaxTenants = 10000;
+
+    /**
+     * Name of the tenant which new tenants are folded into once there are kMaxTenants.
+     */
+    static const char kOverflowTenant[];
+
+    /**
+     * Name under which report() shows operations which do not belong to a tenant.
+     */
+    static const char kInternalTenantReportName[];
+
+    explicit FairTicketScheduler(TicketHolder* holder);
+    ~FairTicketScheduler();
+
+    /**
+     * Waits until a ticket is granted to 'tenant' or 'deadline' passes. Returns the tenant
+     * to pass to release(), or nullptr if the deadline passed.
+     */
+    Tenant* acquire(StringData tenant, Date_t deadline);
+
+    /**
+     * Returns a ticket which was held for 'held'. 'tenant' is the result of acquire(), or
+     * nullptr if the ticket was taken from the TicketHolder directly.
+     */
+    void release(Tenant* tenant, Microseconds held);
+
+    TicketHolder* holder() const {
+        return _holder;
+    }
+
+    /**
+     * Number of operations currently queued.
+     */
+    int numQueued() const;
+
+    /**
+     * Appends the queue depth, number of tickets in use and wait time statistics of every
+     * tenant which has used this scheduler.
+     */
+    void report(BSONObjBuilder* builder) const;
+
+    /**
+     * Sets the weight and ticket limit of tenants, shared by all schedulers, from a document
+     * of the form {<db>: {weight: <number>, maxTickets: <int>}, ...}. Tenants which are not
+     * mentioned have weight 1 and no limit, and maxTickets 0 means no limit.
+     */
+    static Status setShares(const BSONObj& shares);
+    static BSONObj getShares();
+
+    /**
+     * Returns the wait time histogram bucket for a wait of 'micros': bucket 0 holds waits of
+     * less than 128us, and each following bucket holds twice the range of the previous one.
+     */
+    static int waitHistogramBucket(int64_t micros);
+
+private:
+    struct Waiter;
+
+    // The following must be called with _mutex held.
+    Tenant* _getTenant_inlock(StringData name);
+    Tenant* _pickNext_inlock();
+    void _grant_inlock(Tenant* tenant);
+    void _handOff_inlock(Tenant* tenant);
+    void _dispatch_inlock();
+    void _deactivate_inlock(Tenant* tenant);
+
+    TicketHolder* const _holder;
+
+    mutable stdx::mutex _mutex;
+
+    std::map<std::string, std::unique_ptr<Tenant>> _tenants;
+
+    // Tenants which have operations queued.
+    std::vector<Tenant*> _active;
+
+    int _numQueued = 0;
+
+    // Start tag of the most recently granted ticket. A tenant which starts queueing again is
+    // charged from here, so that it cannot claim credit for the time it was idle.
+    double _virtualTime = 0;
+};
+
+}  // namespace mongo
@@ -0,0 +1,236 @@
+/**
+ * Copyright (C) 2017 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/json.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/fair_ticket_scheduler.h"
+#include "mongo/util/concurrency/ticketholder.h"
+
+namespace mongo {
+namespace {
+
+/**
+ * Acquires a ticket for each tenant on its own thread, in order, and records the order in which
+ * they are granted. Each thread returns its ticket as soon as it is granted.
+ */
+class QueuedAcquisitions {
+public:
+    explicit QueuedAcquisitions(FairTicketScheduler* scheduler) : _scheduler(scheduler) {}
+
+    ~QueuedAcquisitions() {
+        for (auto&& thread : _threads) {
+            thread.join();
+        }
+    }
+
+    void queue(std::string tenant) {
+        const int queuedBefore = _scheduler->numQueued();
+        _threads.emplace_back([this, tenant] {
+            auto granted = _scheduler->acquire(tenant, Date_t::max());
+            {
+                stdx::lock_guard<stdx::mutex> lk(_mutex);
+                _order.push_back(tenant);
+            }
+            _scheduler->release(granted, Microseconds(1000));
+        });
+        while (_scheduler->numQueued() == queuedBefore) {
+            stdx::this_thread::yield();
+        }
+    }
+
+    /**
+     * Waits for all acquisitions and returns the tenants in the order they were granted, with the
+     * empty tenant shown as "-".
+     */
+    std::string join() {
+        for (auto&& thread : _threads) {
+            thread.join();
+        }
+        _threads.clear();
+
+        std::string order;
+        for (auto&& tenant : _order) {
+            order += tenant.empty() ? "-" : tenant;
+        }
+        return order;
+    }
+
+private:
+    FairTicketScheduler* const _scheduler;
+    std::vector<stdx::thread> _threads;
+
+    stdx::mutex _mutex;
+    std::vector<std::string> _order;
+};
+
+BSONObj tenantReport(const FairTicketScheduler& scheduler, StringData tenant) {
+    BSONObjBuilder builder;
+    scheduler.report(&builder);
+    return builder.obj()["tenants"].Obj()[tenant].Obj().getOwned();
+}
+
+TEST(FairTicketSchedulerTest, GrantsFreeTicketsImmediately) {
+    TicketHolder holder(2);
+    FairTicketScheduler scheduler(&holder);
+
+    auto first = scheduler.acquire("a", Date_t::now());
+    auto second = scheduler.acquire("b", Date_t::now());
+    ASSERT(first);
+    ASSERT(second);
+    ASSERT_EQ(holder.available(), 0);
+
+    scheduler.release(first, Microseconds(10));
+    scheduler.release(second, Microseconds(10));
+    ASSERT_EQ(holder.available(), 2);
+    ASSERT_EQ(tenantReport(scheduler, "a")["granted"].numberLong(), 1);
+    ASSERT_EQ(tenantReport(scheduler, "a")["queued"].numberLong(), 0);
+}
+
+TEST(FairTicketSchedulerTest, TimesOutWhenNoTicketIsReleased) {
+    TicketHolder holder(1);
+    FairTicketScheduler scheduler(&holder);
+
+    auto held = scheduler.acquire("a", Date_t::now());
+    ASSERT(held);
+    ASSERT_FALSE(scheduler.acquire("b", Date_t::now() + Milliseconds(10)));
+    ASSERT_EQ(scheduler.numQueued(), 0);
+    ASSERT_EQ(holder.numWaiting(), 0);
+
+    BSONObj report = tenantReport(scheduler, "b");
+    ASSERT_EQ(report["queued"].numberLong(), 1);
+    ASSERT_EQ(report["timedOut"].numberLong(), 1);
+    ASSERT_EQ(report["queueDepth"].numberInt(), 0);
+
+    scheduler.release(held, Microseconds(10));
+    ASSERT_EQ(holder.available(), 1);
+}
+
+TEST(FairTicketSchedulerTest, HandsReleasedTicketToLeastChargedTenant) {
+    TicketHolder holder(1);
+    FairTicketScheduler scheduler(&holder);
+
+    auto held = scheduler.acquire("a", Date_t::now());
+    ASSERT(held);
+
+    QueuedAcquisitions acquisitions(&scheduler);
+    acquisitions.queue("a");
+    acquisitions.queue("a");
+    acquisitions.queue("b");
+    ASSERT_EQ(holder.numWaiting(), 3);
+
+    scheduler.release(held, Microseconds(1000));
+    ASSERT_EQ(acquisitions.join(), "baa");
+    ASSERT_EQ(holder.available(), 1);
+}
+
+TEST(FairTicketSchedulerTest, ServesInternalOperationsFirst) {
+    TicketHolder holder(1);
+    FairTicketScheduler scheduler(&holder);
+
+    auto held = scheduler.acquire("a", Date_t::now());
+    ASSERT(held);
+
+    QueuedAcquisitions acquisitions(&scheduler);
+    acquisitions.queue("b");
+    acquisitions.queue("");
+
+    scheduler.release(held, Microseconds(1000));
+    ASSERT_EQ(acquisitions.join(), "-b");
+}
+
+TEST(FairTicketSchedulerTest, PicksUpTicketsReleasedToTheHolder) {
+    TicketHolder holder(1);
+    FairTicketScheduler scheduler(&holder);
+    ASSERT(holder.tryAcquire());
+
+    QueuedAcquisitions acquisitions(&scheduler);
+    acquisitions.queue("a");
+
+    holder.release();
+    ASSERT_EQ(acquisitions.join(), "a");
+}
+
+TEST(FairTicketSchedulerTest, LimitsTicketsHeldByTenant) {
+    ASSERT_OK(FairTicketScheduler::setShares(fromjson("{a: {maxTickets: 1}}")));
+
+    TicketHolder holder(3);
+    FairTicketScheduler scheduler(&holder);
+
+    auto first = scheduler.acquire("a", Date_t::now());
+    ASSERT(first);
+    ASSERT_FALSE(scheduler.acquire("a", Date_t::now() + Milliseconds(10)));
+    auto other = scheduler.acquire("b", Date_t::now());
+    ASSERT(other);
+
+    scheduler.release(first, Microseconds(10));
+    auto second = scheduler.acquire("a", Date_t::now());
+    ASSERT(second);
+
+    scheduler.release(second, Microseconds(10));
+    scheduler.release(other, Microseconds(10));
+    ASSERT_EQ(holder.available(), 3);
+
+    ASSERT_OK(FairTicketScheduler::setShares(BSONObj()));
+}
+
+TEST(FairTicketSchedulerTest, ValidatesShares) {
+    ASSERT_OK(FairTicketScheduler::setShares(fromjson("{a: {weight: 2.5, maxTickets: 10}}")));
+    ASSERT_BSONOBJ_EQ(FairTicketScheduler::getShares(),
+                      fromjson("{a: {weight: 2.5, maxTickets: 10}}"));
+
+    ASSERT_NOT_OK(FairTicketScheduler::setShares(fromjson("{a: 1}")));
+    ASSERT_NOT_OK(FairTicketScheduler::setShares(fromjson("{a: {weight: 0}}")));
+    ASSERT_NOT_OK(FairTicketScheduler::setShares(fromjson("{a: {weight: 'x'}}")));
+    ASSERT_NOT_OK(FairTicketScheduler::setShares(fromjson("{a: {maxTickets: -1}}")));
+    ASSERT_NOT_OK(FairTicketScheduler::setShares(fromjson("{a: {priority: 1}}")));
+    ASSERT_BSONOBJ_EQ(FairTicketScheduler::getShares(),
+                      fromjson("{a: {weight: 2.5, maxTickets: 10}}"));
+
+    ASSERT_OK(FairTicketScheduler::setShares(BSONObj()));
+}
+
+TEST(FairTicketSchedulerTest, WaitHistogramBuckets) {
+    ASSERT_EQ(FairTicketScheduler::waitHistogramBucket(0), 0);
+    ASSERT_EQ(FairTicketScheduler::waitHistogramBucket(127), 0);
+    ASSERT_EQ(FairTicketScheduler::waitHistogramBucket(128), 1);
+    ASSERT_EQ(FairTicketScheduler::waitHistogramBucket(255), 1);
+    ASSERT_EQ(FairTicketScheduler::waitHistogramBucket(256), 2);
+    ASSERT_EQ(FairTicketScheduler::waitHistogramBucket(int64_t(1) << 40),
+              FairTicketScheduler::kNumWaitHistogramBuckets - 1);
+}
+
+}  // namespace
+}  // namespace mongo
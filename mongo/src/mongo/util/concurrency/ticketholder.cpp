@@ -38,6 +38,14 @@
 
 namespace mongo {
 
+TicketHolder::WaitScope::WaitScope(TicketHolder* holder) : _holder(holder) {
+    _holder->_numWaiting.fetchAndAdd(1);
+}
+
+TicketHolder::WaitScope::~WaitScope() {
+    _holder->_numWaiting.fetchAndSubtract(1);
+}
+
 #if defined(__linux__)
 namespace {
 void _check(int ret) {
@@ -88,6 +96,7 @@ wiredtiger
 */
 //LockerImpl<IsForMMAPV1>::_lockGlobalBeginе
 void TicketHolder::waitForTicket() { 
+    WaitScope waiting(this);
     while (0 != sem_wait(&_sem)) {
         if (errno != EINTR)
             _check(-1);
@@ -95,6 +104,7 @@ void TicketHolder::waitForTicket() {
 }
 
 bool TicketHolder::waitForTicketUntil(Date_t until) {
+    WaitScope waiting(this);
     const long long millisSinceEpoch = until.toMillisSinceEpoch();
     struct timespec ts;
 
@@ -111,6 +121,7 @@ bool TicketHolder::waitForTicketUntil(Date_t until) {
 }
 
 void TicketHolder::release() {
+    _numReleased.fetchAndAdd(1);
     _check(sem_post(&_sem));
 }
 
@@ -130,7 +141,7 @@ Status TicketHolder::resize(int newSize) {
                                     << newSize);
 
     while (_outof.load() < newSize) {
-        release();
+        _check(sem_post(&_sem));
         _outof.fetchAndAdd(1);
     }
 
@@ -173,6 +184,7 @@ bool TicketHolder::tryAcquire() {
 }
 
 void TicketHolder::waitForTicket() {
+    WaitScope waiting(this);
     stdx::unique_lock<stdx::mutex> lk(_mutex);
 
     while (!_tryAcquire()) {
@@ -181,12 +193,14 @@ void TicketHolder::waitForTicket() {
 }
 
 bool TicketHolder::waitForTicketUntil(Date_t until) {
+    WaitScope waiting(this);
     stdx::unique_lock<stdx::mutex> lk(_mutex);
 
     return _newTicket.wait_until(lk, until.toSystemTimePoint(), [this] { return _tryAcquire(); });
 }
 
 void TicketHolder::release() {
+    _numReleased.fetchAndAdd(1);
     {
         stdx::lock_guard<stdx::mutex> lk(_mutex);
         _num++;
@@ -31,6 +31,7 @@
 #endif
 
 #include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/mutex.h"
 #include "mongo/util/concurrency/mutex.h"
@@ -63,7 +64,41 @@ public:
 
     int outof() const;
 
+    /**
+     * Number of tickets returned through release() since construction. Tickets added by
+     * resize() are not counted, so the difference between two readings is the number of
+     * operations which finished with a ticket in between.
+     */
+    uint64_t numReleased() const {
+        return _numReleased.load();
+    }
+
+    /**
+     * Counts the calling thread in numWaiting() for its lifetime. Queues which order threads
+     * before they reach the TicketHolder use this so that their waiters are counted too.
+     */
+    class WaitScope {
+        MONGO_DISALLOW_COPYING(WaitScope);
+
+    public:
+        explicit WaitScope(TicketHolder* holder);
+        ~WaitScope();
+
+    private:
+        TicketHolder* const _holder;
+    };
+
+    /**
+     * Number of threads currently waiting for a ticket, see WaitScope.
+     */
+    int numWaiting() const {
+        return _numWaiting.load();
+    }
+
 private:
+    AtomicUInt64 _numReleased;
+    AtomicInt32 _numWaiting;
+
 #if defined(__linux__)
     //ź
     mutable sem_t _sem;
@@ -31,6 +31,7 @@
 
 #include "mongo/platform/basic.h"
 
+#include "mongo/stdx/thread.h"
 #include "mongo/unittest/unittest.h"
 #include "mongo/util/concurrency/ticketholder.h"
 
@@ -71,4 +72,34 @@ TEST(TicketholderTest, BasicTimeout) {
     holder.release();
     ASSERT_EQ(holder.used(), 0);
 }
+
+TEST(TicketholderTest, CountsReleases) {
+    TicketHolder holder(5);
+    ASSERT_EQ(holder.numReleased(), 0U);
+    { ScopedTicket ticket(&holder); }
+    { ScopedTicket ticket(&holder); }
+    ASSERT_EQ(holder.numReleased(), 2U);
+
+    // Growing the pool must not count as releasing tickets.
+    ASSERT_OK(holder.resize(10));
+    ASSERT_EQ(holder.numReleased(), 2U);
+}
+
+TEST(TicketholderTest, CountsWaiters) {
+    TicketHolder holder(5);
+    for (int i = 0; i < 5; i++) {
+        ASSERT(holder.tryAcquire());
+    }
+    ASSERT_EQ(holder.numWaiting(), 0);
+
+    stdx::thread waiter([&] { holder.waitForTicket(); });
+    while (holder.numWaiting() == 0) {
+        sleepmillis(1);
+    }
+    ASSERT_EQ(holder.numWaiting(), 1);
+
+    holder.release();
+    waiter.join();
+    ASSERT_EQ(holder.numWaiting(), 0);
+}
 }  // namespace
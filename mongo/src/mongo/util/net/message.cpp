@@ -30,6 +30,8 @@
 
 #include "mongo/util/net/message.h"
 
+#include <cstring>
+
 #include "mongo/platform/atomic_word.h"
 
 namespace mongo {
@@ -42,4 +44,50 @@ int32_t nextMessageId() {
     return NextMsgId.fetchAndAdd(1);
 }
 
+std::vector<ConstDataRange> Message::buffers() const {
+    std::vector<ConstDataRange> out;
+    if (!_buf) {
+        return out;
+    }
+
+    int bufLen = size();
+    for (const auto& segment : _segments) {
+        bufLen -= segment.len - segment.placeholderLen;
+    }
+
+    out.reserve(2 * _segments.size() + 1);
+    const char* const base = _buf.get();
+    int pos = 0;
+    for (const auto& segment : _segments) {
+        invariant(segment.offset >= pos);
+        if (segment.offset > pos) {
+            out.emplace_back(base + pos, segment.offset - pos);
+        }
+        out.emplace_back(segment.data, segment.len);
+        pos = segment.offset + segment.placeholderLen;
+    }
+    invariant(bufLen >= pos);
+    if (bufLen > pos) {
+        out.emplace_back(base + pos, bufLen - pos);
+    }
+    return out;
+}
+
+void Message::makeContiguous() {
+    if (isContiguous()) {
+        return;
+    }
+
+    auto flat = SharedBuffer::allocate(size());
+    char* out = flat.get();
+    for (const auto& range : buffers()) {
+        memcpy(out, range.data(), range.length());
+        out += range.length();
+    }
+    invariant(out == flat.get() + size());
+
+    _buf = std::move(flat);
+    _segments.clear();
+}
+
 }  // namespace mongo
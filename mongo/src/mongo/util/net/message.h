@@ -29,12 +29,17 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
+#include "mongo/base/data_range.h"
 #include "mongo/base/data_type_endian.h"
 #include "mongo/base/data_view.h"
 #include "mongo/base/encoded_value_storage.h"
 #include "mongo/base/static_assert.h"
+#include "mongo/bson/util/builder.h"
+#include "mongo/util/assert_util.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/shared_buffer.h"
 
 namespace mongo {
 
@@ -449,11 +454,62 @@ inline int ConstView::dataLen() const {
 
 }  // namespace MsgData
 
+/**
+ * Bytes that are sent in place of the 'placeholderLen' bytes at 'offset' in a message's buffer.
+ * They are read from 'data', which 'owner' keeps alive, so that large payloads such as the
+ * documents of a cursor batch do not have to be copied into the message buffer.
+ */
+struct MessageSegment {
+    int offset;
+    int placeholderLen;
+    ConstSharedBuffer owner;
+    const char* data;
+    int len;
+};
+
+/**
+ * Collects the MessageSegments of a message while it is being built.
+ */
+class MessageSegmentSink {
+public:
+    virtual ~MessageSegmentSink() = default;
+
+    /**
+     * Returns true if data appended to 'builder' is appended to the message this sink belongs to,
+     * so that offsets into 'builder' are offsets into the message.
+     */
+    virtual bool buildsInto(const BufBuilder& builder) const = 0;
+
+    /**
+     * Payloads smaller than this are cheaper to copy than to send as a separate buffer.
+     */
+    virtual int minSegmentBytes() const = 0;
+
+    /**
+     * Segments must be added in increasing offset order, and their placeholders must not overlap.
+     */
+    virtual void addSegment(MessageSegment segment) = 0;
+
+    /**
+     * Forgets every segment at or after 'offset'. Must be called whenever the message buffer is
+     * truncated to 'offset'.
+     */
+    virtual void discardSegmentsFrom(int offset) = 0;
+};
+
 //DbMessage._msgԱ  messageOpMsgRequest ReplyInterface  ReplyBuilderInterfaceȵĹϵԲοfactory.cppʵ
 class Message {
 public:
     Message() = default;
     explicit Message(SharedBuffer data) : _buf(std::move(data)) {}
+
+    /**
+     * A message whose header length covers 'data' with 'segments' spliced in. The segments must
+     * be sorted by offset.
+     */
+    Message(SharedBuffer data, std::vector<MessageSegment> segments)
+        : _buf(std::move(data)), _segments(std::move(segments)) {}
+
     //ͷheader
     MsgData::View header() const {
         verify(!empty());
@@ -490,8 +546,31 @@ public:
     //buf
     void reset() {
         _buf = {};
+        _segments.clear();
+    }
+
+    /**
+     * Returns false if some of this message's bytes live outside its buffer. Such a message must
+     * be sent with buffers(), or made contiguous before anything reads past its header.
+     */
+    bool isContiguous() const {
+        return _segments.empty();
     }
 
+    const std::vector<MessageSegment>& segments() const {
+        return _segments;
+    }
+
+    /**
+     * Returns the ranges that make up this message, in order, for vectored writes.
+     */
+    std::vector<ConstDataRange> buffers() const;
+
+    /**
+     * Copies the message into a single buffer if it has segments.
+     */
+    void makeContiguous();
+
     // use to set first buffer if empty
     //_bufֱʹbufռ
     void setData(SharedBuffer buf) {
@@ -515,24 +594,29 @@ public:
     }
 
     char* buf() {
+        invariant(isContiguous());
         return _buf.get();
     }
 
     const char* buf() const {
+        invariant(isContiguous());
         return _buf.get();
     }
 
     SharedBuffer sharedBuffer() {
+        invariant(isContiguous());
         return _buf;
     }
 
     ConstSharedBuffer sharedBuffer() const {
+        invariant(isContiguous());
         return _buf;
     }
 
 private:
     //Žݵbuf
     SharedBuffer _buf;
+    std::vector<MessageSegment> _segments;
 };
 
 /**
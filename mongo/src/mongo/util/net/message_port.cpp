@@ -197,6 +197,15 @@ bool MessagingPort::call(const Message& toSend, Message& response) {
 
 void MessagingPort::say(const Message& toSend) {
     invariant(!toSend.empty());
+    if (!toSend.isContiguous()) {
+        std::vector<std::pair<char*, int>> data;
+        for (const auto& range : toSend.buffers()) {
+            data.emplace_back(const_cast<char*>(range.data()), static_cast<int>(range.length()));
+        }
+        send(data, "say");
+        return;
+    }
+
     auto buf = toSend.buf();
     if (buf) {
         send(buf, MsgData::ConstView(buf).getLen(), "say");
@@ -258,6 +258,58 @@ BSONObjBuilder OpMsgBuilder::resumeBody() {
 
 AtomicBool OpMsgBuilder::disableDupeFieldCheck_forTest{false};
 
+void OpMsgBuilder::addSegment(MessageSegment segment) {
+    invariant(_state == kBody);
+    invariant(_minSegmentBytes > 0);
+    invariant(segment.offset >= _bodyStart);
+    invariant(segment.offset + segment.placeholderLen <= _buf.len());
+    invariant(_segments.empty() ||
+              segment.offset >= _segments.back().offset + _segments.back().placeholderLen);
+    _segments.push_back(std::move(segment));
+}
+
+void OpMsgBuilder::discardSegmentsFrom(int offset) {
+    while (!_segments.empty() && _segments.back().offset >= offset) {
+        _segments.pop_back();
+    }
+}
+
+int OpMsgBuilder::growForSegments(int objOffset,
+                                  std::vector<MessageSegment>::const_iterator* next,
+                                  std::vector<std::pair<int, int>>* lengths) const {
+    const char* const base = _buf.buf();
+    const BSONObj obj(base + objOffset);
+    int growth = 0;
+    for (auto&& elem : obj) {
+        if (*next == _segments.cend()) {
+            break;
+        }
+
+        const int valueOffset = elem.value() - base;
+        const int elemEnd = elem.rawdata() - base + elem.size();
+        if ((*next)->offset >= elemEnd) {
+            continue;
+        }
+
+        // Placeholders are always whole embedded objects, so anything else containing a segment
+        // means the body was rewritten without discarding the segments in it.
+        invariant(elem.isABSONObj());
+        invariant((*next)->offset >= valueOffset);
+        if ((*next)->offset == valueOffset) {
+            invariant(elem.embeddedObject().objsize() == (*next)->placeholderLen);
+            growth += (*next)->len - (*next)->placeholderLen;
+            ++*next;
+        } else {
+            growth += growForSegments(valueOffset, next, lengths);
+        }
+    }
+
+    if (growth) {
+        lengths->emplace_back(objOffset, obj.objsize() + growth);
+    }
+    return growth;
+}
+
 //message
 Message OpMsgBuilder::finish() {
     if (kDebugBuild && !disableDupeFieldCheck_forTest.load()) {
@@ -276,13 +328,23 @@ Message OpMsgBuilder::finish() {
     invariant(!_openBuilder);
     _state = kDone;
 
-    const auto size = _buf.len();
+    auto size = _buf.len();
+    if (!_segments.empty()) {
+        std::vector<std::pair<int, int>> lengths;
+        auto next = _segments.cbegin();
+        size += growForSegments(_bodyStart, &next, &lengths);
+        invariant(next == _segments.cend());
+        for (auto&& length : lengths) {
+            DataView(_buf.buf()).write<LittleEndian<int32_t>>(length.second, length.first);
+        }
+    }
+
     MSGHEADER::View header(_buf.buf());
     header.setMessageLength(size);
     // header.setRequestMsgId(...); // These are currently filled in by the networking layer.
     // header.setResponseToMsgId(...);
     header.setOpCode(dbMsg);
-    return Message(_buf.release());
+    return Message(_buf.release(), std::move(_segments));
 }
 
 }  // namespace mongo
@@ -171,7 +171,7 @@ struct OpMsgRequest : public OpMsg {
  * body. This allows repeatedly appending fields to the body until right before it is ready to be
  * sent.
  */
-class OpMsgBuilder {
+class OpMsgBuilder final : public MessageSegmentSink {
     MONGO_DISALLOW_COPYING(OpMsgBuilder);
 
 public:
@@ -179,6 +179,29 @@ public:
         skipHeaderAndFlags();
     }
 
+    /**
+     * Allows documents of at least 'minBytes' in the body to be sent from their own buffers, see
+     * MessageSegmentSink. Each such document is represented in the body by an empty object until
+     * finish() fixes up the lengths of the objects enclosing it. Segments are disabled by default
+     * and when 'minBytes' is 0.
+     */
+    void enableSegments(int minBytes) {
+        invariant(minBytes >= 0);
+        _minSegmentBytes = minBytes;
+    }
+
+    bool buildsInto(const BufBuilder& builder) const override {
+        return _minSegmentBytes > 0 && &builder == &_buf;
+    }
+
+    int minSegmentBytes() const override {
+        return _minSegmentBytes;
+    }
+
+    void addSegment(MessageSegment segment) override;
+
+    void discardSegmentsFrom(int offset) override;
+
     /**
      * See the documentation for DocSequenceBuilder below.
      */
@@ -222,6 +245,7 @@ public:
 
         _buf.reset();
         skipHeaderAndFlags();
+        _segments.clear();
         _bodyStart = 0;
         _state = kEmpty;
         _openBuilder = false;
@@ -247,6 +271,15 @@ private:
 
     void finishDocumentStream(DocSequenceBuilder* docSequenceBuilder);
 
+    /**
+     * Walks the object at 'objOffset' and every object nested in it that contains a segment,
+     * starting at '*next'. Records the corrected length of each such object in 'lengths' and
+     * returns how much the segments grow the object at 'objOffset'.
+     */
+    int growForSegments(int objOffset,
+                        std::vector<MessageSegment>::const_iterator* next,
+                        std::vector<std::pair<int, int>>* lengths) const;
+
     void skipHeaderAndFlags() {
         _buf.skip(sizeof(MSGHEADER::Layout));  // This is filled in by finish().
         _buf.appendNum(uint32_t(0));           // flags (currently always 0).
@@ -254,6 +287,8 @@ private:
 
     // When adding members, remember to update reset().
     BufBuilder _buf;
+    std::vector<MessageSegment> _segments;
+    int _minSegmentBytes = 0;
     int _bodyStart = 0;
     State _state = kEmpty;
     bool _openBuilder = false;
@@ -30,7 +30,9 @@
 
 #include "mongo/platform/basic.h"
 
+#include <algorithm>
 #include <type_traits>
+#include <vector>
 
 #include "mongo/base/static_assert.h"
 #include "mongo/bson/json.h"
@@ -824,6 +826,125 @@ TEST(OpMsgSerializer, SetFlagWorks) {
     }
 }
 
+// Appends 'doc' to 'array' as a segment of 'builder', the way CursorResponseBuilder does.
+void appendSegment(OpMsgBuilder* builder, BSONArrayBuilder* array, const BSONObj& doc) {
+    array->append(BSONObj());
+    builder->addSegment({array->len() - BSONObj::kMinBSONLength,
+                         BSONObj::kMinBSONLength,
+                         doc.sharedBuffer(),
+                         doc.objdata(),
+                         doc.objsize()});
+}
+
+TEST(OpMsgSerializer, BodyWithSegments) {
+    const auto first = fromjson("{a: 1, s: 'first'}");
+    const auto last = fromjson("{c: {d: [1, 2, 3]}}");
+
+    OpMsgBuilder builder;
+    builder.enableSegments(1);
+    {
+        auto body = builder.beginBody();
+        {
+            BSONObjBuilder cursor(body.subobjStart("cursor"));
+            {
+                BSONArrayBuilder batch(cursor.subarrayStart("firstBatch"));
+                appendSegment(&builder, &batch, first);
+                batch.append(fromjson("{b: 2}"));
+                appendSegment(&builder, &batch, last);
+            }
+            cursor.append("id", 0LL);
+        }
+        body.append("ok", 1.0);
+    }
+    builder.resumeBody().append("$clusterTime", 5);
+
+    auto msg = builder.finish();
+    ASSERT_FALSE(msg.isContiguous());
+    ASSERT_EQ(msg.segments().size(), 2u);
+
+    // The segments are sent from the documents' own buffers.
+    size_t total = 0;
+    std::vector<const char*> sentFrom;
+    for (const auto& range : msg.buffers()) {
+        total += range.length();
+        sentFrom.push_back(range.data());
+    }
+    ASSERT_EQ(total, static_cast<size_t>(msg.size()));
+    ASSERT(std::find(sentFrom.begin(), sentFrom.end(), first.objdata()) != sentFrom.end());
+    ASSERT(std::find(sentFrom.begin(), sentFrom.end(), last.objdata()) != sentFrom.end());
+
+    msg.makeContiguous();
+    ASSERT_TRUE(msg.isContiguous());
+    testSerializer(msg,
+                   OpMsgBytes{
+                       kNoFlags,  //
+                       kBodySection,
+                       fromjson("{cursor: {firstBatch: [{a: 1, s: 'first'}, {b: 2}, "
+                                "{c: {d: [1, 2, 3]}}], id: {$numberLong: '0'}}, "
+                                "ok: 1.0, $clusterTime: 5}"),
+                   });
+}
+
+TEST(OpMsgSerializer, DiscardedSegmentsAreNotSent) {
+    OpMsgBuilder builder;
+    builder.enableSegments(1);
+    {
+        auto body = builder.beginBody();
+        body.append("ping", 1);
+        const int lenBeforeBatch = body.bb().len();
+        {
+            BSONArrayBuilder batch(body.subarrayStart("batch"));
+            appendSegment(&builder, &batch, fromjson("{a: 1}"));
+        }
+        body.bb().setlen(lenBeforeBatch);
+        builder.discardSegmentsFrom(lenBeforeBatch);
+    }
+
+    auto msg = builder.finish();
+    ASSERT_TRUE(msg.isContiguous());
+    testSerializer(msg,
+                   OpMsgBytes{
+                       kNoFlags,  //
+                       kBodySection,
+                       fromjson("{ping: 1}"),
+                   });
+}
+
+TEST(OpMsgSerializer, ResetDiscardsSegments) {
+    OpMsgBuilder builder;
+    builder.enableSegments(1);
+    {
+        auto body = builder.beginBody();
+        BSONArrayBuilder batch(body.subarrayStart("batch"));
+        appendSegment(&builder, &batch, fromjson("{a: 1}"));
+    }
+
+    builder.reset();
+    builder.beginBody().append("pong", 1);
+
+    auto msg = builder.finish();
+    ASSERT_TRUE(msg.isContiguous());
+    testSerializer(msg,
+                   OpMsgBytes{
+                       kNoFlags,  //
+                       kBodySection,
+                       fromjson("{pong: 1}"),
+                   });
+}
+
+TEST(OpMsgSerializer, SegmentsOnlyApplyToOwnBuffer) {
+    OpMsgBuilder builder;
+    auto body = builder.beginBody();
+    ASSERT_FALSE(builder.buildsInto(body.bb()));
+
+    builder.enableSegments(16);
+    ASSERT_TRUE(builder.buildsInto(body.bb()));
+    ASSERT_EQ(builder.minSegmentBytes(), 16);
+
+    BSONObjBuilder other;
+    ASSERT_FALSE(builder.buildsInto(other.bb()));
+}
+
 TEST(OpMsgRequest, GetDatabaseWorks) {
     OpMsgRequest msg;
     msg.body = fromjson("{$db: 'foo'}");
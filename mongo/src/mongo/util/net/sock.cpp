@@ -39,6 +39,7 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
@@ -612,9 +613,11 @@ void Socket::send(const vector<pair<char*, int>>& data, const char* context) {
     struct msghdr meta;
     memset(&meta, 0, sizeof(meta));
     meta.msg_iov = &d[0];
-    meta.msg_iovlen = d.size();
+    size_t iovRemaining = i;
 
-    while (meta.msg_iovlen > 0) {
+    while (iovRemaining > 0) {
+        // sendmsg() rejects more than IOV_MAX buffers at a time.
+        meta.msg_iovlen = std::min<size_t>(iovRemaining, IOV_MAX);
         int ret = -1;
         if (MONGO_FAIL_POINT(throwSockExcep)) {
 #if defined(_WIN32)
@@ -638,7 +641,7 @@ void Socket::send(const vector<pair<char*, int>>& data, const char* context) {
                 } else {
                     ret -= i->iov_len;
                     ++i;
-                    --(meta.msg_iovlen);
+                    --iovRemaining;
                 }
             }
         }